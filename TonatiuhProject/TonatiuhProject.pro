@@ -24,11 +24,17 @@ tests.CONFIG = recursive
 tests.recurse = tests
 tests.depends = geometry
 
-QMAKE_EXTRA_TARGETS += src plugins tests
+benchmarks.target = benchmarks
+benchmarks.CONFIG = recursive
+benchmarks.recurse = benchmarks
+benchmarks.depends = geometry
+
+QMAKE_EXTRA_TARGETS += src plugins tests benchmarks
 SUBDIRS = geometry \
 		fields \
 		src \
           plugins \
-          tests
+          tests \
+          benchmarks
             
 			
\ No newline at end of file
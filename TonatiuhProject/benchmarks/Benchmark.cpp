@@ -0,0 +1,124 @@
+/***************************************************************************
+ Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+ This file is part of Tonatiuh.
+
+ Tonatiuh program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+ Acknowledgments:
+
+ The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+ then Chair of the Department of Engineering of the University of Texas at
+ Brownsville. From May 2004 to July 2008, it was supported by the Department
+ of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+ the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+ During 2007, NREL also contributed to the validation of Tonatiuh under the
+ framework of the Memorandum of Understanding signed with the Spanish
+ National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+ Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+ direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+ Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+ Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola, Gilda Jimenez,
+ Juana Amieva, Azael Mancillas, Cesar Cantu.
+ ***************************************************************************/
+
+#include <iostream>
+
+#include <QFile>
+#include <QTextStream>
+
+#include "Benchmark.h"
+
+/*!
+ * Creates a recorder that only runs the benchmarks whose "suite/name" contains \a filter.
+ * An empty \a filter runs all the benchmarks.
+ */
+BenchmarkRecorder::BenchmarkRecorder( QString filter )
+:m_filter( filter )
+{
+
+}
+
+/*!
+ * Returns true if the benchmark \a name of the \a suite must be run.
+ */
+bool BenchmarkRecorder::IsEnabled( QString suite, QString name ) const
+{
+	if( m_filter.isEmpty() )	return true;
+	return QString( "%1/%2" ).arg( suite, name ).contains( m_filter, Qt::CaseInsensitive );
+}
+
+/*!
+ * Returns the results recorded up to now.
+ */
+QVector< BenchmarkResult > BenchmarkRecorder::Results() const
+{
+	return m_results;
+}
+
+/*!
+ * Starts the measure of a benchmark.
+ */
+void BenchmarkRecorder::Start()
+{
+	m_timer.start();
+}
+
+/*!
+ * Finishes the measure started with Start() and stores it as the benchmark \a name of the \a suite.
+ */
+void BenchmarkRecorder::Stop( QString suite, QString name, unsigned long items, double checksum )
+{
+	BenchmarkResult result;
+	result.suite = suite;
+	result.name = name;
+	result.items = items;
+	result.elapsedSeconds = m_timer.nsecsElapsed() * 1.0e-9;
+	result.checksum = checksum;
+	m_results.push_back( result );
+
+	double nsPerItem = ( items > 0 ) ? result.elapsedSeconds * 1.0e9 / items : 0.0;
+	std::cout << suite.toStdString() << "/" << name.toStdString() << ": "
+			<< result.elapsedSeconds << " s, "
+			<< nsPerItem << " ns/item" << std::endl;
+}
+
+/*!
+ * Saves the results in \a fileName as tab separated values, one benchmark per line.
+ * Returns false if the file cannot be written.
+ */
+bool BenchmarkRecorder::WriteResults( QString fileName ) const
+{
+	QFile resultsFile( fileName );
+	if( !resultsFile.open( QIODevice::WriteOnly | QIODevice::Text ) )	return false;
+
+	QTextStream out( &resultsFile );
+	out.setRealNumberPrecision( 10 );
+	out << "version\tsuite\tname\titems\tseconds\titemsPerSecond\tnsPerItem\tchecksum\n";
+	for( int r = 0; r < m_results.size(); ++r )
+	{
+		const BenchmarkResult& result = m_results[r];
+		double itemsPerSecond = ( result.elapsedSeconds > 0 ) ? result.items / result.elapsedSeconds : 0.0;
+		double nsPerItem = ( result.items > 0 ) ? result.elapsedSeconds * 1.0e9 / result.items : 0.0;
+		out << APP_VERSION << "\t" << result.suite << "\t" << result.name << "\t"
+			<< result.items << "\t" << result.elapsedSeconds << "\t"
+			<< itemsPerSecond << "\t" << nsPerItem << "\t" << result.checksum << "\n";
+	}
+
+	resultsFile.close();
+	return true;
+}
@@ -0,0 +1,136 @@
+/***************************************************************************
+ Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+ This file is part of Tonatiuh.
+
+ Tonatiuh program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+ Acknowledgments:
+
+ The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+ then Chair of the Department of Engineering of the University of Texas at
+ Brownsville. From May 2004 to July 2008, it was supported by the Department
+ of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+ the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+ During 2007, NREL also contributed to the validation of Tonatiuh under the
+ framework of the Memorandum of Understanding signed with the Spanish
+ National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+ Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+ direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+ Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+ Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola, Gilda Jimenez,
+ Juana Amieva, Azael Mancillas, Cesar Cantu.
+ ***************************************************************************/
+
+#include <stdlib.h>
+#include <vector>
+
+#include "BBox.h"
+#include "Benchmark.h"
+#include "gc.h"
+#include "Point3D.h"
+#include "Ray.h"
+#include "TestsAuxiliaryFunctions.h"
+#include "Transform.h"
+#include "Vector3D.h"
+
+namespace
+{
+	const unsigned long numberOfSamples = 1000000;
+	const unsigned int seed = 12345;
+}
+
+/*!
+ * Measures the ray-box intersection and the application of transforms to points, vectors and rays.
+ */
+void tbm::RunGeometryBenchmarks( BenchmarkRecorder& recorder )
+{
+	const QString suite( "Geometry" );
+
+	srand( seed );
+	std::vector< Ray > rays;
+	rays.reserve( numberOfSamples );
+	for( unsigned long r = 0; r < numberOfSamples; ++r )
+		rays.push_back( taf::randomRay( -10.0, 10.0 ) );
+
+	BBox box( Point3D( -1.0, -1.0, -1.0 ), Point3D( 1.0, 1.0, 1.0 ) );
+	Transform transform = Translate( 1.0, 2.0, 3.0 ) * RotateY( 0.3 ) * RotateX( 0.7 );
+
+	if( recorder.IsEnabled( suite, "BBoxIntersectP" ) )
+	{
+		double hits = 0;
+		recorder.Start();
+		for( unsigned long r = 0; r < numberOfSamples; ++r )
+		{
+			double t0, t1;
+			if( box.IntersectP( rays[r], &t0, &t1 ) )	hits += t0;
+		}
+		recorder.Stop( suite, "BBoxIntersectP", numberOfSamples, hits );
+	}
+
+	if( recorder.IsEnabled( suite, "TransformPoint" ) )
+	{
+		double sum = 0;
+		recorder.Start();
+		for( unsigned long r = 0; r < numberOfSamples; ++r )
+		{
+			Point3D point;
+			transform( rays[r].origin, point );
+			sum += point.x;
+		}
+		recorder.Stop( suite, "TransformPoint", numberOfSamples, sum );
+	}
+
+	if( recorder.IsEnabled( suite, "TransformVector" ) )
+	{
+		double sum = 0;
+		recorder.Start();
+		for( unsigned long r = 0; r < numberOfSamples; ++r )
+		{
+			Vector3D vector;
+			transform( rays[r].direction(), vector );
+			sum += vector.y;
+		}
+		recorder.Stop( suite, "TransformVector", numberOfSamples, sum );
+	}
+
+	if( recorder.IsEnabled( suite, "TransformRay" ) )
+	{
+		double sum = 0;
+		recorder.Start();
+		for( unsigned long r = 0; r < numberOfSamples; ++r )
+		{
+			Ray ray;
+			transform( rays[r], ray );
+			sum += ray.origin.z;
+		}
+		recorder.Stop( suite, "TransformRay", numberOfSamples, sum );
+	}
+
+	if( recorder.IsEnabled( suite, "TransformBBox" ) )
+	{
+		double sum = 0;
+		recorder.Start();
+		for( unsigned long r = 0; r < numberOfSamples; ++r )
+		{
+			BBox transformedBox;
+			transform( BBox( rays[r].origin ), transformedBox );
+			sum += transformedBox.pMax.x;
+		}
+		recorder.Stop( suite, "TransformBBox", numberOfSamples, sum );
+	}
+}
@@ -0,0 +1,280 @@
+/***************************************************************************
+ Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+ This file is part of Tonatiuh.
+
+ Tonatiuh program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+ Acknowledgments:
+
+ The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+ then Chair of the Department of Engineering of the University of Texas at
+ Brownsville. From May 2004 to July 2008, it was supported by the Department
+ of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+ the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+ During 2007, NREL also contributed to the validation of Tonatiuh under the
+ framework of the Memorandum of Understanding signed with the Spanish
+ National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+ Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+ direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+ Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+ Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola, Gilda Jimenez,
+ Juana Amieva, Azael Mancillas, Cesar Cantu.
+ ***************************************************************************/
+
+#include <cmath>
+#include <iostream>
+#include <stdlib.h>
+#include <vector>
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QVariant>
+#include <QVector>
+
+#include "BBox.h"
+#include "Benchmark.h"
+#include "BVH.h"
+#include "DifferentialGeometry.h"
+#include "gc.h"
+#include "MeshLoader.h"
+#include "NormalVector.h"
+#include "PluginManager.h"
+#include "Point3D.h"
+#include "Ray.h"
+#include "TestsAuxiliaryFunctions.h"
+#include "Triangle.h"
+#include "TShape.h"
+#include "TShapeFactory.h"
+#include "Vector3D.h"
+
+namespace
+{
+	const unsigned long numberOfRays = 200000;
+	const unsigned int seed = 12345;
+	const unsigned long numbersOfTriangles[] = { 100000, 1000000 };
+
+	/*!
+	 * Generates a rippled parabolic dish of 10x10 m with about \a numberOfTriangles triangles as an indexed mesh,
+	 * like the meshes of the facets exported from CAD tools.
+	 */
+	void GenerateMesh( unsigned long numberOfTriangles, std::vector< float >* vertices, std::vector< unsigned int >* indices )
+	{
+		unsigned long gridSize = (unsigned long) sqrt( numberOfTriangles / 2.0 ) + 1;
+		vertices->clear();
+		indices->clear();
+		vertices->reserve( 3 * gridSize * gridSize );
+		indices->reserve( 6 * ( gridSize - 1 ) * ( gridSize - 1 ) );
+
+		for( unsigned long i = 0; i < gridSize; ++i )
+		{
+			for( unsigned long j = 0; j < gridSize; ++j )
+			{
+				double x = 10.0 * i / ( gridSize - 1 ) - 5.0;
+				double y = 10.0 * j / ( gridSize - 1 ) - 5.0;
+				double z = ( x * x + y * y ) / 40.0 + 0.005 * sin( 7.0 * x ) * cos( 5.0 * y );
+				vertices->push_back( float( x ) );
+				vertices->push_back( float( z ) );
+				vertices->push_back( float( y ) );
+			}
+		}
+
+		for( unsigned long i = 0; i + 1 < gridSize; ++i )
+		{
+			for( unsigned long j = 0; j + 1 < gridSize; ++j )
+			{
+				unsigned int v = (unsigned int) ( i * gridSize + j );
+				indices->push_back( v );
+				indices->push_back( v + 1 );
+				indices->push_back( v + gridSize );
+				indices->push_back( v + 1 );
+				indices->push_back( v + gridSize + 1 );
+				indices->push_back( v + gridSize );
+			}
+		}
+	}
+
+	/*!
+	 * Returns the triangles of the indexed mesh defined by \a vertices and \a indices, as ShapeCAD builds them.
+	 */
+	std::vector< Triangle > MeshTriangles( const std::vector< float >& vertices, const std::vector< unsigned int >& indices )
+	{
+		std::vector< Triangle > triangles;
+		triangles.reserve( indices.size() / 3 );
+		for( unsigned long t = 0; t < indices.size(); t += 3 )
+		{
+			Point3D v1( vertices[3 * indices[t]], vertices[3 * indices[t] + 1], vertices[3 * indices[t] + 2] );
+			Point3D v2( vertices[3 * indices[t + 1]], vertices[3 * indices[t + 1] + 1], vertices[3 * indices[t + 1] + 2] );
+			Point3D v3( vertices[3 * indices[t + 2]], vertices[3 * indices[t + 2] + 1], vertices[3 * indices[t + 2] + 2] );
+
+			NormalVector normal;
+			Vector3D normalVector = CrossProduct( Vector3D( v2 - v1 ), Vector3D( v3 - v1 ) );
+			if( normalVector.length() > 0.0 )	normal = NormalVector( Normalize( normalVector ) );
+			triangles.push_back( Triangle( v1, v2, v3, normal ) );
+		}
+		return triangles;
+	}
+
+	/*!
+	 * Writes the indexed mesh defined by \a vertices and \a indices to \a fileName as a binary STL file.
+	 */
+	bool WriteBinarySTL( QString fileName, const std::vector< float >& vertices, const std::vector< unsigned int >& indices )
+	{
+		QFile stlFile( fileName );
+		if( !stlFile.open( QIODevice::WriteOnly | QIODevice::Truncate ) )	return false;
+
+		QDataStream out( &stlFile );
+		out.setByteOrder( QDataStream::LittleEndian );
+		out.setFloatingPointPrecision( QDataStream::SinglePrecision );
+
+		QByteArray header( 80, ' ' );
+		header.replace( 0, 18, "TonatiuhBenchmark " );
+		out.writeRawData( header.constData(), header.size() );
+		out<<quint32( indices.size() / 3 );
+
+		for( unsigned long t = 0; t < indices.size(); t += 3 )
+		{
+			out<<0.0f<<0.0f<<0.0f;
+			for( int c = 0; c < 3; ++c )
+				out<<vertices[3 * indices[t + c]]<<vertices[3 * indices[t + c] + 1]<<vertices[3 * indices[t + c] + 2];
+			out<<quint16( 0 );
+		}
+		stlFile.close();
+		return ( out.status() == QDataStream::Ok );
+	}
+
+	/*!
+	 * Returns \a numberOfRays rays that point to random points of the \a box.
+	 */
+	std::vector< Ray > RaysToBox( const BBox& box, unsigned long numberOfRays )
+	{
+		Point3D center;
+		double radius;
+		box.BoundingSphere( center, radius );
+		if( radius <= 0 )	radius = 1.0;
+
+		srand( seed );
+		std::vector< Ray > rays;
+		rays.reserve( numberOfRays );
+		for( unsigned long r = 0; r < numberOfRays; ++r )
+		{
+			Point3D target( taf::randomNumber( box.pMin.x, box.pMax.x ),
+					taf::randomNumber( box.pMin.y, box.pMax.y ),
+					taf::randomNumber( box.pMin.z, box.pMax.z ) );
+			Vector3D direction = taf::randomDirection();
+			rays.push_back( Ray( target - 2 * radius * direction, direction ) );
+		}
+		return rays;
+	}
+}
+
+/*!
+ * Measures the triangle meshes of the CAD shapes on generated meshes of 10^5 and 10^6 triangles: the build of
+ * the bounding volume hierarchy, its restore from the node data saved with the scene, the ray intersection with
+ * the hierarchy, the load of the mesh from a binary STL file and the intersection of a CAD shape created with
+ * the loaded file.
+ */
+void tbm::RunMeshBenchmarks( BenchmarkRecorder& recorder, const PluginManager& pluginManager )
+{
+	TShapeFactory* cadFactory = 0;
+	QVector< TShapeFactory* > shapeFactoryList = pluginManager.GetShapeFactories();
+	for( int s = 0; s < shapeFactoryList.size(); ++s )
+		if( shapeFactoryList[s]->TShapeName() == QLatin1String( "CAD_Shape" ) )	cadFactory = shapeFactoryList[s];
+
+	QDir exportDirectory = QDir::temp();
+	QString stlFileName = exportDirectory.absoluteFilePath( "TonatiuhBenchmarkMesh.stl" );
+
+	for( unsigned int m = 0; m < sizeof( numbersOfTriangles ) / sizeof( numbersOfTriangles[0] ); ++m )
+	{
+		std::vector< float > vertices;
+		std::vector< unsigned int > indices;
+		GenerateMesh( numbersOfTriangles[m], &vertices, &indices );
+		unsigned long nTriangles = indices.size() / 3;
+
+		bool buildEnabled = recorder.IsEnabled( "BVH", QString( "Build%1" ).arg( nTriangles ) );
+		bool restoreEnabled = recorder.IsEnabled( "BVH", QString( "Restore%1" ).arg( nTriangles ) );
+		bool intersectEnabled = recorder.IsEnabled( "BVH", QString( "Intersect%1" ).arg( nTriangles ) );
+		if( buildEnabled || restoreEnabled || intersectEnabled )
+		{
+			std::vector< Triangle > triangles = MeshTriangles( vertices, indices );
+			recorder.Start();
+			BVH bvh( &triangles );
+			std::vector< int > nodeData;
+			std::vector< BBox > nodeBounds;
+			bvh.GetNodeData( &nodeData, &nodeBounds );
+			if( buildEnabled )	recorder.Stop( "BVH", QString( "Build%1" ).arg( nTriangles ), nTriangles, double( nodeBounds.size() ) );
+
+			if( restoreEnabled )
+			{
+				recorder.Start();
+				BVH restoredBVH( &triangles, nodeData, nodeBounds );
+				recorder.Stop( "BVH", QString( "Restore%1" ).arg( nTriangles ), nTriangles, restoredBVH.IsValid() ? 1 : 0 );
+			}
+
+			if( intersectEnabled )
+			{
+				std::vector< Ray > rays = RaysToBox( bvh.GetBBox(), numberOfRays );
+				double hits = 0;
+				recorder.Start();
+				for( unsigned long r = 0; r < rays.size(); ++r )
+				{
+					double tHit = gc::Infinity;
+					DifferentialGeometry dg;
+					if( bvh.Intersect( rays[r], &tHit, &dg ) )	hits += tHit;
+				}
+				recorder.Stop( "BVH", QString( "Intersect%1" ).arg( nTriangles ), rays.size(), hits );
+			}
+		}
+
+		bool loadEnabled = recorder.IsEnabled( "MeshLoader", QString( "BinarySTL%1" ).arg( nTriangles ) );
+		bool shapeEnabled = cadFactory && recorder.IsEnabled( "ShapeIntersect", QString( "CAD_Shape%1" ).arg( nTriangles ) );
+		if( !( loadEnabled || shapeEnabled ) || !WriteBinarySTL( stlFileName, vertices, indices ) )	continue;
+
+		if( loadEnabled )
+		{
+			MeshLoader loader;
+			recorder.Start();
+			bool loaded = loader.Load( stlFileName );
+			recorder.Stop( "MeshLoader", QString( "BinarySTL%1" ).arg( nTriangles ), nTriangles, loaded ? loader.GetNumberOfVertices() : 0 );
+			if( loaded )	std::cout << "  " << loader.GetReport().toStdString() << std::endl;
+		}
+
+		if( shapeEnabled )
+		{
+			QVector< QVariant > parametersList;
+			parametersList << stlFileName;
+			TShape* shape = cadFactory->CreateTShape( parametersList.size(), parametersList );
+			if( shape )
+			{
+				shape->ref();
+				std::vector< Ray > shapeRays = RaysToBox( shape->GetBBox(), numberOfRays );
+				double hits = 0;
+				recorder.Start();
+				for( unsigned long r = 0; r < shapeRays.size(); ++r )
+				{
+					double tHit = 0.0;
+					DifferentialGeometry dg;
+					if( shape->Intersect( shapeRays[r], &tHit, &dg ) )	hits += tHit;
+				}
+				recorder.Stop( "ShapeIntersect", QString( "CAD_Shape%1" ).arg( nTriangles ), shapeRays.size(), hits );
+				shape->unref();
+			}
+		}
+	}
+	exportDirectory.remove( "TonatiuhBenchmarkMesh.stl" );
+}
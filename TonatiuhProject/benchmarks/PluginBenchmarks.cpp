@@ -0,0 +1,399 @@
+/***************************************************************************
+ Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+ This file is part of Tonatiuh.
+
+ Tonatiuh program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+ Acknowledgments:
+
+ The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+ then Chair of the Department of Engineering of the University of Texas at
+ Brownsville. From May 2004 to July 2008, it was supported by the Department
+ of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+ the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+ During 2007, NREL also contributed to the validation of Tonatiuh under the
+ framework of the Memorandum of Understanding signed with the Spanish
+ National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+ Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+ direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+ Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+ Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola, Gilda Jimenez,
+ Juana Amieva, Azael Mancillas, Cesar Cantu.
+ ***************************************************************************/
+
+#include <cmath>
+#include <stdlib.h>
+#include <vector>
+
+#include <QDir>
+#include <QFile>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+
+#include <Inventor/fields/SoField.h>
+#include <Inventor/nodekits/SoNodeKitListPart.h>
+
+#include "BBox.h"
+#include "Benchmark.h"
+#include "DifferentialGeometry.h"
+#include "gc.h"
+#include "InstanceNode.h"
+#include "NormalVector.h"
+#include "Photon.h"
+#include "PhotonMapExport.h"
+#include "PhotonMapExportFactory.h"
+#include "PhotonSurfaceIndex.h"
+#include "PluginManager.h"
+#include "Point3D.h"
+#include "RandomDeviate.h"
+#include "RandomDeviateFactory.h"
+#include "Ray.h"
+#include "TComponentFactory.h"
+#include "TestsAuxiliaryFunctions.h"
+#include "TMaterial.h"
+#include "TMaterialFactory.h"
+#include "TShape.h"
+#include "TShapeFactory.h"
+#include "TSunShape.h"
+#include "TSunShapeFactory.h"
+#include "TSeparatorKit.h"
+#include "TShapeKit.h"
+#include "Vector3D.h"
+
+namespace
+{
+	const unsigned long numberOfRays = 200000;
+	const unsigned long numberOfRandomNumbers = 10000000;
+	const unsigned long numberOfPhotons = 1000000;
+	const int numberOfPhotonSurfaces = 100;
+	const unsigned int seed = 12345;
+	const unsigned long numbersOfHeliostats[] = { 10000, 50000, 100000 };
+	const unsigned long numbersOfSamples[] = { 1024, 16384, 262144 };
+
+	/*!
+	 * Returns the relative error of the estimate, with the first \a numberOfSamples sample points of \a rand,
+	 * of the area of a disk of radius 0.3 in the unit square. The point is displaced by a tenth of a second
+	 * point before wrapping it in the square, so the estimate takes the sample dimensions 1 to 4 like
+	 * the position of a primary ray and the first dimensions of its direction.
+	 */
+	double DiskAreaError( RandomDeviate& rand, unsigned long numberOfSamples )
+	{
+		const double radius = 0.3;
+		unsigned long inside = 0;
+		for( unsigned long s = 0; s < numberOfSamples; ++s )
+		{
+			double u = rand.Sample( s, 1 ) + 0.1 * rand.Sample( s, 3 );
+			double v = rand.Sample( s, 2 ) + 0.1 * rand.Sample( s, 4 );
+			double x = u - floor( u ) - 0.5;
+			double y = v - floor( v ) - 0.5;
+			if( x * x + y * y < radius * radius )	++inside;
+		}
+
+		double area = gc::Pi * radius * radius;
+		return ( fabs( double( inside ) / numberOfSamples - area ) / area );
+	}
+
+	/*!
+	 * Returns \a numberOfRays rays, in \a shape coordinates, that point to the bounding box of the \a shape.
+	 */
+	std::vector< Ray > RaysToShape( const TShape& shape, unsigned long numberOfRays )
+	{
+		std::vector< Ray > rays;
+		BBox box = shape.GetBBox();
+		if( ( box.pMin.x > box.pMax.x ) || ( box.pMin.y > box.pMax.y ) || ( box.pMin.z > box.pMax.z ) )	return rays;
+
+		Point3D center;
+		double radius;
+		box.BoundingSphere( center, radius );
+		if( radius <= 0 )	radius = 1.0;
+
+		srand( seed );
+		rays.reserve( numberOfRays );
+		for( unsigned long r = 0; r < numberOfRays; ++r )
+		{
+			Point3D target( taf::randomNumber( box.pMin.x, box.pMax.x ),
+					taf::randomNumber( box.pMin.y, box.pMax.y ),
+					taf::randomNumber( box.pMin.z, box.pMax.z ) );
+			Vector3D direction = taf::randomDirection();
+			rays.push_back( Ray( target - 2 * radius * direction, direction ) );
+		}
+		return rays;
+	}
+
+	/*!
+	 * Writes to \a fileName the coordinates of \a numberOfHeliostats heliostats placed in a square grid.
+	 */
+	bool WriteHeliostatCoordinates( QString fileName, unsigned long numberOfHeliostats )
+	{
+		QFile coordinatesFile( fileName );
+		if( !coordinatesFile.open( QIODevice::WriteOnly ) )	return false;
+
+		unsigned long rowSize = 1;
+		while( rowSize * rowSize < numberOfHeliostats )	++rowSize;
+
+		QByteArray coordinates;
+		for( unsigned long h = 0; h < numberOfHeliostats; ++h )
+		{
+			coordinates += QByteArray::number( 15.0 * ( h % rowSize ) - 7.5 * rowSize );
+			coordinates += "\t0\t";
+			coordinates += QByteArray::number( 15.0 * ( h / rowSize ) + 100.0 );
+			coordinates += "\n";
+		}
+		coordinatesFile.write( coordinates );
+		coordinatesFile.close();
+		return true;
+	}
+
+	/*!
+	 * Sets the reflectivity of the \a material to one, whatever the name of its field, so that
+	 * OutputRay computes an output ray instead of absorbing the ray.
+	 */
+	void SetFullReflectivity( TMaterial* material )
+	{
+		QStringList reflectivityFields;
+		reflectivityFields << "m_reflectivity" << "reflectivity" << "reflectivityFront" << "reflectivityBack";
+		for( int f = 0; f < reflectivityFields.count(); ++f )
+		{
+			SoField* field = material->getField( reflectivityFields[f].toLatin1().data() );
+			if( field ) field->set( "1" );
+		}
+	}
+}
+
+/*!
+ * Measures the hot kernels of the loaded plugins: the intersection of each shape, the generation of random
+ * numbers, the output ray of each material, the sampling of each sunshape, the photon map exports and
+ * the generation of heliostat fields.
+ *
+ * The shapes defined by a file, as the CAD shape, are measured by RunMeshBenchmarks with a generated mesh.
+ * The exported photons hit the surfaces of a field, so the exports serialize the surfaces of the photons.
+ *
+ * The SamplingConvergence suite compares the random generators as samplers: its checksum is the relative
+ * error of an area estimated with an increasing number of sample points.
+ */
+void tbm::RunPluginBenchmarks( BenchmarkRecorder& recorder, const PluginManager& pluginManager )
+{
+	QVector< RandomDeviateFactory* > randomDeviateFactoryList = pluginManager.GetRandomDeviateFactories();
+	for( int r = 0; r < randomDeviateFactoryList.size(); ++r )
+	{
+		QString name = randomDeviateFactoryList[r]->RandomDeviateName();
+		if( !recorder.IsEnabled( "RandomDeviate", name ) )	continue;
+
+		RandomDeviate* randomDeviate = randomDeviateFactoryList[r]->CreateRandomDeviate();
+		std::vector< double > numbers( numberOfRandomNumbers );
+
+		recorder.Start();
+		randomDeviate->FillArray( &numbers[0], numberOfRandomNumbers );
+		recorder.Stop( "RandomDeviate", name, numberOfRandomNumbers, numbers[numberOfRandomNumbers - 1] );
+
+		delete randomDeviate;
+	}
+
+	for( int r = 0; r < randomDeviateFactoryList.size(); ++r )
+	{
+		for( unsigned int n = 0; n < sizeof( numbersOfSamples ) / sizeof( numbersOfSamples[0] ); ++n )
+		{
+			unsigned long numberOfSamples = numbersOfSamples[n];
+			QString name = QString( "%1 %2" ).arg( randomDeviateFactoryList[r]->RandomDeviateName() ).arg( numberOfSamples );
+			if( !recorder.IsEnabled( "SamplingConvergence", name ) )	continue;
+
+			RandomDeviate* randomDeviate = randomDeviateFactoryList[r]->CreateRandomDeviate( seed, 0 );
+			recorder.Start();
+			double error = DiskAreaError( *randomDeviate, numberOfSamples );
+			recorder.Stop( "SamplingConvergence", name, numberOfSamples, error );
+			delete randomDeviate;
+		}
+	}
+
+	//Materials and sunshapes need a random generator to sample their distributions
+	if( randomDeviateFactoryList.size() < 1 )	return;
+	RandomDeviate* rand = randomDeviateFactoryList[0]->CreateRandomDeviate();
+
+	QVector< TShapeFactory* > shapeFactoryList = pluginManager.GetShapeFactories();
+	for( int s = 0; s < shapeFactoryList.size(); ++s )
+	{
+		QString name = shapeFactoryList[s]->TShapeName();
+		if( !recorder.IsEnabled( "ShapeIntersect", name ) )	continue;
+
+		//The shapes defined by a file are measured with a generated mesh in RunMeshBenchmarks
+		if( ( name == QLatin1String( "CAD_Shape" ) ) || ( name == QLatin1String( "Bezier_Patch" ) ) )	continue;
+
+		TShape* shape = shapeFactoryList[s]->CreateTShape();
+		shape->ref();
+
+		std::vector< Ray > rays = RaysToShape( *shape, numberOfRays );
+		if( rays.size() > 0 )
+		{
+			double hits = 0;
+			recorder.Start();
+			for( unsigned long r = 0; r < rays.size(); ++r )
+			{
+				double tHit = 0.0;
+				DifferentialGeometry dg;
+				if( shape->Intersect( rays[r], &tHit, &dg ) )	hits += tHit;
+			}
+			recorder.Stop( "ShapeIntersect", name, rays.size(), hits );
+		}
+		shape->unref();
+	}
+
+	QVector< TMaterialFactory* > materialFactoryList = pluginManager.GetMaterialFactories();
+	for( int m = 0; m < materialFactoryList.size(); ++m )
+	{
+		QString name = materialFactoryList[m]->TMaterialName();
+		if( !recorder.IsEnabled( "MaterialOutputRay", name ) )	continue;
+
+		TMaterial* material = materialFactoryList[m]->CreateTMaterial();
+		material->ref();
+		SetFullReflectivity( material );
+
+		DifferentialGeometry dg;
+		dg.point = Point3D( 0.0, 0.0, 0.0 );
+		dg.normal = NormalVector( 0.0, 1.0, 0.0 );
+		dg.shapeFrontSide = true;
+		Ray incident( Point3D( 0.0, 1.0, 0.0 ), Normalize( Vector3D( 0.1, -1.0, 0.05 ) ) );
+
+		double sum = 0;
+		recorder.Start();
+		for( unsigned long r = 0; r < numberOfRays; ++r )
+		{
+			Ray outputRay;
+			if( material->OutputRay( incident, &dg, *rand, &outputRay ) )	sum += outputRay.direction().y;
+		}
+		recorder.Stop( "MaterialOutputRay", name, numberOfRays, sum );
+		material->unref();
+	}
+
+	QVector< TSunShapeFactory* > sunShapeFactoryList = pluginManager.GetSunShapeFactories();
+	for( int s = 0; s < sunShapeFactoryList.size(); ++s )
+	{
+		QString name = sunShapeFactoryList[s]->TSunShapeName();
+		if( !recorder.IsEnabled( "SunShapeSampling", name ) )	continue;
+
+		TSunShape* sunShape = sunShapeFactoryList[s]->CreateTSunShape();
+		sunShape->ref();
+
+		double sum = 0;
+		recorder.Start();
+		for( unsigned long r = 0; r < numberOfRays; ++r )
+		{
+			Vector3D direction;
+			sunShape->GenerateRayDirection( direction, *rand );
+			sum += direction.x;
+		}
+		recorder.Stop( "SunShapeSampling", name, numberOfRays, sum );
+		sunShape->unref();
+	}
+	delete rand;
+
+	//The photons hit the surfaces of a field like the traced ones: an incoming photon, a reflection and the absorption
+	TSeparatorKit* photonsRoot = new TSeparatorKit;
+	photonsRoot->ref();
+	photonsRoot->setName( "RootNode" );
+	InstanceNode* photonsRootInstance = new InstanceNode( photonsRoot );
+	SoNodeKitListPart* photonsChildList = static_cast< SoNodeKitListPart* >( photonsRoot->getPart( "childList", true ) );
+	for( int s = 0; s < numberOfPhotonSurfaces; ++s )
+	{
+		TShapeKit* surfaceKit = new TShapeKit;
+		surfaceKit->setName( QString( "Heliostat_%1" ).arg( s ).toStdString().c_str() );
+		photonsChildList->addChild( surfaceKit );
+		photonsRootInstance->AddChild( new InstanceNode( surfaceKit ) );
+	}
+	PhotonSurfaceIndex surfaceIndex;
+	surfaceIndex.AddSurfaces( photonsRootInstance );
+
+	std::vector< Photon* > photons;
+	photons.reserve( numberOfPhotons );
+	srand( seed );
+	for( unsigned long p = 0; p < numberOfPhotons; ++p )
+	{
+		InstanceNode* surface = photonsRootInstance->children[( p / 3 ) % numberOfPhotonSurfaces];
+		Photon* photon = new Photon( taf::randomPoint( -10.0, 10.0 ), 1, double( p % 3 ), ( p % 3 ) ? surface : 0, ( p % 3 ) == 1 );
+		photon->surfaceId = ( p % 3 ) ? surfaceIndex.SurfaceId( surface ) : 0;
+		photons.push_back( photon );
+	}
+
+	QDir exportDirectory = QDir::temp();
+	QVector< PhotonMapExportFactory* > exportFactoryList = pluginManager.GetExportPMModeFactories();
+	for( int e = 0; e < exportFactoryList.size(); ++e )
+	{
+		QString name = exportFactoryList[e]->GetName();
+		if( !recorder.IsEnabled( "SavePhotonMap", name ) )	continue;
+
+		PhotonMapExport* exportMode = exportFactoryList[e]->GetExportPhotonMapMode();
+		if( !exportMode )	continue;
+
+		exportMode->SetSaveCoordinatesEnabled( true );
+		exportMode->SetSaveSideEnabled( true );
+		exportMode->SetSaveSurfacesIDEnabled( true );
+		exportMode->SetSaveParameterValue( "ExportDirectory", exportDirectory.absolutePath() );
+		exportMode->SetSaveParameterValue( "ExportFile", "TonatiuhBenchmark" );
+		exportMode->SetSaveParameterValue( "DBFilename", "TonatiuhBenchmark" );
+		exportMode->SetPowerPerPhoton( 1.0 );
+		if( exportMode->StartExport() )
+		{
+			recorder.Start();
+			exportMode->SavePhotonMap( photons );
+			exportMode->EndExport();
+			recorder.Stop( "SavePhotonMap", name, numberOfPhotons, 0 );
+		}
+		delete exportMode;
+	}
+
+	exportDirectory.remove( "TonatiuhBenchmark.dat" );
+	exportDirectory.remove( "TonatiuhBenchmark.db" );
+	for( unsigned long p = 0; p < numberOfPhotons; ++p )
+		delete photons[p];
+	delete photonsRootInstance;
+	photonsRoot->unref();
+
+	TComponentFactory* fieldFactory = 0;
+	QVector< TComponentFactory* > componentFactoryList = pluginManager.GetComponentFactories();
+	for( int c = 0; c < componentFactoryList.size(); ++c )
+		if( componentFactoryList[c]->TComponentName() == QLatin1String( "Heliostat_Field_Component" ) )
+			fieldFactory = componentFactoryList[c];
+	if( !fieldFactory )	return;
+
+	QString coordinatesFileName = exportDirectory.absoluteFilePath( "TonatiuhBenchmarkField.txt" );
+	for( unsigned int f = 0; f < sizeof( numbersOfHeliostats ) / sizeof( numbersOfHeliostats[0] ); ++f )
+	{
+		unsigned long numberOfHeliostats = numbersOfHeliostats[f];
+		QString name = QString( "HeliostatField%1" ).arg( numberOfHeliostats );
+		if( !recorder.IsEnabled( "Component", name ) )	continue;
+		if( !WriteHeliostatCoordinates( coordinatesFileName, numberOfHeliostats ) )	continue;
+
+		//Flat 10x10 heliostats aiming at a fixed point
+		QVector< QVariant > parametersList;
+		parametersList << coordinatesFileName << QString() << QString( "Flat_Rectangle" )
+				<< 10.0 << 10.0 << -1.0 << 0.9 << 1.0
+				<< 3 << QString() << 0.0 << 0.0
+				<< 0.0 << 120.0 << 0.0;
+
+		recorder.Start();
+		TSeparatorKit* field = fieldFactory->CreateTComponent( const_cast< PluginManager* >( &pluginManager ), parametersList.size(), parametersList );
+		recorder.Stop( "Component", name, numberOfHeliostats, field ? 1 : 0 );
+
+		if( field )
+		{
+			field->ref();
+			field->unref();
+		}
+	}
+	exportDirectory.remove( "TonatiuhBenchmarkField.txt" );
+}
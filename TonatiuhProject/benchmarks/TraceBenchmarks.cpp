@@ -0,0 +1,392 @@
+/***************************************************************************
+ Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+ This file is part of Tonatiuh.
+
+ Tonatiuh program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+ Acknowledgments:
+
+ The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+ then Chair of the Department of Engineering of the University of Texas at
+ Brownsville. From May 2004 to July 2008, it was supported by the Department
+ of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+ the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+ During 2007, NREL also contributed to the validation of Tonatiuh under the
+ framework of the Memorandum of Understanding signed with the Spanish
+ National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+ Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+ direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+ Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+ Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola, Gilda Jimenez,
+ Juana Amieva, Azael Mancillas, Cesar Cantu.
+ ***************************************************************************/
+
+#include <cmath>
+
+#include <QDir>
+#include <QFileInfo>
+#include <QFuture>
+#include <QMutex>
+#include <QPair>
+#include <QStringList>
+#include <QThread>
+#include <QtConcurrentMap>
+
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/actions/SoWriteAction.h>
+#include <Inventor/fields/SoField.h>
+#include <Inventor/nodekits/SoNodeKitListPart.h>
+#include <Inventor/nodes/SoTransform.h>
+
+#include "BBox.h"
+#include "Benchmark.h"
+#include "Document.h"
+#include "gc.h"
+#include "InstanceNode.h"
+#include "Matrix4x4.h"
+#include "PluginManager.h"
+#include "RandomDeviate.h"
+#include "RandomDeviateFactory.h"
+#include "RayTracer.h"
+#include "RayTracerNoTr.h"
+#include "RayTracingScheduler.h"
+#include "SceneModel.h"
+#include "tgf.h"
+#include "TLightKit.h"
+#include "TLightShape.h"
+#include "TMaterial.h"
+#include "TMaterialFactory.h"
+#include "TPhotonMap.h"
+#include "Transform.h"
+#include "trf.h"
+#include "TSceneKit.h"
+#include "TSceneTracker.h"
+#include "TSeparatorKit.h"
+#include "TShape.h"
+#include "TShapeFactory.h"
+#include "TShapeKit.h"
+#include "TSunShape.h"
+#include "TSunShapeFactory.h"
+#include "TTracker.h"
+#include "TTrackerFactory.h"
+#include "TTransmissivity.h"
+
+namespace
+{
+	const unsigned long numberOfRays = 1000000;
+	const int sunWidthDivisions = 200;
+	const int sunHeightDivisions = 200;
+
+	const int fieldRows = 100;
+	const int fieldColumns = 100;
+	const double fieldSpacing = 12.0;
+	const double towerHeight = 120.0;
+
+	/*!
+	 * Returns the factory of \a factoryList whose name, obtained with \a nameFunction, is \a name.
+	 */
+	template< class Factory >
+	Factory* FindFactory( const QVector< Factory* >& factoryList, QString ( Factory::*nameFunction )() const, QString name )
+	{
+		for( int f = 0; f < factoryList.size(); ++f )
+			if( ( factoryList[f]->*nameFunction )() == name )	return factoryList[f];
+		return 0;
+	}
+
+	/*!
+	 * Sets the value of the field \a fieldName of the \a node from its string representation.
+	 */
+	void SetFieldValue( SoNode* node, const char* fieldName, const char* value )
+	{
+		SoField* field = node->getField( fieldName );
+		if( field )	field->set( value );
+	}
+
+	/*!
+	 * Creates a shape kit with a \a width x \a height flat rectangle and a specular material.
+	 * Returns null if the needed plugins are not loaded.
+	 */
+	TShapeKit* CreateFlatSurface( const PluginManager& pluginManager, const char* width, const char* height, const char* reflectivity )
+	{
+		TShapeFactory* shapeFactory = FindFactory( pluginManager.GetShapeFactories(), &TShapeFactory::TShapeName, "Flat_Rectangle" );
+		TMaterialFactory* materialFactory = FindFactory( pluginManager.GetMaterialFactories(), &TMaterialFactory::TMaterialName, "Specular_Standard_Material" );
+		if( !shapeFactory || !materialFactory )	return 0;
+
+		TShape* shape = shapeFactory->CreateTShape();
+		SetFieldValue( shape, "width", width );
+		SetFieldValue( shape, "height", height );
+
+		TMaterial* material = materialFactory->CreateTMaterial();
+		SetFieldValue( material, "m_reflectivity", reflectivity );
+
+		TShapeKit* shapeKit = new TShapeKit;
+		shapeKit->setPart( "shape", shape );
+		shapeKit->setPart( "material", material );
+		return shapeKit;
+	}
+
+	/*!
+	 * Creates a scene with a field of fieldRows x fieldColumns tracking heliostats, aiming to a flat receiver on top of a tower
+	 * placed at the center of the field.
+	 * Returns null if the needed plugins are not loaded.
+	 */
+	TSceneKit* CreateHeliostatField( const PluginManager& pluginManager )
+	{
+		TSunShapeFactory* sunShapeFactory = FindFactory( pluginManager.GetSunShapeFactories(), &TSunShapeFactory::TSunShapeName, "Pillbox_Sunshape" );
+		TTrackerFactory* trackerFactory = FindFactory( pluginManager.GetTrackerFactories(), &TTrackerFactory::TTrackerName, "Heliostat_tracker" );
+		if( !sunShapeFactory || !trackerFactory )	return 0;
+
+		TShapeKit* receiver = CreateFlatSurface( pluginManager, "20", "20", "0" );
+		if( !receiver )	return 0;
+		receiver->ref();
+
+		//Every heliostat shares the same facet surface node.
+		TShapeKit* facetSurface = CreateFlatSurface( pluginManager, "10", "10", "0.95" );
+		facetSurface->ref();
+
+		TSceneKit* scene = new TSceneKit;
+		scene->ref();
+		scene->setSearchingChildren( true );
+
+		TLightKit* lightKit = new TLightKit;
+		lightKit->setPart( "tsunshape", sunShapeFactory->CreateTSunShape() );
+		scene->setPart( "lightList[0]", lightKit );
+
+		SoNodeKitListPart* sceneChildList = static_cast< SoNodeKitListPart* >( scene->getPart( "childList", true ) );
+		TSeparatorKit* sunNode = new TSeparatorKit;
+		sunNode->setName( "SunNode" );
+		sunNode->setPart( "tracker", new TSceneTracker );
+		sceneChildList->addChild( sunNode );
+
+		TSeparatorKit* rootNode = new TSeparatorKit;
+		rootNode->setName( "RootNode" );
+		static_cast< SoNodeKitListPart* >( sunNode->getPart( "childList", true ) )->addChild( rootNode );
+		SoNodeKitListPart* rootChildList = static_cast< SoNodeKitListPart* >( rootNode->getPart( "childList", true ) );
+
+		TSeparatorKit* tower = new TSeparatorKit;
+		tower->setName( "Receiver" );
+		SoTransform* towerTransform = static_cast< SoTransform* >( tower->getPart( "transform", true ) );
+		towerTransform->translation.setValue( 0.0, towerHeight, 0.0 );
+		towerTransform->rotation.setValue( SbVec3f( 1.0, 0.0, 0.0 ), gc::Pi );
+		static_cast< SoNodeKitListPart* >( tower->getPart( "childList", true ) )->addChild( receiver );
+		receiver->unref();
+		rootChildList->addChild( tower );
+
+		QString aimingPoint = QString( "0 %1 0" ).arg( towerHeight );
+		for( int row = 0; row < fieldRows; ++row )
+		{
+			for( int column = 0; column < fieldColumns; ++column )
+			{
+				double x = ( column - 0.5 * ( fieldColumns - 1 ) ) * fieldSpacing;
+				double z = ( row - 0.5 * ( fieldRows - 1 ) ) * fieldSpacing;
+				if( ( fabs( x ) < fieldSpacing ) && ( fabs( z ) < fieldSpacing ) )	continue;
+
+				TSeparatorKit* heliostat = new TSeparatorKit;
+				heliostat->setName( QString( "Heliostat_%1_%2" ).arg( row ).arg( column ).toStdString().c_str() );
+				SoTransform* heliostatTransform = static_cast< SoTransform* >( heliostat->getPart( "transform", true ) );
+				heliostatTransform->translation.setValue( x, 0.0, z );
+				rootChildList->addChild( heliostat );
+
+				TSeparatorKit* facet = new TSeparatorKit;
+				TTracker* tracker = trackerFactory->CreateTTracker();
+				SetFieldValue( tracker, "aimingPoint", aimingPoint.toLatin1().data() );
+				facet->setPart( "tracker", tracker );
+				static_cast< SoNodeKitListPart* >( heliostat->getPart( "childList", true ) )->addChild( facet );
+				static_cast< SoNodeKitListPart* >( facet->getPart( "childList", true ) )->addChild( facetSurface );
+			}
+		}
+		facetSurface->unref();
+
+		scene->unrefNoDelete();
+		return scene;
+	}
+
+	/*!
+	 * Traces \a numberOfRays rays through the \a scene and records, with the \a name prefix, the time needed to
+	 * prepare the scene and the time needed to trace the rays.
+	 */
+	void TraceScene( BenchmarkRecorder& recorder, QString name, TSceneKit* scene, RandomDeviate& rand )
+	{
+		const QString suite( "Trace" );
+
+		recorder.Start();
+		SceneModel sceneModel;
+		sceneModel.SetCoinScene( *scene );
+
+		InstanceNode* sceneInstance = sceneModel.NodeFromIndex( QModelIndex() );
+		if( !sceneInstance || sceneInstance->children.size() < 2 )	return;
+		InstanceNode* lightInstance = sceneInstance->children[0];
+		InstanceNode* rootSeparatorInstance = sceneInstance->children[1];
+
+		TLightKit* lightKit = static_cast< TLightKit* >( scene->getPart( "lightList[0]", false ) );
+		if( !lightKit )	return;
+		TSunShape* sunShape = static_cast< TSunShape* >( lightKit->getPart( "tsunshape", false ) );
+		TLightShape* raycastingSurface = static_cast< TLightShape* >( lightKit->getPart( "icon", false ) );
+		SoTransform* lightTransform = static_cast< SoTransform* >( lightKit->getPart( "transform", false ) );
+		if( !sunShape || !raycastingSurface || !lightTransform )	return;
+
+		TTransmissivity* transmissivity = static_cast< TTransmissivity* >( scene->getPart( "transmissivity", false ) );
+
+		TSeparatorKit* concentratorRoot = static_cast< TSeparatorKit* >( scene->getPart( "childList[0]", false ) );
+		if( !concentratorRoot )	return;
+
+		SoGetBoundingBoxAction bbAction( SbViewportRegion() );
+		concentratorRoot->getBoundingBox( &bbAction );
+		SbBox3f box = bbAction.getXfBoundingBox().project();
+		if( !box.isEmpty() )
+		{
+			BBox sceneBox;
+			sceneBox.pMin = Point3D( box.getMin()[0], box.getMin()[1], box.getMin()[2] );
+			sceneBox.pMax = Point3D( box.getMax()[0], box.getMax()[1], box.getMax()[2] );
+			lightKit->Update( sceneBox );
+		}
+		sceneModel.UpdateSceneModel();
+
+		trf::ComputeSceneTreeMap( rootSeparatorInstance, Transform( new Matrix4x4 ), true );
+
+		QSet< QString > disabledNodes = QString( lightKit->disabledNodes.getValue().getString() ).split( ";", QString::SkipEmptyParts ).toSet();
+		QVector< QPair< TShapeKit*, Transform > > surfacesList;
+		trf::ComputeFistStageSurfaceList( rootSeparatorInstance, disabledNodes, &surfacesList );
+		lightKit->ComputeLightSourceArea( sunWidthDivisions, sunHeightDivisions, surfacesList );
+		recorder.Stop( suite, name + "Prepare", surfacesList.count(), raycastingSurface->GetValidArea() );
+		if( surfacesList.count() < 1 )	return;
+
+		Transform lightToWorld = tgf::TransformFromSoTransform( lightTransform );
+		lightInstance->SetIntersectionTransform( lightToWorld.GetInverse() );
+
+		TPhotonMap photonMap;
+		photonMap.SetBufferSize( HUGE_VAL );
+		photonMap.SetConcentratorToWorld( rootSeparatorInstance->GetIntersectionTransform() );
+
+		RayTracingScheduler scheduler( numberOfRays, QThread::idealThreadCount() );
+		QVector< RayTracingScheduler* > raysPerThread = scheduler.ThreadsList();
+
+		QMutex mutex;
+		QMutex mutexPhotonMap;
+		QVector< InstanceNode* > exportSuraceList;
+
+		recorder.Start();
+		if( transmissivity )
+			QtConcurrent::blockingMap( raysPerThread, RayTracer( rootSeparatorInstance,
+							lightInstance, raycastingSurface, sunShape, lightToWorld,
+							transmissivity,
+							rand,
+							&mutex, &photonMap, &mutexPhotonMap,
+							exportSuraceList ) );
+		else
+			QtConcurrent::blockingMap( raysPerThread, RayTracerNoTr( rootSeparatorInstance,
+							lightInstance, raycastingSurface, sunShape, lightToWorld,
+							rand,
+							&mutex, &photonMap, &mutexPhotonMap,
+							exportSuraceList ) );
+		recorder.Stop( suite, name, scheduler.TracedRays(), photonMap.GetAllPhotons().size() );
+	}
+
+	/*!
+	 * Measures the time to save and load the generated heliostat field scene in ASCII ( tnh ) and binary ( tnhb ) formats.
+	 */
+	void SceneFiles( BenchmarkRecorder& recorder, TSceneKit* fieldScene )
+	{
+		QDir fileDirectory = QDir::temp();
+		QString sourceFileName = fileDirectory.absoluteFilePath( "TonatiuhBenchmarkSource.tnh" );
+		QString textFileName = fileDirectory.absoluteFilePath( "TonatiuhBenchmark.tnh" );
+		QString binaryFileName = fileDirectory.absoluteFilePath( "TonatiuhBenchmark.tnhb" );
+		unsigned long nHeliostats = fieldRows * fieldColumns;
+
+		SoWriteAction sourceOutput;
+		if( !sourceOutput.getOutput()->openFile( sourceFileName.toLatin1().constData() ) )	return;
+		sourceOutput.apply( fieldScene );
+		sourceOutput.getOutput()->closeFile();
+
+		Document textDocument;
+		recorder.Start();
+		bool textRead = textDocument.ReadFile( sourceFileName );
+		recorder.Stop( "Scene", "HeliostatFieldLoadText", nHeliostats, QFileInfo( sourceFileName ).size() );
+
+		if( textRead )
+		{
+			recorder.Start();
+			textDocument.WriteFile( textFileName );
+			recorder.Stop( "Scene", "HeliostatFieldSaveText", nHeliostats, QFileInfo( textFileName ).size() );
+
+			recorder.Start();
+			textDocument.WriteFile( binaryFileName );
+			recorder.Stop( "Scene", "HeliostatFieldSaveBinary", nHeliostats, QFileInfo( binaryFileName ).size() );
+
+			Document binaryDocument;
+			recorder.Start();
+			binaryDocument.ReadFile( binaryFileName );
+			recorder.Stop( "Scene", "HeliostatFieldLoadBinary", nHeliostats, QFileInfo( binaryFileName ).size() );
+		}
+
+		fileDirectory.remove( sourceFileName );
+		fileDirectory.remove( textFileName );
+		fileDirectory.remove( binaryFileName );
+	}
+}
+
+/*!
+ * Measures complete ray traces of the SolarFurnace_normal.tnh test model and of a generated heliostat field, and
+ * the save and load times of the generated heliostat field scene.
+ */
+void tbm::RunTraceBenchmarks( BenchmarkRecorder& recorder, const PluginManager& pluginManager )
+{
+	QVector< RandomDeviateFactory* > randomDeviateFactoryList = pluginManager.GetRandomDeviateFactories();
+	if( randomDeviateFactoryList.size() < 1 )	return;
+	RandomDeviate* rand = randomDeviateFactoryList[0]->CreateRandomDeviate();
+
+	if( recorder.IsEnabled( "Trace", "SolarFurnace" ) )
+	{
+		Document document;
+		if( document.ReadFile( QDir( TEST_DIR ).absoluteFilePath( "SolarFurnace_normal.tnh" ) ) )
+			TraceScene( recorder, "SolarFurnace", document.GetSceneKit(), *rand );
+	}
+
+	if( recorder.IsEnabled( "Scene", "HeliostatField" ) )
+	{
+		TSceneKit* fieldScene = CreateHeliostatField( pluginManager );
+		if( fieldScene )
+		{
+			fieldScene->ref();
+			SceneFiles( recorder, fieldScene );
+			fieldScene->unref();
+		}
+	}
+
+	if( recorder.IsEnabled( "Trace", "HeliostatField" ) )
+	{
+		TSceneKit* fieldScene = CreateHeliostatField( pluginManager );
+		if( fieldScene )
+		{
+			fieldScene->ref();
+
+			//Evaluates all the heliostat trackers for a new sun position
+			recorder.Start();
+			fieldScene->UpdateSunPosition( 0.25 * gc::Pi, 0.25 * gc::Pi );
+			recorder.Stop( "Trace", "HeliostatFieldTrackers", fieldRows * fieldColumns, 0 );
+
+			TLightKit* lightKit = static_cast< TLightKit* >( fieldScene->getPart( "lightList[0]", false ) );
+			lightKit->ChangePosition( 0.25 * gc::Pi, 0.25 * gc::Pi );
+
+			TraceScene( recorder, "HeliostatField", fieldScene, *rand );
+			fieldScene->unref();
+		}
+	}
+
+	delete rand;
+}
@@ -0,0 +1,146 @@
+TEMPLATE = app
+CONFIG += console debug_and_release
+include( ../config.pri )
+
+QT += xml opengl svg  script network
+
+DEFINES += TEST_DIR=\\\"$$PWD/../tests\\\"
+
+INCLUDEPATH += ../tests \
+               ../plugins/ShapeCAD/src
+
+SOURCES += *.cpp \
+           ../tests/TestsAuxiliaryFunctions.cpp \
+           ../plugins/ShapeCAD/src/BVH.cpp \
+           ../plugins/ShapeCAD/src/MeshLoader.cpp \
+           ../plugins/ShapeCAD/src/Triangle.cpp
+
+HEADERS += *.h \
+           ../plugins/ShapeCAD/src/BVH.h \
+           ../plugins/ShapeCAD/src/MeshLoader.h \
+           ../plugins/ShapeCAD/src/Triangle.h
+
+win32 {
+	LIBS += -lpsapi
+}
+
+CONFIG(debug, debug|release) {
+    OBJECTS       +=    $$(TONATIUH_ROOT)/debug/BBox.o \
+                        $$(TONATIUH_ROOT)/debug/DifferentialGeometry.o \
+                        $$(TONATIUH_ROOT)/debug/Document.o \
+                        $$(TONATIUH_ROOT)/debug/InstanceNode.o \
+                        $$(TONATIUH_ROOT)/debug/LightCellSampling.o \
+                        $$(TONATIUH_ROOT)/debug/Matrix4x4.o \
+                        $$(TONATIUH_ROOT)/debug/moc_Document.o \
+                        $$(TONATIUH_ROOT)/debug/moc_ParallelRandomDeviate.o \
+                        $$(TONATIUH_ROOT)/debug/moc_RayTracingScheduler.o \
+                        $$(TONATIUH_ROOT)/debug/moc_SceneModel.o \
+                        $$(TONATIUH_ROOT)/debug/NormalVector.o \
+                        $$(TONATIUH_ROOT)/debug/ParallelRandomDeviate.o \
+                        $$(TONATIUH_ROOT)/debug/PathWrapper.o \
+                        $$(TONATIUH_ROOT)/debug/Photon.o \
+                        $$(TONATIUH_ROOT)/debug/PhotonMapExport.o \
+                        $$(TONATIUH_ROOT)/debug/PhotonMapIndex.o \
+                        $$(TONATIUH_ROOT)/debug/PhotonSurfaceIndex.o \
+                        $$(TONATIUH_ROOT)/debug/PhotonTally.o \
+                        $$(TONATIUH_ROOT)/debug/Point3D.o \
+                        $$(TONATIUH_ROOT)/debug/PluginManager.o \
+                        $$(TONATIUH_ROOT)/debug/RayFile.o \
+                        $$(TONATIUH_ROOT)/debug/RayTracer.o \
+                        $$(TONATIUH_ROOT)/debug/RayTracerNoTr.o \
+                        $$(TONATIUH_ROOT)/debug/RayTracingScheduler.o \
+                        $$(TONATIUH_ROOT)/debug/RefCount.o \
+                        $$(TONATIUH_ROOT)/debug/SceneModel.o \
+                        $$(TONATIUH_ROOT)/debug/sunpos.o \
+                        $$(TONATIUH_ROOT)/debug/TCube.o \
+                        $$(TONATIUH_ROOT)/debug/TDefaultMaterial.o \
+                        $$(TONATIUH_ROOT)/debug/TDefaultSunShape.o \
+                        $$(TONATIUH_ROOT)/debug/TDefaultTracker.o \
+                        $$(TONATIUH_ROOT)/debug/TDefaultTransmissivity.o \
+                        $$(TONATIUH_ROOT)/debug/tgf.o \
+                        $$(TONATIUH_ROOT)/debug/TLightKit.o \
+                        $$(TONATIUH_ROOT)/debug/TLightShape.o \
+                        $$(TONATIUH_ROOT)/debug/TMaterial.o \
+                        $$(TONATIUH_ROOT)/debug/TPhotonMap.o \
+                        $$(TONATIUH_ROOT)/debug/TraceCheckpoint.o \
+                        $$(TONATIUH_ROOT)/debug/Transform.o \
+                        $$(TONATIUH_ROOT)/debug/trf.o \
+                        $$(TONATIUH_ROOT)/debug/TSceneTracker.o \
+                        $$(TONATIUH_ROOT)/debug/TSceneKit.o \
+                        $$(TONATIUH_ROOT)/debug/TSeparatorKit.o \
+                        $$(TONATIUH_ROOT)/debug/TShape.o \
+                        $$(TONATIUH_ROOT)/debug/TShapeKit.o \
+                        $$(TONATIUH_ROOT)/debug/TSunShape.o \
+                        $$(TONATIUH_ROOT)/debug/TSquare.o \
+                        $$(TONATIUH_ROOT)/debug/TTracker.o \
+                        $$(TONATIUH_ROOT)/debug/TTrackerForAiming.o \
+                        $$(TONATIUH_ROOT)/debug/TTransmissivity.o \
+                        $$(TONATIUH_ROOT)/debug/Vector3D.o
+}                     
+else { 
+    OBJECTS       +=    $$(TONATIUH_ROOT)/release/BBox.o \
+                        $$(TONATIUH_ROOT)/release/DifferentialGeometry.o \
+                        $$(TONATIUH_ROOT)/release/Document.o \
+                        $$(TONATIUH_ROOT)/release/InstanceNode.o \
+                        $$(TONATIUH_ROOT)/release/LightCellSampling.o \
+                        $$(TONATIUH_ROOT)/release/Matrix4x4.o \
+                        $$(TONATIUH_ROOT)/release/moc_Document.o \
+                        $$(TONATIUH_ROOT)/release/moc_ParallelRandomDeviate.o \
+                        $$(TONATIUH_ROOT)/release/moc_RayTracingScheduler.o \
+                        $$(TONATIUH_ROOT)/release/moc_SceneModel.o \
+                        $$(TONATIUH_ROOT)/release/NormalVector.o \
+                        $$(TONATIUH_ROOT)/release/ParallelRandomDeviate.o \
+                        $$(TONATIUH_ROOT)/release/PathWrapper.o \
+                        $$(TONATIUH_ROOT)/release/Photon.o \
+                        $$(TONATIUH_ROOT)/release/PhotonMapExport.o \
+                        $$(TONATIUH_ROOT)/release/PhotonMapIndex.o \
+                        $$(TONATIUH_ROOT)/release/PhotonSurfaceIndex.o \
+                        $$(TONATIUH_ROOT)/release/PhotonTally.o \
+                        $$(TONATIUH_ROOT)/release/Point3D.o \
+                        $$(TONATIUH_ROOT)/release/PluginManager.o \
+                        $$(TONATIUH_ROOT)/release/RayFile.o \
+                        $$(TONATIUH_ROOT)/release/RayTracer.o \
+                        $$(TONATIUH_ROOT)/release/RayTracerNoTr.o \
+                        $$(TONATIUH_ROOT)/release/RayTracingScheduler.o \
+                        $$(TONATIUH_ROOT)/release/RefCount.o \
+                        $$(TONATIUH_ROOT)/release/SceneModel.o \
+                        $$(TONATIUH_ROOT)/release/sunpos.o \
+                        $$(TONATIUH_ROOT)/release/TCube.o \
+                        $$(TONATIUH_ROOT)/release/TDefaultMaterial.o \
+                        $$(TONATIUH_ROOT)/release/TDefaultSunShape.o \
+                        $$(TONATIUH_ROOT)/release/TDefaultTracker.o \
+                        $$(TONATIUH_ROOT)/release/TDefaultTransmissivity.o \
+                        $$(TONATIUH_ROOT)/release/tgf.o \
+                        $$(TONATIUH_ROOT)/release/TLightKit.o \
+                        $$(TONATIUH_ROOT)/release/TLightShape.o \
+                        $$(TONATIUH_ROOT)/release/TMaterial.o \
+                        $$(TONATIUH_ROOT)/release/TPhotonMap.o \
+                        $$(TONATIUH_ROOT)/release/TraceCheckpoint.o \
+                        $$(TONATIUH_ROOT)/release/Transform.o \
+                        $$(TONATIUH_ROOT)/release/trf.o \
+                        $$(TONATIUH_ROOT)/release/TSeparatorKit.o \
+                        $$(TONATIUH_ROOT)/release/TSceneKit.o \
+                        $$(TONATIUH_ROOT)/release/TSceneTracker.o \
+                        $$(TONATIUH_ROOT)/release/TShape.o \
+                        $$(TONATIUH_ROOT)/release/TShapeKit.o \
+                        $$(TONATIUH_ROOT)/release/TSunShape.o \
+                        $$(TONATIUH_ROOT)/release/TSquare.o \
+                        $$(TONATIUH_ROOT)/release/TTracker.o \
+                        $$(TONATIUH_ROOT)/release/TTrackerForAiming.o \
+                        $$(TONATIUH_ROOT)/release/TTransmissivity.o \
+                        $$(TONATIUH_ROOT)/release/Vector3D.o
+}
+
+
+TARGET = TonatiuhBenchmarks
+
+CONFIG(debug, debug|release) {
+    DESTDIR = ../bin/debug
+}
+else{
+    DESTDIR=../bin/release
+}
+
+benchmarks.target= benchmarks
+
+QMAKE_EXTRA_TARGETS += benchmarks
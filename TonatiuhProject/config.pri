@@ -13,7 +13,7 @@ isEmpty( COINDIR ) {
 }
 
 greaterThan(QT_MAJOR_VERSION, 4) {
-    QT += widgets
+    QT += widgets concurrent
 } 
 
 INCLUDEPATH += 	. \
@@ -37,14 +37,17 @@ Juana Amieva, Azael Mancillas, Cesar Cantu.
 ***************************************************************************/
 
 #include <algorithm>
+#include <clocale>
+#include <cstdlib>
+#include <cstring>
 
 #include <QFile>
 #include <QMessageBox>
-#include <QTextStream>
 
 #include <Inventor/nodes/SoSeparator.h>
 #include <Inventor/nodes/SoTransform.h>
 
+#include "gc.h"
 #include "Point3D.h"
 #include "NormalVector.h"
 
@@ -63,14 +66,125 @@ Juana Amieva, Azael Mancillas, Cesar Cantu.
 #include "HeliostatFieldWizard.h"
 
 
-bool comparePuntosPorX( std::pair< Point3D, Point3D > pA, std::pair< Point3D, Point3D > pB )
+namespace
 {
-	return ( pA.first.x < pB.first.x );
-}
+	inline bool IsBlank( char c )
+	{
+		return ( ( c == ' ' ) || ( c == '\r' ) || ( c == '\v' ) || ( c == '\f' ) );
+	}
 
-bool comparePuntosPorZ( std::pair< Point3D, Point3D > pA, std::pair< Point3D, Point3D > pB )
-{
-	return ( pA.first.z < pB.first.z );
+	inline bool IsSeparator( char c )
+	{
+		return ( ( c == '\t' ) || ( c == ',' ) || ( c == ';' ) );
+	}
+
+	/*!
+	 * Converts the number in [\a begin, \a end) without allocating. The text is copied to a stack
+	 * buffer with its '.' replaced by the \a decimalPoint of the C locale, so strtod reads it
+	 * in any locale.
+	 */
+	bool ParseNumber( const char* begin, const char* end, char decimalPoint, double* value )
+	{
+		char buffer[64];
+		size_t length = end - begin;
+		if( ( length == 0 ) || ( length >= sizeof( buffer ) ) )	return ( false );
+		for( size_t i = 0; i < length; ++i )
+			buffer[i] = ( begin[i] == '.' ) ? decimalPoint : begin[i];
+		buffer[length] = '\0';
+
+		char* numberEnd = 0;
+		*value = strtod( buffer, &numberEnd );
+		return ( numberEnd == buffer + length );
+	}
+
+	/*!
+	 * Reads the points of \a fileName. Each line has the x, y and z coordinates separated by tabs, commas
+	 * or semicolons. The lines that do not start with three numbers are skipped.
+	 */
+	bool ReadPointsFile( QString fileName, std::vector< Point3D >* pointList )
+	{
+		QFile pointsFile( fileName );
+		if( !pointsFile.open( QIODevice::ReadOnly ) )	return ( false );
+		QByteArray data = pointsFile.readAll();
+		pointsFile.close();
+
+		char decimalPoint = *localeconv()->decimal_point;
+		const char* line = data.constData();
+		const char* dataEnd = line + data.size();
+		pointList->reserve( pointList->size() + data.size() / 24 );
+		while( line < dataEnd )
+		{
+			const char* lineEnd = static_cast< const char* >( memchr( line, '\n', dataEnd - line ) );
+			if( !lineEnd )	lineEnd = dataEnd;
+
+			double coordinates[3];
+			int nCoordinates = 0;
+			const char* token = line;
+			while( ( nCoordinates < 3 ) && ( token < lineEnd ) )
+			{
+				while( ( token < lineEnd ) && ( IsBlank( *token ) || IsSeparator( *token ) ) )	++token;
+				const char* tokenEnd = token;
+				while( ( tokenEnd < lineEnd ) && !IsSeparator( *tokenEnd ) )	++tokenEnd;
+				const char* valueEnd = tokenEnd;
+				while( ( valueEnd > token ) && IsBlank( *( valueEnd - 1 ) ) )	--valueEnd;
+				if( valueEnd == token )	break;
+
+				if( !ParseNumber( token, valueEnd, decimalPoint, &coordinates[nCoordinates] ) )	break;
+				nCoordinates++;
+				token = tokenEnd;
+			}
+
+			if( nCoordinates == 3 )
+				pointList->push_back( Point3D( coordinates[0], coordinates[1], coordinates[2] ) );
+			line = lineEnd + 1;
+		}
+		return ( true );
+	}
+
+	/*!
+	 * Orders heliostat indices by the x or z coordinate of the heliostat centers.
+	 */
+	struct CenterOrder
+	{
+		CenterOrder( const std::vector< Point3D >* centerList, bool byZ )
+		:m_centerList( centerList ),
+		 m_byZ( byZ )
+		{
+
+		}
+
+		bool operator()( unsigned int a, unsigned int b ) const
+		{
+			if( m_byZ )	return ( ( *m_centerList )[a].z < ( *m_centerList )[b].z );
+			return ( ( *m_centerList )[a].x < ( *m_centerList )[b].x );
+		}
+
+		const std::vector< Point3D >* m_centerList;
+		bool m_byZ;
+	};
+
+	/*!
+	 * Selects the heliostat indices whose center x or z coordinate is lower than a split value.
+	 */
+	struct CenterBelow
+	{
+		CenterBelow( const std::vector< Point3D >* centerList, bool byZ, double splitPoint )
+		:m_centerList( centerList ),
+		 m_byZ( byZ ),
+		 m_splitPoint( splitPoint )
+		{
+
+		}
+
+		bool operator()( unsigned int a ) const
+		{
+			return ( ( m_byZ ? ( *m_centerList )[a].z : ( *m_centerList )[a].x ) < m_splitPoint );
+		}
+
+		const std::vector< Point3D >* m_centerList;
+		bool m_byZ;
+		double m_splitPoint;
+	};
 }
 
 
@@ -160,25 +274,12 @@ TSeparatorKit* ComponentHeliostatField::CreateField()
 	std::vector< Point3D > hCenterList;
 	if( helCoord == 1 )
 	{
-		QFile coordinatesFile( wizard.GetCoordinatesFile() );
-		if( !coordinatesFile.open( QIODevice::ReadOnly ) )
+		if( !ReadPointsFile( wizard.GetCoordinatesFile(), &hCenterList ) )
 		{
 			QMessageBox::warning( 0, QString( "Campo Heliostatos" ),
 					QString( "Impossible to read the heliostat coordinates file." ) );
 			return 0;
 		}
-
-		QTextStream coordIn( &coordinatesFile );
-
-		while( !coordIn.atEnd() )
-		{
-			QString inLine = coordIn.readLine();
-			QStringList heliostatL = inLine.split(QRegExp("[\\t,;]"), QString::SkipEmptyParts);
-			if( heliostatL.count() >=3 )
-				hCenterList.push_back( Point3D( heliostatL[0].toDouble(),
-						heliostatL[1].toDouble(),
-						heliostatL[2].toDouble() ) );
-		}
 	}
 	else if( helCoord == 2 )
 	{
@@ -248,26 +349,13 @@ TSeparatorKit* ComponentHeliostatField::CreateField()
 	}
 	else if( strategy == 4 )
 	{
-		QFile aimingPointFile( wizard.GetStrategyFile() );
-		if( !aimingPointFile.open( QIODevice::ReadOnly ) )
+		if( !ReadPointsFile( wizard.GetStrategyFile(), &aimingPointList ) )
 		{
 			QMessageBox::warning( 0, QString( "Campo Heliostatos" ),
 					QString( "Impossible to read the aiming points file." ) );
 			return 0;
 		}
 
-		QTextStream aimingPointIn( &aimingPointFile );
-
-		while( !aimingPointIn.atEnd() )
-		{
-			QString inLine = aimingPointIn.readLine();
-			QStringList aimingPointL = inLine.split(QRegExp("[\\t,;]"), QString::SkipEmptyParts);
-			if( aimingPointL.count() >=3 )
-				aimingPointList.push_back( Point3D( aimingPointL[0].toDouble(),
-						aimingPointL[1].toDouble(),
-						aimingPointL[2].toDouble() ) );
-		}
-
 		if( aimingPointList.size() != hCenterList.size() )
 		{
 			QMessageBox::warning( 0, QString( "Campo Heliostatos" ),
@@ -300,8 +388,18 @@ TSeparatorKit* ComponentHeliostatField::CreateField()
 	heliostatsNodeSeparator->setName( "Heliostatos" );
 	heliostatsNodeSeparator->ref();
 
-	CreateHeliostatZones( hCenterList, heliostatsNodeSeparator, heliostatTrackerFactory, shapeFactory, heliostat, heliostatComponent, heliostatWidth, heliostatHeight, heliostatRadius,
-			materialNode, aimingPointList, 1 );
+	//All the heliostats share the same surface node unless each one has its own radius.
+	TShapeKit* heliostatSurface = 0;
+	if( ( heliostat == 2 ) && ( ( heliostatRadius >= 0.0 ) || ( shapeFactory->TShapeName() != QString( "Spherical_rectangle" ) ) ) )
+		heliostatSurface = CreateHeliostatSurface( shapeFactory, heliostatWidth, heliostatHeight, heliostatRadius, materialNode );
+
+	std::vector< unsigned int > heliostatOrder( hCenterList.size() );
+	for( unsigned int i = 0; i < heliostatOrder.size(); i++ )
+		heliostatOrder[i] = i;
+
+	CreateHeliostatZones( hCenterList, aimingPointList, heliostatOrder, 0, heliostatOrder.size(), heliostatsNodeSeparator,
+			heliostatTrackerFactory, shapeFactory, heliostat, heliostatComponent, heliostatWidth, heliostatHeight, heliostatRadius,
+			materialNode, heliostatSurface, 1 );
 
 	return heliostatsNodeSeparator;
 
@@ -313,27 +411,14 @@ TSeparatorKit* ComponentHeliostatField::CreateField(QVector< QVariant >  argumen
 	//Heliostat coordinates
 	if( argumentList.count() != 15 )	return 0;
 
-	QFile coordinatesFile( argumentList[0].toString() );
-	if( !coordinatesFile.open( QIODevice::ReadOnly ) )
+	std::vector< Point3D > hCenterList;
+	if( !ReadPointsFile( argumentList[0].toString(), &hCenterList ) )
 	{
 		QMessageBox::warning( 0, QString( "Campo Heliostatos" ),
 				QString( "Impossible to read the heliostat coordinates file." ) );
 			return 0;
 	}
 
-	QTextStream coordIn( &coordinatesFile );
-
-	std::vector< Point3D > hCenterList;
-	while( !coordIn.atEnd() )
-	{
-		QString inLine = coordIn.readLine();
-		QStringList heliostat = inLine.split(QRegExp("[\\t,;]"), QString::SkipEmptyParts);
-		if( heliostat.count() >=3 )
-			hCenterList.push_back( Point3D( heliostat[0].toDouble(),
-					heliostat[1].toDouble(),
-					heliostat[2].toDouble() ) );
-	}
-
 
 	//Heliostat
 
@@ -437,26 +522,13 @@ TSeparatorKit* ComponentHeliostatField::CreateField(QVector< QVariant >  argumen
 	std::vector< Point3D > aimingPointList;
 	if( strategy == 1 )
 	{
-		QFile aimingPointFile( argumentList[9].toString() );
-		if( !aimingPointFile.open( QIODevice::ReadOnly ) )
+		if( !ReadPointsFile( argumentList[9].toString(), &aimingPointList ) )
 		{
 			QMessageBox::warning( 0, QString( "Campo Heliostatos" ),
 					QString( "Impossible to read the aiming points file." ) );
 			return 0;
 		}
 
-		QTextStream aimingPointIn( &aimingPointFile );
-
-		while( !aimingPointIn.atEnd() )
-		{
-			QString inLine = aimingPointIn.readLine();
-			QStringList aimingPointL = inLine.split(QRegExp("[\\t,;]"), QString::SkipEmptyParts);
-			if( aimingPointL.count() >=3 )
-				aimingPointList.push_back( Point3D( aimingPointL[0].toDouble(),
-						aimingPointL[1].toDouble(),
-						aimingPointL[2].toDouble() ) );
-		}
-
 		if( aimingPointList.size() != hCenterList.size() )
 		{
 			QMessageBox::warning( 0, QString( "Campo Heliostatos" ),
@@ -580,14 +652,35 @@ TSeparatorKit* ComponentHeliostatField::CreateField(QVector< QVariant >  argumen
 	heliostatsNodeSeparator->setName( "Heliostats" );
 	heliostatsNodeSeparator->ref();
 
-	CreateHeliostatZones( hCenterList, heliostatsNodeSeparator, heliostatTrackerFactory, shapeFactory, heliostat, heliostatComponentNode, heliostatWidth, heliostatHeight, heliostatRadius,
-			materialNode, aimingPointList, 1 );
+	//All the heliostats share the same surface node unless each one has its own radius.
+	TShapeKit* heliostatSurface = 0;
+	if( ( heliostat == 2 ) && ( ( heliostatRadius >= 0.0 ) || ( shapeFactory->TShapeName() != QString( "Spherical_rectangle" ) ) ) )
+		heliostatSurface = CreateHeliostatSurface( shapeFactory, heliostatWidth, heliostatHeight, heliostatRadius, materialNode );
+
+	std::vector< unsigned int > heliostatOrder( hCenterList.size() );
+	for( unsigned int i = 0; i < heliostatOrder.size(); i++ )
+		heliostatOrder[i] = i;
+
+	CreateHeliostatZones( hCenterList, aimingPointList, heliostatOrder, 0, heliostatOrder.size(), heliostatsNodeSeparator,
+			heliostatTrackerFactory, shapeFactory, heliostat, heliostatComponentNode, heliostatWidth, heliostatHeight, heliostatRadius,
+			materialNode, heliostatSurface, 1 );
 
 	return heliostatsNodeSeparator;
 }
 
 
-void ComponentHeliostatField::CreateHeliostatZones( std::vector< Point3D >  heliostatCenterList, TSeparatorKit* parentNode,
+/*!
+ * Adds to \a parentNode the heliostats [\a first, \a last) of \a heliostatOrder. Zones with eight or more heliostats are
+ * split in two at the middle of their extent along x ( \a eje 1 ) or z ( \a eje 3 ), alternating the axis at each level.
+ * \a heliostatOrder is partitioned in place. Each zone is completed before it is added to its parent, so the new
+ * nodes only notify their changes to nodes that are not yet part of the field.
+ */
+void ComponentHeliostatField::CreateHeliostatZones( const std::vector< Point3D >& heliostatCenterList,
+		const std::vector< Point3D >& aimingPointList,
+		std::vector< unsigned int >& heliostatOrder,
+		unsigned int first,
+		unsigned int last,
+		TSeparatorKit* parentNode,
 		TTrackerFactory* heliostatTrackerFactory,
 		TShapeFactory* heliostatShapeFactory,
 		int heliostat,
@@ -596,39 +689,33 @@ void ComponentHeliostatField::CreateHeliostatZones( std::vector< Point3D >  heli
 		double heliostatHeight,
 		double heliostatRadius,
 		TMaterial* materialNode,
-		std::vector< Point3D > aimingPointList,
+		TShapeKit* heliostatSurface,
 		int eje )
 {
 	SoType separatorType = SoType::fromName( SbName ( "TSeparatorKit" ) );
-	SoType shapeKitType = SoType::fromName( SbName ( "TShapeKit" ) );
 
 	SoNodeKitListPart* heliostatsNodePartList = static_cast< SoNodeKitListPart* >( parentNode->getPart( "childList", true ) );
 	if( !heliostatsNodePartList ) return;
 
-	int nHeliostatCenters = ( int ) heliostatCenterList.size();
+	int nHeliostatCenters = last - first;
 	if( nHeliostatCenters < 8 )
 	{
 
 		for( int nHeliostat = 0; nHeliostat < nHeliostatCenters; nHeliostat++ )
 		{
+			unsigned int index = heliostatOrder[first + nHeliostat];
+			const Point3D& hCenter = heliostatCenterList[index];
+
 			TSeparatorKit* heliostatSeparator = static_cast< TSeparatorKit* > ( separatorType.createInstance() );
-			heliostatsNodePartList->addChild(heliostatSeparator);
 			QString heliostatName = QString( QLatin1String( "Heliostat%1" ) ).arg( QString::number( nHeliostat ) );
 			heliostatSeparator->setName( heliostatName.toStdString().c_str() );
 			SoTransform* nodeTransform = dynamic_cast< SoTransform* >( heliostatSeparator->getPart( "transform", true ) );
-			nodeTransform->translation.setValue( heliostatCenterList[nHeliostat].x,
-					heliostatCenterList[nHeliostat].y,
-					heliostatCenterList[nHeliostat].z );
-
-			Point3D hCenter( heliostatCenterList[nHeliostat].x,
-					heliostatCenterList[nHeliostat].y,
-					heliostatCenterList[nHeliostat].z );
+			nodeTransform->translation.setValue( hCenter.x, hCenter.y, hCenter.z );
 
 			SoNodeKitListPart*  heliostatPartList = static_cast< SoNodeKitListPart* >( heliostatSeparator->getPart( "childList", true ) );
 			if( !heliostatPartList ) return;
 
 			TSeparatorKit* heliostatTrackerNode = static_cast< TSeparatorKit* > ( separatorType.createInstance() );
-			heliostatPartList->addChild( heliostatTrackerNode );
 			heliostatTrackerNode->setName( "HeliostatTrackerNode" );
 			SoNodeKitListPart*  heliostaTrackerNodetPartList = static_cast< SoNodeKitListPart* >( heliostatTrackerNode->getPart( "childList", true ) );
 			if( !heliostaTrackerNodetPartList ) return;
@@ -639,138 +726,113 @@ void ComponentHeliostatField::CreateHeliostatZones( std::vector< Point3D >  heli
 
 			SoSFVec3f* aimingPointField = dynamic_cast< SoSFVec3f* > ( tracker->getField ( "aimingPoint" ) );
 
-			if( aimingPointField )	aimingPointField->setValue( SbVec3f( aimingPointList[nHeliostat].x, aimingPointList[nHeliostat].y, aimingPointList[nHeliostat].z) );
+			if( aimingPointField )	aimingPointField->setValue( SbVec3f( aimingPointList[index].x, aimingPointList[index].y, aimingPointList[index].z) );
 
 			if( heliostat == 1 )
 				heliostaTrackerNodetPartList->addChild( heliostatComponent );
 			else if( heliostat == 2 )
 			{
-				TShapeKit* heliostatSurface = static_cast< TShapeKit* > ( shapeKitType.createInstance() );
-				heliostaTrackerNodetPartList->addChild(heliostatSurface);
-
-				TShape* shape = heliostatShapeFactory->CreateTShape();
-
-				if( heliostatShapeFactory->TShapeName() == QString( "Spherical_rectangle" ) )
+				if( heliostatSurface )
+					heliostaTrackerNodetPartList->addChild( heliostatSurface );
+				else
 				{
-					trt::TONATIUH_REAL* hRadiusField = static_cast< trt::TONATIUH_REAL* > ( shape->getField( "radius" ) );
-
-					if( heliostatRadius < 0.0 )
-						hRadiusField->setValue(  2* Distance( aimingPointList[nHeliostat], hCenter ) );
-					else
-						hRadiusField->setValue(  heliostatRadius );
-
-					trt::TONATIUH_REAL* widthXField = static_cast< trt::TONATIUH_REAL* > ( shape->getField( "widthX" ) );
-					widthXField->setValue(  heliostatWidth );
-
-					trt::TONATIUH_REAL* widthZField = static_cast< trt::TONATIUH_REAL* > ( shape->getField( "widthZ" ) );
-					widthZField->setValue(  heliostatHeight );
-				}
-				else if( heliostatShapeFactory->TShapeName() == QString( "Flat_Rectangle" ) )
-				{
-					trt::TONATIUH_REAL* widthXField = static_cast< trt::TONATIUH_REAL* > ( shape->getField( "width" ) );
-					widthXField->setValue(  heliostatWidth );
-
-					trt::TONATIUH_REAL* widthZField = static_cast< trt::TONATIUH_REAL* > ( shape->getField( "height" ) );
-					widthZField->setValue(  heliostatHeight );
+					double radius = ( heliostatRadius < 0.0 ) ? 2* Distance( aimingPointList[index], hCenter ) : heliostatRadius;
+					heliostaTrackerNodetPartList->addChild( CreateHeliostatSurface( heliostatShapeFactory, heliostatWidth, heliostatHeight, radius, materialNode ) );
 				}
-
-				heliostatSurface->setPart("shape", shape);
-				heliostatSurface->setPart("material", materialNode );
 			}
+
+			heliostatPartList->addChild( heliostatTrackerNode );
+			heliostatsNodePartList->addChild( heliostatSeparator );
 		}
 	}
 	else
 	{
-		//TSeparatorKit* heliostatSeparator1 = new TSeparatorKit;
-		TSeparatorKit* heliostatSeparator1 = static_cast< TSeparatorKit* > ( separatorType.createInstance() );
-		heliostatsNodePartList->addChild(heliostatSeparator1);
-		QString heliostatName1 = QString( QLatin1String( "DivisionPor%1_1" ) ).arg( ( eje == 3 )? QString( 'Z' ): QString( 'X' ) );
-		heliostatSeparator1->setName( heliostatName1.toStdString().c_str() );
+		bool splitByZ = ( eje == 3 );
 
-		//TSeparatorKit* heliostatSeparator2 = new TSeparatorKit;
-		TSeparatorKit* heliostatSeparator2 = static_cast< TSeparatorKit* > ( separatorType.createInstance() );
-		heliostatsNodePartList->addChild(heliostatSeparator2);
-		QString heliostatName2 = QString( QLatin1String( "DivisionPor%1_2" ) ).arg( ( eje == 3 )? QString( 'Z' ): QString( 'X' ) );
-		heliostatSeparator2->setName( heliostatName2.toStdString().c_str() );
-
-
-		if( fabs( eje - 3 ) < 0.001 )
+		double coordMin = gc::Infinity;
+		double coordMax = - gc::Infinity;
+		for( unsigned int i = first; i < last; i++ )
 		{
-			std::vector< std::pair < Point3D, Point3D > > coordsAndAimingPoint;
-			for( unsigned int i=0; i < heliostatCenterList.size(); i++)
-				coordsAndAimingPoint.push_back( std::make_pair( heliostatCenterList[i], aimingPointList[i] ) );
+			const Point3D& hCenter = heliostatCenterList[heliostatOrder[i]];
+			double coord = splitByZ ? hCenter.z : hCenter.x;
+			if( coord < coordMin )	coordMin = coord;
+			if( coord > coordMax )	coordMax = coord;
+		}
+		double splitPoint = coordMin + ( 0.5 * ( coordMax - coordMin ) );
 
-			std::sort( coordsAndAimingPoint.begin(), coordsAndAimingPoint.end(), comparePuntosPorZ );
+		std::vector< unsigned int >::iterator zoneBegin = heliostatOrder.begin() + first;
+		std::vector< unsigned int >::iterator zoneEnd = heliostatOrder.begin() + last;
+		std::vector< unsigned int >::iterator zoneSplit = std::partition( zoneBegin, zoneEnd, CenterBelow( &heliostatCenterList, splitByZ, splitPoint ) );
+		if( ( zoneSplit == zoneBegin ) || ( zoneSplit == zoneEnd ) )
+		{
+			//All the heliostats have the same coordinate. They are split in two halves.
+			zoneSplit = zoneBegin + nHeliostatCenters / 2;
+			std::nth_element( zoneBegin, zoneSplit, zoneEnd, CenterOrder( &heliostatCenterList, splitByZ ) );
+		}
+		unsigned int split = first + ( zoneSplit - zoneBegin );
 
-			std::vector< Point3D >::iterator it;
+		//The heliostats of the last zones are named in coordinate order.
+		if( split - first < 8 )	std::sort( zoneBegin, zoneSplit, CenterOrder( &heliostatCenterList, splitByZ ) );
+		if( last - split < 8 )	std::sort( zoneSplit, zoneEnd, CenterOrder( &heliostatCenterList, splitByZ ) );
 
-			double zMin = coordsAndAimingPoint[0].first.z;
-			double zMax = coordsAndAimingPoint[nHeliostatCenters-1].first.z;
+		TSeparatorKit* heliostatSeparator1 = static_cast< TSeparatorKit* > ( separatorType.createInstance() );
+		QString heliostatName1 = QString( QLatin1String( "DivisionPor%1_1" ) ).arg( splitByZ ? QString( 'Z' ): QString( 'X' ) );
+		heliostatSeparator1->setName( heliostatName1.toStdString().c_str() );
 
-			double splitPoint = zMin + ( 0.5 * ( zMax - zMin ) );
-			std::vector< Point3D > hCenterListPart1;
-			std::vector< Point3D > aimingPointListPart1;
-			double position = 0;
+		TSeparatorKit* heliostatSeparator2 = static_cast< TSeparatorKit* > ( separatorType.createInstance() );
+		QString heliostatName2 = QString( QLatin1String( "DivisionPor%1_2" ) ).arg( splitByZ ? QString( 'Z' ): QString( 'X' ) );
+		heliostatSeparator2->setName( heliostatName2.toStdString().c_str() );
 
-			while( ( position < heliostatCenterList.size() )
-					&& ( coordsAndAimingPoint[position].first.z < splitPoint ) )
-			{
-				hCenterListPart1.push_back( coordsAndAimingPoint[position].first );
-				aimingPointListPart1.push_back( coordsAndAimingPoint[position].second );
-				position++;
-			}
+		CreateHeliostatZones( heliostatCenterList, aimingPointList, heliostatOrder, first, split, heliostatSeparator1,
+				heliostatTrackerFactory, heliostatShapeFactory, heliostat, heliostatComponent, heliostatWidth, heliostatHeight, heliostatRadius,
+				materialNode, heliostatSurface, splitByZ ? 1 : 3 );
+		CreateHeliostatZones( heliostatCenterList, aimingPointList, heliostatOrder, split, last, heliostatSeparator2,
+				heliostatTrackerFactory, heliostatShapeFactory, heliostat, heliostatComponent, heliostatWidth, heliostatHeight, heliostatRadius,
+				materialNode, heliostatSurface, splitByZ ? 1 : 3 );
 
-			std::vector< Point3D > hCenterListPart2;
-			std::vector< Point3D > aimingPointListPart2;
-			while( position < heliostatCenterList.size() )
-			{
-				hCenterListPart2.push_back( coordsAndAimingPoint[position].first );
-				aimingPointListPart2.push_back( coordsAndAimingPoint[position].second );
-				position++;
-			}
-			CreateHeliostatZones( hCenterListPart1, heliostatSeparator1, heliostatTrackerFactory, heliostatShapeFactory, heliostat, heliostatComponent, heliostatWidth, heliostatHeight, heliostatRadius,
-					materialNode, aimingPointListPart1, 1 );
-			CreateHeliostatZones( hCenterListPart2, heliostatSeparator2, heliostatTrackerFactory, heliostatShapeFactory, heliostat, heliostatComponent, heliostatWidth, heliostatHeight, heliostatRadius,
-					materialNode, aimingPointListPart2, 1 );
-		}
-		else
-		{
-			std::vector< std::pair < Point3D, Point3D > > coordsAndAimingPoint;
-			for( unsigned int i=0; i < heliostatCenterList.size(); i++)
-				coordsAndAimingPoint.push_back( std::make_pair( heliostatCenterList[i], aimingPointList[i] ) );
+		heliostatsNodePartList->addChild( heliostatSeparator1 );
+		heliostatsNodePartList->addChild( heliostatSeparator2 );
+	}
+}
 
-			std::sort( coordsAndAimingPoint.begin(), coordsAndAimingPoint.end(), comparePuntosPorX );
+/*!
+ * Creates a heliostat surface node with a new \a heliostatShapeFactory shape of the given dimensions and \a materialNode.
+ * The same surface node can be added to several heliostats, so the shape is stored and intersected as a single node.
+ */
+TShapeKit* ComponentHeliostatField::CreateHeliostatSurface( TShapeFactory* heliostatShapeFactory,
+		double heliostatWidth,
+		double heliostatHeight,
+		double heliostatRadius,
+		TMaterial* materialNode )
+{
+	SoType shapeKitType = SoType::fromName( SbName ( "TShapeKit" ) );
+	TShapeKit* heliostatSurface = static_cast< TShapeKit* > ( shapeKitType.createInstance() );
 
-			double xMin = coordsAndAimingPoint[0].first.x;
-			double xMax = coordsAndAimingPoint[nHeliostatCenters-1].first.x;
+	TShape* shape = heliostatShapeFactory->CreateTShape();
+	if( shape && ( heliostatShapeFactory->TShapeName() == QString( "Spherical_rectangle" ) ) )
+	{
+		trt::TONATIUH_REAL* hRadiusField = static_cast< trt::TONATIUH_REAL* > ( shape->getField( "radius" ) );
+		hRadiusField->setValue(  heliostatRadius );
 
-			double splitPoint = xMin + ( 0.5 * ( xMax - xMin ) );
-			std::vector< Point3D > hCenterListPart1;
-			std::vector< Point3D > aimingPointListPart1;
-			double position = 0;
-			while( ( position < heliostatCenterList.size() )
-					&& ( coordsAndAimingPoint[position].first.x < splitPoint ) )
-			{
-				hCenterListPart1.push_back( coordsAndAimingPoint[position].first );
-				aimingPointListPart1.push_back( coordsAndAimingPoint[position].second );
-				position++;
-			}
+		trt::TONATIUH_REAL* widthXField = static_cast< trt::TONATIUH_REAL* > ( shape->getField( "widthX" ) );
+		widthXField->setValue(  heliostatWidth );
 
+		trt::TONATIUH_REAL* widthZField = static_cast< trt::TONATIUH_REAL* > ( shape->getField( "widthZ" ) );
+		widthZField->setValue(  heliostatHeight );
+	}
+	else if( shape && ( heliostatShapeFactory->TShapeName() == QString( "Flat_Rectangle" ) ) )
+	{
+		trt::TONATIUH_REAL* widthXField = static_cast< trt::TONATIUH_REAL* > ( shape->getField( "width" ) );
+		widthXField->setValue(  heliostatWidth );
 
-			std::vector< Point3D > hCenterListPart2;
-			std::vector< Point3D > aimingPointListPart2;
-			while( position < heliostatCenterList.size() )
-			{
-				hCenterListPart2.push_back( coordsAndAimingPoint[position].first );
-				aimingPointListPart2.push_back( coordsAndAimingPoint[position].second );
-				position++;
-			}
-			CreateHeliostatZones( hCenterListPart1, heliostatSeparator1, heliostatTrackerFactory, heliostatShapeFactory, heliostat, heliostatComponent, heliostatWidth, heliostatHeight, heliostatRadius,
-					materialNode, aimingPointListPart1, 3 );
-			CreateHeliostatZones( hCenterListPart2, heliostatSeparator2, heliostatTrackerFactory, heliostatShapeFactory, heliostat, heliostatComponent, heliostatWidth, heliostatHeight, heliostatRadius,
-					materialNode, aimingPointListPart2, 3 );
-		}
+		trt::TONATIUH_REAL* widthZField = static_cast< trt::TONATIUH_REAL* > ( shape->getField( "height" ) );
+		widthZField->setValue(  heliostatHeight );
 	}
+
+	heliostatSurface->setPart("shape", shape);
+	heliostatSurface->setPart("material", materialNode );
+
+	return ( heliostatSurface );
 }
 
 TSeparatorKit* ComponentHeliostatField::OpenHeliostatComponent( QString fileName )
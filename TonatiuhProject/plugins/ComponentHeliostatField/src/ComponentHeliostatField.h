@@ -48,6 +48,7 @@ class QString;
 class SoNode;
 class TSeparatorKit;
 class TShapeFactory;
+class TShapeKit;
 class TMaterial;
 class TTrackerFactory;
 
@@ -62,7 +63,11 @@ public:
 	TSeparatorKit* CreateField(QVector< QVariant >  argumentList);
 
 private:
-	void CreateHeliostatZones( std::vector< Point3D >  heliostatCenterList,
+	void CreateHeliostatZones( const std::vector< Point3D >& heliostatCenterList,
+			const std::vector< Point3D >& aimingPointList,
+			std::vector< unsigned int >& heliostatOrder,
+			unsigned int first,
+			unsigned int last,
 			TSeparatorKit* parentNode,
 			TTrackerFactory* heliostatTrackerFactory,
 			TShapeFactory* heliostatShaperFactory,
@@ -72,8 +77,13 @@ private:
 			double heliostatHeight,
 			double heliostatRadius,
 			TMaterial* materialNode,
-			std::vector< Point3D > aimingPointList,
+			TShapeKit* heliostatSurface,
 			int eje );
+	TShapeKit* CreateHeliostatSurface( TShapeFactory* heliostatShapeFactory,
+			double heliostatWidth,
+			double heliostatHeight,
+			double heliostatRadius,
+			TMaterial* materialNode );
 
 	TSeparatorKit* OpenHeliostatComponent( QString fileName );
 
@@ -158,6 +158,25 @@ bool MaterialStandardRoughSpecular::OutputRay( const Ray& incident, Differential
 	double randomNumber = rand.RandomDouble();
 	if ( randomNumber >= reflectivity.getValue()  ) return false;
 
+	return ( ReflectedRay( incident, dg, rand, outputRay ) );
+}
+
+/*!
+ * Reflects the \a incident ray without absorbing it. The reflected power fraction is returned in \a reflectance.
+ */
+bool MaterialStandardRoughSpecular::WeightedOutputRay( const Ray& incident, DifferentialGeometry* dg, RandomDeviate& rand, Ray* outputRay, double* reflectance ) const
+{
+	*reflectance = reflectivity.getValue();
+	if( *reflectance <= 0.0 )	return ( false );
+
+	return ( ReflectedRay( incident, dg, rand, outputRay ) );
+}
+
+/*!
+ * Computes the \a outputRay reflected from the \a incident ray with the surface slope error.
+ */
+bool MaterialStandardRoughSpecular::ReflectedRay( const Ray& incident, DifferentialGeometry* dg, RandomDeviate& rand, Ray* outputRay ) const
+{
 	//Compute reflected ray (local coordinates )
 	outputRay->origin = dg->point;
 
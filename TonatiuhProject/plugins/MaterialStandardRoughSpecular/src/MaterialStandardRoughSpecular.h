@@ -65,6 +65,7 @@ public:
 
     QString getIcon();
 	bool OutputRay( const Ray& incident, DifferentialGeometry* dg, RandomDeviate& rand, Ray* outputRay  ) const;
+	bool WeightedOutputRay( const Ray& incident, DifferentialGeometry* dg, RandomDeviate& rand, Ray* outputRay, double* reflectance ) const;
 
 	trt::TONATIUH_REAL reflectivity;
 	trt::TONATIUH_REAL sigmaSlope;
@@ -83,6 +84,7 @@ protected:
    	virtual ~MaterialStandardRoughSpecular();
 
    	Vector3D ComputeErrorVector( double simgaError, RandomDeviate& rand ) const;
+   	bool ReflectedRay( const Ray& incident, DifferentialGeometry* dg, RandomDeviate& rand, Ray* outputRay ) const;
 
 	static void updateReflectivity( void* data, SoSensor* );
 	static void updateAmbientColor( void* data, SoSensor* );
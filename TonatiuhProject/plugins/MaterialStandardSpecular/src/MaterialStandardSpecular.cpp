@@ -164,6 +164,25 @@ bool MaterialStandardSpecular::OutputRay( const Ray& incident, DifferentialGeome
 	double randomNumber = rand.RandomDouble();
 	if ( randomNumber >= m_reflectivity.getValue()  ) return false;//return 0;
 
+	return ( ReflectedRay( incident, dg, rand, outputRay ) );
+}
+
+/*!
+ * Reflects the \a incident ray without absorbing it. The reflected power fraction is returned in \a reflectance.
+ */
+bool MaterialStandardSpecular::WeightedOutputRay( const Ray& incident, DifferentialGeometry* dg, RandomDeviate& rand, Ray* outputRay, double* reflectance ) const
+{
+	*reflectance = m_reflectivity.getValue();
+	if( *reflectance <= 0.0 )	return ( false );
+
+	return ( ReflectedRay( incident, dg, rand, outputRay ) );
+}
+
+/*!
+ * Computes the \a outputRay reflected from the \a incident ray with the surface slope error.
+ */
+bool MaterialStandardSpecular::ReflectedRay( const Ray& incident, DifferentialGeometry* dg, RandomDeviate& rand, Ray* outputRay ) const
+{
 	//Compute reflected ray (local coordinates )
 	outputRay->origin = dg->point;
 
@@ -65,6 +65,7 @@ public:
 
     QString getIcon();
 	bool OutputRay( const Ray& incident, DifferentialGeometry* dg, RandomDeviate& rand, Ray* outputRay  ) const;
+	bool WeightedOutputRay( const Ray& incident, DifferentialGeometry* dg, RandomDeviate& rand, Ray* outputRay, double* reflectance ) const;
 
 	trt::TONATIUH_REAL m_reflectivity;
 	trt::TONATIUH_REAL m_sigmaSlope;
@@ -83,6 +84,8 @@ protected:
 
    	double m_sigmaOpt;
 
+   	bool ReflectedRay( const Ray& incident, DifferentialGeometry* dg, RandomDeviate& rand, Ray* outputRay ) const;
+
 	static void updateReflectivity( void* data, SoSensor* );
 	static void updateAmbientColor( void* data, SoSensor* );
 	static void updateDiffuseColor( void* data, SoSensor* );
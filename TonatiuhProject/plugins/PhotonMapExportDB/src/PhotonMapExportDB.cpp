@@ -71,6 +71,17 @@ PhotonMapExportDB::~PhotonMapExportDB()
  */
 void PhotonMapExportDB::EndExport()
 {
+	//Index the photons by surface and position to query a surface or a region without scanning the table
+	if( m_isDBOpened && m_saveSurfaceID && m_saveCoordinates )
+	{
+		char* sErrMsg = 0;
+		sqlite3_exec( m_pDB, "CREATE INDEX IF NOT EXISTS PhotonsSurfacePosition ON Photons( surfaceID, x, y, z );", NULL, NULL, &sErrMsg );
+		if( sErrMsg )
+		{
+			std::cout<< "SQL error: "<<sErrMsg<<"\n"<<std::endl;
+			sqlite3_free( sErrMsg );
+		}
+	}
 	if( m_isDBOpened )	Close();
 }
 
@@ -102,9 +113,9 @@ void PhotonMapExportDB::SavePhotonMap( std::vector< Photon* > raysLists )
 
 	if( !m_isDBOpened )	Open();
 
-	if( m_saveCoordinates && m_saveSide && m_savePrevNexID && m_saveSurfaceID )
+	if( m_saveCoordinates && m_saveSide && m_savePrevNexID && m_saveSurfaceID && !m_saveWeight )
 		SaveAllData( raysLists );
-	else if( m_saveCoordinates && m_saveSide && !m_savePrevNexID && m_saveSurfaceID )
+	else if( m_saveCoordinates && m_saveSide && !m_savePrevNexID && m_saveSurfaceID && !m_saveWeight )
 		SaveNotNextPrevID( raysLists );
 	else
 		SaveSelectedData( raysLists );
@@ -183,18 +194,19 @@ bool PhotonMapExportDB::Close()
     return 1;
 
 }
-void PhotonMapExportDB::InsertSurface( InstanceNode* instance )
+void PhotonMapExportDB::InsertSurface( const Photon* photon )
 {
-	m_surfaceIdentfier.push_back( instance );
-	m_surfaceWorldToObject.push_back( instance->GetIntersectionTransform() );
+	if( photon->surfaceId < 1 )	return;
 
+	if( photon->surfaceId > m_surfaceIdentfier.count() )	m_surfaceIdentfier.resize( photon->surfaceId );
+	if( m_surfaceIdentfier[photon->surfaceId - 1] )	return;
+	m_surfaceIdentfier[photon->surfaceId - 1] = photon->intersectedSurface;
 
-	int surfaceID = m_surfaceIdentfier.size();
-	QString surfaceURL = QString(" ").append( instance->GetNodeURL() );
+	QString surfaceURL = QString(" ").append( photon->intersectedSurface->GetNodeURL() );
 
 	std::stringstream surfaces;
 	surfaces << "Insert into Surfaces values("
-			<< surfaceID << ",'"
+			<< photon->surfaceId << ",'"
 			<< surfaceURL.toStdString().c_str() <<"');";
 	char* sErrMsg = 0;
 	sqlite3_exec( m_pDB, surfaces.str().c_str(), 0, 0, &sErrMsg );
@@ -236,6 +248,9 @@ bool PhotonMapExportDB::Open()
 			if( m_savePrevNexID )
 				createPhotonsTableCmmd.append( QLatin1String( ", previousID INTEGER, nextID INTEGER" ) );
 
+			if( m_saveWeight )
+				createPhotonsTableCmmd.append( QLatin1String( ", weight REAL" ) );
+
 			if( m_saveSurfaceID )
 				createPhotonsTableCmmd.append( QLatin1String( ", surfaceID INTEGER,"
 						" FOREIGN KEY( surfaceID ) REFERENCES surfaces ( id ) " )  );
@@ -341,103 +356,38 @@ void PhotonMapExportDB::SaveAllData( std::vector< Photon* > raysLists )
 	unsigned long nPhotonElements = raysLists.size();
 	double previousPhotonID = 0;
 
-	if( m_saveCoordinatesInGlobal )
-	{
-		for( unsigned int i = 0; i < raysLists.size(); i++ )
-		{
-			Photon* photon = raysLists[i];
-			if( photon->id < 1 )	previousPhotonID = 0;
-
-			sqlite3_bind_text( stmt, 1, QString::number(++m_exportedPhoton ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
-
-			//m_saveCoordinates
-			Point3D photonPos =  m_concentratorToWorld( photon->pos );
-			sqlite3_bind_text( stmt, 2, QString::number( photonPos.x ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
-			sqlite3_bind_text( stmt, 3, QString::number( photonPos.y ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
-			sqlite3_bind_text( stmt, 4, QString::number( photonPos.z ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
-
-			//m_saveSide
-			sqlite3_bind_text( stmt, 5, QString::number( photon->side ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
-
-			//m_savePrevNexID
-			sqlite3_bind_text( stmt, 6, QString::number( previousPhotonID ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
-			int nextPhotonID = 0;
-			if( ( i < ( nPhotonElements - 1 ) ) && ( raysLists[i+1]->id > 0  ) )
-				nextPhotonID = m_exportedPhoton +1;
-			sqlite3_bind_text( stmt, 7, QString::number( nextPhotonID ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
-
-			//m_saveSurfaceID
-			unsigned long urlId = 0;
-			if( photon->intersectedSurface )
-			{
-				if( !m_surfaceIdentfier.contains( photon->intersectedSurface ) )
-					InsertSurface( photon->intersectedSurface );
-
-				urlId = m_surfaceIdentfier.indexOf( photon->intersectedSurface ) + 1;
-
-			}
-			sqlite3_bind_text( stmt, 8, QString::number( urlId ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
-
-
-			sqlite3_step( stmt );
-			sqlite3_clear_bindings( stmt );
-			sqlite3_reset( stmt );
-
-			previousPhotonID = m_exportedPhoton;
-		}
-	}
-	else
+	for( unsigned int i = 0; i < raysLists.size(); i++ )
 	{
-		for( unsigned int i = 0; i < raysLists.size(); i++ )
-		{
-			std::stringstream ss;
-			Photon* photon = raysLists[i];
-			if( photon->id < 1 )	previousPhotonID = 0;
-
-			unsigned long urlId = 0;
-			Transform worldToObject( 1.0, 0.0, 0.0, 0.0,
-					0.0, 1.0, 0.0, 0.0,
-					0.0, 0.0, 1.0, 0.0,
-					0.0, 0.0, 0.0, 1.0 );
-			if( photon->intersectedSurface )
-			{
-
-				if( !m_surfaceIdentfier.contains( photon->intersectedSurface ) )
-					InsertSurface( photon->intersectedSurface );
-
-				urlId = m_surfaceIdentfier.indexOf( photon->intersectedSurface ) ;
-				worldToObject = m_surfaceWorldToObject[urlId];
-				urlId++;
-			}
+		Photon* photon = raysLists[i];
+		if( photon->id < 1 )	previousPhotonID = 0;
+		InsertSurface( photon );
 
+		sqlite3_bind_text( stmt, 1, QString::number(++m_exportedPhoton ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
 
-			sqlite3_bind_text( stmt, 1, QString::number(++m_exportedPhoton ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
+		//m_saveCoordinates
+		sqlite3_bind_text( stmt, 2, QString::number( photon->exportPos.x ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
+		sqlite3_bind_text( stmt, 3, QString::number( photon->exportPos.y ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
+		sqlite3_bind_text( stmt, 4, QString::number( photon->exportPos.z ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
 
-			//m_saveCoordinates
-			Point3D photonPos = worldToObject(  photon->pos );
-			sqlite3_bind_text( stmt, 2, QString::number( photonPos.x ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
-			sqlite3_bind_text( stmt, 3, QString::number( photonPos.y ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
-			sqlite3_bind_text( stmt, 4, QString::number( photonPos.z ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
+		//m_saveSide
+		sqlite3_bind_text( stmt, 5, QString::number( photon->side ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
 
-			//m_saveSide
-			sqlite3_bind_text( stmt, 5, QString::number( photon->side ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
+		//m_savePrevNexID
+		sqlite3_bind_text( stmt, 6, QString::number( previousPhotonID ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
+		int nextPhotonID = 0;
+		if( ( i < ( nPhotonElements - 1 ) ) && ( raysLists[i+1]->id > 0  ) )
+			nextPhotonID = m_exportedPhoton +1;
+		sqlite3_bind_text( stmt, 7, QString::number( nextPhotonID ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
 
-			//m_savePrevNexID
-			sqlite3_bind_text( stmt, 6, QString::number( previousPhotonID ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
-			int nextPhotonID = 0;
-			if( ( i < ( nPhotonElements - 1 ) ) && ( raysLists[i+1]->id > 0  ) )
-				nextPhotonID = m_exportedPhoton +1;
-			sqlite3_bind_text( stmt, 7, QString::number( nextPhotonID ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
+		//m_saveSurfaceID
+		sqlite3_bind_text( stmt, 8, QString::number( photon->surfaceId ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
 
-			//m_saveSurfaceID
-			sqlite3_bind_text( stmt, 8, QString::number( urlId ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
 
+		sqlite3_step( stmt );
+		sqlite3_clear_bindings( stmt );
+		sqlite3_reset( stmt );
 
-			sqlite3_step( stmt );
-			sqlite3_clear_bindings( stmt );
-			sqlite3_reset( stmt );
-			previousPhotonID = m_exportedPhoton;
-		}
+		previousPhotonID = m_exportedPhoton;
 	}
 	int rc = sqlite3_exec( m_pDB, "END TRANSACTION", 0, 0, &sErrMsg );
 
@@ -466,87 +416,28 @@ void PhotonMapExportDB::SaveNotNextPrevID( std::vector< Photon* > raysLists )
 
 	unsigned long nPhotonElements = raysLists.size();
 
-	if( m_saveCoordinatesInGlobal )
-	{
-
-		for( unsigned int i = 0; i < nPhotonElements; i++ )
-		{
-			Photon* photon = raysLists[i];
-
-
-			sqlite3_bind_text( stmt, 1, QString::number(++m_exportedPhoton ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
-
-			//m_saveCoordinates
-			Point3D photonPos =  m_concentratorToWorld( photon->pos );
-			sqlite3_bind_text( stmt, 2, QString::number( photonPos.x ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
-			sqlite3_bind_text( stmt, 3, QString::number( photonPos.y ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
-			sqlite3_bind_text( stmt, 4, QString::number( photonPos.z ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
-
-			//m_saveSide
-			sqlite3_bind_text( stmt, 5, QString::number( photon->side ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
-
-			//m_saveSurfaceID
-			unsigned long urlId = 0;
-			if( photon->intersectedSurface )
-			{
-				if( !m_surfaceIdentfier.contains( photon->intersectedSurface ) )
-					InsertSurface( photon->intersectedSurface );
-
-				urlId = m_surfaceIdentfier.indexOf( photon->intersectedSurface ) + 1;
-
-			}
-			sqlite3_bind_text( stmt, 6, QString::number( urlId ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
-
-
-			sqlite3_step( stmt );
-			sqlite3_clear_bindings( stmt );
-			sqlite3_reset( stmt );
-		}
-	}
-	else
+	for( unsigned int i = 0; i < nPhotonElements; i++ )
 	{
-		for( unsigned int i = 0; i < nPhotonElements; i++ )
-		{
-			std::stringstream ss;
-			Photon* photon = raysLists[i];
-
-			unsigned long urlId = 0;
-			Transform worldToObject( 1.0, 0.0, 0.0, 0.0,
-					0.0, 1.0, 0.0, 0.0,
-					0.0, 0.0, 1.0, 0.0,
-					0.0, 0.0, 0.0, 1.0 );
-			if( photon->intersectedSurface )
-			{
-
-				if( !m_surfaceIdentfier.contains( photon->intersectedSurface ) )
-					InsertSurface( photon->intersectedSurface );
-
-				urlId = m_surfaceIdentfier.indexOf( photon->intersectedSurface ) ;
-				worldToObject = m_surfaceWorldToObject[urlId];
-				urlId++;
-			}
-
-			sqlite3_bind_text( stmt, 1, QString::number(++m_exportedPhoton ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
-
-			//m_saveCoordinates
-			Point3D localPos = worldToObject( photon->pos );
-			sqlite3_bind_text( stmt, 2, QString::number( localPos.x ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
-			sqlite3_bind_text( stmt, 3, QString::number( localPos.y ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
-			sqlite3_bind_text( stmt, 4, QString::number( localPos.z ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
+		Photon* photon = raysLists[i];
+		InsertSurface( photon );
 
-			//m_saveSide
-			sqlite3_bind_text( stmt, 5, QString::number( photon->side ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
+		sqlite3_bind_text( stmt, 1, QString::number(++m_exportedPhoton ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
 
-			//m_saveSurfaceID
-			sqlite3_bind_text( stmt, 6, QString::number( urlId ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
+		//m_saveCoordinates
+		sqlite3_bind_text( stmt, 2, QString::number( photon->exportPos.x ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
+		sqlite3_bind_text( stmt, 3, QString::number( photon->exportPos.y ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
+		sqlite3_bind_text( stmt, 4, QString::number( photon->exportPos.z ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
 
+		//m_saveSide
+		sqlite3_bind_text( stmt, 5, QString::number( photon->side ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
 
-			sqlite3_step( stmt );
-			sqlite3_clear_bindings( stmt );
-			sqlite3_reset( stmt );
+		//m_saveSurfaceID
+		sqlite3_bind_text( stmt, 6, QString::number( photon->surfaceId ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
 
 
-		}
+		sqlite3_step( stmt );
+		sqlite3_clear_bindings( stmt );
+		sqlite3_reset( stmt );
 	}
 	int rc = sqlite3_exec( m_pDB, "END TRANSACTION", 0, 0, &sErrMsg );
 
@@ -572,6 +463,7 @@ void PhotonMapExportDB::SaveSelectedData( std::vector< Photon* > raysLists )
 	if( m_saveCoordinates )	insertCommand.append( ", @x, @y, @z" );
 	if( m_saveSide )	insertCommand.append( ", @side" );
 	if( m_savePrevNexID )	insertCommand.append( ", @prev, @next" );
+	if( m_saveWeight )	insertCommand.append( ", @weight" );
 	if( m_saveSurfaceID )	insertCommand.append( ", @surfaceID" );
 	insertCommand.append( ")" );
 
@@ -590,38 +482,15 @@ void PhotonMapExportDB::SaveSelectedData( std::vector< Photon* > raysLists )
 		Photon* photon = raysLists[i];
 		if( photon->id < 1 )	previousPhotonID = 0;
 
-		unsigned long urlId = 0;
-		Transform worldToObject( 1.0, 0.0, 0.0, 0.0,
-				0.0, 1.0, 0.0, 0.0,
-				0.0, 0.0, 1.0, 0.0,
-				0.0, 0.0, 0.0, 1.0 );
-		if( photon->intersectedSurface )
-		{
-
-			if( !m_surfaceIdentfier.contains( photon->intersectedSurface ) )
-				InsertSurface( photon->intersectedSurface );
-
-			urlId = m_surfaceIdentfier.indexOf( photon->intersectedSurface ) ;
-			worldToObject = m_surfaceWorldToObject[urlId];
-			urlId++;
-		}
+		InsertSurface( photon );
 
 		sqlite3_bind_text( stmt, ++parameterIndex, QString::number(++m_exportedPhoton ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
 
-		if( m_saveCoordinates && m_saveCoordinatesInGlobal )
+		if( m_saveCoordinates )
 		{
-			Point3D photonPos =  m_concentratorToWorld( photon->pos );
-			sqlite3_bind_text( stmt, ++parameterIndex, QString::number( photonPos.x ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
-			sqlite3_bind_text( stmt, ++parameterIndex, QString::number( photonPos.y ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
-			sqlite3_bind_text( stmt, ++parameterIndex, QString::number( photonPos.z ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
-
-		}
-		else if( m_saveCoordinates && !m_saveCoordinatesInGlobal )
-		{
-			Point3D photonPos = worldToObject( photon->pos );
-			sqlite3_bind_text( stmt, ++parameterIndex, QString::number( photonPos.x ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
-			sqlite3_bind_text( stmt, ++parameterIndex, QString::number( photonPos.y ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
-			sqlite3_bind_text( stmt, ++parameterIndex, QString::number( photonPos.z ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
+			sqlite3_bind_text( stmt, ++parameterIndex, QString::number( photon->exportPos.x ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
+			sqlite3_bind_text( stmt, ++parameterIndex, QString::number( photon->exportPos.y ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
+			sqlite3_bind_text( stmt, ++parameterIndex, QString::number( photon->exportPos.z ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
 		}
 
 		if( m_saveSide )
@@ -637,8 +506,11 @@ void PhotonMapExportDB::SaveSelectedData( std::vector< Photon* > raysLists )
 			sqlite3_bind_text( stmt, ++parameterIndex, QString::number( nextPhotonID ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
 		}
 
+		if( m_saveWeight )
+			sqlite3_bind_text( stmt, ++parameterIndex, QString::number( photon->weight ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
+
 		if( m_saveSurfaceID )
-			sqlite3_bind_text( stmt, ++parameterIndex, QString::number( urlId ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
+			sqlite3_bind_text( stmt, ++parameterIndex, QString::number( photon->surfaceId ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
 
 		sqlite3_bind_text( stmt, 1, QString::number(++m_exportedPhoton ).toStdString().c_str(), -1, SQLITE_TRANSIENT );
 
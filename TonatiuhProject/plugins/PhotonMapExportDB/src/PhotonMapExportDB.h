@@ -62,7 +62,7 @@ public:
 
 private:
     bool Close();
-    void InsertSurface( InstanceNode* instance );
+    void InsertSurface( const Photon* photon );
 	bool Open();
 	void SaveAllData( std::vector< Photon* > raysLists );
 	void SaveNotNextPrevID( std::vector< Photon* > raysLists );
@@ -78,7 +78,6 @@ private:
 	bool m_isWPhoton;
     sqlite3* m_pDB;
 	QVector< InstanceNode* > m_surfaceIdentfier;
-	QVector< Transform > m_surfaceWorldToObject;
 
 };
 
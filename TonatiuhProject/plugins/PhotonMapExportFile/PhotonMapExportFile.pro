@@ -20,6 +20,7 @@ HEADERS = src/*.h  \
 			$$(TONATIUH_ROOT)/src/source/gui/SceneModel.h \
 			$$(TONATIUH_ROOT)/src/source/raytracing/DifferentialGeometry.h \
             $$(TONATIUH_ROOT)/src/source/raytracing/Photon.h \
+            $$(TONATIUH_ROOT)/src/source/raytracing/PhotonMapIndex.h \
 			$$(TONATIUH_ROOT)/src/source/raytracing/TCube.h \
 			$$(TONATIUH_ROOT)/src/source/raytracing/TDefaultMaterial.h\
 			$$(TONATIUH_ROOT)/src/source/raytracing/TDefaultSunShape.h \
@@ -48,6 +49,7 @@ SOURCES = src/*.cpp  \
             $$(TONATIUH_ROOT)/src/source/gui/PhotonMapExportParametersWidget.cpp \
 			$$(TONATIUH_ROOT)/src/source/gui/SceneModel.cpp \
             $$(TONATIUH_ROOT)/src/source/raytracing/Photon.cpp \
+            $$(TONATIUH_ROOT)/src/source/raytracing/PhotonMapIndex.cpp \
 			$$(TONATIUH_ROOT)/src/source/raytracing/TCube.cpp \
 			$$(TONATIUH_ROOT)/src/source/raytracing/TDefaultMaterial.cpp \
 			$$(TONATIUH_ROOT)/src/source/raytracing/TDefaultSunShape.cpp \
@@ -0,0 +1,345 @@
+/***************************************************************************
+Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+This file is part of Tonatiuh.
+
+Tonatiuh program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Acknowledgments:
+
+The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+then Chair of the Department of Engineering of the University of Texas at
+Brownsville. From May 2004 to July 2008, it was supported by the Department
+of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+During 2007, NREL also contributed to the validation of Tonatiuh under the
+framework of the Memorandum of Understanding signed with the Spanish
+National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez,
+Juana Amieva, Azael Mancillas, Cesar Cantu.
+***************************************************************************/
+
+#include <cstring>
+
+#include "Photon.h"
+#include "PhotonChunkCodec.h"
+
+namespace
+{
+	const quint32 chunkMagic = 0x545A4348; //"TZCH"
+
+	quint64 DoubleBits( double value )
+	{
+		quint64 bits;
+		std::memcpy( &bits, &value, sizeof( bits ) );
+		return ( bits );
+	}
+
+	double BitsDouble( quint64 bits )
+	{
+		double value;
+		std::memcpy( &value, &bits, sizeof( value ) );
+		return ( value );
+	}
+
+	/*
+	 * Appends \a column to \a data as eight byte planes, the most significant first. The deltas of
+	 * close values share the high bytes and leave long runs of zeros to the compressor.
+	 */
+	void AppendByteColumns( const std::vector< quint64 >& column, QByteArray* data )
+	{
+		int offset = data->size();
+		unsigned long n = column.size();
+		data->resize( offset + int( 8 * n ) );
+
+		char* planes = data->data() + offset;
+		for( int b = 0; b < 8; ++b )
+		{
+			int shift = 8 * ( 7 - b );
+			for( unsigned long i = 0; i < n; ++i )
+				planes[b * n + i] = char( ( column[i] >> shift ) & 0xFF );
+		}
+	}
+
+	bool ReadByteColumns( const QByteArray& data, int* offset, unsigned long n, std::vector< quint64 >* column )
+	{
+		if( ( unsigned long ) ( data.size() - *offset ) < 8 * n )	return ( false );
+
+		const unsigned char* planes = reinterpret_cast< const unsigned char* >( data.constData() + *offset );
+		column->assign( n, 0 );
+		for( int b = 0; b < 8; ++b )
+			for( unsigned long i = 0; i < n; ++i )
+				( *column )[i] = ( ( *column )[i] << 8 ) | planes[b * n + i];
+
+		*offset += int( 8 * n );
+		return ( true );
+	}
+
+	/*
+	 * Appends the XOR of each value of \a values with the previous one.
+	 */
+	void AppendDeltaColumn( const std::vector< double >& values, QByteArray* data )
+	{
+		std::vector< quint64 > column( values.size() );
+		quint64 previous = 0;
+		for( unsigned long i = 0; i < values.size(); ++i )
+		{
+			quint64 bits = DoubleBits( values[i] );
+			column[i] = bits ^ previous;
+			previous = bits;
+		}
+		AppendByteColumns( column, data );
+	}
+
+	bool ReadDeltaColumn( const QByteArray& data, int* offset, unsigned long n, int column, int nColumns,
+			std::vector< double >* values )
+	{
+		std::vector< quint64 > deltas;
+		if( !ReadByteColumns( data, offset, n, &deltas ) )	return ( false );
+
+		quint64 previous = 0;
+		for( unsigned long i = 0; i < n; ++i )
+		{
+			previous ^= deltas[i];
+			( *values )[i * nColumns + column] = BitsDouble( previous );
+		}
+		return ( true );
+	}
+}
+
+/*!
+ * Creates a codec for the photon data \a fields, a combination of PhotonChunkCodec::Field values,
+ * that compresses with zlib \a compressionLevel. The default level is -1.
+ */
+PhotonChunkCodec::PhotonChunkCodec( int fields, int compressionLevel )
+:m_fields( fields ),
+ m_compressionLevel( compressionLevel )
+{
+
+}
+
+/*!
+ * Returns the number of values of each decoded photon: the identifier and the values of the codec fields
+ * in the order of the uncompressed data files.
+ */
+int PhotonChunkCodec::NumberOfColumns() const
+{
+	int nColumns = 1;
+	if( m_fields & Coordinates )	nColumns += 3;
+	if( m_fields & Side )	nColumns += 1;
+	if( m_fields & PrevNextID )	nColumns += 2;
+	if( m_fields & SurfaceID )	nColumns += 1;
+	if( m_fields & Weight )	nColumns += 1;
+	return ( nColumns );
+}
+
+/*!
+ * Returns the compressed payload of the \a numberOfPhotons photons of \a raysLists from \a startIndex.
+ *
+ * \a firstIndex is the first photon written in the same export call. As in the uncompressed files,
+ * a photon has a previous photon link if it is not the first of its ray nor of the call.
+ */
+QByteArray PhotonChunkCodec::Encode( const std::vector< Photon* >& raysLists, unsigned long firstIndex,
+		unsigned long startIndex, unsigned long numberOfPhotons ) const
+{
+	unsigned long n = numberOfPhotons;
+	QByteArray data;
+
+	if( m_fields & Coordinates )
+	{
+		std::vector< double > values( n );
+		for( int axis = 0; axis < 3; ++axis )
+		{
+			for( unsigned long i = 0; i < n; ++i )
+				values[i] = raysLists[startIndex + i]->exportPos[axis];
+			AppendDeltaColumn( values, &data );
+		}
+	}
+
+	int surfaceBits = 0;
+	if( m_fields & SurfaceID )
+	{
+		int maximumID = 0;
+		for( unsigned long i = 0; i < n; ++i )
+			if( raysLists[startIndex + i]->surfaceId > maximumID )	maximumID = raysLists[startIndex + i]->surfaceId;
+		while( ( maximumID >> surfaceBits ) > 0 )	surfaceBits++;
+	}
+
+	if( m_fields & ( PrevNextID | Side | SurfaceID ) )
+	{
+		int width = FlagsWidth( surfaceBits );
+		data.append( char( surfaceBits ) );
+		int offset = data.size();
+		data.resize( offset + int( ( n * width + 7 ) / 8 ) );
+
+		unsigned char* bits = reinterpret_cast< unsigned char* >( data.data() + offset );
+		std::memset( bits, 0, ( n * width + 7 ) / 8 );
+		unsigned long position = 0;
+		for( unsigned long i = 0; i < n; ++i )
+		{
+			unsigned long index = startIndex + i;
+			Photon* photon = raysLists[index];
+
+			quint64 value = 0;
+			int valueBits = 0;
+			if( m_fields & PrevNextID )
+			{
+				bool hasPrevious = ( index > firstIndex ) && !( photon->id < 1 );
+				bool hasNext = ( index + 1 < raysLists.size() ) && ( raysLists[index + 1]->id > 0 );
+				value |= ( hasPrevious ? 1 : 0 ) | ( hasNext ? 2 : 0 );
+				valueBits += 2;
+			}
+			if( m_fields & Side )
+			{
+				value |= quint64( photon->side & 1 ) << valueBits;
+				valueBits += 1;
+			}
+			if( m_fields & SurfaceID )	value |= quint64( photon->surfaceId ) << valueBits;
+
+			for( int b = 0; b < width; ++b, ++position )
+				if( ( value >> b ) & 1 )	bits[position >> 3] |= ( unsigned char ) ( 1 << ( position & 7 ) );
+		}
+	}
+
+	if( m_fields & Weight )
+	{
+		std::vector< double > values( n );
+		for( unsigned long i = 0; i < n; ++i )
+			values[i] = raysLists[startIndex + i]->weight;
+		AppendDeltaColumn( values, &data );
+	}
+
+	return ( qCompress( data, m_compressionLevel ) );
+}
+
+/*!
+ * Decompresses \a payload, a chunk of \a numberOfPhotons photons, to \a values. Each photon is stored in
+ * NumberOfColumns consecutive values with the identifiers starting from \a firstPhotonID.
+ *
+ * Returns false if the payload is not valid.
+ */
+bool PhotonChunkCodec::Decode( const QByteArray& payload, unsigned long numberOfPhotons, double firstPhotonID,
+		std::vector< double >* values ) const
+{
+	QByteArray data = qUncompress( payload );
+
+	unsigned long n = numberOfPhotons;
+	int nColumns = NumberOfColumns();
+	values->assign( n * nColumns, 0.0 );
+	for( unsigned long i = 0; i < n; ++i )
+		( *values )[i * nColumns] = firstPhotonID + i;
+
+	int offset = 0;
+	int column = 1;
+	if( m_fields & Coordinates )
+	{
+		for( int axis = 0; axis < 3; ++axis )
+			if( !ReadDeltaColumn( data, &offset, n, column++, nColumns, values ) )	return ( false );
+	}
+
+	int sideColumn = column;
+	if( m_fields & Side )	column++;
+	int prevNextColumn = column;
+	if( m_fields & PrevNextID )	column += 2;
+	int surfaceColumn = column;
+	if( m_fields & SurfaceID )	column++;
+
+	if( m_fields & ( PrevNextID | Side | SurfaceID ) )
+	{
+		if( offset >= data.size() )	return ( false );
+		int surfaceBits = data[offset++];
+		int width = FlagsWidth( surfaceBits );
+		if( surfaceBits < 0 || surfaceBits > 31 || ( unsigned long ) ( data.size() - offset ) < ( n * width + 7 ) / 8 )
+			return ( false );
+
+		const unsigned char* bits = reinterpret_cast< const unsigned char* >( data.constData() + offset );
+		unsigned long position = 0;
+		for( unsigned long i = 0; i < n; ++i )
+		{
+			quint64 value = 0;
+			for( int b = 0; b < width; ++b, ++position )
+				if( ( bits[position >> 3] >> ( position & 7 ) ) & 1 )	value |= quint64( 1 ) << b;
+
+			double* photonValues = &( *values )[i * nColumns];
+			if( m_fields & PrevNextID )
+			{
+				if( value & 1 )	photonValues[prevNextColumn] = photonValues[0] - 1;
+				if( value & 2 )	photonValues[prevNextColumn + 1] = photonValues[0] + 1;
+				value >>= 2;
+			}
+			if( m_fields & Side )
+			{
+				photonValues[sideColumn] = double( value & 1 );
+				value >>= 1;
+			}
+			if( m_fields & SurfaceID )	photonValues[surfaceColumn] = double( value );
+		}
+		offset += int( ( n * width + 7 ) / 8 );
+	}
+
+	if( m_fields & Weight )
+	{
+		if( !ReadDeltaColumn( data, &offset, n, column, nColumns, values ) )	return ( false );
+	}
+
+	return ( offset == data.size() );
+}
+
+/*!
+ * Reads from \a in the header of the next chunk. Returns false if there is not a valid header.
+ */
+bool PhotonChunkCodec::ReadChunkHeader( QDataStream& in, int* fields, unsigned long* numberOfPhotons,
+		double* firstPhotonID, int* payloadSize )
+{
+	quint32 magic;
+	quint32 chunkFields;
+	quint32 chunkPhotons;
+	double chunkFirstID;
+	qint32 chunkPayloadSize;
+	in>>magic>>chunkFields>>chunkPhotons>>chunkFirstID>>chunkPayloadSize;
+	if( in.status() != QDataStream::Ok || magic != chunkMagic || chunkPayloadSize < 0 )	return ( false );
+
+	*fields = int( chunkFields );
+	*numberOfPhotons = chunkPhotons;
+	*firstPhotonID = chunkFirstID;
+	*payloadSize = chunkPayloadSize;
+	return ( true );
+}
+
+/*!
+ * Writes to \a out the header of a chunk. The payload must be written next.
+ */
+void PhotonChunkCodec::WriteChunkHeader( QDataStream& out, int fields, unsigned long numberOfPhotons,
+		double firstPhotonID, int payloadSize )
+{
+	out<<chunkMagic<<quint32( fields )<<quint32( numberOfPhotons )<<firstPhotonID<<qint32( payloadSize );
+}
+
+/*!
+ * Returns the number of bits packed for each photon with \a surfaceBits bits for the surface identifier.
+ */
+int PhotonChunkCodec::FlagsWidth( int surfaceBits ) const
+{
+	int width = 0;
+	if( m_fields & PrevNextID )	width += 2;
+	if( m_fields & Side )	width += 1;
+	if( m_fields & SurfaceID )	width += surfaceBits;
+	return ( width );
+}
@@ -0,0 +1,97 @@
+/***************************************************************************
+Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+This file is part of Tonatiuh.
+
+Tonatiuh program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Acknowledgments:
+
+The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+then Chair of the Department of Engineering of the University of Texas at
+Brownsville. From May 2004 to July 2008, it was supported by the Department
+of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+During 2007, NREL also contributed to the validation of Tonatiuh under the
+framework of the Memorandum of Understanding signed with the Spanish
+National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez,
+Juana Amieva, Azael Mancillas, Cesar Cantu.
+***************************************************************************/
+
+#ifndef PHOTONCHUNKCODEC_H_
+#define PHOTONCHUNKCODEC_H_
+
+#include <vector>
+
+#include <QByteArray>
+#include <QDataStream>
+
+struct Photon;
+
+/*! *****************************
+ * class PhotonChunkCodec
+ *
+ * Encodes a run of photons as an independent zlib compressed chunk. The data is stored by columns:
+ * the coordinates and the weight as the XOR of each value with the previous one split in byte planes,
+ * and the side, the previous and next photon links and the surface identifier bit packed together.
+ * The photon identifiers are consecutive and only the first one is stored in the chunk header.
+ *
+ * A compressed data file is a sequence of chunks, each one a header followed by its payload, so the
+ * chunks can be located with the headers and decompressed concurrently.
+ * **************************** */
+class PhotonChunkCodec
+{
+
+public:
+	enum Field
+	{
+		Coordinates = 1,
+		Side = 2,
+		PrevNextID = 4,
+		SurfaceID = 8,
+		Weight = 16
+	};
+
+	PhotonChunkCodec( int fields, int compressionLevel = -1 );
+
+	int Fields() const { return ( m_fields ); };
+	int NumberOfColumns() const;
+
+	QByteArray Encode( const std::vector< Photon* >& raysLists, unsigned long firstIndex,
+			unsigned long startIndex, unsigned long numberOfPhotons ) const;
+	bool Decode( const QByteArray& payload, unsigned long numberOfPhotons, double firstPhotonID,
+			std::vector< double >* values ) const;
+
+	static bool ReadChunkHeader( QDataStream& in, int* fields, unsigned long* numberOfPhotons,
+			double* firstPhotonID, int* payloadSize );
+	static void WriteChunkHeader( QDataStream& out, int fields, unsigned long numberOfPhotons,
+			double firstPhotonID, int payloadSize );
+
+	static const int headerSize = 24;
+
+private:
+	int FlagsWidth( int surfaceBits ) const;
+
+	int m_fields;
+	int m_compressionLevel;
+};
+
+#endif /* PHOTONCHUNKCODEC_H_ */
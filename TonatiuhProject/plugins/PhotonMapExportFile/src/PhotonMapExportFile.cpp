@@ -36,6 +36,7 @@ Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez
 Juana Amieva, Azael Mancillas, Cesar Cantu.
 ***************************************************************************/
 
+#include <algorithm>
 #include <iostream>
 
 #include <QDataStream>
@@ -44,11 +45,208 @@ Juana Amieva, Azael Mancillas, Cesar Cantu.
 #include <QFile>
 #include <QFileInfo>
 #include <QMessageBox>
+#include <QSharedPointer>
+#include <QtConcurrentMap>
+#include <QtConcurrentRun>
 
+#include "PhotonChunkCodec.h"
 #include "PhotonMapExportFile.h"
+#include "PhotonMapIndex.h"
 #include "InstanceNode.h"
 #include "SceneModel.h"
 
+namespace
+{
+	/*
+	 * A run of photons to export as a compressed chunk.
+	 */
+	struct PhotonChunk
+	{
+		unsigned long startIndex;
+		unsigned long numberOfPhotons;
+		QByteArray payload;
+	};
+
+	/*
+	 * Functor to compress the photon chunks in parallel.
+	 */
+	struct PhotonChunkEncoder
+	{
+		PhotonChunkEncoder( const PhotonChunkCodec& codec, const std::vector< Photon* >* raysLists, unsigned long firstIndex )
+		:m_codec( codec ),
+		 m_raysLists( raysLists ),
+		 m_firstIndex( firstIndex )
+		{
+
+		}
+
+		typedef void result_type;
+		void operator()( PhotonChunk& chunk ) const
+		{
+			chunk.payload = m_codec.Encode( *m_raysLists, m_firstIndex, chunk.startIndex, chunk.numberOfPhotons );
+		}
+
+		PhotonChunkCodec m_codec;
+		const std::vector< Photon* >* m_raysLists;
+		unsigned long m_firstIndex;
+	};
+
+	/*
+	 * Photons copied from the photon map buffer to be compressed and appended to a data file in the writer thread.
+	 * The photon after the batch, if any, is copied too because it defines the next photon link of the last one.
+	 */
+	struct CompressedPhotonBatch
+	{
+		QString fileName;
+		int fields;
+		unsigned long nPhotonsPerChunk;
+		unsigned long numberOfPhotons;
+		double firstPhotonID;
+		std::vector< Photon > photons;
+	};
+
+	/*
+	 * Compresses the photons of \a batch in parallel chunks and appends the chunks in order to its data file.
+	 */
+	void WriteCompressedPhotonBatch( QSharedPointer< CompressedPhotonBatch > batch )
+	{
+		std::vector< Photon* > raysLists( batch->photons.size() );
+		for( unsigned long i = 0; i < batch->photons.size(); ++i )
+			raysLists[i] = &batch->photons[i];
+
+		QVector< PhotonChunk > chunks;
+		for( unsigned long chunkStart = 0; chunkStart < batch->numberOfPhotons; chunkStart += batch->nPhotonsPerChunk )
+		{
+			PhotonChunk chunk;
+			chunk.startIndex = chunkStart;
+			chunk.numberOfPhotons = std::min( batch->nPhotonsPerChunk, batch->numberOfPhotons - chunkStart );
+			chunks.push_back( chunk );
+		}
+		QtConcurrent::blockingMap( chunks, PhotonChunkEncoder( PhotonChunkCodec( batch->fields ), &raysLists, 0 ) );
+
+		QFile exportFile( batch->fileName );
+		bool isWritten = exportFile.open( QIODevice::Append );
+
+		QDataStream out( &exportFile );
+		double firstPhotonID = batch->firstPhotonID;
+		for( int c = 0; isWritten && ( c < chunks.size() ); ++c )
+		{
+			PhotonChunkCodec::WriteChunkHeader( out, batch->fields, chunks[c].numberOfPhotons, firstPhotonID, chunks[c].payload.size() );
+			out.writeRawData( chunks[c].payload.constData(), chunks[c].payload.size() );
+			firstPhotonID += chunks[c].numberOfPhotons;
+		}
+		isWritten = isWritten && ( out.status() == QDataStream::Ok );
+		exportFile.close();
+
+		if( !isWritten )
+			std::cerr<<"PhotonMapExportFile: error writing "<<batch->fileName.toStdString()<<"."<<std::endl;
+	}
+
+	/*
+	 * Writes to \a out the \a numberOfPhotons photons of \a raysLists from \a startIndex as the uncompressed
+	 * files do, with the PhotonChunkCodec \a fields and the identifiers starting from \a firstPhotonID.
+	 */
+	void WritePhotonValues( QDataStream& out, int fields, const std::vector< Photon* >& raysLists,
+			unsigned long startIndex, unsigned long numberOfPhotons, double firstPhotonID )
+	{
+		for( unsigned long i = 0; i < numberOfPhotons; ++i )
+		{
+			unsigned long index = startIndex + i;
+			Photon* photon = raysLists[index];
+			double photonID = firstPhotonID + i;
+
+			out<<photonID;
+			if( fields & PhotonChunkCodec::Coordinates )	out<<photon->exportPos.x << photon->exportPos.y << photon->exportPos.z;
+			if( fields & PhotonChunkCodec::Side )	out<<double( photon->side );
+			if( fields & PhotonChunkCodec::PrevNextID )
+			{
+				out<<( ( index > 0 && !( photon->id < 1 ) ) ? photonID - 1 : 0.0 );
+				out<<( ( ( index + 1 < raysLists.size() ) && ( raysLists[index + 1]->id > 0 ) ) ? photonID + 1 : 0.0 );
+			}
+			if( fields & PhotonChunkCodec::SurfaceID )	out<<double( photon->surfaceId );
+			if( fields & PhotonChunkCodec::Weight )	out<<photon->weight;
+		}
+	}
+
+	/*
+	 * A run of photons to append to a shard file.
+	 */
+	struct PhotonShard
+	{
+		QFile* file;
+		unsigned long startIndex;
+		unsigned long numberOfPhotons;
+		double firstPhotonID;
+		bool isWritten;
+	};
+
+	/*
+	 * Functor to serialize and write the shards in parallel. Each shard is written with a single call.
+	 */
+	struct PhotonShardWriter
+	{
+		PhotonShardWriter( int fields, unsigned long nPhotonsPerChunk, const std::vector< Photon* >* raysLists )
+		:m_fields( fields ),
+		 m_nPhotonsPerChunk( nPhotonsPerChunk ),
+		 m_raysLists( raysLists )
+		{
+
+		}
+
+		typedef void result_type;
+		void operator()( PhotonShard& shard ) const
+		{
+			QByteArray buffer;
+			QDataStream out( &buffer, QIODevice::WriteOnly );
+			if( m_nPhotonsPerChunk > 0 )
+			{
+				PhotonChunkCodec codec( m_fields );
+				for( unsigned long chunkStart = 0; chunkStart < shard.numberOfPhotons; chunkStart += m_nPhotonsPerChunk )
+				{
+					unsigned long nChunkPhotons = std::min( m_nPhotonsPerChunk, shard.numberOfPhotons - chunkStart );
+					QByteArray payload = codec.Encode( *m_raysLists, 0, shard.startIndex + chunkStart, nChunkPhotons );
+					PhotonChunkCodec::WriteChunkHeader( out, m_fields, nChunkPhotons, shard.firstPhotonID + chunkStart, payload.size() );
+					out.writeRawData( payload.constData(), payload.size() );
+				}
+			}
+			else
+				WritePhotonValues( out, m_fields, *m_raysLists, shard.startIndex, shard.numberOfPhotons, shard.firstPhotonID );
+
+			shard.isWritten = ( shard.file->write( buffer ) == buffer.size() ) && shard.file->flush();
+		}
+
+		int m_fields;
+		unsigned long m_nPhotonsPerChunk;
+		const std::vector< Photon* >* m_raysLists;
+	};
+
+	/*
+	 * Photons copied from the photon map buffer to be split in shards and appended to the shard files in the writer thread.
+	 */
+	struct ShardPhotonBatch
+	{
+		int fields;
+		unsigned long nPhotonsPerChunk;
+		std::vector< Photon > photons;
+		QVector< PhotonShard > shards;
+	};
+
+	/*
+	 * Serializes the shards of \a batch in parallel and appends each one to its shard file.
+	 */
+	void WriteShardPhotonBatch( QSharedPointer< ShardPhotonBatch > batch )
+	{
+		std::vector< Photon* > raysLists( batch->photons.size() );
+		for( unsigned long i = 0; i < batch->photons.size(); ++i )
+			raysLists[i] = &batch->photons[i];
+
+		QtConcurrent::blockingMap( batch->shards, PhotonShardWriter( batch->fields, batch->nPhotonsPerChunk, &raysLists ) );
+		for( int s = 0; s < batch->shards.size(); ++s )
+			if( !batch->shards[s].isWritten )
+				std::cerr<<"PhotonMapExportFile: error writing "<<batch->shards[s].file->fileName().toStdString()<<"."<<std::endl;
+	}
+}
+
 /*!
  * Creates export object to export photon map photons to a file.
  */
@@ -60,7 +258,10 @@ PhotonMapExportFile::PhotonMapExportFile()
  m_exportDirecotryName( QLatin1String( "" ) ),
  m_exportedPhotons( 0 ),
  m_nPhotonsPerFile( -1 ),
- m_oneFile( true )
+ m_nPhotonsPerChunk( 0 ),
+ m_oneFile( true ),
+ m_nShards( 0 ),
+ m_nIndexCellPhotons( 0 )
 {
 
 }
@@ -70,6 +271,8 @@ PhotonMapExportFile::PhotonMapExportFile()
  */
 PhotonMapExportFile::~PhotonMapExportFile()
 {
+	WaitForWriter();
+	CloseShards();
 
 }
 
@@ -82,6 +285,9 @@ QStringList PhotonMapExportFile::GetParameterNames()
 	parametersNames<<QLatin1String( "ExportDirectory" );
 	parametersNames<<QLatin1String( "ExportFile" );
 	parametersNames<<QLatin1String( "FileSize" );
+	parametersNames<<QLatin1String( "CompressedChunkSize" );
+	parametersNames<<QLatin1String( "NumberOfShards" );
+	parametersNames<<QLatin1String( "SpatialIndexCellPhotons" );
 
 	return parametersNames;
 }
@@ -91,6 +297,8 @@ QStringList PhotonMapExportFile::GetParameterNames()
  */
 void PhotonMapExportFile::EndExport()
 {
+	WaitForWriter();
+	CloseShards();
 
 	QDir exportDirectory( m_exportDirecotryName );
 	QString exportFilename;
@@ -111,6 +319,80 @@ void PhotonMapExportFile::EndExport()
 	QTextStream out( &exportFile );
 
 	out<<double( m_powerPerPhoton );
+
+	if( m_nShards > 0 )	WriteShardManifest();
+	if( m_nPhotonsPerChunk > 0 )	WriteChunkIndex();
+
+	//StartExport does not accept the index with compressed photon maps. The index replaces the index file when it is complete.
+	if( m_nIndexCellPhotons > 0 )
+	{
+		QString errorMessage;
+		if( !PhotonMapIndex::Build( exportDirectory.absoluteFilePath( QString( QLatin1String( "%1.pmi" ) ).arg( m_photonsFilename ) ),
+				DataFileNames(), ColumnNames(), m_nIndexCellPhotons, &errorMessage ) )
+			std::cerr<<"PhotonMapExportFile: "<<errorMessage.toStdString()<<std::endl;
+	}
+}
+
+/*!
+ * Restores the exported photons counter and the surfaces identifiers saved with SaveState. The data files are
+ * truncated to the size they had when the state was saved.
+ */
+bool PhotonMapExportFile::RestoreState( QDataStream& in )
+{
+	WaitForWriter();
+
+	quint64 exportedPhotons;
+	qint32 currentFile;
+	QStringList surfacesURL;
+	QList< qint64 > dataFileSizes;
+	in>>exportedPhotons>>currentFile>>surfacesURL>>dataFileSizes;
+	if( in.status() != QDataStream::Ok || !m_pSceneModel )	return 0;
+
+	//The surfaces without photons exported have an empty url
+	QVector< InstanceNode* > surfaceIdentfier;
+	for( int s = 0; s < surfacesURL.count(); ++s )
+	{
+		InstanceNode* surface = 0;
+		if( !surfacesURL[s].isEmpty() )
+		{
+			QModelIndex surfaceIndex = m_pSceneModel->IndexFromNodeUrl( surfacesURL[s] );
+			if( !surfaceIndex.isValid() )	return 0;
+			surface = m_pSceneModel->NodeFromIndex( surfaceIndex );
+		}
+		surfaceIdentfier.push_back( surface );
+	}
+
+	m_exportedPhotons = exportedPhotons;
+	m_currentFile = currentFile;
+	m_surfaceIdentfier = surfaceIdentfier;
+
+	QStringList dataFiles = DataFileNames();
+	if( dataFiles.count() != dataFileSizes.count() )	return 0;
+	for( int f = 0; f < dataFiles.count(); ++f )
+	{
+		QFile dataFile( dataFiles[f] );
+		if( dataFileSizes[f] == 0 )
+		{
+			if( dataFile.exists() && !dataFile.remove() )	return 0;
+		}
+		else if( dataFile.size() < dataFileSizes[f] || !dataFile.resize( dataFileSizes[f] ) )	return 0;
+	}
+
+	//Remove the files started after the checkpoint
+	if( !m_oneFile && m_nShards < 1 )
+	{
+		QDir exportDirectory( m_exportDirecotryName );
+		int nextFile = m_currentFile + 1;
+		QString nextFileName = exportDirectory.absoluteFilePath( QString( QLatin1String( "%1_%2.dat" ) ).arg( m_photonsFilename, QString::number( nextFile ) ) );
+		while( QFile::exists( nextFileName ) )
+		{
+			if( !QFile::remove( nextFileName ) )	return 0;
+			nextFile++;
+			nextFileName = exportDirectory.absoluteFilePath( QString( QLatin1String( "%1_%2.dat" ) ).arg( m_photonsFilename, QString::number( nextFile ) ) );
+		}
+	}
+
+	return 1;
 }
 
 /*!
@@ -118,15 +400,19 @@ void PhotonMapExportFile::EndExport()
  */
 void PhotonMapExportFile::SavePhotonMap( std::vector< Photon* > raysLists )
 {
-	if( m_oneFile )
+	if( m_nShards > 0 )
+		SaveToShards( raysLists );
+	else if( m_oneFile )
 	{
 		QDir exportDirectory( m_exportDirecotryName );
 		QString filename = m_photonsFilename;
 		QString exportFilename = exportDirectory.absoluteFilePath( filename.append( QLatin1String( ".dat" ) ) );
 
-		if( m_saveCoordinates && m_saveSide && m_savePrevNexID && m_saveSurfaceID )
+		if( m_nPhotonsPerChunk > 0 )
+			ExportCompressedPhotons( exportFilename, raysLists, 0, raysLists.size() );
+		else if( m_saveCoordinates && m_saveSide && m_savePrevNexID && m_saveSurfaceID && !m_saveWeight )
 			ExportAllPhotonsAllData( exportFilename, raysLists );
-		else if( m_saveCoordinates && m_saveSide && !m_savePrevNexID && m_saveSurfaceID )
+		else if( m_saveCoordinates && m_saveSide && !m_savePrevNexID && m_saveSurfaceID && !m_saveWeight )
 			ExportAllPhotonsNotNextPrevID( exportFilename, raysLists );
 		else
 			ExportAllPhotonsSelectedData( exportFilename, raysLists );
@@ -135,6 +421,27 @@ void PhotonMapExportFile::SavePhotonMap( std::vector< Photon* > raysLists )
 		SaveToVariousFiles( raysLists );
 }
 
+/*!
+ * Saves the exported photons counter, the surfaces identifiers and the data files sizes to \a out.
+ */
+bool PhotonMapExportFile::SaveState( QDataStream& out ) const
+{
+	//The data file sizes must include the batch being written.
+	WaitForWriter();
+
+	QStringList surfacesURL;
+	for( int s = 0; s < m_surfaceIdentfier.count(); ++s )
+		surfacesURL<<( m_surfaceIdentfier[s] ? m_surfaceIdentfier[s]->GetNodeURL() : QString() );
+
+	QList< qint64 > dataFileSizes;
+	QStringList dataFiles = DataFileNames();
+	for( int f = 0; f < dataFiles.count(); ++f )
+		dataFileSizes<<QFileInfo( dataFiles[f] ).size();
+
+	out<<quint64( m_exportedPhotons )<<qint32( m_currentFile )<<surfacesURL<<dataFileSizes;
+	return ( out.status() == QDataStream::Ok );
+}
+
 /*!
  *	Sets the current power per
  */
@@ -176,13 +483,105 @@ void PhotonMapExportFile::SetSaveParameterValue( QString parameterName, QString
 		}
 
 	}
+
+	//Number of photons of each compressed chunk. The photons are not compressed if it is not positive.
+	else if( parameterName == parameters[3] )
+	{
+		if( parameterValue.toDouble() < 1 )	m_nPhotonsPerChunk = 0;
+		else	m_nPhotonsPerChunk = ( unsigned long ) parameterValue.toDouble();
+	}
+
+	//Number of shard files written in parallel. The shards replace the files of FileSize if it is positive.
+	else if( parameterName == parameters[4] )
+	{
+		if( parameterValue.toDouble() < 1 )	m_nShards = 0;
+		else	m_nShards = int( parameterValue.toDouble() );
+	}
+
+	//Average number of photons of each cell of the spatial index. The index is not built if it is not positive.
+	else if( parameterName == parameters[5] )
+	{
+		if( parameterValue.toDouble() < 1 )	m_nIndexCellPhotons = 0;
+		else	m_nIndexCellPhotons = ( unsigned long ) parameterValue.toDouble();
+	}
+}
+
+/*!
+ * Returns the names of the values exported for each photon.
+ */
+QStringList PhotonMapExportFile::ColumnNames() const
+{
+	QStringList columns;
+	columns<<QLatin1String( "id" );
+	if( m_saveCoordinates  )	columns<<QLatin1String( "x" )<<QLatin1String( "y" )<<QLatin1String( "z" );
+	if(  m_saveSide )	columns<<QLatin1String( "side" );
+	if( m_savePrevNexID )	columns<<QLatin1String( "previous ID" )<<QLatin1String( "next ID" );
+	if( m_saveSurfaceID )	columns<<QLatin1String( "surface ID" );
+	if( m_saveWeight )	columns<<QLatin1String( "weight" );
+	return ( columns );
+}
+
+/*!
+ * Closes the shard files.
+ */
+void PhotonMapExportFile::CloseShards()
+{
+	for( int s = 0; s < m_shardFiles.size(); ++s )
+		delete m_shardFiles[s];
+	m_shardFiles.clear();
+}
+
+/*!
+ * Returns the data files written until now: "<name>.dat", "<name>_1.dat" to "<name>_<current file>.dat" or
+ * the shard files "<name>_shard_1.dat" to "<name>_shard_<number of shards>.dat".
+ */
+QStringList PhotonMapExportFile::DataFileNames() const
+{
+	QDir exportDirectory( m_exportDirecotryName );
+
+	QStringList dataFiles;
+	if( m_nShards > 0 )
+	{
+		for( int s = 1; s <= m_nShards; ++s )
+			dataFiles<<exportDirectory.absoluteFilePath( QString( QLatin1String( "%1_shard_%2.dat" ) ).arg( m_photonsFilename, QString::number( s ) ) );
+	}
+	else if( m_oneFile )
+		dataFiles<<exportDirectory.absoluteFilePath( QString( QLatin1String( "%1.dat" ) ).arg( m_photonsFilename ) );
+	else
+	{
+		for( int f = 1; f <= m_currentFile; ++f )
+			dataFiles<<exportDirectory.absoluteFilePath( QString( QLatin1String( "%1_%2.dat" ) ).arg( m_photonsFilename, QString::number( f ) ) );
+	}
+	return ( dataFiles );
 }
 
 /*!
- * Deletes the files that can be uset to export.
+ * Returns the PhotonChunkCodec fields of the selected photon data.
+ */
+int PhotonMapExportFile::ExportedFields() const
+{
+	int fields = 0;
+	if( m_saveCoordinates )	fields |= PhotonChunkCodec::Coordinates;
+	if( m_saveSide )	fields |= PhotonChunkCodec::Side;
+	if( m_savePrevNexID )	fields |= PhotonChunkCodec::PrevNextID;
+	if( m_saveSurfaceID )	fields |= PhotonChunkCodec::SurfaceID;
+	if( m_saveWeight )	fields |= PhotonChunkCodec::Weight;
+	return ( fields );
+}
+
+/*!
+ * Deletes the files that can be uset to export. Returns false if the parameters are not valid: the spatial index is
+ * only built for uncompressed photon maps.
  */
 bool PhotonMapExportFile::StartExport()
 {
+	WaitForWriter();
+
+	if( m_nIndexCellPhotons > 0 && m_nPhotonsPerChunk > 0 )
+	{
+		std::cerr<<"PhotonMapExportFile: the spatial index is only built for uncompressed photon maps."<<std::endl;
+		return 0;
+	}
 
 	if( m_exportedPhotons < 1  )	RemoveExistingFiles();
 	return 1;
@@ -199,109 +598,70 @@ void PhotonMapExportFile::ExportAllPhotonsAllData( QString filename, std::vector
 	QDataStream out( &exportFile );
 
 	unsigned long nPhotonElements = raysLists.size();
-	if( m_saveCoordinatesInGlobal )
-	{
-		double previousPhotonID = 0;
-		for( unsigned long i = 0; i < nPhotonElements; ++i )
-		{
-
-			Photon* photon = raysLists[i];
-			unsigned long urlId = 0;
-			if( photon->intersectedSurface )
-			{
-				if( !m_surfaceIdentfier.contains( photon->intersectedSurface ) )
-				{
-					m_surfaceIdentfier.push_back( photon->intersectedSurface );
-					urlId = m_surfaceIdentfier.size();
-					m_surfaceWorldToObject.push_back( photon->intersectedSurface->GetIntersectionTransform() );
-				}
-				else
-					urlId = m_surfaceIdentfier.indexOf( photon->intersectedSurface ) + 1;
-			}
-
-			out<<double( ++m_exportedPhotons );
-			if( photon->id < 1 )	previousPhotonID = 0;
-
-
-			//m_saveCoordinates
-			Point3D scenePos = m_concentratorToWorld( photon->pos );
-			out<<scenePos.x << scenePos.y << scenePos.z;
-
-			//m_saveSide
-			double side = double( photon->side );
-			out<<side;
-
-			//m_savePrevNexID
-			out<<previousPhotonID;
-			if( ( i < ( nPhotonElements - 1 ) ) && ( raysLists[i+1]->id > 0  ) )
-				out<< double( m_exportedPhotons +1 );
-			else
-				out <<0.0;
-
-			//m_saveSurfaceID
-			out<<double( urlId );
-
-			previousPhotonID = m_exportedPhotons;
-		}
-
-	}
-	else
+	double previousPhotonID = 0;
+	for( unsigned long i = 0; i < nPhotonElements; ++i )
 	{
-		double previousPhotonID = 0;
-		for( unsigned long i = 0; i < nPhotonElements; ++i )
-		{
-
-			Photon* photon = raysLists[i];
-
-			out<<double( ++m_exportedPhotons );
-			if( photon->id < 1 )	previousPhotonID = 0;
-
-			unsigned long urlId = 0;
-			Transform worldToObject( 1.0, 0.0, 0.0, 0.0,
-					0.0, 1.0, 0.0, 0.0,
-					0.0, 0.0, 1.0, 0.0,
-					0.0, 0.0, 0.0, 1.0 );
-			if( photon->intersectedSurface )
-			{
+		Photon* photon = raysLists[i];
+		InsertSurface( photon );
 
-				if( !m_surfaceIdentfier.contains( photon->intersectedSurface ) )
-				{
-					m_surfaceIdentfier.push_back( photon->intersectedSurface );
-					urlId = m_surfaceIdentfier.size();
-					worldToObject = photon->intersectedSurface->GetIntersectionTransform();
-					m_surfaceWorldToObject.push_back( worldToObject );
-				}
-				else
-				{
-					urlId = m_surfaceIdentfier.indexOf( photon->intersectedSurface ) ;
-					worldToObject = m_surfaceWorldToObject[urlId];
-					urlId++;
-				}
-			}
+		out<<double( ++m_exportedPhotons );
+		if( photon->id < 1 )	previousPhotonID = 0;
 
-			//m_saveCoordinates
-			Point3D localPos = worldToObject( photon->pos );
-			out<<localPos.x << localPos.y << localPos.z;
+		//m_saveCoordinates
+		out<<photon->exportPos.x << photon->exportPos.y << photon->exportPos.z;
 
-			//m_saveSide
-			double side = double( photon->side );
-			out<<side;
+		//m_saveSide
+		double side = double( photon->side );
+		out<<side;
 
-			//m_savePrevNexID
-			out<<previousPhotonID;
-			if( ( i < ( nPhotonElements - 1 ) ) && ( raysLists[i+1]->id > 0  ) )	out<< double( m_exportedPhotons +1 );
-			else out <<0.0;
+		//m_savePrevNexID
+		out<<previousPhotonID;
+		if( ( i < ( nPhotonElements - 1 ) ) && ( raysLists[i+1]->id > 0  ) )
+			out<< double( m_exportedPhotons +1 );
+		else
+			out <<0.0;
 
-			//m_saveSurfaceID
-			out<<double( urlId );
+		//m_saveSurfaceID
+		out<<double( photon->surfaceId );
 
-			previousPhotonID = m_exportedPhotons;
-		}
+		previousPhotonID = m_exportedPhotons;
 	}
 	exportFile.close();
 
 }
 
+/*!
+ * Exports \a numberOfPhotons photons from \a raysLists starting from \a startIndex to file \a filename
+ * as compressed chunks of \a m_nPhotonsPerChunk photons.
+ *
+ * The photons are copied and handed to a writer thread that compresses the chunks in parallel and
+ * appends them to the file in order, so the ray tracing threads that wait for the photon map go on
+ * while the batch is compressed. Only one batch is written at a time.
+ */
+void PhotonMapExportFile::ExportCompressedPhotons( QString filename, std::vector< Photon* > raysLists,
+		unsigned long startIndex, unsigned long numberOfPhotons )
+{
+	QSharedPointer< CompressedPhotonBatch > batch( new CompressedPhotonBatch );
+	batch->fileName = filename;
+	batch->fields = ExportedFields();
+	batch->nPhotonsPerChunk = m_nPhotonsPerChunk;
+	batch->numberOfPhotons = numberOfPhotons;
+	batch->firstPhotonID = double( m_exportedPhotons + 1 );
+
+	unsigned long endIndex = startIndex + numberOfPhotons;
+	unsigned long copyEndIndex = std::min( endIndex + 1, ( unsigned long ) raysLists.size() );
+	batch->photons.reserve( copyEndIndex - startIndex );
+	for( unsigned long i = startIndex; i < copyEndIndex; ++i )
+		batch->photons.push_back( *raysLists[i] );
+
+	for( unsigned long i = startIndex; i < endIndex; ++i )
+		InsertSurface( raysLists[i] );
+	m_exportedPhotons += numberOfPhotons;
+
+	WaitForWriter();
+	m_writerFuture = QtConcurrent::run( WriteCompressedPhotonBatch, batch );
+}
+
 /*!
  * Exports \a raysLists photons data except previous and next photon identifier to file \a filename.
  */
@@ -312,82 +672,23 @@ void PhotonMapExportFile::ExportAllPhotonsNotNextPrevID( QString filename, std::
 	exportFile.open( QIODevice::Append );
 
 	QDataStream out( &exportFile );
-	if( m_saveCoordinatesInGlobal )
-	{
-		unsigned long nPhotons = raysLists.size();
-		for( unsigned long i = 0; i < nPhotons; ++i )
-		{
-			Photon* photon = raysLists[i];
-			unsigned long urlId = 0;
-			if( photon->intersectedSurface )
-			{
-				if( !m_surfaceIdentfier.contains( photon->intersectedSurface ) )
-				{
-					m_surfaceIdentfier.push_back( photon->intersectedSurface );
-					urlId = m_surfaceIdentfier.size();
-					m_surfaceWorldToObject.push_back( photon->intersectedSurface->GetIntersectionTransform() );
-				}
-				else
-					urlId = m_surfaceIdentfier.indexOf( photon->intersectedSurface ) + 1;
 
-			}
-
-			out<<double( ++m_exportedPhotons );
-
-			//m_saveCoordinates
-			Point3D scenePos = m_concentratorToWorld( photon->pos );
-			out<<scenePos.x << scenePos.y << scenePos.z;
-			//out<<photon->pos.x << photon->pos.y << photon->pos.z;
-
-			//m_saveSide
-			out<<double( photon->side );
-
-			//m_saveSurfaceID
-			out<<double( urlId );
-		}
-	}
-	else
+	unsigned long nPhotons = raysLists.size();
+	for( unsigned long i = 0; i < nPhotons; ++i )
 	{
+		Photon* photon = raysLists[i];
+		InsertSurface( photon );
 
-		unsigned long nPhotons = raysLists.size();
-		for( unsigned long i = 0; i < nPhotons; ++i )
-		{
-			Photon* photon = raysLists[i];
-			unsigned long urlId = 0;
-			Transform worldToObject( 1.0, 0.0, 0.0, 0.0,
-							0.0, 1.0, 0.0, 0.0,
-							0.0, 0.0, 1.0, 0.0,
-							0.0, 0.0, 0.0, 1.0 );
-			if( photon->intersectedSurface )
-			{
-				if( !m_surfaceIdentfier.contains( photon->intersectedSurface ) )
-				{
-					m_surfaceIdentfier.push_back( photon->intersectedSurface );
-					urlId = m_surfaceIdentfier.size();
-					worldToObject = photon->intersectedSurface->GetIntersectionTransform();
-					m_surfaceWorldToObject.push_back( worldToObject );
-				}
-				else
-				{
-					urlId = m_surfaceIdentfier.indexOf( photon->intersectedSurface ) ;
-					worldToObject = m_surfaceWorldToObject[urlId];
-					urlId++;
-				}
-
-			}
-			out<<double( ++m_exportedPhotons );
-
-			//m_saveCoordinates
-			Point3D localPos = worldToObject( photon->pos );
-			out<<localPos.x << localPos.y << localPos.z;
+		out<<double( ++m_exportedPhotons );
 
-			//m_saveSide
-			out<<double( photon->side );
+		//m_saveCoordinates
+		out<<photon->exportPos.x << photon->exportPos.y << photon->exportPos.z;
 
-			//m_saveSurfaceID
-			out<<double( urlId );
-		}
+		//m_saveSide
+		out<<double( photon->side );
 
+		//m_saveSurfaceID
+		out<<double( photon->surfaceId );
 	}
 	exportFile.close();
 
@@ -410,38 +711,12 @@ void PhotonMapExportFile::ExportAllPhotonsSelectedData( QString filename, std::v
 	for( unsigned long i = 0; i < nPhotons; ++i )
 	{
 		Photon* photon = raysLists[i];
-		unsigned long urlId = 0;
-		Transform worldToObject( 1.0, 0.0, 0.0, 0.0,
-							0.0, 1.0, 0.0, 0.0,
-							0.0, 0.0, 1.0, 0.0,
-							0.0, 0.0, 0.0, 1.0 );
-		if( photon->intersectedSurface )
-		{
-			if( !m_surfaceIdentfier.contains( photon->intersectedSurface ) )
-			{
-				m_surfaceIdentfier.push_back( photon->intersectedSurface );
-				urlId = m_surfaceIdentfier.size();
-				worldToObject = photon->intersectedSurface->GetIntersectionTransform();
-				m_surfaceWorldToObject.push_back( worldToObject );
-			}
-			else
-			{
-				urlId = m_surfaceIdentfier.indexOf( photon->intersectedSurface ) ;
-				worldToObject = m_surfaceWorldToObject[urlId];
-				urlId++;
-			}
-
-		}
+		InsertSurface( photon );
 
 		out<<double( ++m_exportedPhotons );
 		if( photon->id < 1 )	previousPhotonID = 0;
 
-		if( m_saveCoordinates && m_saveCoordinatesInGlobal )	out<<photon->pos.x << photon->pos.y << photon->pos.z;
-		else if( m_saveCoordinates && !m_saveCoordinatesInGlobal )
-		{
-			Point3D localPos = worldToObject( photon->pos );
-			out<<localPos.x << localPos.y << localPos.z;
-		}
+		if( m_saveCoordinates )	out<<photon->exportPos.x << photon->exportPos.y << photon->exportPos.z;
 
 		if(  m_saveSide )
 		{
@@ -456,7 +731,10 @@ void PhotonMapExportFile::ExportAllPhotonsSelectedData( QString filename, std::v
 		}
 
 		if( m_saveSurfaceID )
-			out<<double( urlId );
+			out<<double( photon->surfaceId );
+
+		if( m_saveWeight )
+			out<<photon->weight;
 
 		previousPhotonID = m_exportedPhotons;
 
@@ -477,108 +755,35 @@ void PhotonMapExportFile::ExportSelectedPhotonsAllData( QString filename, std::v
 	QDataStream out( &exportFile );
 
 	unsigned int nPhotonElements = raysLists.size();
-	if( m_saveCoordinatesInGlobal )
-	{
-		double previousPhotonID = 0;
-		unsigned long exportedPhotonsToFile = 0;
-		while( exportedPhotonsToFile < numberOfPhotons )
-		{
-			Photon* photon = raysLists[startIndex + exportedPhotonsToFile];
-			unsigned long urlId = 0;
-			if( photon->intersectedSurface )
-			{
-				if( !m_surfaceIdentfier.contains( photon->intersectedSurface ) )
-				{
-					m_surfaceIdentfier.push_back( photon->intersectedSurface );
-					urlId = m_surfaceIdentfier.size();
-					m_surfaceWorldToObject.push_back( photon->intersectedSurface->GetIntersectionTransform() );
-				}
-				else
-					urlId = m_surfaceIdentfier.indexOf( photon->intersectedSurface ) + 1;
-			}
-
-			out<<double( ++m_exportedPhotons );
-			if( photon->id < 1 )	previousPhotonID = 0;
-
-			//m_saveCoordinates
-			Point3D scenePos = m_concentratorToWorld( photon->pos );
-			out<<scenePos.x << scenePos.y << scenePos.z;
-			//out<<photon->pos.x << photon->pos.y << photon->pos.z;
-
-			//m_saveSide
-			double side = double( photon->side );
-			out<<side;
-
-			//m_savePrevNexID
-			out<<previousPhotonID;
-			if( ( ( startIndex + exportedPhotonsToFile ) < ( nPhotonElements - 1 ) ) && ( raysLists[startIndex + exportedPhotonsToFile + 1]->id > 0  ) )
-				out<< double( m_exportedPhotons +1 );
-			else
-				out <<0.0;
-
-
-			//m_saveSurfaceID
-			out<<double( urlId );
-
-			previousPhotonID = m_exportedPhotons;
-			exportedPhotonsToFile++;
-
-		}
-	}
-	else
+	double previousPhotonID = 0;
+	unsigned long exportedPhotonsToFile = 0;
+	while( exportedPhotonsToFile < numberOfPhotons )
 	{
-		double previousPhotonID = 0;
-		unsigned long exportedPhotonsToFile = 0;
-		while( exportedPhotonsToFile < numberOfPhotons )
-		{
-			Photon* photon = raysLists[startIndex + exportedPhotonsToFile];
-			unsigned long urlId = 0;
-			Transform worldToObject( 1.0, 0.0, 0.0, 0.0,
-							0.0, 1.0, 0.0, 0.0,
-							0.0, 0.0, 1.0, 0.0,
-							0.0, 0.0, 0.0, 1.0 );
-			if( photon->intersectedSurface )
-			{
-				if( !m_surfaceIdentfier.contains( photon->intersectedSurface ) )
-				{
-					m_surfaceIdentfier.push_back( photon->intersectedSurface );
-					urlId = m_surfaceIdentfier.size();
-					worldToObject = photon->intersectedSurface->GetIntersectionTransform();
-					m_surfaceWorldToObject.push_back( worldToObject );
-				}
-				else
-				{
-					urlId = m_surfaceIdentfier.indexOf( photon->intersectedSurface ) ;
-					worldToObject = m_surfaceWorldToObject[urlId];
-					urlId++;
-				}
-			}
-
-			out<<double( ++m_exportedPhotons );
-			if( photon->id < 1 )	previousPhotonID = 0;
+		Photon* photon = raysLists[startIndex + exportedPhotonsToFile];
+		InsertSurface( photon );
 
-			//m_saveCoordinates
-			Point3D localPos = worldToObject( photon->pos );
-			out<<localPos.x << localPos.y << localPos.z;
+		out<<double( ++m_exportedPhotons );
+		if( photon->id < 1 )	previousPhotonID = 0;
 
-			//m_saveSide
-			double side = double( photon->side );
-			out<<side;
+		//m_saveCoordinates
+		out<<photon->exportPos.x << photon->exportPos.y << photon->exportPos.z;
 
-			//m_savePrevNexID
-			out<<previousPhotonID;
-			if( ( ( startIndex + exportedPhotonsToFile ) < ( nPhotonElements - 1 ) ) && ( raysLists[startIndex + exportedPhotonsToFile + 1]->id > 0  ) )
-				out<< double( m_exportedPhotons +1 );
-			else
-				out <<0.0;
+		//m_saveSide
+		double side = double( photon->side );
+		out<<side;
 
-			//m_saveSurfaceID
-			out<<double( urlId );
+		//m_savePrevNexID
+		out<<previousPhotonID;
+		if( ( ( startIndex + exportedPhotonsToFile ) < ( nPhotonElements - 1 ) ) && ( raysLists[startIndex + exportedPhotonsToFile + 1]->id > 0  ) )
+			out<< double( m_exportedPhotons +1 );
+		else
+			out <<0.0;
 
-			previousPhotonID = m_exportedPhotons;
-			exportedPhotonsToFile++;
-		}
+		//m_saveSurfaceID
+		out<<double( photon->surfaceId );
 
+		previousPhotonID = m_exportedPhotons;
+		exportedPhotonsToFile++;
 	}
 	exportFile.close();
 
@@ -595,86 +800,25 @@ void PhotonMapExportFile::ExportSelectedPhotonsNotNextPrevID( QString filename,
 
 	QDataStream out( &exportFile );
 
-	if( m_saveCoordinatesInGlobal )
-	{
-		unsigned long exportedPhotonsToFile = 0;
-		while( exportedPhotonsToFile < numberOfPhotons )
-		{
-			Photon* photon = raysLists[startIndex + exportedPhotonsToFile];
-			unsigned long urlId = 0;
-			if( photon->intersectedSurface )
-			{
-				if( !m_surfaceIdentfier.contains( photon->intersectedSurface ) )
-				{
-					m_surfaceIdentfier.push_back( photon->intersectedSurface );
-					urlId = m_surfaceIdentfier.size();
-					m_surfaceWorldToObject.push_back( photon->intersectedSurface->GetIntersectionTransform() );
-				}
-				else
-					urlId = m_surfaceIdentfier.indexOf( photon->intersectedSurface ) + 1;
-			}
-
-			out<<double( ++m_exportedPhotons );
-
-			//m_saveCoordinates
-			Point3D scenePos = m_concentratorToWorld( photon->pos );
-			out<<scenePos.x << scenePos.y << scenePos.z;
-			//out<<photon->pos.x << photon->pos.y << photon->pos.z;
-
-			//m_saveSide
-			double side = double( photon->side );
-			out<<side;
-
-			//m_saveSurfaceID
-			out<<double( urlId );
-
-			exportedPhotonsToFile++;
-		}
-	}
-	else
+	unsigned long exportedPhotonsToFile = 0;
+	while( exportedPhotonsToFile < numberOfPhotons )
 	{
-		unsigned long exportedPhotonsToFile = 0;
-		while( exportedPhotonsToFile < numberOfPhotons )
-		{
-			Photon* photon = raysLists[startIndex + exportedPhotonsToFile];
-			unsigned long urlId = 0;
-			Transform worldToObject( 1.0, 0.0, 0.0, 0.0,
-							0.0, 1.0, 0.0, 0.0,
-							0.0, 0.0, 1.0, 0.0,
-							0.0, 0.0, 0.0, 1.0 );
-			if( photon->intersectedSurface )
-			{
-				if( !m_surfaceIdentfier.contains( photon->intersectedSurface ) )
-				{
-					m_surfaceIdentfier.push_back( photon->intersectedSurface );
-					urlId = m_surfaceIdentfier.size();
-					worldToObject = photon->intersectedSurface->GetIntersectionTransform();
-					m_surfaceWorldToObject.push_back( worldToObject );
-				}
-				else
-				{
-					urlId = m_surfaceIdentfier.indexOf( photon->intersectedSurface ) ;
-					worldToObject = m_surfaceWorldToObject[urlId];
-					urlId++;
-				}
-			}
-
-			out<<double( ++m_exportedPhotons );
+		Photon* photon = raysLists[startIndex + exportedPhotonsToFile];
+		InsertSurface( photon );
 
-			//m_saveCoordinates
-			Point3D localPos = worldToObject( photon->pos );
-			out<<localPos.x << localPos.y << localPos.z;
+		out<<double( ++m_exportedPhotons );
 
-			//m_saveSide
-			double side = double( photon->side );
-			out<<side;
+		//m_saveCoordinates
+		out<<photon->exportPos.x << photon->exportPos.y << photon->exportPos.z;
 
-			//m_saveSurfaceID
-			out<<double( urlId );
+		//m_saveSide
+		double side = double( photon->side );
+		out<<side;
 
-			exportedPhotonsToFile++;
-		}
+		//m_saveSurfaceID
+		out<<double( photon->surfaceId );
 
+		exportedPhotonsToFile++;
 	}
 	exportFile.close();
 
@@ -699,43 +843,12 @@ void PhotonMapExportFile::ExportSelectedPhotonsSelectedData( QString filename, s
 	while( exportedPhotonsToFile < numberOfPhotons )
 	{
 		Photon* photon = raysLists[startIndex + exportedPhotonsToFile];
-		unsigned long urlId = 0;
-		Transform worldToObject( 1.0, 0.0, 0.0, 0.0,
-						0.0, 1.0, 0.0, 0.0,
-						0.0, 0.0, 1.0, 0.0,
-						0.0, 0.0, 0.0, 1.0 );
-		if( photon->intersectedSurface )
-		{
-			if( !m_surfaceIdentfier.contains( photon->intersectedSurface ) )
-			{
-				m_surfaceIdentfier.push_back( photon->intersectedSurface );
-				urlId = m_surfaceIdentfier.size();
-				worldToObject = photon->intersectedSurface->GetIntersectionTransform();
-				m_surfaceWorldToObject.push_back( worldToObject );
-			}
-			else
-			{
-				urlId = m_surfaceIdentfier.indexOf( photon->intersectedSurface ) ;
-				worldToObject = m_surfaceWorldToObject[urlId];
-				urlId++;
-			}
-		}
+		InsertSurface( photon );
 
 		out<<double( ++m_exportedPhotons );
 		if( photon->id < 1 )	previousPhotonID = 0;
 
-		if( m_saveCoordinates && m_saveCoordinatesInGlobal )
-		{
-
-			Point3D scenePos = m_concentratorToWorld( photon->pos );
-			out<<scenePos.x << scenePos.y << scenePos.z;
-			//out<<photon->pos.x << photon->pos.y << photon->pos.z;
-		}
-		else if( m_saveCoordinates && !m_saveCoordinatesInGlobal )
-		{
-			Point3D localPos = worldToObject( photon->pos );
-			out<<localPos.x << localPos.y << localPos.z;
-		}
+		if( m_saveCoordinates )	out<<photon->exportPos.x << photon->exportPos.y << photon->exportPos.z;
 
 		if(  m_saveSide )
 		{
@@ -752,7 +865,10 @@ void PhotonMapExportFile::ExportSelectedPhotonsSelectedData( QString filename, s
 		}
 
 		if( m_saveSurfaceID )
-			out<<double( urlId );
+			out<<double( photon->surfaceId );
+
+		if( m_saveWeight )
+			out<<photon->weight;
 
 		previousPhotonID = m_exportedPhotons;
 		exportedPhotonsToFile++;
@@ -761,6 +877,39 @@ void PhotonMapExportFile::ExportSelectedPhotonsSelectedData( QString filename, s
 
 }
 
+/*!
+ * Adds the surface of \a photon to the exported surfaces list with the index tagged by the tracer.
+ */
+void PhotonMapExportFile::InsertSurface( const Photon* photon )
+{
+	if( photon->surfaceId < 1 )	return;
+
+	if( photon->surfaceId > m_surfaceIdentfier.count() )	m_surfaceIdentfier.resize( photon->surfaceId );
+	if( !m_surfaceIdentfier[photon->surfaceId - 1] )	m_surfaceIdentfier[photon->surfaceId - 1] = photon->intersectedSurface;
+}
+
+/*!
+ * Opens the shard files to append the photons. The files stay open until the export ends.
+ */
+bool PhotonMapExportFile::OpenShards()
+{
+	if( !m_shardFiles.isEmpty() )	return ( true );
+
+	QStringList shardFiles = DataFileNames();
+	for( int s = 0; s < shardFiles.count(); ++s )
+	{
+		QFile* shardFile = new QFile( shardFiles[s] );
+		if( !shardFile->open( QIODevice::Append ) )
+		{
+			delete shardFile;
+			CloseShards();
+			return ( false );
+		}
+		m_shardFiles.push_back( shardFile );
+	}
+	return ( true );
+}
+
 /*!
  * Remove existing files that this export type can used.
  */
@@ -769,6 +918,17 @@ void PhotonMapExportFile::RemoveExistingFiles()
 
 	QDir exportDirectory( m_exportDirecotryName );
 	QString filename = m_photonsFilename;
+	QFile::remove( exportDirectory.absoluteFilePath( QString( QLatin1String( "%1_chunks.txt" ) ).arg( m_photonsFilename ) ) );
+	QFile::remove( exportDirectory.absoluteFilePath( QString( QLatin1String( "%1_shards.txt" ) ).arg( m_photonsFilename ) ) );
+	QFile::remove( exportDirectory.absoluteFilePath( QString( QLatin1String( "%1.pmi" ) ).arg( m_photonsFilename ) ) );
+	if( m_nShards > 0 )
+	{
+		QStringList shardFiles = DataFileNames();
+		for( int s = 0; s < shardFiles.count(); ++s )
+			QFile::remove( shardFiles[s] );
+		return;
+	}
+
 	if( m_oneFile )
 	{
 		QString exportFilename = exportDirectory.absoluteFilePath( filename.append( QLatin1String( ".dat" ) ) );
@@ -800,6 +960,56 @@ void PhotonMapExportFile::RemoveExistingFiles()
 	}
 }
 
+/*!
+ * Splits \a raysLists in a contiguous run of photons for each shard and appends the runs to the shard
+ * files in parallel. The photon identifiers are the same as in a single file export.
+ *
+ * As in ExportCompressedPhotons, the photons are copied and the shards are written in the writer thread,
+ * so the ray tracing threads that wait for the photon map do not wait for the compression.
+ */
+void PhotonMapExportFile::SaveToShards( std::vector< Photon* > raysLists )
+{
+	if( !OpenShards() )
+	{
+		std::cerr<<"PhotonMapExportFile: the shard files can not be opened."<<std::endl;
+		return;
+	}
+
+	unsigned long nPhotons = raysLists.size();
+	unsigned long nShards = m_shardFiles.size();
+
+	QSharedPointer< ShardPhotonBatch > batch( new ShardPhotonBatch );
+	batch->fields = ExportedFields();
+	batch->nPhotonsPerChunk = m_nPhotonsPerChunk;
+	batch->photons.reserve( nPhotons );
+	for( unsigned long i = 0; i < nPhotons; ++i )
+		batch->photons.push_back( *raysLists[i] );
+
+	unsigned long startIndex = 0;
+	for( unsigned long s = 0; s < nShards; ++s )
+	{
+		unsigned long endIndex = nPhotons * ( s + 1 ) / nShards;
+		if( endIndex > startIndex )
+		{
+			PhotonShard shard;
+			shard.file = m_shardFiles[s];
+			shard.startIndex = startIndex;
+			shard.numberOfPhotons = endIndex - startIndex;
+			shard.firstPhotonID = double( m_exportedPhotons + startIndex + 1 );
+			shard.isWritten = false;
+			batch->shards.push_back( shard );
+		}
+		startIndex = endIndex;
+	}
+
+	for( unsigned long i = 0; i < nPhotons; ++i )
+		InsertSurface( raysLists[i] );
+	m_exportedPhotons += nPhotons;
+
+	WaitForWriter();
+	m_writerFuture = QtConcurrent::run( WriteShardPhotonBatch, batch );
+}
+
 /*!
  * Exports \a raysLists photons data to files with the same number of photons in each file.
  * Each file stores \a m_nPhotonsPerFile photons.
@@ -825,9 +1035,11 @@ void PhotonMapExportFile::SaveToVariousFiles( std::vector <Photon* > raysLists )
 
 			QString currentFileName = exportDirectory.absoluteFilePath( newName );
 
-			if( m_saveCoordinates && m_saveSide && m_savePrevNexID && m_saveSurfaceID )
+			if( m_nPhotonsPerChunk > 0 )
+				ExportCompressedPhotons( currentFileName, raysLists, startIndex, nPhotonsToExport );
+			else if( m_saveCoordinates && m_saveSide && m_savePrevNexID && m_saveSurfaceID && !m_saveWeight )
 				ExportSelectedPhotonsAllData( currentFileName, raysLists, startIndex, nPhotonsToExport );
-			else if( m_saveCoordinates && m_saveSide && !m_savePrevNexID && m_saveSurfaceID )
+			else if( m_saveCoordinates && m_saveSide && !m_savePrevNexID && m_saveSurfaceID && !m_saveWeight )
 				ExportSelectedPhotonsNotNextPrevID( currentFileName, raysLists, startIndex, nPhotonsToExport );
 			else
 				ExportSelectedPhotonsSelectedData( currentFileName, raysLists, startIndex, nPhotonsToExport );
@@ -852,9 +1064,11 @@ void PhotonMapExportFile::SaveToVariousFiles( std::vector <Photon* > raysLists )
 		QString currentFileName = exportDirectory.absoluteFilePath( newName );
 
 
-		if( m_saveCoordinates && m_saveSide && m_savePrevNexID && m_saveSurfaceID )
+		if( m_nPhotonsPerChunk > 0 )
+			ExportCompressedPhotons( currentFileName, raysLists, startIndex, nPhotonsToExport );
+		else if( m_saveCoordinates && m_saveSide && m_savePrevNexID && m_saveSurfaceID && !m_saveWeight )
 			ExportSelectedPhotonsAllData( currentFileName, raysLists, startIndex, nPhotonsToExport );
-		else if( m_saveCoordinates && m_saveSide && !m_savePrevNexID && m_saveSurfaceID )
+		else if( m_saveCoordinates && m_saveSide && !m_savePrevNexID && m_saveSurfaceID && !m_saveWeight )
 			ExportSelectedPhotonsNotNextPrevID( currentFileName, raysLists, startIndex, nPhotonsToExport );
 		else
 			ExportSelectedPhotonsSelectedData( currentFileName, raysLists, startIndex, nPhotonsToExport );
@@ -862,6 +1076,95 @@ void PhotonMapExportFile::SaveToVariousFiles( std::vector <Photon* > raysLists )
 
 }
 
+/*!
+ * Waits until the writer thread has appended the last batch of compressed or sharded photons to the data files.
+ */
+void PhotonMapExportFile::WaitForWriter() const
+{
+	m_writerFuture.waitForFinished();
+}
+
+/*!
+ * Writes "<name>_chunks.txt" with the data file, offset, number of photons, first photon identifier and
+ * compressed size of each chunk, so the readers can decompress the chunks without scanning the files.
+ */
+void PhotonMapExportFile::WriteChunkIndex()
+{
+	QDir exportDirectory( m_exportDirecotryName );
+	QFile indexFile( exportDirectory.absoluteFilePath( QString( QLatin1String( "%1_chunks.txt" ) ).arg( m_photonsFilename ) ) );
+	if( !indexFile.open( QIODevice::WriteOnly ) )	return;
+
+	QTextStream out( &indexFile );
+	out<<QLatin1String( "file offset photons firstID bytes\n" );
+
+	QStringList dataFiles = DataFileNames();
+	for( int f = 0; f < dataFiles.count(); ++f )
+	{
+		QFile dataFile( dataFiles[f] );
+		if( !dataFile.open( QIODevice::ReadOnly ) )	continue;
+
+		QString dataFileName = QFileInfo( dataFiles[f] ).fileName();
+		QDataStream in( &dataFile );
+		while( !dataFile.atEnd() )
+		{
+			qint64 offset = dataFile.pos();
+			int fields;
+			unsigned long numberOfPhotons;
+			double firstPhotonID;
+			int payloadSize;
+			if( !PhotonChunkCodec::ReadChunkHeader( in, &fields, &numberOfPhotons, &firstPhotonID, &payloadSize ) )	break;
+
+			out<<dataFileName<<QLatin1String( " " )<<offset<<QLatin1String( " " )<<quint64( numberOfPhotons )
+					<<QLatin1String( " " )<<quint64( firstPhotonID )<<QLatin1String( " " )<<payloadSize<<QLatin1String( "\n" );
+			if( !dataFile.seek( offset + PhotonChunkCodec::headerSize + payloadSize ) )	break;
+		}
+	}
+}
+
+/*!
+ * Writes "<name>_shards.txt" with the number of photons and bytes of each shard file and the power per photon.
+ */
+void PhotonMapExportFile::WriteShardManifest()
+{
+	QDir exportDirectory( m_exportDirecotryName );
+	QFile manifestFile( exportDirectory.absoluteFilePath( QString( QLatin1String( "%1_shards.txt" ) ).arg( m_photonsFilename ) ) );
+	if( !manifestFile.open( QIODevice::WriteOnly ) )	return;
+
+	QTextStream out( &manifestFile );
+	out<<QString( QLatin1String( "START SHARDS\n" ) );
+
+	int photonSize = 8 * PhotonChunkCodec( ExportedFields() ).NumberOfColumns();
+	QStringList shardFiles = DataFileNames();
+	for( int s = 0; s < shardFiles.count(); ++s )
+	{
+		QFile shardFile( shardFiles[s] );
+		quint64 shardPhotons = 0;
+		if( m_nPhotonsPerChunk < 1 )	shardPhotons = shardFile.size() / photonSize;
+		else if( shardFile.open( QIODevice::ReadOnly ) )
+		{
+			QDataStream in( &shardFile );
+			while( !shardFile.atEnd() )
+			{
+				qint64 offset = shardFile.pos();
+				int fields;
+				unsigned long numberOfPhotons;
+				double firstPhotonID;
+				int payloadSize;
+				if( !PhotonChunkCodec::ReadChunkHeader( in, &fields, &numberOfPhotons, &firstPhotonID, &payloadSize ) )	break;
+
+				shardPhotons += numberOfPhotons;
+				if( !shardFile.seek( offset + PhotonChunkCodec::headerSize + payloadSize ) )	break;
+			}
+		}
+
+		out<<QFileInfo( shardFiles[s] ).fileName()<<QLatin1String( " " )<<shardPhotons
+				<<QLatin1String( " " )<<QFileInfo( shardFiles[s] ).size()<<QLatin1String( "\n" );
+	}
+
+	out<<QString( QLatin1String( "END SHARDS\n" ) );
+	out<<QString( QLatin1String( "wPhoton %1\n" ) ).arg( QString::number( m_powerPerPhoton, 'g', 17 ) );
+}
+
 /*!
  * Writes the file or first file header with the format.
  */
@@ -872,30 +1175,24 @@ void PhotonMapExportFile::WriteFileFormat( QString exportFilename )
 	exportFile.open( QIODevice::WriteOnly );
 	QTextStream out( &exportFile );
 	out<<QString( QLatin1String( "START PARAMETERS\n" ) );
-	out<<QString( QLatin1String( "id\n" ) );
-	if( m_saveCoordinates  )
-	{
-		out<<QString( QLatin1String( "x\n" ) );
-		out<<QString( QLatin1String( "y\n" ) );
-		out<<QString( QLatin1String( "z\n" ) );
-	}
-	if(  m_saveSide )	out<<QString( QLatin1String( "side\n" ) );
-	if( m_savePrevNexID )
-	{
-		out<<QString( QLatin1String( "previous ID\n" ) );
-		out<<QString( QLatin1String( "next ID\n" ) );
-	}
-	if( m_saveSurfaceID )
+	QStringList columns = ColumnNames();
+	for( int c = 0; c < columns.count(); ++c )
+		out<<columns[c]<<QLatin1String( "\n" );
+	out<<QString( QLatin1String( "END PARAMETERS\n" ) );
+
+	if( m_nPhotonsPerChunk > 0 )
 	{
-		out<<QString( QLatin1String( "surface ID\n" ) );
+		out<<QString( QLatin1String( "START COMPRESSION\n" ) );
+		out<<QString( QLatin1String( "zlib chunks %1\n" ) ).arg( QString::number( m_nPhotonsPerChunk ) );
+		out<<QString( QLatin1String( "index %1_chunks.txt\n" ) ).arg( m_photonsFilename );
+		out<<QString( QLatin1String( "END COMPRESSION\n" ) );
 	}
 
-	out<<QString( QLatin1String( "END PARAMETERS\n" ) );
-
 
 	out<<QString( QLatin1String( "START SURFACES\n" ) );
 	for( int s = 0; s < m_surfaceIdentfier.count(); s++ )
 	{
+		if( !m_surfaceIdentfier[s] )	continue;
 		QString surfaceURL = m_surfaceIdentfier[s]->GetNodeURL();
 		out<<QString( QLatin1String( "%1 %2\n" ) ).arg( QString::number( s+1 ),
 				surfaceURL);
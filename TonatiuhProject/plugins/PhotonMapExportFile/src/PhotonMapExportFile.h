@@ -39,12 +39,14 @@ Juana Amieva, Azael Mancillas, Cesar Cantu.
 #ifndef EXPORTPHOTONMAPFILE_H_
 #define EXPORTPHOTONMAPFILE_H_
 
+#include <QFuture>
 #include <QMap>
 #include <QString>
 
 #include "PhotonMapExport.h"
 
 class Photon;
+class QFile;
 
 class PhotonMapExportFile : public PhotonMapExport
 {
@@ -56,13 +58,17 @@ public:
 	static QStringList GetParameterNames();
 
 	void EndExport();
+	bool RestoreState( QDataStream& in );
 	void SavePhotonMap( std::vector< Photon* > raysLists );
+	bool SaveState( QDataStream& out ) const;
 	void SetPowerPerPhoton( double wPhoton );
 	void SetSaveParameterValue( QString parameterName, QString parameterValue );
 	bool StartExport();
 
 private:
 	void ExportAllPhotonsAllData( QString filename, std::vector< Photon* > raysLists );
+	void ExportCompressedPhotons( QString filename, std::vector< Photon* > raysLists,
+			unsigned long startIndex, unsigned long numberOfPhotons );
 	void ExportAllPhotonsNotNextPrevID( QString filename, std::vector< Photon* > raysLists );
 	void ExportAllPhotonsSelectedData( QString filename, std::vector< Photon* > raysLists );
 	void ExportSelectedPhotonsAllData( QString filename, std::vector< Photon* > raysLists,
@@ -73,20 +79,36 @@ private:
 			unsigned long startIndex, 	unsigned long numberOfPhotons );
 
 
+    void CloseShards();
+    QStringList ColumnNames() const;
+    QStringList DataFileNames() const;
+    int ExportedFields() const;
+    void InsertSurface( const Photon* photon );
+    bool OpenShards();
     void RemoveExistingFiles();
+    void SaveToShards( std::vector< Photon* > raysLists );
     void SaveToVariousFiles( std::vector <Photon* > raysLists );
+    void WaitForWriter() const;
+    void WriteChunkIndex();
     void WriteFileFormat( QString exportFilename );
+    void WriteShardManifest();
 
 
 	QString m_photonsFilename;
 	double m_powerPerPhoton;
 	QVector< InstanceNode* > m_surfaceIdentfier;
-	QVector< Transform > m_surfaceWorldToObject;
 	int m_currentFile;
 	QString m_exportDirecotryName;
 	unsigned long m_exportedPhotons;
 	unsigned long m_nPhotonsPerFile;
+	unsigned long m_nPhotonsPerChunk;
 	bool m_oneFile;
+	int m_nShards;
+	QVector< QFile* > m_shardFiles;
+	unsigned long m_nIndexCellPhotons;
+
+	//Writer thread of the last batch of compressed or sharded photons.
+	mutable QFuture< void > m_writerFuture;
 
 };
 
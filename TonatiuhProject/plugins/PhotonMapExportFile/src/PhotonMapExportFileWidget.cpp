@@ -94,9 +94,44 @@ QString PhotonMapExportFileWidget::GetParameterValue( QString parameter ) const
 		else	return QString::number( nOfPhotonsSpin->value() );
 	}
 
+	//Number of photons of each compressed chunk.
+	else if( parameter == parametersName[3] )
+	{
+		if( !compressCheck->isChecked() )	return QString::number( -1 );
+		else	return QString::number( nOfChunkPhotonsSpin->value() );
+	}
+
+	//Number of shard files written in parallel.
+	else if( parameter == parametersName[4] )
+	{
+		if( !shardsCheck->isChecked() )	return QString::number( -1 );
+		else	return QString::number( nOfShardsSpin->value() );
+	}
+
+	//Average number of photons of each cell of the spatial index.
+	else if( parameter == parametersName[5] )
+	{
+		if( !spatialIndexCheck->isChecked() )	return QString::number( -1 );
+		else	return QString::number( nOfCellPhotonsSpin->value() );
+	}
+
 	return QString();
 }
 
+/*!
+ * Unchecks the option just checked if the spatial index and the compression are both checked,
+ * because the spatial index is only built for uncompressed photon maps.
+ */
+void PhotonMapExportFileWidget::CheckSpatialIndex()
+{
+	if( !spatialIndexCheck->isChecked() || !compressCheck->isChecked() )	return;
+
+	QMessageBox::information( this, QLatin1String( "Tonatiuh" ),
+			tr( "The spatial index is only built for uncompressed photon maps." ), 1 );
+	if( sender() == compressCheck )	compressCheck->setChecked( false );
+	else	spatialIndexCheck->setChecked( false );
+}
+
 /*!
  * Select existing directory to save the data exported from the photon.
  */
@@ -130,4 +165,6 @@ void PhotonMapExportFileWidget::SelectSaveDirectory()
 void PhotonMapExportFileWidget::SetupTriggers()
 {
 	connect( selectDirectoryButton, SIGNAL( clicked() ), this, SLOT( SelectSaveDirectory() ) );
+	connect( compressCheck, SIGNAL( toggled( bool ) ), this, SLOT( CheckSpatialIndex() ) );
+	connect( spatialIndexCheck, SIGNAL( toggled( bool ) ), this, SLOT( CheckSpatialIndex() ) );
 }
@@ -57,6 +57,7 @@ public:
     QString GetParameterValue( QString parameter ) const;
 
 private slots:
+	void CheckSpatialIndex();
 	void SelectSaveDirectory();
 
 private:
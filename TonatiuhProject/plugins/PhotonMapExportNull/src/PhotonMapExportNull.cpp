@@ -71,6 +71,14 @@ void PhotonMapExportNull::EndExport()
 
 }
 
+/*!
+ * There is no state to restore.
+ */
+bool PhotonMapExportNull::RestoreState( QDataStream& /*in*/ )
+{
+	return 1;
+}
+
 /*!
  * Nothing is done
  */
@@ -79,6 +87,14 @@ void PhotonMapExportNull::SavePhotonMap( std::vector< Photon* > /*raysLists*/ )
 
 }
 
+/*!
+ * There is no state to save.
+ */
+bool PhotonMapExportNull::SaveState( QDataStream& /*out*/ ) const
+{
+	return 1;
+}
+
 /*!
  * Nothing is done
  */
@@ -57,7 +57,9 @@ public:
 	static QStringList GetParameterNames();
 
 	void EndExport();
+	bool RestoreState( QDataStream& in );
 	void SavePhotonMap( std::vector< Photon* > raysLists );
+	bool SaveState( QDataStream& out ) const;
 	void SetPowerPerPhoton( double wPhoton );
 	void SetSaveParameterValue( QString parameterName, QString parameterValue );
 	bool StartExport();
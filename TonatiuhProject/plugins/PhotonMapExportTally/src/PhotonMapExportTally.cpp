@@ -0,0 +1,237 @@
+/***************************************************************************
+Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+This file is part of Tonatiuh.
+
+Tonatiuh program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Acknowledgments:
+
+The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+then Chair of the Department of Engineering of the University of Texas at
+Brownsville. From May 2004 to July 2008, it was supported by the Department
+of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+During 2007, NREL also contributed to the validation of Tonatiuh under the
+framework of the Memorandum of Understanding signed with the Spanish
+National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez,
+Juana Amieva, Azael Mancillas, Cesar Cantu.
+***************************************************************************/
+
+#include <iostream>
+
+#include <QDir>
+#include <QFile>
+#include <QTextStream>
+
+#include "InstanceNode.h"
+#include "PhotonMapExportTally.h"
+#include "SceneModel.h"
+
+/*!
+ * Creates an export mode that tallies the photons by surface.
+ */
+PhotonMapExportTally::PhotonMapExportTally()
+:PhotonMapExport(),
+ m_exportDirecotryName( QLatin1String( "" ) ),
+ m_tallyFilename( QLatin1String( "" ) ),
+ m_powerPerPhoton( 0.0 )
+{
+
+}
+
+/*!
+ * Destroys the object.
+ */
+PhotonMapExportTally::~PhotonMapExportTally()
+{
+
+}
+
+/*!
+ * Returns the plugin parameters names.
+ */
+QStringList PhotonMapExportTally::GetParameterNames()
+{
+	QStringList parametersNames;
+	parametersNames<<QLatin1String( "ExportDirectory" );
+	parametersNames<<QLatin1String( "ExportFile" );
+
+	return parametersNames;
+}
+
+/*!
+ * Writes the tally table to "<file>_tally.txt". Each row has the surface identifier, the side, the photons
+ * and absorbed photons, the power and absorbed power in W, and the surface url.
+ */
+void PhotonMapExportTally::EndExport()
+{
+	QDir exportDirectory( m_exportDirecotryName );
+	QString tallyFilename = exportDirectory.absoluteFilePath( QString( QLatin1String( "%1_tally.txt" ) ).arg( m_tallyFilename ) );
+
+	QFile tallyFile( tallyFilename );
+	if( !tallyFile.open( QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text ) )
+	{
+		std::cerr<<"PhotonMapExportTally: cannot open file '"<<tallyFilename.toStdString()<<"'."<<std::endl;
+		return;
+	}
+
+	QTextStream out( &tallyFile );
+	out<<"id\tside\tphotons\tabsorbed_photons\tpower\tabsorbed_power\tsurface\n";
+
+	PhotonTallyCounts counts = m_tally.Counts();
+	for( int s = 0; s < counts.NumberOfSurfaces(); ++s )
+	{
+		if( !counts.surfaces[s] )	continue;
+		QString surfaceURL = counts.surfaces[s]->GetNodeURL();
+		for( int side = 0; side < 2; ++side )
+		{
+			int index = 2 * s + side;
+			if( counts.hits[index] == 0.0 )	continue;
+			out<<s<<"\t"<<side<<"\t"
+				<<qulonglong( counts.hits[index] )<<"\t"<<qulonglong( counts.absorbedHits[index] )<<"\t"
+				<<counts.weights[index] * m_powerPerPhoton<<"\t"<<counts.absorbedWeights[index] * m_powerPerPhoton<<"\t"
+				<<surfaceURL<<"\n";
+		}
+	}
+
+	out<<"wPhoton\t"<<m_powerPerPhoton<<"\n";
+}
+
+/*!
+ * Returns the tally where the ray tracing threads count the photons.
+ */
+PhotonTally* PhotonMapExportTally::GetPhotonTally()
+{
+	return ( &m_tally );
+}
+
+/*!
+ * Restores the tally saved with SaveState.
+ */
+bool PhotonMapExportTally::RestoreState( QDataStream& in )
+{
+	QStringList surfacesURL;
+	QList< double > hits;
+	QList< double > absorbedHits;
+	QList< double > weights;
+	QList< double > absorbedWeights;
+	in>>surfacesURL>>hits>>absorbedHits>>weights>>absorbedWeights;
+	if( in.status() != QDataStream::Ok || !m_pSceneModel )	return 0;
+
+	int nCounts = 2 * surfacesURL.count();
+	if( hits.count() != nCounts || absorbedHits.count() != nCounts ||
+			weights.count() != nCounts || absorbedWeights.count() != nCounts )
+		return 0;
+
+	//The surfaces without photons have an empty url
+	PhotonTallyCounts counts;
+	for( int s = 0; s < surfacesURL.count(); ++s )
+	{
+		InstanceNode* surface = 0;
+		if( !surfacesURL[s].isEmpty() )
+		{
+			QModelIndex surfaceIndex = m_pSceneModel->IndexFromNodeUrl( surfacesURL[s] );
+			if( !surfaceIndex.isValid() )	return 0;
+			surface = m_pSceneModel->NodeFromIndex( surfaceIndex );
+		}
+		counts.surfaces.push_back( surface );
+	}
+
+	counts.hits = hits.toVector().toStdVector();
+	counts.absorbedHits = absorbedHits.toVector().toStdVector();
+	counts.weights = weights.toVector().toStdVector();
+	counts.absorbedWeights = absorbedWeights.toVector().toStdVector();
+	m_tally.SetCounts( counts );
+
+	return 1;
+}
+
+/*!
+ * The photons are tallied by the ray tracing threads and never reach the export.
+ */
+void PhotonMapExportTally::SavePhotonMap( std::vector< Photon* > /*raysLists*/ )
+{
+
+}
+
+/*!
+ * Saves the tally to restore it after a checkpoint with RestoreState.
+ */
+bool PhotonMapExportTally::SaveState( QDataStream& out ) const
+{
+	PhotonTallyCounts counts = m_tally.Counts();
+
+	QStringList surfacesURL;
+	for( int s = 0; s < counts.NumberOfSurfaces(); ++s )
+		surfacesURL<<( counts.surfaces[s] ? counts.surfaces[s]->GetNodeURL() : QString() );
+
+	out<<surfacesURL
+		<<QVector< double >::fromStdVector( counts.hits ).toList()
+		<<QVector< double >::fromStdVector( counts.absorbedHits ).toList()
+		<<QVector< double >::fromStdVector( counts.weights ).toList()
+		<<QVector< double >::fromStdVector( counts.absorbedWeights ).toList();
+	return ( out.status() == QDataStream::Ok );
+}
+
+/*!
+ * Sets the power of each photon to \a wPhoton.
+ */
+void PhotonMapExportTally::SetPowerPerPhoton( double wPhoton )
+{
+	m_powerPerPhoton = wPhoton;
+}
+
+/*!
+ * Sets to parameter \a parameterName the value \a parameterValue.
+ */
+void PhotonMapExportTally::SetSaveParameterValue( QString parameterName, QString parameterValue )
+{
+	QStringList parameters = GetParameterNames();
+
+	//Directory name
+	if( parameterName == parameters[0] )
+		m_exportDirecotryName = parameterValue;
+
+	//File name
+	else if( parameterName == parameters[1] )
+		m_tallyFilename = parameterValue;
+}
+
+/*!
+ * Checks that the table can be written. The tally is not emptied, it can be restored from a checkpoint.
+ */
+bool PhotonMapExportTally::StartExport()
+{
+	QDir exportDirectory( m_exportDirecotryName );
+	if( m_exportDirecotryName.isEmpty() || !exportDirectory.exists() )
+	{
+		std::cerr<<"PhotonMapExportTally: the export directory is not valid."<<std::endl;
+		return 0;
+	}
+	if( m_tallyFilename.isEmpty() )
+	{
+		std::cerr<<"PhotonMapExportTally: the export file name is not defined."<<std::endl;
+		return 0;
+	}
+
+	return 1;
+}
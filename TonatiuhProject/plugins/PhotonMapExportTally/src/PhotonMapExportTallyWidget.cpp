@@ -0,0 +1,119 @@
+/***************************************************************************
+Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+This file is part of Tonatiuh.
+
+Tonatiuh program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Acknowledgments:
+
+The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+then Chair of the Department of Engineering of the University of Texas at
+Brownsville. From May 2004 to July 2008, it was supported by the Department
+of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+During 2007, NREL also contributed to the validation of Tonatiuh under the
+framework of the Memorandum of Understanding signed with the Spanish
+National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez,
+Juana Amieva, Azael Mancillas, Cesar Cantu.
+***************************************************************************/
+
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QSettings>
+
+#include "PhotonMapExportTally.h"
+#include "PhotonMapExportTallyWidget.h"
+
+/*!
+ * Creates a widget for the plugin parameters.
+ */
+PhotonMapExportTallyWidget::PhotonMapExportTallyWidget( QWidget* parent )
+:PhotonMapExportParametersWidget( parent)
+{
+	setupUi( this );
+	SetupTriggers();
+}
+
+/*!
+ * Destroys widget object.
+ */
+PhotonMapExportTallyWidget::~PhotonMapExportTallyWidget()
+{
+
+}
+
+/*!
+ * Returns the plugin parameters names.
+ */
+QStringList PhotonMapExportTallyWidget::GetParameterNames() const
+{
+	return PhotonMapExportTally::GetParameterNames();
+}
+
+/*!
+ * Returns the value of the parameter \a parameter.
+ */
+QString PhotonMapExportTallyWidget::GetParameterValue( QString parameter ) const
+{
+	QStringList parametersName = GetParameterNames();
+
+	//Directory name
+	if( parameter == parametersName[0] )
+		return saveDirectoryLine->text();
+
+	//File name.
+	else if( parameter == parametersName[1] )
+		return filenameLine->text();
+
+	return QString();
+}
+
+/*!
+ * Select existing directory to save the tally table.
+ */
+void PhotonMapExportTallyWidget::SelectSaveDirectory()
+{
+	QSettings settings( QLatin1String( "NREL UTB CENER" ), QLatin1String( "Tonatiuh" ) );
+	QString lastUsedDirectory = settings.value( QLatin1String( "PhotonMapExportTallyWidget.directoryToExport" ),
+			QLatin1String( "." ) ).toString();
+
+	QString directoryToExport = QFileDialog::getExistingDirectory ( this, tr( "Save Direcotry" ), lastUsedDirectory );
+	if( directoryToExport.isEmpty() )	return;
+
+	QDir dirToExport( directoryToExport );
+	if( !dirToExport.exists() )
+	{
+		QMessageBox::information( this, QLatin1String( "Tonatiuh" ), tr( "Selected directory is not valid." ), 1 );
+		return;
+	}
+
+	settings.setValue( QLatin1String( "PhotonMapExportTallyWidget.directoryToExport" ), directoryToExport );
+	saveDirectoryLine->setText( directoryToExport );
+}
+
+/*!
+ * Setups triggers for the buttons.
+ */
+void PhotonMapExportTallyWidget::SetupTriggers()
+{
+	connect( selectDirectoryButton, SIGNAL( clicked() ), this, SLOT( SelectSaveDirectory() ) );
+}
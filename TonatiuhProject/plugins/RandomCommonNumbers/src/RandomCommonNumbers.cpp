@@ -0,0 +1,92 @@
+/***************************************************************************
+Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+This file is part of Tonatiuh.
+
+Tonatiuh program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Acknowledgments:
+
+The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+then Chair of the Department of Engineering of the University of Texas at
+Brownsville. From May 2004 to July 2008, it was supported by the Department
+of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+During 2007, NREL also contributed to the validation of Tonatiuh under the
+framework of the Memorandum of Understanding signed with the Spanish
+National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez,
+Juana Amieva, Azael Mancillas, Cesar Cantu.
+***************************************************************************/
+
+#include "RandomCommonNumbers.h"
+
+namespace
+{
+	const unsigned long long goldenGamma = 0x9E3779B97F4A7C15ULL;
+
+	unsigned long long MixBits( unsigned long long z )
+	{
+		z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+		z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL;
+		return ( z ^ ( z >> 31 ) );
+	}
+}
+
+/*!
+ * Creates the generator with the key \a seedValue. Until a substream is started, it generates the stream
+ * \a streamIndex, which starts 2^40 numbers after the stream \a streamIndex - 1.
+ *
+ * The ray tracer starts a substream for each ray, so the default buffer is small.
+ */
+RandomCommonNumbers::RandomCommonNumbers( unsigned long seedValue, unsigned long streamIndex, const unsigned long arraySize )
+: RandomDeviate( arraySize ),
+  m_seedKey( MixBits( (unsigned long long) seedValue * goldenGamma + 1 ) ),
+  m_state( 0 )
+{
+	m_state = m_seedKey + ( (unsigned long long) streamIndex << 40 ) * goldenGamma;
+}
+
+RandomCommonNumbers::~RandomCommonNumbers()
+{
+}
+
+void RandomCommonNumbers::FillArray( double* array, const unsigned long arraySize )
+{
+	for( unsigned long i = 0; i < arraySize; ++i )
+	{
+		m_state += goldenGamma;
+		array[i] = ( ( MixBits( m_state ) >> 11 ) + 0.5 ) * ( 1.0 / 9007199254740992.0 );
+	}
+}
+
+bool RandomCommonNumbers::HasSubstreams( ) const
+{
+	return ( true );
+}
+
+/*!
+ * Starts the substream \a substreamIndex. The start state is hashed twice, so the substreams of consecutive
+ * rays are not overlapping shifts of the same sequence.
+ */
+void RandomCommonNumbers::SetSubstream( unsigned long long substreamIndex )
+{
+	m_state = MixBits( m_seedKey ^ MixBits( substreamIndex + goldenGamma ) );
+}
@@ -59,6 +59,18 @@ RandomMersenneTwister* RandomMersenneTwisterFactory::CreateRandomDeviate( ) cons
 	return new RandomMersenneTwister( seed );
 	//return new RandomMersenneTwister( 123 );
 }
+
+/*!
+ * Returns a generator initialized with the key { \a seed, \a streamIndex }.
+ * The Mersenne Twister has no jump ahead, so the streams are independent initializations
+ * of its 19937 bit state instead of proven disjoint subsequences.
+ * The streams are created for each chunk of rays, so they use a small buffer.
+ */
+RandomMersenneTwister* RandomMersenneTwisterFactory::CreateRandomDeviate( unsigned long seed, unsigned long streamIndex ) const
+{
+	unsigned long seedArray[2] = { seed, streamIndex };
+	return new RandomMersenneTwister( seedArray, 2, 10000 );
+}
 #if QT_VERSION < 0x050000 // pre Qt 5
 Q_EXPORT_PLUGIN2(RandomMersenneTwister, RandomMersenneTwisterFactory )
 #endif
@@ -47,7 +47,7 @@ class RandomMersenneTwisterFactory : public QObject, public RandomDeviateFactory
 	Q_OBJECT
 	Q_INTERFACES(RandomDeviateFactory)
 #if QT_VERSION >= 0x050000 // pre Qt 5
-    Q_PLUGIN_METADATA(IID "tonatiuh.RandomDeviateFactory")
+    Q_PLUGIN_METADATA(IID "tonatiuh.RandomDeviateFactory/2.0")
 #endif
 
 
@@ -55,6 +55,7 @@ public:
 	QString RandomDeviateName() const;
 	QIcon RandomDeviateIcon() const;
 	RandomMersenneTwister* CreateRandomDeviate( ) const;
+	RandomMersenneTwister* CreateRandomDeviate( unsigned long seed, unsigned long streamIndex ) const;
 
 };
 
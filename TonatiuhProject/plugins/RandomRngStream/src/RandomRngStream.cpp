@@ -348,6 +348,32 @@ RandomRngStream::RandomRngStream (  unsigned long seedValue, const unsigned long
    MatVecModM (A2p127, &sm_nextSeed[3], &sm_nextSeed[3], m2);
 }
 
+/**
+ * Creates the stream \a streamIndex of the package started with \a seedValue.
+ * The stream starts streamIndex * 2^127 numbers after the seed, so streams
+ * with different indexes never overlap.
+ */
+RandomRngStream::RandomRngStream (  unsigned long seedValue, unsigned long streamIndex, const unsigned long arraySize )
+: RandomDeviate(arraySize)
+{
+   m_anti = false;
+   m_incPrec = false;
+
+   unsigned long seed1 = seedValue % 4294967087UL;
+   unsigned long seed2 = seedValue % 4294944443UL;
+   if( seed1 == 0 )	seed1 = 12345UL;
+   if( seed2 == 0 )	seed2 = 12345UL;
+   unsigned long seedArray[6] = { seed1, seed1, seed1, seed2, seed2, seed2 };
+   SetSeed( seedArray );
+
+   double B1[3][3], B2[3][3];
+   MatPowModM (A1p127, B1, m1, streamIndex);
+   MatPowModM (A2p127, B2, m2, streamIndex);
+   MatVecModM (B1, m_ig, m_ig, m1);
+   MatVecModM (B2, &m_ig[3], &m_ig[3], m2);
+   ResetStartStream();
+}
+
 /**
  * Destructor
  */
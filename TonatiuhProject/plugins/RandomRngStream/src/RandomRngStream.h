@@ -48,6 +48,7 @@ class RandomRngStream : public RandomDeviate
 {
 public:
 	RandomRngStream ( unsigned long seedValue = 5489UL, const unsigned long arraySize = 1000000 );
+	RandomRngStream ( unsigned long seedValue, unsigned long streamIndex, const unsigned long arraySize );
 	~RandomRngStream();
 	void FillArray( double* array, const unsigned long arraySize );
 
@@ -57,6 +57,16 @@ RandomRngStream* RandomRngStreamFactory::CreateRandomDeviate( ) const
 	unsigned long seed = QTime::currentTime().msec();
 	return ( new RandomRngStream( seed ) );
 }
+
+/*!
+ * Returns the stream \a streamIndex of the generator started with \a seed.
+ * Each stream starts 2^127 numbers after the previous one.
+ * The streams are created for each chunk of rays, so they use a small buffer.
+ */
+RandomRngStream* RandomRngStreamFactory::CreateRandomDeviate( unsigned long seed, unsigned long streamIndex ) const
+{
+	return ( new RandomRngStream( seed, streamIndex, 10000 ) );
+}
 #if QT_VERSION < 0x050000 // pre Qt 5
 Q_EXPORT_PLUGIN2(RandomRngStream, RandomRngStreamFactory )
 #endif
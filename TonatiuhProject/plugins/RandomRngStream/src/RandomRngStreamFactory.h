@@ -47,13 +47,14 @@ class RandomRngStreamFactory : public QObject, public RandomDeviateFactory
 	Q_OBJECT
 	Q_INTERFACES(RandomDeviateFactory)
 #if QT_VERSION >= 0x050000 // pre Qt 5
-    Q_PLUGIN_METADATA(IID "tonatiuh.RandomDeviateFactory")
+    Q_PLUGIN_METADATA(IID "tonatiuh.RandomDeviateFactory/2.0")
 #endif
 
 public:
 	QString RandomDeviateName() const;
 	QIcon RandomDeviateIcon() const;
 	RandomRngStream* CreateRandomDeviate( ) const;
+	RandomRngStream* CreateRandomDeviate( unsigned long seed, unsigned long streamIndex ) const;
 
 };
 
@@ -0,0 +1,175 @@
+/***************************************************************************
+Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+This file is part of Tonatiuh.
+
+Tonatiuh program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Acknowledgments:
+
+The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+then Chair of the Department of Engineering of the University of Texas at
+Brownsville. From May 2004 to July 2008, it was supported by the Department
+of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+During 2007, NREL also contributed to the validation of Tonatiuh under the
+framework of the Memorandum of Understanding signed with the Spanish
+National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez,
+Juana Amieva, Azael Mancillas, Cesar Cantu.
+***************************************************************************/
+
+#include "RandomSobol.h"
+
+namespace
+{
+	/*
+	 * Primitive polynomials and initial direction numbers of the dimensions 2 to 16 from
+	 * S. Joe and F. Y. Kuo, new-joe-kuo-6.21201. The first dimension is the van der Corput sequence.
+	 */
+	struct SobolPolynomial
+	{
+		unsigned int degree;
+		unsigned int coefficients;
+		unsigned int initialNumbers[6];
+	};
+
+	const SobolPolynomial sobolPolynomials[] = {
+		{ 1, 0, { 1 } },
+		{ 2, 1, { 1, 3 } },
+		{ 3, 1, { 1, 3, 1 } },
+		{ 3, 2, { 1, 1, 1 } },
+		{ 4, 1, { 1, 1, 3, 3 } },
+		{ 4, 4, { 1, 3, 5, 13 } },
+		{ 5, 2, { 1, 1, 5, 5, 17 } },
+		{ 5, 4, { 1, 1, 5, 5, 5 } },
+		{ 5, 7, { 1, 1, 7, 11, 19 } },
+		{ 5, 11, { 1, 1, 5, 1, 1 } },
+		{ 5, 13, { 1, 1, 1, 3, 11 } },
+		{ 5, 14, { 1, 3, 5, 5, 31 } },
+		{ 6, 1, { 1, 3, 3, 9, 7, 49 } },
+		{ 6, 13, { 1, 1, 1, 15, 21, 21 } },
+		{ 6, 16, { 1, 3, 1, 13, 27, 49 } }
+	};
+
+	const unsigned long long goldenGamma = 0x9E3779B97F4A7C15ULL;
+
+	unsigned long long MixBits( unsigned long long z )
+	{
+		z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+		z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL;
+		return ( z ^ ( z >> 31 ) );
+	}
+
+	unsigned long long ReverseBits( unsigned long long x )
+	{
+		x = ( ( x >> 1 ) & 0x5555555555555555ULL ) | ( ( x & 0x5555555555555555ULL ) << 1 );
+		x = ( ( x >> 2 ) & 0x3333333333333333ULL ) | ( ( x & 0x3333333333333333ULL ) << 2 );
+		x = ( ( x >> 4 ) & 0x0F0F0F0F0F0F0F0FULL ) | ( ( x & 0x0F0F0F0F0F0F0F0FULL ) << 4 );
+		x = ( ( x >> 8 ) & 0x00FF00FF00FF00FFULL ) | ( ( x & 0x00FF00FF00FF00FFULL ) << 8 );
+		x = ( ( x >> 16 ) & 0x0000FFFF0000FFFFULL ) | ( ( x & 0x0000FFFF0000FFFFULL ) << 16 );
+		return ( ( x >> 32 ) | ( x << 32 ) );
+	}
+
+	/*
+	 * Nested uniform scrambling of \a x (Burley, 2020). On the reversed bits, the Laine-Karras permutation
+	 * changes each bit only from the bits below it, which is an Owen scrambling of the original bits.
+	 */
+	unsigned long long NestedUniformScramble( unsigned long long x, unsigned long long seed )
+	{
+		x = ReverseBits( x );
+		x += seed;
+		x ^= x * 0x6c50b47cULL;
+		x ^= x * 0xb82f1e52ULL;
+		x ^= x * 0xc7afe638ULL;
+		x ^= x * 0x8d22f6e6ULL;
+		return ( ReverseBits( x ) );
+	}
+}
+
+/*!
+ * Creates the Sobol generator scrambled with \a seedValue. The pseudo-random stream of RandomDouble()
+ * starts 2^40 numbers after the stream \a streamIndex - 1.
+ */
+RandomSobol::RandomSobol( unsigned long seedValue, unsigned long streamIndex, const unsigned long arraySize )
+: RandomDeviate( arraySize ),
+  m_state( 0 )
+{
+	for( int b = 0; b < Bits; ++b )
+		m_directions[0][b] = 1ULL << ( Bits - 1 - b );
+
+	for( int d = 1; d < Dimensions; ++d )
+	{
+		const SobolPolynomial& polynomial = sobolPolynomials[d - 1];
+		unsigned int s = polynomial.degree;
+		unsigned long long* v = m_directions[d];
+
+		for( unsigned int i = 0; i < s; ++i )
+			v[i] = (unsigned long long) polynomial.initialNumbers[i] << ( Bits - 1 - i );
+
+		for( unsigned int i = s; i < Bits; ++i )
+		{
+			v[i] = v[i - s] ^ ( v[i - s] >> s );
+			for( unsigned int k = 1; k < s; ++k )
+				if( ( polynomial.coefficients >> ( s - 1 - k ) ) & 1 )	v[i] ^= v[i - k];
+		}
+	}
+
+	for( int d = 0; d < Dimensions; ++d )
+		m_scrambleSeeds[d] = MixBits( (unsigned long long) seedValue * goldenGamma + d + 1 );
+
+	m_state = MixBits( seedValue ) + ( (unsigned long long) streamIndex << 40 ) * goldenGamma;
+}
+
+RandomSobol::~RandomSobol()
+{
+}
+
+void RandomSobol::FillArray( double* array, const unsigned long arraySize )
+{
+	for( unsigned long i = 0; i < arraySize; ++i )
+		array[i] = ( ( NextInteger() >> 11 ) + 0.5 ) * ( 1.0 / 9007199254740992.0 );
+}
+
+unsigned int RandomSobol::NumberOfDimensions( ) const
+{
+	return ( Dimensions );
+}
+
+/*!
+ * Returns the coordinate \a dimension of the scrambled Sobol point \a sampleIndex. The point is computed
+ * directly from the index, so the threads can take any point in any order.
+ */
+double RandomSobol::SampleCoordinate( unsigned long long sampleIndex, unsigned int dimension ) const
+{
+	const unsigned long long* v = m_directions[dimension];
+	unsigned long long x = 0;
+	for( int b = 0; sampleIndex; ++b, sampleIndex >>= 1 )
+		if( sampleIndex & 1 )	x ^= v[b];
+
+	x = NestedUniformScramble( x, m_scrambleSeeds[dimension] );
+	return ( ( ( x >> 11 ) + 0.5 ) * ( 1.0 / 9007199254740992.0 ) );
+}
+
+unsigned long long RandomSobol::NextInteger()
+{
+	m_state += goldenGamma;
+	return ( MixBits( m_state ) );
+}
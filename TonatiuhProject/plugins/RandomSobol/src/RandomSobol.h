@@ -0,0 +1,76 @@
+/***************************************************************************
+Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+This file is part of Tonatiuh.
+
+Tonatiuh program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Acknowledgments:
+
+The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+then Chair of the Department of Engineering of the University of Texas at
+Brownsville. From May 2004 to July 2008, it was supported by the Department
+of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+During 2007, NREL also contributed to the validation of Tonatiuh under the
+framework of the Memorandum of Understanding signed with the Spanish
+National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez,
+Juana Amieva, Azael Mancillas, Cesar Cantu.
+***************************************************************************/
+
+#ifndef RANDOMSOBOL_H_
+#define RANDOMSOBOL_H_
+
+#include "RandomDeviate.h"
+
+//!  RandomSobol is a scrambled Sobol quasi-random generator.
+/*!
+  The sample point n is the point n of the Sobol sequence in NumberOfDimensions() dimensions, with the
+  direction numbers of Joe and Kuo. Each dimension is scrambled with a nested uniform (Owen) scrambling
+  hashed from the seed, so the points are unbiased and the streams of the same seed share the same sequence.
+
+  The numbers of RandomDouble(), used by the samplings that have no fixed dimension, come from a
+  SplitMix64 pseudo-random stream.
+*/
+class RandomSobol : public RandomDeviate
+{
+public:
+	RandomSobol( unsigned long seedValue = 5489UL, unsigned long streamIndex = 0, const unsigned long arraySize = 100000 );
+	~RandomSobol();
+
+	void FillArray( double* array, const unsigned long arraySize );
+	unsigned int NumberOfDimensions( ) const;
+	double SampleCoordinate( unsigned long long sampleIndex, unsigned int dimension ) const;
+
+private:
+	enum { Dimensions = 16, Bits = 64 };
+
+	unsigned long long NextInteger();
+
+	unsigned long long m_directions[Dimensions][Bits];
+	unsigned long long m_scrambleSeeds[Dimensions];
+	unsigned long long m_state;
+
+	RandomSobol( const RandomSobol& );
+	void operator=( const RandomSobol& );
+};
+
+#endif /* RANDOMSOBOL_H_ */
@@ -23,6 +23,10 @@ SOURCES = src/*.cpp  \
            	$$(TONATIUH_ROOT)/src/source/raytracing/TShape.cpp \ 
            	$$(TONATIUH_ROOT)/src/source/raytracing/TShapeKit.cpp
 
+win32 {
+	LIBS += -lpsapi
+}
+
 RESOURCES += src/ShapeCAD.qrc	
 		
 TARGET        = ShapeCAD
@@ -43,6 +43,34 @@ Juana Amieva, Azael Mancillas, Cesar Cantu, I
 #include "gf.h"
 #include "Ray.h"
 
+namespace
+{
+	/*!
+	 * Compares the centroids of two triangles along the \a dimension axis.
+	 */
+	struct CentroidLess
+	{
+		CentroidLess( const std::vector< Triangle >* triangleList, int dimension )
+		:m_triangleList( triangleList ),
+		 m_dimension( dimension )
+		{
+
+		}
+
+		bool operator()( unsigned int t1, unsigned int t2 ) const
+		{
+			Point3D c1 = ( *m_triangleList )[t1].GetCentroid();
+			Point3D c2 = ( *m_triangleList )[t2].GetCentroid();
+			if( m_dimension == 0 )	return ( c1.x < c2.x );
+			if( m_dimension == 1 )	return ( c1.y < c2.y );
+			return ( c1.z < c2.z );
+		}
+
+		const std::vector< Triangle >* m_triangleList;
+		int m_dimension;
+	};
+}
+
 /*! *****************************
  * class BVHNode
  * **************************** */
@@ -112,18 +140,55 @@ void BVHNode::SetBoundingBox( BBox bbox )
  * **************************** */
 
 /*!
- * Creates bounding volume hierarchy object
+ * Creates bounding volume hierarchy object for the triangles in \a triangleList.
+ * The triangles are reordered so that the triangles of each leaf are contiguous.
+ * GetTriangleOrder() returns the original position of each triangle.
  */
-BVH::BVH( std::vector< Triangle*>* triangleList, int leafSize )
+BVH::BVH( std::vector< Triangle >* triangleList, int leafSize )
 :m_leafSize( leafSize ),
  m_nNodes ( 0 ),
  m_nLeafs( 0 ),
  m_rootNode( 0 ),
- m_triangleList( triangleList )
+ m_triangleList( triangleList ),
+ m_triangleOrder( triangleList->size() )
 {
+	for( unsigned int t = 0; t < m_triangleOrder.size(); t++ )
+		m_triangleOrder[t] = t;
 
 	Build();
 
+	std::vector< Triangle > orderedList;
+	orderedList.reserve( m_triangleList->size() );
+	for( unsigned int t = 0; t < m_triangleOrder.size(); t++ )
+		orderedList.push_back( ( *m_triangleList )[m_triangleOrder[t]] );
+	m_triangleList->swap( orderedList );
+}
+
+/*!
+ * Creates the hierarchy stored in \a nodeData and \a nodeBounds by GetNodeData() for the
+ * triangles in \a triangleList, that must be in the order of the stored hierarchy.
+ * If the data is not valid, the hierarchy is empty and IsValid() returns false.
+ */
+BVH::BVH( std::vector< Triangle >* triangleList, const std::vector< int >& nodeData, const std::vector< BBox >& nodeBounds )
+:m_leafSize( 1 ),
+ m_nNodes ( 0 ),
+ m_nLeafs( 0 ),
+ m_rootNode( 0 ),
+ m_triangleList( triangleList ),
+ m_triangleOrder( triangleList->size() )
+{
+	for( unsigned int t = 0; t < m_triangleOrder.size(); t++ )
+		m_triangleOrder[t] = t;
+
+	if( nodeData.empty() || ( nodeData.size() != 3 * nodeBounds.size() ) )	return;
+
+	int nodeIndex = 0;
+	m_rootNode = RestoreRecursive( nodeData, nodeBounds, &nodeIndex );
+	if( m_rootNode && ( nodeIndex != int( nodeBounds.size() ) ) )
+	{
+		delete m_rootNode;
+		m_rootNode = 0;
+	}
 }
 
 /*!
@@ -144,6 +209,18 @@ BBox BVH::GetBBox() const
 	return BBox();
 }
 
+/*!
+ * Stores the hierarchy nodes in depth-first order. Each node is stored as three values in \a nodeData:
+ * 1, first triangle and number of triangles for leaf nodes and 0, right child node index and 0 for the
+ * rest. The left child of a node is the next node. The node bounding boxes are stored in \a nodeBounds.
+ */
+void BVH::GetNodeData( std::vector< int >* nodeData, std::vector< BBox >* nodeBounds ) const
+{
+	nodeData->clear();
+	nodeBounds->clear();
+	if( m_rootNode )	SerializeRecursive( m_rootNode, nodeData, nodeBounds );
+}
+
 bool BVH::Intersect(const Ray& objectRay , double* tHit, DifferentialGeometry* dg ) const
 {
 
@@ -250,27 +327,18 @@ bool BVH::Intersect(BVHNode* node, const Ray& objectRay, double *tHit, Different
 		for( int f = 0; f < node->GetNumberOfTriangles(); f++ )
 		{
 			int tIndex = left_index + f;
-			Triangle* triangle = m_triangleList->at( tIndex );
-
-			if( triangle )
-			{
-
-				Point3D v1 = triangle->GetVertex1();
-				Point3D v2 = triangle->GetVertex2();
-				Point3D v3 = triangle->GetVertex3();
+			const Triangle& triangle = ( *m_triangleList )[tIndex];
 
-				double thitT = tHitNode;
-				DifferentialGeometry dgT;
+			double thitT = tHitNode;
+			DifferentialGeometry dgT;
 
-
-				bool isIntersectionT = triangle->Intersect( objectRay, &thitT, &dgT );
-				if( isIntersectionT && thitT < tHitNode )
-				{
-					tHitNode = thitT;
-					*tHit = thitT;
-					*dg = dgT;
-					isIntersection = true;
-				}
+			bool isIntersectionT = triangle.Intersect( objectRay, &thitT, &dgT );
+			if( isIntersectionT && thitT < tHitNode )
+			{
+				tHitNode = thitT;
+				*tHit = thitT;
+				*dg = dgT;
+				isIntersection = true;
 			}
 		}
 
@@ -291,9 +359,7 @@ void BVH::Build()
 	for( unsigned int t = 0; t < m_triangleList->size(); t++ )
 	{
 
-		Triangle* triangle = m_triangleList->at(t);
-
-		hBBox = Union ( hBBox, triangle->GetBBox( ) );
+		hBBox = Union ( hBBox, ( *m_triangleList )[t].GetBBox( ) );
 	}
 
 
@@ -355,24 +421,24 @@ void BVH::BuildRecursive(int left_index, int right_index, BVHNode* node, int dep
 		for ( int f = left_index; f < right_index; f++ )
 		{
 
-			Triangle* triangle = m_triangleList->at( f );
+			const Triangle& triangle = ( *m_triangleList )[m_triangleOrder[f]];
 
-			if( ( dimension1 == 0 ) && ( triangle->GetCentroid().x > dMean1 ) )
+			if( ( dimension1 == 0 ) && ( triangle.GetCentroid().x > dMean1 ) )
 			{
 				splitIndex = f;
 				break;
 			}
-			else if( ( dimension1 == 1 ) && ( triangle->GetCentroid().y > dMean1 ) )
+			else if( ( dimension1 == 1 ) && ( triangle.GetCentroid().y > dMean1 ) )
 			{
 				splitIndex = f;
 				break;
 			}
-			else if( ( dimension1 == 2 ) && (triangle->GetCentroid().z > dMean1 ) )
+			else if( ( dimension1 == 2 ) && (triangle.GetCentroid().z > dMean1 ) )
 			{
 				splitIndex = f;
 				break;
 			}
-			leftBBox = Union ( leftBBox, triangle->GetBBox( ) );
+			leftBBox = Union ( leftBBox, triangle.GetBBox( ) );
 
 		}
 
@@ -383,8 +449,7 @@ void BVH::BuildRecursive(int left_index, int right_index, BVHNode* node, int dep
 			leftBBox = BBox( );
 			for ( int f = left_index; f < splitIndex; f++ )
 			{
-				Triangle* triangle = m_triangleList->at( f );
-				leftBBox = Union ( leftBBox, triangle->GetBBox( ) );
+				leftBBox = Union ( leftBBox, ( *m_triangleList )[m_triangleOrder[f]].GetBBox( ) );
 			}
 		}
 
@@ -392,8 +457,7 @@ void BVH::BuildRecursive(int left_index, int right_index, BVHNode* node, int dep
 		BBox rightBBox;
 		for ( int f = splitIndex; f < right_index; f++ )
 		{
-			Triangle* triangle = m_triangleList->at( f );
-			rightBBox = Union ( rightBBox, triangle->GetBBox( ) );
+			rightBBox = Union ( rightBBox, ( *m_triangleList )[m_triangleOrder[f]].GetBBox( ) );
 		}
 
 
@@ -413,40 +477,80 @@ void BVH::BuildRecursive(int left_index, int right_index, BVHNode* node, int dep
 }
 
 
-void BVH::SortTrinaglesList(int left_index, int right_index, int dimension )
+/*!
+ * Creates the node \a nodeIndex of the stored hierarchy and its children. Returns null if the data is not valid.
+ */
+BVHNode* BVH::RestoreRecursive( const std::vector< int >& nodeData, const std::vector< BBox >& nodeBounds, int* nodeIndex )
 {
-	if( dimension == 0 )  //x axis
-		std::sort( m_triangleList->begin()+ left_index, m_triangleList->begin() +  right_index  , BVH::LessXThan );
-	else if( dimension == 1 )  //y axis
-		std::sort( m_triangleList->begin()+ left_index, m_triangleList->begin() +  right_index  , BVH::LessYThan );
-	else if( dimension == 2 )  //y axis
-		std::sort( m_triangleList->begin()+ left_index, m_triangleList->begin() +  right_index  , BVH::LessZThan );
+	int index = *nodeIndex;
+	if( index >= int( nodeBounds.size() ) )	return ( 0 );
+	( *nodeIndex )++;
 
-}
+	BVHNode* node = new BVHNode;
+	node->SetBoundingBox( nodeBounds[index] );
+	m_nNodes++;
 
+	int nodeType = nodeData[3 * index];
+	if( nodeType == 1 )
+	{
+		int firstTriangle = nodeData[3 * index + 1];
+		int nTriangles = nodeData[3 * index + 2];
+		if( ( firstTriangle < 0 ) || ( nTriangles < 0 ) || ( firstTriangle + nTriangles > int( m_triangleList->size() ) ) )
+		{
+			delete node;
+			return ( 0 );
+		}
+		node->MakeLeaf( firstTriangle, nTriangles );
+		m_nLeafs++;
+		return ( node );
+	}
 
-bool BVH::LessXThan( const Triangle* t1, const Triangle* t2 )
-{
+	if( nodeType != 0 )
+	{
+		delete node;
+		return ( 0 );
+	}
 
-	if( t1->GetCentroid().x < t2->GetCentroid().x )
-		return ( true );
-	return ( false );
-}
+	BVHNode* leftNode = RestoreRecursive( nodeData, nodeBounds, nodeIndex );
+	node->SetLeftNode( leftNode );
+	if( !leftNode || ( *nodeIndex != nodeData[3 * index + 1] ) )
+	{
+		delete node;
+		return ( 0 );
+	}
 
-bool BVH::LessYThan( const Triangle* t1, const Triangle* t2 )
-{
+	BVHNode* rightNode = RestoreRecursive( nodeData, nodeBounds, nodeIndex );
+	node->SetRightNode( rightNode );
+	if( !rightNode )
+	{
+		delete node;
+		return ( 0 );
+	}
 
-	if( t1->GetCentroid().y < t2->GetCentroid().y )
-		return ( true );
-	return ( false );
+	return ( node );
 }
 
-bool BVH::LessZThan( const Triangle* t1, const Triangle* t2 )
+void BVH::SerializeRecursive( const BVHNode* node, std::vector< int >* nodeData, std::vector< BBox >* nodeBounds ) const
 {
+	int index = nodeBounds->size();
+	nodeBounds->push_back( node->GetBoundingBox() );
+	if( node->IsLeaf() )
+	{
+		nodeData->push_back( 1 );
+		nodeData->push_back( node->GetIndex() );
+		nodeData->push_back( node->GetNumberOfTriangles() );
+		return;
+	}
 
-	if( t1->GetCentroid().z < t2->GetCentroid().z )
-		return ( true );
-	return ( false );
+	nodeData->push_back( 0 );
+	nodeData->push_back( 0 );
+	nodeData->push_back( 0 );
+	SerializeRecursive( node->GetLeftNode(), nodeData, nodeBounds );
+	( *nodeData )[3 * index + 1] = nodeBounds->size();
+	SerializeRecursive( node->GetRightNode(), nodeData, nodeBounds );
 }
 
-
+void BVH::SortTrinaglesList(int left_index, int right_index, int dimension )
+{
+	std::sort( m_triangleOrder.begin() + left_index, m_triangleOrder.begin() + right_index, CentroidLess( m_triangleList, dimension ) );
+}
@@ -91,10 +91,15 @@ class BVH {
 
 public:
 
-	BVH( std::vector< Triangle*>* triangleList, int leafSize = 1 );
+	BVH( std::vector< Triangle >* triangleList, int leafSize = 1 );
+	BVH( std::vector< Triangle >* triangleList, const std::vector< int >& nodeData, const std::vector< BBox >& nodeBounds );
 	~BVH();
 
 	BBox GetBBox() const;
+	void GetNodeData( std::vector< int >* nodeData, std::vector< BBox >* nodeBounds ) const;
+	const std::vector< unsigned int >& GetTriangleOrder() const { return ( m_triangleOrder ); };
+	bool IsValid() const { return ( m_rootNode != 0 ); };
+
 	bool Intersect(const Ray& objectRay, double *tHit, DifferentialGeometry *dg ) const;
 	bool Intersect(BVHNode* node, const Ray& objectRay, double *tHit, DifferentialGeometry *dg ) const;
 	//bool getIntersection( const Ray& ray, IntersectionInfo *intersection, bool occlusion) const;
@@ -102,21 +107,19 @@ public:
 private:
 	void Build();
 	void BuildRecursive(int left_index, int right_index, BVHNode* node, int depth );
+	BVHNode* RestoreRecursive( const std::vector< int >& nodeData, const std::vector< BBox >& nodeBounds, int* nodeIndex );
+	void SerializeRecursive( const BVHNode* node, std::vector< int >* nodeData, std::vector< BBox >* nodeBounds ) const;
 	void SortTrinaglesList(int left_index, int right_index, int dimension );
 
 
-	static bool LessXThan( const Triangle* t1, const Triangle* t2 );
-	static bool LessYThan( const Triangle* t1, const Triangle* t2 );
-	static bool LessZThan( const Triangle* t1, const Triangle* t2 );
-
-
 	int m_leafSize;
 	int m_nNodes;
 	int m_nLeafs;
 
 
 	BVHNode* m_rootNode;
-	std::vector< Triangle*>* m_triangleList;
+	std::vector< Triangle >* m_triangleList;
+	std::vector< unsigned int > m_triangleOrder;
 
 
 };
@@ -0,0 +1,892 @@
+/***************************************************************************
+Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+This file is part of Tonatiuh.
+
+Tonatiuh program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Acknowledgments:
+
+The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+then Chair of the Department of Engineering of the University of Texas at
+Brownsville. From May 2004 to July 2008, it was supported by the Department
+of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+During 2007, NREL also contributed to the validation of Tonatiuh under the
+framework of the Memorandum of Understanding signed with the Spanish
+National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez,
+Juana Amieva, Azael Mancillas, Cesar Cantu.
+***************************************************************************/
+
+#include <algorithm>
+#include <clocale>
+#include <cstdlib>
+#include <cstring>
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QThread>
+#include <QtConcurrentMap>
+#include <QtEndian>
+
+#if defined( Q_OS_WIN )
+#include <windows.h>
+#include <psapi.h>
+#elif defined( Q_OS_UNIX )
+#include <sys/resource.h>
+#endif
+
+#include "MeshLoader.h"
+
+namespace
+{
+	/*!
+	 * Part of the mapped file parsed by one thread and the values read from it.
+	 */
+	struct MeshChunk
+	{
+		MeshChunk()
+		:begin( 0 ),
+		 end( 0 ),
+		 isValid( true ),
+		 vertexOffset( 0 ),
+		 cornerOffset( 0 )
+		{
+
+		}
+
+		const char* begin;
+		const char* end;
+		bool isValid;
+
+		//ASCII STL triangle corners and OBJ vertices, three floats each.
+		std::vector< float > positions;
+
+		//ASCII STL facet normals, three floats each.
+		std::vector< float > normals;
+
+		//OBJ face corners. Relative indices are kept local to the chunk until the offsets are known.
+		std::vector< long long > faceIndices;
+		std::vector< unsigned char > isRelativeIndex;
+		unsigned long vertexOffset;
+		unsigned long cornerOffset;
+	};
+
+	/*!
+	 * Range of triangle corners processed by one thread.
+	 */
+	struct CornerRange
+	{
+		unsigned long first;
+		unsigned long last;
+	};
+
+	/*!
+	 * Vertices welded by one thread. Each partition owns the positions whose hash falls in it.
+	 */
+	struct WeldPartition
+	{
+		unsigned char id;
+		std::vector< float > vertices;
+	};
+
+	/*!
+	 * Bit pattern of a vertex position used to weld corners.
+	 */
+	struct VertexKey
+	{
+		quint32 x;
+		quint32 y;
+		quint32 z;
+
+		bool operator==( const VertexKey& other ) const
+		{
+			return ( ( x == other.x ) && ( y == other.y ) && ( z == other.z ) );
+		}
+	};
+
+	inline uint qHash( const VertexKey& key )
+	{
+		return ( ( key.x * 73856093u ) ^ ( key.y * 19349663u ) ^ ( key.z * 83492791u ) );
+	}
+
+	inline VertexKey MakeVertexKey( const float* position )
+	{
+		//Adding zero turns -0.0 into 0.0 so both weld together.
+		float x = position[0] + 0.0f;
+		float y = position[1] + 0.0f;
+		float z = position[2] + 0.0f;
+
+		VertexKey key;
+		memcpy( &key.x, &x, sizeof( float ) );
+		memcpy( &key.y, &y, sizeof( float ) );
+		memcpy( &key.z, &z, sizeof( float ) );
+		return ( key );
+	}
+
+	inline bool IsSpace( char c )
+	{
+		return ( ( c == ' ' ) || ( c == '\t' ) || ( c == '\r' ) || ( c == '\v' ) || ( c == '\f' ) );
+	}
+
+	inline const char* SkipSpaces( const char* p, const char* end )
+	{
+		while( ( p < end ) && IsSpace( *p ) )	++p;
+		return ( p );
+	}
+
+	/*!
+	 * Returns true if the text at \a p is \a keyword followed by a space or the end of the line.
+	 */
+	inline bool IsKeyword( const char* p, const char* end, const char* keyword )
+	{
+		size_t length = strlen( keyword );
+		if( size_t( end - p ) < length )	return ( false );
+		if( strncmp( p, keyword, length ) != 0 )	return ( false );
+		return ( ( p + length == end ) || IsSpace( p[length] ) );
+	}
+
+	/*!
+	 * Reads the number at \a p and moves \a p after it. The token is copied to a stack buffer
+	 * with its '.' replaced by the \a decimalPoint of the current C locale, so the conversion
+	 * does not depend on the locale.
+	 */
+	bool ParseFloat( const char** p, const char* end, char decimalPoint, float* value )
+	{
+		const char* begin = SkipSpaces( *p, end );
+		const char* tokenEnd = begin;
+		while( ( tokenEnd < end ) && !IsSpace( *tokenEnd ) )	++tokenEnd;
+
+		char buffer[64];
+		size_t length = tokenEnd - begin;
+		if( ( length == 0 ) || ( length >= sizeof( buffer ) ) )	return ( false );
+		for( size_t i = 0; i < length; ++i )
+			buffer[i] = ( begin[i] == '.' ) ? decimalPoint : begin[i];
+		buffer[length] = '\0';
+
+		char* numberEnd = 0;
+		*value = float( strtod( buffer, &numberEnd ) );
+		*p = tokenEnd;
+		return ( numberEnd == buffer + length );
+	}
+
+	bool ParsePoint( const char** p, const char* end, char decimalPoint, float* point )
+	{
+		return ( ParseFloat( p, end, decimalPoint, &point[0] ) &&
+				ParseFloat( p, end, decimalPoint, &point[1] ) &&
+				ParseFloat( p, end, decimalPoint, &point[2] ) );
+	}
+
+	/*!
+	 * Swaps the last two corners of the triangle at \a corner if its winding normal points
+	 * against the facet \a normal of the file. Null file normals leave the triangle as it is.
+	 */
+	inline void OrientTriangle( float* corner, const float* normal )
+	{
+		double e1[3] = { corner[3] - corner[0], corner[4] - corner[1], corner[5] - corner[2] };
+		double e2[3] = { corner[6] - corner[0], corner[7] - corner[1], corner[8] - corner[2] };
+		double winding = normal[0] * ( e1[1] * e2[2] - e1[2] * e2[1] )
+						+ normal[1] * ( e1[2] * e2[0] - e1[0] * e2[2] )
+						+ normal[2] * ( e1[0] * e2[1] - e1[1] * e2[0] );
+		if( winding < 0.0 )
+		{
+			for( int k = 3; k < 6; ++k )	std::swap( corner[k], corner[k + 3] );
+		}
+	}
+
+	/*!
+	 * Reads the vertex index of the OBJ face corner at \a p ("v", "v/vt", "v//vn" or "v/vt/vn")
+	 * and moves \a p after the corner.
+	 */
+	bool ParseFaceIndex( const char** p, const char* end, long long* index )
+	{
+		const char* c = SkipSpaces( *p, end );
+		if( c == end )	return ( false );
+
+		bool isNegative = false;
+		if( ( *c == '-' ) || ( *c == '+' ) )
+		{
+			isNegative = ( *c == '-' );
+			++c;
+		}
+
+		long long value = 0;
+		const char* digits = c;
+		while( ( c < end ) && ( *c >= '0' ) && ( *c <= '9' ) )
+		{
+			value = 10 * value + ( *c - '0' );
+			++c;
+		}
+		if( ( c == digits ) || ( value == 0 ) )	return ( false );
+
+		while( ( c < end ) && !IsSpace( *c ) )	++c;
+		*p = c;
+		*index = isNegative ? -value : value;
+		return ( true );
+	}
+
+	/*!
+	 * Splits the text in \a data into line aligned chunks.
+	 */
+	std::vector< MeshChunk > SplitLines( const char* data, qint64 size )
+	{
+		int nChunks = 4 * std::max( 1, QThread::idealThreadCount() );
+		qint64 chunkSize = std::max( size / nChunks, qint64( 1 << 16 ) );
+
+		std::vector< MeshChunk > chunks;
+		const char* end = data + size;
+		const char* begin = data;
+		while( begin < end )
+		{
+			const char* chunkEnd = ( end - begin > chunkSize ) ? begin + chunkSize : end;
+			if( chunkEnd < end )
+			{
+				const char* newLine = static_cast< const char* >( memchr( chunkEnd, '\n', end - chunkEnd ) );
+				chunkEnd = newLine ? newLine + 1 : end;
+			}
+
+			MeshChunk chunk;
+			chunk.begin = begin;
+			chunk.end = chunkEnd;
+			chunks.push_back( chunk );
+			begin = chunkEnd;
+		}
+		return ( chunks );
+	}
+
+	inline const char* LineEnd( const char* line, const char* end )
+	{
+		const char* newLine = static_cast< const char* >( memchr( line, '\n', end - line ) );
+		return ( newLine ? newLine : end );
+	}
+
+	/*!
+	 * Copies the vertices of the binary STL facets [first, last) to the corners buffer.
+	 */
+	struct BinarySTLReader
+	{
+		BinarySTLReader( const char* data, float* corners )
+		:m_data( data ),
+		 m_corners( corners )
+		{
+
+		}
+
+		typedef void result_type;
+		void operator()( CornerRange& facets ) const
+		{
+			for( unsigned long f = facets.first; f < facets.last; ++f )
+			{
+				//Each facet record: normal (3 floats), 3 vertices (9 floats) and 2 attribute bytes.
+				const uchar* record = reinterpret_cast< const uchar* >( m_data + 84 + 50 * f );
+				float normal[3];
+				for( int k = 0; k < 3; ++k )
+				{
+					quint32 bits = qFromLittleEndian< quint32 >( record + 4 * k );
+					memcpy( normal + k, &bits, sizeof( float ) );
+				}
+
+				float* corner = m_corners + 9 * f;
+				for( int k = 0; k < 9; ++k )
+				{
+					quint32 bits = qFromLittleEndian< quint32 >( record + 12 + 4 * k );
+					memcpy( corner + k, &bits, sizeof( float ) );
+				}
+				OrientTriangle( corner, normal );
+			}
+		}
+
+		const char* m_data;
+		float* m_corners;
+	};
+
+	/*!
+	 * Reads the "facet normal" and "vertex" records of an ASCII STL chunk.
+	 */
+	struct AsciiSTLReader
+	{
+		AsciiSTLReader( char decimalPoint )
+		:m_decimalPoint( decimalPoint )
+		{
+
+		}
+
+		typedef void result_type;
+		void operator()( MeshChunk& chunk ) const
+		{
+			const char* line = chunk.begin;
+			while( line < chunk.end )
+			{
+				const char* lineEnd = LineEnd( line, chunk.end );
+				const char* p = SkipSpaces( line, lineEnd );
+				if( IsKeyword( p, lineEnd, "vertex" ) )
+				{
+					p += 6;
+					float v[3];
+					if( !ParsePoint( &p, lineEnd, m_decimalPoint, v ) )
+					{
+						chunk.isValid = false;
+						return;
+					}
+					chunk.positions.insert( chunk.positions.end(), v, v + 3 );
+				}
+				else if( IsKeyword( p, lineEnd, "facet" ) )
+				{
+					p = SkipSpaces( p + 5, lineEnd );
+					bool isNormal = IsKeyword( p, lineEnd, "normal" );
+					if( isNormal )	p += 6;
+
+					float n[3];
+					if( !isNormal || !ParsePoint( &p, lineEnd, m_decimalPoint, n ) )
+					{
+						chunk.isValid = false;
+						return;
+					}
+					chunk.normals.insert( chunk.normals.end(), n, n + 3 );
+				}
+				line = lineEnd + 1;
+			}
+		}
+
+		char m_decimalPoint;
+	};
+
+	/*!
+	 * Reads the "v" and "f" records of an OBJ chunk. Polygons are split into triangle fans.
+	 */
+	struct OBJReader
+	{
+		OBJReader( char decimalPoint )
+		:m_decimalPoint( decimalPoint )
+		{
+
+		}
+
+		typedef void result_type;
+		void operator()( MeshChunk& chunk ) const
+		{
+			std::vector< long long > polygon;
+			std::vector< unsigned char > isRelative;
+
+			const char* line = chunk.begin;
+			while( line < chunk.end )
+			{
+				const char* lineEnd = LineEnd( line, chunk.end );
+				const char* p = SkipSpaces( line, lineEnd );
+				if( IsKeyword( p, lineEnd, "v" ) )
+				{
+					p += 1;
+					float v[3];
+					if( !ParsePoint( &p, lineEnd, m_decimalPoint, v ) )
+					{
+						chunk.isValid = false;
+						return;
+					}
+					chunk.positions.insert( chunk.positions.end(), v, v + 3 );
+				}
+				else if( IsKeyword( p, lineEnd, "f" ) )
+				{
+					p += 1;
+					polygon.clear();
+					isRelative.clear();
+
+					long long nLocalVertices = chunk.positions.size() / 3;
+					long long index;
+					while( SkipSpaces( p, lineEnd ) < lineEnd )
+					{
+						if( !ParseFaceIndex( &p, lineEnd, &index ) )
+						{
+							chunk.isValid = false;
+							return;
+						}
+						polygon.push_back( ( index > 0 ) ? index - 1 : nLocalVertices + index );
+						isRelative.push_back( index < 0 );
+					}
+					if( polygon.size() < 3 )
+					{
+						chunk.isValid = false;
+						return;
+					}
+
+					for( unsigned int k = 1; k + 1 < polygon.size(); ++k )
+					{
+						chunk.faceIndices.push_back( polygon[0] );
+						chunk.faceIndices.push_back( polygon[k] );
+						chunk.faceIndices.push_back( polygon[k + 1] );
+						chunk.isRelativeIndex.push_back( isRelative[0] );
+						chunk.isRelativeIndex.push_back( isRelative[k] );
+						chunk.isRelativeIndex.push_back( isRelative[k + 1] );
+					}
+				}
+				line = lineEnd + 1;
+			}
+		}
+
+		char m_decimalPoint;
+	};
+
+	/*!
+	 * Copies the positions of the OBJ face corners of a chunk to the corners buffer.
+	 */
+	struct OBJFaceResolver
+	{
+		OBJFaceResolver( const std::vector< float >* vertices, float* corners )
+		:m_vertices( vertices ),
+		 m_corners( corners )
+		{
+
+		}
+
+		typedef void result_type;
+		void operator()( MeshChunk& chunk ) const
+		{
+			long long nVertices = m_vertices->size() / 3;
+			for( unsigned long c = 0; c < chunk.faceIndices.size(); ++c )
+			{
+				long long index = chunk.faceIndices[c];
+				if( chunk.isRelativeIndex[c] )	index += chunk.vertexOffset;
+				if( ( index < 0 ) || ( index >= nVertices ) )
+				{
+					chunk.isValid = false;
+					return;
+				}
+				memcpy( m_corners + 3 * ( chunk.cornerOffset + c ), &( *m_vertices )[3 * index], 3 * sizeof( float ) );
+			}
+		}
+
+		const std::vector< float >* m_vertices;
+		float* m_corners;
+	};
+
+	/*!
+	 * Assigns every corner to the weld partition given by the hash of its position.
+	 */
+	struct CornerPartitioner
+	{
+		CornerPartitioner( const float* corners, unsigned char* partition, int nPartitions )
+		:m_corners( corners ),
+		 m_partition( partition ),
+		 m_nPartitions( nPartitions )
+		{
+
+		}
+
+		typedef void result_type;
+		void operator()( CornerRange& range ) const
+		{
+			for( unsigned long c = range.first; c < range.last; ++c )
+				m_partition[c] = static_cast< unsigned char >( qHash( MakeVertexKey( m_corners + 3 * c ) ) % m_nPartitions );
+		}
+
+		const float* m_corners;
+		unsigned char* m_partition;
+		int m_nPartitions;
+	};
+
+	/*!
+	 * Welds the corners of one partition and stores their index inside the partition.
+	 */
+	struct PartitionWelder
+	{
+		PartitionWelder( const float* corners, const unsigned char* partition, unsigned long nCorners, unsigned int* indices )
+		:m_corners( corners ),
+		 m_partition( partition ),
+		 m_nCorners( nCorners ),
+		 m_indices( indices )
+		{
+
+		}
+
+		typedef void result_type;
+		void operator()( WeldPartition& weldPartition ) const
+		{
+			QHash< VertexKey, unsigned int > vertexIndex;
+			for( unsigned long c = 0; c < m_nCorners; ++c )
+			{
+				if( m_partition[c] != weldPartition.id )	continue;
+
+				const float* position = m_corners + 3 * c;
+				VertexKey key = MakeVertexKey( position );
+				QHash< VertexKey, unsigned int >::const_iterator it = vertexIndex.constFind( key );
+				if( it != vertexIndex.constEnd() )
+				{
+					m_indices[c] = it.value();
+				}
+				else
+				{
+					unsigned int index = weldPartition.vertices.size() / 3;
+					vertexIndex.insert( key, index );
+					weldPartition.vertices.insert( weldPartition.vertices.end(), position, position + 3 );
+					m_indices[c] = index;
+				}
+			}
+		}
+
+		const float* m_corners;
+		const unsigned char* m_partition;
+		unsigned long m_nCorners;
+		unsigned int* m_indices;
+	};
+
+	/*!
+	 * Turns the partition indices of the corners into mesh vertex indices.
+	 */
+	struct IndexOffsetter
+	{
+		IndexOffsetter( const unsigned char* partition, const std::vector< unsigned long >* offsets, unsigned int* indices )
+		:m_partition( partition ),
+		 m_offsets( offsets ),
+		 m_indices( indices )
+		{
+
+		}
+
+		typedef void result_type;
+		void operator()( CornerRange& range ) const
+		{
+			for( unsigned long c = range.first; c < range.last; ++c )
+				m_indices[c] += ( *m_offsets )[m_partition[c]];
+		}
+
+		const unsigned char* m_partition;
+		const std::vector< unsigned long >* m_offsets;
+		unsigned int* m_indices;
+	};
+
+	std::vector< CornerRange > SplitRange( unsigned long size )
+	{
+		unsigned long nRanges = 4 * std::max( 1, QThread::idealThreadCount() );
+		unsigned long rangeSize = std::max( ( size + nRanges - 1 ) / nRanges, 4096ul );
+
+		std::vector< CornerRange > ranges;
+		for( unsigned long first = 0; first < size; first += rangeSize )
+		{
+			CornerRange range;
+			range.first = first;
+			range.last = std::min( first + rangeSize, size );
+			ranges.push_back( range );
+		}
+		return ( ranges );
+	}
+}
+
+/*! *****************************
+ * class MeshLoader
+ * **************************** */
+
+MeshLoader::MeshLoader()
+:m_errorMessage( ),
+ m_nFileTriangles( 0 ),
+ m_loadTime( 0.0 ),
+ m_peakMemory( 0 )
+{
+
+}
+
+/*!
+ * Reads the mesh in \a fileName. Files with "obj" suffix are read as Wavefront OBJ and
+ * the rest as binary or ASCII STL. Returns false and sets the error message if the file
+ * cannot be read.
+ *
+ * A STL file is binary if it is large enough for the facet count of its header, or if it
+ * does not start with the "solid" keyword. Binary files may have bytes after the last facet.
+ * The shape normals are computed from the triangle winding, so the winding of the STL facets
+ * is turned to agree with the normals of the file. OBJ faces keep the winding of the file.
+ */
+bool MeshLoader::Load( QString fileName )
+{
+	Clear();
+
+	QElapsedTimer timer;
+	timer.start();
+
+	QFile file( fileName );
+	if( !file.open( QIODevice::ReadOnly ) )
+	{
+		m_errorMessage = QString( "Cannot open file %1." ).arg( fileName );
+		return ( false );
+	}
+
+	qint64 size = file.size();
+	uchar* data = ( size > 0 ) ? file.map( 0, size ) : 0;
+	if( !data )
+	{
+		m_errorMessage = QString( "Cannot map file %1." ).arg( fileName );
+		return ( false );
+	}
+
+	const char* text = reinterpret_cast< const char* >( data );
+	std::vector< float > corners;
+	bool readOK = false;
+	if( QFileInfo( fileName ).suffix().compare( QLatin1String( "obj" ), Qt::CaseInsensitive ) == 0 )
+	{
+		readOK = ReadOBJ( text, size, &corners );
+	}
+	else
+	{
+		const char* begin = SkipSpaces( text, text + size );
+		bool isSolid = IsKeyword( begin, LineEnd( begin, text + size ), "solid" );
+		bool fitsFacets = ( size >= 84 ) && ( 84 + 50 * qint64( qFromLittleEndian< quint32 >( data + 80 ) ) <= size );
+		if( fitsFacets || ( !isSolid && ( size >= 84 ) ) )
+			readOK = ReadBinarySTL( text, size, &corners );
+		else
+			readOK = ReadAsciiSTL( text, size, &corners );
+	}
+
+	file.unmap( data );
+	file.close();
+	if( !readOK )
+	{
+		if( m_errorMessage.isEmpty() )	m_errorMessage = QString( "Cannot read file %1." ).arg( fileName );
+		return ( false );
+	}
+
+	m_nFileTriangles = corners.size() / 9;
+	WeldVertices( corners );
+
+	m_loadTime = timer.elapsed() / 1000.0;
+	m_peakMemory = PeakMemoryUsage();
+
+	if( m_indices.empty() )
+	{
+		m_errorMessage = QString( "File %1 does not contain any triangle." ).arg( fileName );
+		return ( false );
+	}
+	return ( true );
+}
+
+/*!
+ * Returns a line with the mesh size, the load time and the peak memory of the last load.
+ */
+QString MeshLoader::GetReport() const
+{
+	return ( QString( "%1 triangles read, %2 triangles and %3 vertices after welding. Load time: %4 s. Peak memory: %5 MB." )
+			.arg( m_nFileTriangles )
+			.arg( GetNumberOfTriangles() )
+			.arg( GetNumberOfVertices() )
+			.arg( m_loadTime )
+			.arg( m_peakMemory / ( 1024.0 * 1024.0 ), 0, 'f', 1 ) );
+}
+
+/*!
+ * Returns the peak resident memory of the process in bytes, or zero if the platform does not report it.
+ * The pages of the mapped file that have been read are included.
+ */
+unsigned long MeshLoader::PeakMemoryUsage()
+{
+#if defined( Q_OS_WIN )
+	PROCESS_MEMORY_COUNTERS counters;
+	if( !GetProcessMemoryInfo( GetCurrentProcess(), &counters, sizeof( counters ) ) )	return ( 0 );
+	return ( static_cast< unsigned long >( counters.PeakWorkingSetSize ) );
+#elif defined( Q_OS_UNIX )
+	struct rusage usage;
+	if( getrusage( RUSAGE_SELF, &usage ) != 0 )	return ( 0 );
+#if defined( Q_OS_MAC )
+	return ( usage.ru_maxrss );
+#else
+	return ( usage.ru_maxrss * 1024ul );
+#endif
+#else
+	return ( 0 );
+#endif
+}
+
+void MeshLoader::Clear()
+{
+	m_errorMessage.clear();
+	std::vector< unsigned int >().swap( m_indices );
+	std::vector< float >().swap( m_vertices );
+	m_nFileTriangles = 0;
+	m_loadTime = 0.0;
+	m_peakMemory = 0;
+}
+
+/*!
+ * Copies the facet vertices of the binary STL in \a data to \a corners.
+ */
+bool MeshLoader::ReadBinarySTL( const char* data, qint64 size, std::vector< float >* corners )
+{
+	unsigned long nFacets = qFromLittleEndian< quint32 >( reinterpret_cast< const uchar* >( data + 80 ) );
+	if( 84 + 50 * qint64( nFacets ) > size )
+	{
+		m_errorMessage = QString( "The binary STL file is shorter than its %1 facets." ).arg( nFacets );
+		return ( false );
+	}
+
+	corners->resize( 9 * nFacets );
+	if( nFacets == 0 )	return ( true );
+
+	std::vector< CornerRange > facetRanges = SplitRange( nFacets );
+	QtConcurrent::blockingMap( facetRanges, BinarySTLReader( data, &( *corners )[0] ) );
+	return ( true );
+}
+
+/*!
+ * Reads the vertex records of the ASCII STL in \a data to \a corners.
+ */
+bool MeshLoader::ReadAsciiSTL( const char* data, qint64 size, std::vector< float >* corners )
+{
+	const char* begin = SkipSpaces( data, data + size );
+	if( !IsKeyword( begin, LineEnd( begin, data + size ), "solid" ) )
+	{
+		m_errorMessage = QString( "The file is neither a binary nor an ASCII STL file." );
+		return ( false );
+	}
+
+	std::vector< MeshChunk > chunks = SplitLines( data, size );
+	QtConcurrent::blockingMap( chunks, AsciiSTLReader( *localeconv()->decimal_point ) );
+
+	unsigned long nValues = 0;
+	unsigned long nNormalValues = 0;
+	for( unsigned int c = 0; c < chunks.size(); ++c )
+	{
+		if( !chunks[c].isValid )
+		{
+			m_errorMessage = QString( "Wrong facet or vertex record in the STL file." );
+			return ( false );
+		}
+		nValues += chunks[c].positions.size();
+		nNormalValues += chunks[c].normals.size();
+	}
+	if( ( nValues % 9 != 0 ) || ( nValues != 3 * nNormalValues ) )
+	{
+		m_errorMessage = QString( "The facets of the STL file do not have one normal and three vertex records." );
+		return ( false );
+	}
+
+	std::vector< float > normals;
+	normals.reserve( nNormalValues );
+	corners->reserve( nValues );
+	for( unsigned int c = 0; c < chunks.size(); ++c )
+	{
+		corners->insert( corners->end(), chunks[c].positions.begin(), chunks[c].positions.end() );
+		normals.insert( normals.end(), chunks[c].normals.begin(), chunks[c].normals.end() );
+		std::vector< float >().swap( chunks[c].positions );
+		std::vector< float >().swap( chunks[c].normals );
+	}
+
+	for( unsigned long f = 0; f < nNormalValues / 3; ++f )
+		OrientTriangle( &( *corners )[9 * f], &normals[3 * f] );
+	return ( true );
+}
+
+/*!
+ * Reads the vertices and faces of the OBJ in \a data and stores the triangle corner positions in \a corners.
+ */
+bool MeshLoader::ReadOBJ( const char* data, qint64 size, std::vector< float >* corners )
+{
+	std::vector< MeshChunk > chunks = SplitLines( data, size );
+	QtConcurrent::blockingMap( chunks, OBJReader( *localeconv()->decimal_point ) );
+
+	unsigned long nVertexValues = 0;
+	unsigned long nCorners = 0;
+	for( unsigned int c = 0; c < chunks.size(); ++c )
+	{
+		if( !chunks[c].isValid )
+		{
+			m_errorMessage = QString( "Wrong vertex or face record in the OBJ file." );
+			return ( false );
+		}
+		chunks[c].vertexOffset = nVertexValues / 3;
+		chunks[c].cornerOffset = nCorners;
+		nVertexValues += chunks[c].positions.size();
+		nCorners += chunks[c].faceIndices.size();
+	}
+
+	std::vector< float > vertices;
+	vertices.reserve( nVertexValues );
+	for( unsigned int c = 0; c < chunks.size(); ++c )
+	{
+		vertices.insert( vertices.end(), chunks[c].positions.begin(), chunks[c].positions.end() );
+		std::vector< float >().swap( chunks[c].positions );
+	}
+
+	corners->resize( 3 * nCorners );
+	if( nCorners == 0 )	return ( true );
+
+	QtConcurrent::blockingMap( chunks, OBJFaceResolver( &vertices, &( *corners )[0] ) );
+	for( unsigned int c = 0; c < chunks.size(); ++c )
+	{
+		if( !chunks[c].isValid )
+		{
+			m_errorMessage = QString( "A face of the OBJ file refers to a vertex that does not exist." );
+			return ( false );
+		}
+	}
+	return ( true );
+}
+
+/*!
+ * Builds the indexed mesh from the triangle \a corners. Corners with the same position share
+ * a vertex and the triangles that become degenerate are removed.
+ */
+void MeshLoader::WeldVertices( const std::vector< float >& corners )
+{
+	unsigned long nCorners = corners.size() / 3;
+	if( nCorners == 0 )	return;
+
+	int nPartitions = std::min( std::max( 1, QThread::idealThreadCount() ), 64 );
+	std::vector< unsigned char > partition( nCorners );
+	m_indices.resize( nCorners );
+
+	std::vector< CornerRange > cornerRanges = SplitRange( nCorners );
+	QtConcurrent::blockingMap( cornerRanges, CornerPartitioner( &corners[0], &partition[0], nPartitions ) );
+
+	std::vector< WeldPartition > weldPartitions( nPartitions );
+	for( int p = 0; p < nPartitions; ++p )
+	{
+		weldPartitions[p].id = static_cast< unsigned char >( p );
+	}
+	QtConcurrent::blockingMap( weldPartitions, PartitionWelder( &corners[0], &partition[0], nCorners, &m_indices[0] ) );
+
+	std::vector< unsigned long > offsets( nPartitions );
+	unsigned long nVertexValues = 0;
+	for( int p = 0; p < nPartitions; ++p )
+	{
+		offsets[p] = nVertexValues / 3;
+		nVertexValues += weldPartitions[p].vertices.size();
+	}
+
+	m_vertices.reserve( nVertexValues );
+	for( int p = 0; p < nPartitions; ++p )
+	{
+		m_vertices.insert( m_vertices.end(), weldPartitions[p].vertices.begin(), weldPartitions[p].vertices.end() );
+		std::vector< float >().swap( weldPartitions[p].vertices );
+	}
+	QtConcurrent::blockingMap( cornerRanges, IndexOffsetter( &partition[0], &offsets, &m_indices[0] ) );
+
+	unsigned long nTriangles = 0;
+	for( unsigned long t = 0; t < nCorners / 3; ++t )
+	{
+		unsigned int a = m_indices[3 * t];
+		unsigned int b = m_indices[3 * t + 1];
+		unsigned int c = m_indices[3 * t + 2];
+		if( ( a == b ) || ( b == c ) || ( a == c ) )	continue;
+
+		m_indices[3 * nTriangles] = a;
+		m_indices[3 * nTriangles + 1] = b;
+		m_indices[3 * nTriangles + 2] = c;
+		++nTriangles;
+	}
+	m_indices.resize( 3 * nTriangles );
+}
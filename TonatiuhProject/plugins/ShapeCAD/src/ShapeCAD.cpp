@@ -39,6 +39,7 @@ Juana Amieva, Azael Mancillas, Cesar Cantu, I
 #include <algorithm>
 #include <functional> // for std::bind
 
+#include <QCryptographicHash>
 #include <QString>
 
 #include <Inventor/SoPrimitiveVertex.h>
@@ -57,6 +58,35 @@ Juana Amieva, Azael Mancillas, Cesar Cantu, I
 #include "ShapeCAD.h"
 #include "Triangle.h"
 
+namespace
+{
+	/*!
+	 * Copies \a nValues points of \a values to \a vectors.
+	 */
+	template< class Vec3, class Real >
+	void CopyPoints( Vec3* vectors, const Real* values, int nValues )
+	{
+		for( int v = 0; v < nValues; v++ )
+			vectors[v].setValue( values[3 * v], values[3 * v + 1], values[3 * v + 2] );
+	}
+
+	/*!
+	 * Adds \a size bytes at \a data to \a hash.
+	 */
+	void AddHashData( QCryptographicHash* hash, const void* data, size_t size )
+	{
+		const char* bytes = static_cast< const char* >( data );
+		const size_t blockSize = 1 << 30;
+		while( size > 0 )
+		{
+			size_t length = std::min( size, blockSize );
+			hash->addData( bytes, int( length ) );
+			bytes += length;
+			size -= length;
+		}
+	}
+}
+
 
 /*! *****************************
  * class ShapeCAD
@@ -74,44 +104,47 @@ ShapeCAD::ShapeCAD(  )
 : m_pBVH( 0 )
 {
 	SO_NODE_CONSTRUCTOR(ShapeCAD);
+	SO_NODE_ADD_FIELD( vertexList, (0, 0, 0 ) );
+	SO_NODE_ADD_FIELD( indexList, ( 0 ) );
+	SO_NODE_ADD_FIELD( storeBVH, ( TRUE ) );
+	SO_NODE_ADD_FIELD( bvhNodeList, ( 0 ) );
+	SO_NODE_ADD_FIELD( bvhBoundList, (0, 0, 0 ) );
+	SO_NODE_ADD_FIELD( geometryHash, ( "" ) );
 	SO_NODE_ADD_FIELD( v1VertexList, (0, 0, 0 ) );
 	SO_NODE_ADD_FIELD( v2VertexList, (0, 0, 0 ) );
 	SO_NODE_ADD_FIELD( v3VertexList, (0, 0, 0 ) );
 	SO_NODE_ADD_FIELD( normalVertexList, (0, 0, 0 ) );
 
-
-	m_v1Sensor = new SoFieldSensor(updateTrinaglesList, this);
-	m_v1Sensor->setPriority( 0 );
-	m_v1Sensor->attach( &v1VertexList );
-	m_v2Sensor = new SoFieldSensor(updateTrinaglesList, this);
-	m_v2Sensor->setPriority( 0 );
-	m_v2Sensor->attach( &v2VertexList );
-	m_v3Sensor = new SoFieldSensor(updateTrinaglesList, this);
-	m_v3Sensor->setPriority( 0 );
-	m_v3Sensor->attach( &v3VertexList );
-	m_normalSensor = new SoFieldSensor(updateTrinaglesList, this);
-	m_normalSensor->setPriority( 0 );
-	m_normalSensor->attach( &normalVertexList );
+	vertexList.setNum( 0 );
+	indexList.setNum( 0 );
+	bvhNodeList.setNum( 0 );
+	bvhBoundList.setNum( 0 );
+	v1VertexList.setNum( 0 );
+	v2VertexList.setNum( 0 );
+	v3VertexList.setNum( 0 );
+	normalVertexList.setNum( 0 );
+	vertexList.setDefault( TRUE );
+	indexList.setDefault( TRUE );
+	bvhNodeList.setDefault( TRUE );
+	bvhBoundList.setDefault( TRUE );
+	v1VertexList.setDefault( TRUE );
+	v2VertexList.setDefault( TRUE );
+	v3VertexList.setDefault( TRUE );
+	normalVertexList.setDefault( TRUE );
+
+	m_vertexSensor = new SoFieldSensor(updateMesh, this);
+	m_indexSensor = new SoFieldSensor(updateMesh, this);
+	m_storeBVHSensor = new SoFieldSensor(updateMesh, this);
+	AttachSensors();
 }
 
 ShapeCAD::~ShapeCAD()
 {
 	delete m_pBVH;
 
-
-	if( m_pTriangleList.size() > 0 )
-	{
-		for( unsigned int f = 0; f < m_pTriangleList.size(); f++ )
-		{
-			delete m_pTriangleList[f];
-		}
-	}
-	m_pTriangleList.clear();
-
-	delete m_v1Sensor;
-	delete m_v2Sensor;
-	delete m_v3Sensor;
-	delete m_normalSensor;
+	delete m_vertexSensor;
+	delete m_indexSensor;
+	delete m_storeBVHSensor;
 }
 
 
@@ -173,60 +206,35 @@ Point3D ShapeCAD::Sample( double /*u*/, double /*v*/ ) const
 	return ( Point3D( 0.0, 0.0, 0.0 ) );
 }
 
-
-bool ShapeCAD:: SetFacetList( std::vector< Triangle* > triangleList )
+/*!
+ * Sets the shape mesh to the indexed mesh defined by \a vertices (three coordinates
+ * per vertex) and \a indices (three vertex indices per triangle).
+ */
+bool ShapeCAD::SetMesh( const std::vector< float >& vertices, const std::vector< unsigned int >& indices )
 {
-	m_v1Sensor->detach();
-	m_v2Sensor->detach();
-	m_v3Sensor->detach();
-	m_normalSensor->detach();
-
+	if( ( vertices.size() % 3 != 0 ) || ( indices.size() % 3 != 0 ) )	return ( false );
 
-	if( m_pTriangleList.size() > 0 )
-	{
-		for( unsigned int f = 0; f < m_pTriangleList.size(); f++ )
-		{
-			delete m_pTriangleList[f];
-		}
-	}
-	m_pTriangleList.clear();
+	unsigned int nVertices = vertices.size() / 3;
+	for( unsigned int i = 0; i < indices.size(); i++ )
+		if( indices[i] >= nVertices )	return ( false );
 
-	m_pTriangleList = triangleList;
+	DetachSensors();
 
-
-	for( unsigned int f = 0; f < triangleList.size(); f++ )
+	vertexList.setNum( nVertices );
+	if( nVertices > 0 )
 	{
-
-		Triangle* facet = triangleList[f];
-
-		Point3D v1 = facet->GetVertex1();
-		Point3D v2 = facet->GetVertex2();
-		Point3D v3 = facet->GetVertex3();
-		v1VertexList.set1Value( f, v1.x, v1.y, v1.z);
-		v2VertexList.set1Value( f, v2.x, v2.y, v2.z);
-		v3VertexList.set1Value( f, v3.x, v3.y, v3.z);
-		normalVertexList.set1Value( f, facet->GetNormal().x, facet->GetNormal().y, facet->GetNormal().z);
-
-	}
-
-	if( m_pBVH )
-	{
-		delete m_pBVH;
-		m_pBVH = 0;
+		CopyPoints( vertexList.startEditing(), &vertices[0], nVertices );
+		vertexList.finishEditing();
 	}
 
-	m_pBVH = new BVH( &m_pTriangleList, 1 );
+	indexList.setNum( indices.size() );
+	if( indices.size() > 0 )
+		indexList.setValues( 0, indices.size(), reinterpret_cast< const int32_t* >( &indices[0] ) );
 
+	AttachSensors();
+	UpdateMesh();
 
-	m_v1Sensor->setPriority( 0 );
-	m_v1Sensor->attach( &v1VertexList );
-	m_v2Sensor->setPriority( 0 );
-	m_v2Sensor->attach( &v2VertexList );
-	m_v3Sensor->setPriority( 0 );
-	m_v3Sensor->attach( &v3VertexList );
-	m_normalSensor->setPriority( 0 );
-	m_normalSensor->attach( &normalVertexList );
-	return ( true);
+	return ( !m_triangleList.empty() );
 }
 
 int ShapeCAD::getFields(SoFieldList & /*fields*/ ) const
@@ -249,6 +257,19 @@ void ShapeCAD::computeBBox(SoAction *, SbBox3f &box, SbVec3f& /*center*/ )
     box.setBounds(min, max);
 }
 
+/*!
+ * Copies the fields of \a from. The mesh is updated once all the fields have been copied,
+ * so the hierarchy of \a from is reused.
+ */
+void ShapeCAD::copyContents( const SoFieldContainer* from, SbBool copyConnections )
+{
+	DetachSensors();
+	TShape::copyContents( from, copyConnections );
+	AttachSensors();
+
+	UpdateMesh();
+}
+
 void ShapeCAD::generatePrimitives(SoAction *action)
 {
 
@@ -269,17 +290,19 @@ void ShapeCAD::generatePrimitives(SoAction *action)
 
 	beginShape(action, TRIANGLES );
 
-	for( int f = 0; f < v1VertexList.getNum(); f++ )
+	for( unsigned int f = 0; f < m_triangleList.size(); f++ )
 	{
-		//SbVec3f aPoint = v1VertexList[f];
-		SbVec3f aPoint( v1VertexList[f][0], v1VertexList[f][1], v1VertexList[f][2] );
-		SbVec3f bPoint( v2VertexList[f][0], v2VertexList[f][1], v2VertexList[f][2] );
-		SbVec3f cPoint( v3VertexList[f][0], v3VertexList[f][1], v3VertexList[f][2] );
+		const Triangle& triangle = m_triangleList[f];
+		Point3D v1 = triangle.GetVertex1();
+		Point3D v2 = triangle.GetVertex2();
+		Point3D v3 = triangle.GetVertex3();
+		SbVec3f aPoint( v1.x, v1.y, v1.z );
+		SbVec3f bPoint( v2.x, v2.y, v2.z );
+		SbVec3f cPoint( v3.x, v3.y, v3.z );
 
 		//SbVec3f dpdu =  bPoint - aPoint;
 		//SbVec3f dpdv = cPoint - aPoint;
-		SbVec3f normal( normalVertexList[f][0], normalVertexList[f][1], normalVertexList[f][2] );
-		normal.normalize();
+		SbVec3f normal( triangle.GetNormal().x, triangle.GetNormal().y, triangle.GetNormal().z );
 
 
 		//a Point
@@ -310,81 +333,233 @@ void ShapeCAD::generatePrimitives(SoAction *action)
 
 }
 
-
-void ShapeCAD::updateTrinaglesList( void* data, SoSensor* )
+/*!
+ * Reads the node fields. The mesh is updated once all the fields have been read,
+ * so a stored hierarchy is used instead of building a new one.
+ */
+SbBool ShapeCAD::readInstance( SoInput* in, unsigned short flags )
 {
+	DetachSensors();
+	SbBool readOK = TShape::readInstance( in, flags );
+	AttachSensors();
+
+	if( readOK )	UpdateMesh();
+	return ( readOK );
+}
 
+
+void ShapeCAD::updateMesh( void* data, SoSensor* )
+{
 	ShapeCAD* shapeCAD = (ShapeCAD *) data;
+	shapeCAD->UpdateMesh();
+}
 
+void ShapeCAD::AttachSensors()
+{
+	m_vertexSensor->setPriority( 0 );
+	m_vertexSensor->attach( &vertexList );
+	m_indexSensor->setPriority( 0 );
+	m_indexSensor->attach( &indexList );
+	m_storeBVHSensor->setPriority( 0 );
+	m_storeBVHSensor->attach( &storeBVH );
+}
 
-	if( shapeCAD->m_pTriangleList.size() > 0 )
+/*!
+ * Moves the triangles of the facet lists written by previous versions to the indexed mesh.
+ * Each facet keeps its own three vertices. The indexed mesh takes the normals from the vertices order,
+ * so the second and third vertices of a facet are swapped if its order does not match its stored normal.
+ */
+void ShapeCAD::ConvertFacetLists()
+{
+	int nFacets = v1VertexList.getNum();
+	bool hasNormals = ( normalVertexList.getNum() == nFacets );
+	if( ( v2VertexList.getNum() == nFacets ) && ( v3VertexList.getNum() == nFacets ) )
 	{
-		for( unsigned int f = 0; f < shapeCAD->m_pTriangleList.size(); f++ )
+		vertexList.setNum( 3 * nFacets );
+		indexList.setNum( 3 * nFacets );
+		int32_t* indices = indexList.startEditing();
+		for( int f = 0; f < nFacets; f++ )
 		{
-			delete shapeCAD->m_pTriangleList[f];
+			Point3D v1( v1VertexList[f][0], v1VertexList[f][1], v1VertexList[f][2] );
+			Point3D v2( v2VertexList[f][0], v2VertexList[f][1], v2VertexList[f][2] );
+			Point3D v3( v3VertexList[f][0], v3VertexList[f][1], v3VertexList[f][2] );
+			if( hasNormals )
+			{
+				Vector3D normal( normalVertexList[f][0], normalVertexList[f][1], normalVertexList[f][2] );
+				if( DotProduct( CrossProduct( Vector3D( v2 - v1 ), Vector3D( v3 - v1 ) ), normal ) < 0.0 )	std::swap( v2, v3 );
+			}
+
+			vertexList.set1Value( 3 * f, v1.x, v1.y, v1.z );
+			vertexList.set1Value( 3 * f + 1, v2.x, v2.y, v2.z );
+			vertexList.set1Value( 3 * f + 2, v3.x, v3.y, v3.z );
+			indices[3 * f] = 3 * f;
+			indices[3 * f + 1] = 3 * f + 1;
+			indices[3 * f + 2] = 3 * f + 2;
 		}
+		indexList.finishEditing();
 	}
-	shapeCAD->m_pTriangleList.clear();
 
-	if( shapeCAD->m_pBVH )
+	v1VertexList.setNum( 0 );
+	v2VertexList.setNum( 0 );
+	v3VertexList.setNum( 0 );
+	normalVertexList.setNum( 0 );
+	v1VertexList.setDefault( TRUE );
+	v2VertexList.setDefault( TRUE );
+	v3VertexList.setDefault( TRUE );
+	normalVertexList.setDefault( TRUE );
+}
+
+/*!
+ * Returns the hash of the mesh and the stored hierarchy. It changes if any of them changes.
+ */
+QString ShapeCAD::ComputeGeometryHash() const
+{
+	QCryptographicHash hash( QCryptographicHash::Md5 );
+	hash.addData( "ShapeCAD BVH 1" );
+	if( vertexList.getNum() > 0 )
+		AddHashData( &hash, vertexList.getValues( 0 ), vertexList.getNum() * sizeof( vertexList[0] ) );
+	if( indexList.getNum() > 0 )
+		AddHashData( &hash, indexList.getValues( 0 ), indexList.getNum() * sizeof( int32_t ) );
+	if( bvhNodeList.getNum() > 0 )
+		AddHashData( &hash, bvhNodeList.getValues( 0 ), bvhNodeList.getNum() * sizeof( int32_t ) );
+	if( bvhBoundList.getNum() > 0 )
+		AddHashData( &hash, bvhBoundList.getValues( 0 ), bvhBoundList.getNum() * sizeof( bvhBoundList[0] ) );
+
+	return ( QString( hash.result().toHex() ) );
+}
+
+void ShapeCAD::DetachSensors()
+{
+	m_vertexSensor->detach();
+	m_indexSensor->detach();
+	m_storeBVHSensor->detach();
+}
+
+/*!
+ * Removes the stored hierarchy from the node fields.
+ */
+void ShapeCAD::ClearStoredBVH()
+{
+	bvhNodeList.setNum( 0 );
+	bvhBoundList.setNum( 0 );
+	geometryHash.setValue( "" );
+	bvhNodeList.setDefault( TRUE );
+	bvhBoundList.setDefault( TRUE );
+	geometryHash.setDefault( TRUE );
+}
+
+/*!
+ * Creates the hierarchy from the stored node lists if the stored hash matches the current mesh.
+ */
+bool ShapeCAD::RestoreBVH()
+{
+	if( ( bvhNodeList.getNum() == 0 ) || ( bvhBoundList.getNum() != 2 * bvhNodeList.getNum() / 3 ) )	return ( false );
+	if( ComputeGeometryHash() != QString( geometryHash.getValue().getString() ) )	return ( false );
+
+	std::vector< int > nodeData( bvhNodeList.getValues( 0 ), bvhNodeList.getValues( 0 ) + bvhNodeList.getNum() );
+	std::vector< BBox > nodeBounds;
+	nodeBounds.reserve( bvhBoundList.getNum() / 2 );
+	for( int b = 0; b < bvhBoundList.getNum(); b += 2 )
 	{
-		delete shapeCAD->m_pBVH;
-		shapeCAD->m_pBVH = 0;
+		Point3D pMin( bvhBoundList[b][0], bvhBoundList[b][1], bvhBoundList[b][2] );
+		Point3D pMax( bvhBoundList[b + 1][0], bvhBoundList[b + 1][1], bvhBoundList[b + 1][2] );
+		nodeBounds.push_back( BBox( pMin, pMax ) );
 	}
 
+	m_pBVH = new BVH( &m_triangleList, nodeData, nodeBounds );
+	if( !m_pBVH->IsValid() )
+	{
+		delete m_pBVH;
+		m_pBVH = 0;
+		return ( false );
+	}
+	return ( true );
+}
+
+/*!
+ * Builds the hierarchy for the mesh and stores it in the node fields. The triangles of indexList
+ * are reordered as the hierarchy leaves.
+ */
+void ShapeCAD::StoreBVH()
+{
+	m_pBVH = new BVH( &m_triangleList, 1 );
+
+	DetachSensors();
 
-	int v1Size = shapeCAD->v1VertexList.getNum();
-	if( ( v1Size > 0 ) &&
-			( shapeCAD->v2VertexList.getNum() == v1Size ) &&
-			( shapeCAD->v3VertexList.getNum() == v1Size ) &&
-			( shapeCAD->normalVertexList.getNum() == v1Size )  )
+	const std::vector< unsigned int >& triangleOrder = m_pBVH->GetTriangleOrder();
+	std::vector< int32_t > indices( indexList.getValues( 0 ), indexList.getValues( 0 ) + indexList.getNum() );
+	int32_t* orderedIndices = indexList.startEditing();
+	for( unsigned int t = 0; t < triangleOrder.size(); t++ )
 	{
-		/*
-		shapeCAD->m_xMin = gc::Infinity;
-		shapeCAD->m_yMin = gc::Infinity;
-		shapeCAD->m_zMin = gc::Infinity;
+		orderedIndices[3 * t] = indices[3 * triangleOrder[t]];
+		orderedIndices[3 * t + 1] = indices[3 * triangleOrder[t] + 1];
+		orderedIndices[3 * t + 2] = indices[3 * triangleOrder[t] + 2];
+	}
+	indexList.finishEditing();
 
-		shapeCAD->m_xMax = - gc::Infinity;
-		shapeCAD->m_yMax = - gc::Infinity;
-		shapeCAD->m_zMax = - gc::Infinity;
-		*/
+	std::vector< int > nodeData;
+	std::vector< BBox > nodeBounds;
+	m_pBVH->GetNodeData( &nodeData, &nodeBounds );
 
-		for(  int f = 0; f < v1Size; f++ )
-		{
-			Point3D v1 = Point3D( shapeCAD->v1VertexList[f][0], shapeCAD->v1VertexList[f][1], shapeCAD->v1VertexList[f][2] );
-			Point3D v2 = Point3D( shapeCAD->v2VertexList[f][0], shapeCAD->v2VertexList[f][1], shapeCAD->v2VertexList[f][2] );
-			Point3D v3 = Point3D( shapeCAD->v3VertexList[f][0], shapeCAD->v3VertexList[f][1], shapeCAD->v3VertexList[f][2] );
-			NormalVector normal = NormalVector( shapeCAD->normalVertexList[f][0], shapeCAD->normalVertexList[f][1], shapeCAD->normalVertexList[f][2] );
-			Triangle* triangle = new Triangle( v1, v2, v3, normal );
-			shapeCAD->m_pTriangleList.push_back( triangle );
-
-			/*
-			if( v1.x < shapeCAD->m_xMin )	shapeCAD->m_xMin = v1.x;
-			if( v2.x < shapeCAD->m_xMin )	shapeCAD->m_xMin = v2.x;
-			if( v3.x < shapeCAD->m_xMin )	shapeCAD->m_xMin = v3.x;
-
-			if( v1.y < shapeCAD->m_yMin )	shapeCAD->m_yMin = v1.y;
-			if( v2.y < shapeCAD->m_yMin )	shapeCAD->m_yMin = v2.y;
-			if( v3.y < shapeCAD->m_yMin ) 	shapeCAD->m_yMin = v3.y;
-
-			if( v1.z < shapeCAD->m_zMin )	shapeCAD->m_zMin = v1.z;
-			if( v2.z < shapeCAD->m_zMin )	shapeCAD->m_zMin = v2.z;
-			if( v3.z < shapeCAD->m_zMin )	shapeCAD->m_zMin = v3.z;
-
-			if( v1.x > shapeCAD->m_xMax )	shapeCAD->m_xMax = v1.x;
-			if( v2.x > shapeCAD->m_xMax )	shapeCAD->m_xMax = v2.x;
-			if( v3.x > shapeCAD->m_xMax )	shapeCAD->m_xMax = v3.x;
-
-			if( v1.y > shapeCAD->m_yMax )	shapeCAD->m_yMax = v1.y;
-			if( v2.y > shapeCAD->m_yMax )	shapeCAD->m_yMax = v2.y;
-			if( v3.y > shapeCAD->m_yMax )	shapeCAD->m_yMax = v3.y;
-
-			if( v1.z > shapeCAD->m_zMax )	shapeCAD->m_zMax = v1.z;
-			if( v2.z > shapeCAD->m_zMax )	shapeCAD->m_zMax = v2.z;
-			if( v3.z > shapeCAD->m_zMax )	shapeCAD->m_zMax = v3.z;
-			*/
-		}
-		shapeCAD->m_pBVH = new BVH( &shapeCAD->m_pTriangleList, 1);
+	bvhNodeList.setNum( nodeData.size() );
+	if( nodeData.size() > 0 )
+		bvhNodeList.setValues( 0, nodeData.size(), &nodeData[0] );
+
+	bvhBoundList.setNum( 2 * nodeBounds.size() );
+	for( unsigned int b = 0; b < nodeBounds.size(); b++ )
+	{
+		bvhBoundList.set1Value( 2 * b, nodeBounds[b].pMin.x, nodeBounds[b].pMin.y, nodeBounds[b].pMin.z );
+		bvhBoundList.set1Value( 2 * b + 1, nodeBounds[b].pMax.x, nodeBounds[b].pMax.y, nodeBounds[b].pMax.z );
 	}
+
+	geometryHash.setValue( ComputeGeometryHash().toStdString().c_str() );
+
+	AttachSensors();
 }
 
+/*!
+ * Creates the triangles of the indexed mesh and its hierarchy. If storeBVH is true, the stored hierarchy is used
+ * when it is valid for the mesh, otherwise a new one is built and stored. If it is false, the hierarchy is built
+ * and the node does not keep it, so the saved files are smaller but the hierarchy is built each time they are read.
+ */
+void ShapeCAD::UpdateMesh()
+{
+	DetachSensors();
+	if( v1VertexList.getNum() > 0 )	ConvertFacetLists();
+	AttachSensors();
+
+	m_triangleList.clear();
+	if( m_pBVH )
+	{
+		delete m_pBVH;
+		m_pBVH = 0;
+	}
+
+	int nVertices = vertexList.getNum();
+	int nIndices = indexList.getNum();
+	if( ( nVertices == 0 ) || ( nIndices == 0 ) || ( nIndices % 3 != 0 ) )	return;
+
+	const int32_t* indices = indexList.getValues( 0 );
+	for( int i = 0; i < nIndices; i++ )
+		if( ( indices[i] < 0 ) || ( indices[i] >= nVertices ) )	return;
+
+	m_triangleList.reserve( nIndices / 3 );
+	for( int t = 0; t < nIndices; t += 3 )
+	{
+		Point3D v1( vertexList[indices[t]][0], vertexList[indices[t]][1], vertexList[indices[t]][2] );
+		Point3D v2( vertexList[indices[t + 1]][0], vertexList[indices[t + 1]][1], vertexList[indices[t + 1]][2] );
+		Point3D v3( vertexList[indices[t + 2]][0], vertexList[indices[t + 2]][1], vertexList[indices[t + 2]][2] );
+
+		Vector3D normalVector = CrossProduct( Vector3D( v2 - v1 ), Vector3D( v3 - v1 ) );
+		NormalVector normal;
+		if( normalVector.length() > 0.0 )	normal = NormalVector( Normalize( normalVector ) );
+		m_triangleList.push_back( Triangle( v1, v2, v3, normal ) );
+	}
+
+	if( !storeBVH.getValue() )
+	{
+		m_pBVH = new BVH( &m_triangleList, 1 );
+		ClearStoredBVH();
+	}
+	else if( !RestoreBVH() )	StoreBVH();
+}
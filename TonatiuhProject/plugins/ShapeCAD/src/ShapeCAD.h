@@ -41,8 +41,13 @@ Juana Amieva, Azael Mancillas, Cesar Cantu, I
 
 #include <vector>
 
+#include <Inventor/fields/SoMFInt32.h>
+#include <Inventor/fields/SoSFBool.h>
+#include <Inventor/fields/SoSFString.h>
 #include <Inventor/sensors/SoFieldSensor.h>
 
+#include <QString>
+
 #include "BVH.h"
 #include "Point3D.h"
 #include "NormalVector.h"
@@ -92,33 +97,54 @@ public:
 
 	Point3D Sample( double u, double v ) const;
 
-	bool SetFacetList( std::vector< Triangle* > triangleList );
+	bool SetMesh( const std::vector< float >& vertices, const std::vector< unsigned int >& indices );
 
 	int	getFields(SoFieldList & fields) const;
 
 
 protected:
-	static void updateTrinaglesList(void *data, SoSensor *);
+	static void updateMesh(void *data, SoSensor *);
 	//bool Near( const Triangle* t1, const Triangle* t2, Point3D referencePoint ) const;
 	void computeBBox(SoAction *action, SbBox3f &box, SbVec3f &center);
+	void copyContents( const SoFieldContainer* from, SbBool copyConnections );
 	void generatePrimitives(SoAction *action);
+	SbBool readInstance( SoInput* in, unsigned short flags );
 	virtual ~ShapeCAD();
 
 
 
 private:
-
+	void AttachSensors();
+	void ConvertFacetLists();
+	QString ComputeGeometryHash() const;
+	void DetachSensors();
+	void ClearStoredBVH();
+	bool RestoreBVH();
+	void StoreBVH();
+	void UpdateMesh();
+
+	//Indexed mesh: shared vertices and three vertexList indices per triangle.
+	trt::TONATIUH_CONTAINERREALVECTOR3 vertexList;
+	SoMFInt32 indexList;
+
+	//Hierarchy built for the mesh, see BVH::GetNodeData(), and the hash of the mesh and the hierarchy.
+	//They are saved with the node only if storeBVH is true.
+	SoSFBool storeBVH;
+	SoMFInt32 bvhNodeList;
+	trt::TONATIUH_CONTAINERREALVECTOR3 bvhBoundList;
+	SoSFString geometryHash;
+
+	//Facet lists of the files saved before the indexed mesh. They are converted to the indexed mesh when read.
 	trt::TONATIUH_CONTAINERREALVECTOR3 v1VertexList;
 	trt::TONATIUH_CONTAINERREALVECTOR3 v2VertexList;
 	trt::TONATIUH_CONTAINERREALVECTOR3 v3VertexList;
 	trt::TONATIUH_CONTAINERREALVECTOR3 normalVertexList;
 
-	std::vector< Triangle*> m_pTriangleList;
+	std::vector< Triangle > m_triangleList;
 
-	SoFieldSensor* m_v1Sensor;
-	SoFieldSensor* m_v2Sensor;
-	SoFieldSensor* m_v3Sensor;
-	SoFieldSensor* m_normalSensor;
+	SoFieldSensor* m_vertexSensor;
+	SoFieldSensor* m_indexSensor;
+	SoFieldSensor* m_storeBVHSensor;
 
 /*
 	double m_xMin;
@@ -59,7 +59,7 @@ public:
    	bool IsFlat() { return false; }
 
 private:
-   	bool ReadSTLFile( QString filename, std::vector< Triangle* >* facetList ) const;
+   	ShapeCAD* CreateShapeFromFile( QString fileName, QString* errorMessage = 0 ) const;
 };
 
 
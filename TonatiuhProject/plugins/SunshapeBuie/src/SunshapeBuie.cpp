@@ -92,7 +92,17 @@ SunshapeBuie::~SunshapeBuie()
 //Light Interface
 void SunshapeBuie::GenerateRayDirection( Vector3D& direction, RandomDeviate& rand ) const
 {
-	double phi = gc::TwoPi * rand.RandomDouble();
+	GenerateRayDirection( direction, rand, 0, -1 );
+}
+
+/*!
+ * Generates the direction of the primary ray \a sampleIndex. The azimuth takes the sample dimension \a firstDimension.
+ * The zenith angle is sampled by rejection and takes its numbers from the random number stream.
+ */
+void SunshapeBuie::GenerateRayDirection( Vector3D& direction, RandomDeviate& rand,
+		unsigned long long sampleIndex, int firstDimension ) const
+{
+	double phi = gc::TwoPi * rand.Sample( sampleIndex, firstDimension );
     double theta = zenithAngle( rand );
     double sinTheta = sin( theta );
     double cosTheta = cos( theta );
@@ -62,8 +62,18 @@ SunshapePillbox::~SunshapePillbox()
 //Light Interface
 void SunshapePillbox::GenerateRayDirection( Vector3D& direction, RandomDeviate& rand ) const
 {
-	double phi = gc::TwoPi * rand.RandomDouble();
-    double theta = asin( sin( thetaMax.getValue() )*sqrt( rand.RandomDouble() ) );
+	GenerateRayDirection( direction, rand, 0, -1 );
+}
+
+/*!
+ * Generates the direction of the primary ray \a sampleIndex. The azimuth takes the sample dimension \a firstDimension and
+ * the zenith angle the dimension \a firstDimension + 1.
+ */
+void SunshapePillbox::GenerateRayDirection( Vector3D& direction, RandomDeviate& rand,
+		unsigned long long sampleIndex, int firstDimension ) const
+{
+	double phi = gc::TwoPi * rand.Sample( sampleIndex, firstDimension );
+    double theta = asin( sin( thetaMax.getValue() )*sqrt( rand.Sample( sampleIndex, firstDimension + 1 ) ) );
     double sinTheta = sin( theta );
     double cosTheta = cos( theta );
     double cosPhi = cos( phi );
@@ -57,6 +57,8 @@ public:
 
     //Sunshape Interface
     void GenerateRayDirection( Vector3D& direction, RandomDeviate& rand) const;
+    void GenerateRayDirection( Vector3D& direction, RandomDeviate& rand,
+    		unsigned long long sampleIndex, int firstDimension ) const;
 	double GetIrradiance() const;
     double GetThetaMax() const;
 
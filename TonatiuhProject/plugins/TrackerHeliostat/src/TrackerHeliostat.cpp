@@ -108,11 +108,11 @@ QString TrackerHeliostat::getIcon()
 	return QString(":/icons/TrackerHeliostat.png");
 }
 
-void TrackerHeliostat::Evaluate( Vector3D sunVectorW, Transform parentWT0 )
+bool TrackerHeliostat::ComputeTrackerMatrix( const Vector3D& sunVectorW, const Transform& parentWT0, SbMatrix* trackerMatrix ) const
 {
 	Vector3D i = parentWT0( sunVectorW );
 
-	if( i.length() == 0.0f ) return;
+	if( i.length() == 0.0f ) return ( false );
 	i = Normalize(i);
 
 	Point3D focus( aimingPoint.getValue( )[0], aimingPoint.getValue( )[1],aimingPoint.getValue( )[2] );
@@ -125,11 +125,11 @@ void TrackerHeliostat::Evaluate( Vector3D sunVectorW, Transform parentWT0 )
 		r = Vector3D( focus );
 
 
-	if( r.length() == 0.0f ) return;
+	if( r.length() == 0.0f ) return ( false );
 	r = Normalize(r);
 
 	Vector3D n = ( i + r );
-	if( n.length() == 0.0f ) return;
+	if( n.length() == 0.0f ) return ( false );
 	n = Normalize( n );
 
 	Vector3D Axe1;
@@ -144,34 +144,29 @@ void TrackerHeliostat::Evaluate( Vector3D sunVectorW, Transform parentWT0 )
 
 	Vector3D t = CrossProduct( n, Axe1 );
 	//Vector3D t( n[2], 0.0f, -n[0] );
-	if( t.length() == 0.0f ) return;
+	if( t.length() == 0.0f ) return ( false );
 	t = Normalize(t);
 
 	Vector3D p = CrossProduct( t, n );
-	if (p.length() == 0.0f) return;
+	if (p.length() == 0.0f) return ( false );
 	p = Normalize(p);
 
-	SbMatrix transformMatrix;
 	if ((typeOfRotation.getValue() == 0 ) || (typeOfRotation.getValue() == 3 ))// YX ou  ZX
 	{
-		 transformMatrix = SbMatrix( t[0], t[1], t[2], 0.0,
+		 *trackerMatrix = SbMatrix( t[0], t[1], t[2], 0.0,
 								  n[0], n[1], n[2], 0.0,
 								  p[0], p[1], p[2], 0.0,
 								  0.0, 0.0, 0.0, 1.0 );
 	}
 	else // YZ
 	{
-		transformMatrix = SbMatrix( p[0], p[1], p[2], 0.0,
+		*trackerMatrix = SbMatrix( p[0], p[1], p[2], 0.0,
 								  n[0], n[1], n[2], 0.0,
 								  t[0], t[1], t[2], 0.0,
 								  0.0, 0.0, 0.0, 1.0 );
 	}
 
-
-	SoTransform* newTransform = new SoTransform();
-	newTransform->setMatrix( transformMatrix );
-
-	SetEngineOutput(newTransform);
+	return ( true );
 }
 
 void TrackerHeliostat::evaluate()
@@ -111,7 +111,7 @@ QString TrackerLinearFresnel::getIcon()
 }
 
 
-void TrackerLinearFresnel::Evaluate( Vector3D sunVectorW, Transform parentWT0 )
+bool TrackerLinearFresnel::ComputeTrackerMatrix( const Vector3D& sunVectorW, const Transform& parentWT0, SbMatrix* trackerMatrix ) const
 {
 	Vector3D i = parentWT0( sunVectorW );
 
@@ -168,10 +168,8 @@ void TrackerLinearFresnel::Evaluate( Vector3D sunVectorW, Transform parentWT0 )
 
 	SbVec3f axis = SbVec3f( localAxis.x, localAxis.y, localAxis.z );
 
-	SoTransform* newTransform = new SoTransform();
-	newTransform->rotation.setValue( axis, angle );
-
-	SetEngineOutput(newTransform);
+	SbRotation( axis, angle ).getValue( *trackerMatrix );
+	return ( true );
 }
 
 void TrackerLinearFresnel::evaluate()
@@ -58,7 +58,7 @@ public:
 
 	//Constructor
 	TrackerLinearFresnel();
-	void Evaluate( Vector3D sunVectorW, Transform parentWT0 );
+	bool ComputeTrackerMatrix( const Vector3D& sunVectorW, const Transform& parentWT0, SbMatrix* trackerMatrix ) const;
 	void SwitchAimingPointType();
 
 	enum Axis{
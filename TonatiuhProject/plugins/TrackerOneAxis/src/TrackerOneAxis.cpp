@@ -91,7 +91,7 @@ QString TrackerOneAxis::getIcon()
 	return QString(":/icons/TrackerOneAxis.png");
 }
 
-void TrackerOneAxis::Evaluate( Vector3D sunVectorW, Transform parentWT0 )
+bool TrackerOneAxis::ComputeTrackerMatrix( const Vector3D& sunVectorW, const Transform& parentWT0, SbMatrix* trackerMatrix ) const
 {
 	Vector3D s = parentWT0( sunVectorW );
 	Vector3D p( 1.0f, 0.0f, 0.0f);
@@ -114,15 +114,11 @@ void TrackerOneAxis::Evaluate( Vector3D sunVectorW, Transform parentWT0 )
 	}
 
 
-	SbMatrix transformMatrix( t[0], t[1], t[2], 0.0,
+	*trackerMatrix = SbMatrix( t[0], t[1], t[2], 0.0,
 								n[0], n[1], n[2], 0.0,
 								p[0], p[1], p[2], 0.0,
 								0.0, 0.0, 0.0, 1.0 );
-
-	SoTransform* newTransform = new SoTransform();
-	newTransform->setMatrix( transformMatrix );
-
-	SetEngineOutput(newTransform);
+	return ( true );
 }
 
 void TrackerOneAxis::evaluate()
@@ -57,7 +57,7 @@ public:
 	//Constructor
 	TrackerOneAxis();
 
-	void Evaluate( Vector3D sunVectorW, Transform parentWT0 );
+	bool ComputeTrackerMatrix( const Vector3D& sunVectorW, const Transform& parentWT0, SbMatrix* trackerMatrix ) const;
 
 protected:	
 	virtual ~TrackerOneAxis();
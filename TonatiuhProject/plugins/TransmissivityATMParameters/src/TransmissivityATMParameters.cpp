@@ -62,6 +62,11 @@ TransmissivityATMParameters::~TransmissivityATMParameters()
 }
 
 bool TransmissivityATMParameters::IsTransmitted( double distance, RandomDeviate& rand ) const
+{
+	return ( rand.RandomDouble() < Transmittance( distance ) );
+}
+
+double TransmissivityATMParameters::Transmittance( double distance ) const
 {
 
 
@@ -70,8 +75,5 @@ bool TransmissivityATMParameters::IsTransmitted( double distance, RandomDeviate&
 	double attenuation = atm1.getValue() + atm2.getValue() * dKM + atm3.getValue()* dKM * dKM + atm4.getValue() * dKM * dKM * dKM;
 
 	double t = 1 - ( attenuation / 100 );
-
-	if( rand.RandomDouble() < t  )	return ( true );
-
-	return ( false );
+	return ( t );
 }
@@ -52,6 +52,7 @@ public:
     TransmissivityATMParameters();
 
 	bool IsTransmitted( double distance, RandomDeviate& rand ) const;
+	double Transmittance( double distance ) const;
 
 	//trt::TONATIUH_BOOL ClearDay;
 	trt::TONATIUH_REAL atm1;
@@ -59,6 +59,11 @@ TransmissivityBallestrin::~TransmissivityBallestrin()
 }
 
 bool TransmissivityBallestrin::IsTransmitted( double distance, RandomDeviate& rand ) const
+{
+	return ( rand.RandomDouble() < Transmittance( distance ) );
+}
+
+double TransmissivityBallestrin::Transmittance( double distance ) const
 {
 	double t;
 	if( ClearDay.getValue() )
@@ -72,7 +77,5 @@ bool TransmissivityBallestrin::IsTransmitted( double distance, RandomDeviate& ra
 				-0.0153718 * ( distance / 1000 ) * ( distance / 1000 ) * ( distance / 1000 ) );
 	}
 
-	if( rand.RandomDouble() < t  )	return true;
-
-	return false;
+	return ( t );
 }
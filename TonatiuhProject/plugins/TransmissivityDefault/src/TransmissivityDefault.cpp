@@ -59,7 +59,10 @@ TransmissivityDefault::~TransmissivityDefault()
 
 bool TransmissivityDefault::IsTransmitted( double distance, RandomDeviate& rand ) const
 {
-	if( rand.RandomDouble() < exp( -constant.getValue() * distance  ) )	return true;
+	return ( rand.RandomDouble() < Transmittance( distance ) );
+}
 
-	return false;
+double TransmissivityDefault::Transmittance( double distance ) const
+{
+	return ( exp( -constant.getValue() * distance  ) );
 }
@@ -58,6 +58,11 @@ TransmissivityMirval::~TransmissivityMirval()
 }
 
 bool TransmissivityMirval::IsTransmitted( double distance, RandomDeviate& rand ) const
+{
+	return ( rand.RandomDouble() < Transmittance( distance ) );
+}
+
+double TransmissivityMirval::Transmittance( double distance ) const
 {
 	double t;
 	if( distance/1000 <= 1.0 )
@@ -65,6 +70,5 @@ bool TransmissivityMirval::IsTransmitted( double distance, RandomDeviate& rand )
 	else
 		t= exp (-0.1106 * distance/1000);
 
-	if( rand.RandomDouble() < t  )	return true;
-	return false;
+	return ( t );
 }
@@ -52,6 +52,7 @@ public:
     TransmissivityMirval();
 
 	bool IsTransmitted( double distance, RandomDeviate& rand ) const;
+	double Transmittance( double distance ) const;
 
 
 protected:
@@ -59,8 +59,12 @@ TransmissivitySenguptaNREL::~TransmissivitySenguptaNREL()
 }
 
 bool TransmissivitySenguptaNREL::IsTransmitted( double distance, RandomDeviate& rand ) const
+{
+	return ( rand.RandomDouble() < Transmittance( distance ) );
+}
+
+double TransmissivitySenguptaNREL::Transmittance( double distance ) const
 {
 	double t = exp( -( 0.2299* beta.getValue() + 0.002674 )* distance /250 );
-	if( rand.RandomDouble() < t  )	return true;
-	return false;
+	return ( t );
 }
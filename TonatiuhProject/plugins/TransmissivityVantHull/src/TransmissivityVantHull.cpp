@@ -66,9 +66,20 @@ TransmissivityVantHull::~TransmissivityVantHull()
 
 bool TransmissivityVantHull::IsTransmitted( double distance, RandomDeviate& rand ) const
 {
-
 	if( distance == HUGE_VAL )	return false;
 
+	//The random number is always drawn, so the random sequence of the ray does not depend on the distance.
+	return ( rand.RandomDouble() < Transmittance( distance ) );
+}
+
+/*!
+ * Returns the fraction of the power transmitted along \a distance. The distances too long to evaluate the
+ * attenuation are not attenuated, as IsTransmitted does.
+ */
+double TransmissivityVantHull::Transmittance( double distance ) const
+{
+	if( distance == HUGE_VAL )	return ( 0.0 );
+
 	double R = distance/ 1000;
 	double beta = 3.912 / ( Visibility.getValue() / 1000 );
 	double h = Site_Elevation.getValue()/1000;
@@ -85,12 +96,7 @@ bool TransmissivityVantHull::IsTransmitted( double distance, RandomDeviate& rand
 	double C = C0 * pow( beta - 0.0037, S );
 
 	double e = C * exp( - A * ( Tower_Heigth.getValue() / 1000 ) );
-	if( pow( R, S ) == HUGE_VAL )	return true;
+	if( pow( R, S ) == HUGE_VAL )	return ( 1.0 );
 	double t = exp( - e * pow( R, S ) );
-
-
-	if( rand.RandomDouble() <  t  )	return true;
-
-	return false;
-
+	return ( t );
 }
@@ -52,6 +52,7 @@ public:
     TransmissivityVantHull();
 
 	bool IsTransmitted( double distance, RandomDeviate& rand ) const;
+	double Transmittance( double distance ) const;
 
 	trt::TONATIUH_REAL Visibility;
 	trt::TONATIUH_REAL Site_Elevation;
@@ -59,6 +59,11 @@ TransmissivityVittitoeBiggs::~TransmissivityVittitoeBiggs()
 }
 
 bool TransmissivityVittitoeBiggs::IsTransmitted( double distance, RandomDeviate& rand ) const
+{
+	return ( rand.RandomDouble() < Transmittance( distance ) );
+}
+
+double TransmissivityVittitoeBiggs::Transmittance( double distance ) const
 {
 	double t;
     if( ClearDay.getValue() )
@@ -67,6 +72,5 @@ bool TransmissivityVittitoeBiggs::IsTransmitted( double distance, RandomDeviate&
 	else
 		t = ( 0.98707 - 0.2748 *( distance / 1000 ) + 0.03394 * ( distance / 1000 ) * ( distance / 1000 ) );
 
-    if( rand.RandomDouble() < t )	return true;
-    return false;
+	return ( t );
 }
@@ -52,6 +52,7 @@ public:
     TransmissivityVittitoeBiggs();
 
 	bool IsTransmitted( double distance, RandomDeviate& rand ) const;
+	double Transmittance( double distance ) const;
 
 	trt::TONATIUH_BOOL ClearDay;
 
@@ -12,8 +12,11 @@ SUBDIRS = ComponentHeliostatField \
 			PhotonMapExportDB \
 			PhotonMapExportFile \
 			PhotonMapExportNull\
+			PhotonMapExportTally \
+			RandomCommonNumbers \
 			RandomMersenneTwister \
 			RandomRngStream \
+			RandomSobol \
             ShapeBezierSurface \
 			ShapeCAD \
 			ShapeCone \
@@ -43,6 +43,7 @@ Juana Amieva, Azael Mancillas, Cesar Cantu.
 #include <Inventor/VRMLnodes/SoVRMLBackground.h>
 
 #include <QApplication>
+#include <QFileInfo>
 #include <QString>
 
 #include "Document.h"
@@ -127,7 +128,9 @@ bool Document::ReadFile( const QString& fileName )
 }
 
 /*!
- * Writes the document scene to a file with the given \a fileName.
+ * Writes the document scene to a file with the given \a fileName. If the file suffix is "tnhb" the scene is
+ * written in Inventor binary format, where the values of the multiple fields are stored as raw arrays.
+ * Otherwise the scene is written in Inventor ASCII format.
  *
  * Returns true if the scene was successfully written; otherwise returns false.
  */
@@ -143,7 +146,7 @@ bool Document::WriteFile( const QString& fileName )
    	}
 
     QApplication::setOverrideCursor( Qt::WaitCursor );
-   	SceneOuput.getOutput()->setBinary( false );
+   	SceneOuput.getOutput()->setBinary( IsBinaryFile( fileName ) );
    	SceneOuput.apply( m_scene );
    	SceneOuput.getOutput()->closeFile();
    	QApplication::restoreOverrideCursor();
@@ -159,6 +162,14 @@ bool Document::IsModified( )
     return m_isModified;
 }
 
+/*!
+ * Returns true if \a fileName is a Tonatiuh binary scene file name, "*.tnhb".
+ */
+bool Document::IsBinaryFile( const QString& fileName )
+{
+	return ( QFileInfo( fileName ).suffix().compare( QLatin1String( "tnhb" ), Qt::CaseInsensitive ) == 0 );
+}
+
 /*!
  * Returns the document scene.
  */
@@ -169,6 +180,7 @@ TSceneKit* Document::GetSceneKit() const
 
 /*!
  * Reads the scene saved on the file with given \a filename and return a pointer to the scene.
+ * ASCII and binary Inventor files are read whatever their suffix.
  *
  * Returns null on any error.
  */
@@ -65,6 +65,7 @@ public:
     bool WriteFile( const QString& fileName );
 
     bool IsModified( );
+    static bool IsBinaryFile( const QString& fileName );
     TSceneKit* GetSceneKit() const;
 
 signals:
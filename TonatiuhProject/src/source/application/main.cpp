@@ -46,6 +46,7 @@ Juana Amieva, Azael Mancillas, Cesar Cantu.
 
 #include <Inventor/Qt/SoQt.h>
 
+#include "DistributedTrace.h"
 #include "GraphicRootTracker.h"
 #include "MainWindow.h"
 #include "TCube.h"
@@ -94,6 +95,21 @@ The Tonatiuh project aims to create an open source, cutting-edge, accurate, and
 
  Q_DECLARE_METATYPE(QVector<QVariant>)
 
+/*!
+ * Merges the distributed ray tracing results described by the worker summaries \a summaryFiles.
+ * Returns the application exit code.
+ */
+int MergeDistributedResults( const QStringList& summaryFiles )
+{
+	QString errorMessage;
+	if( !DistributedTrace::Merge( summaryFiles, &errorMessage ) )
+	{
+		std::cerr<<errorMessage.toStdString()<<std::endl;
+		return -1;
+	}
+	return 0;
+}
+
 int main( int argc, char ** argv )
 {
 	QApplication::setColorSpec( QApplication::CustomColor );
@@ -151,6 +167,15 @@ int main( int argc, char ** argv )
    	{
    		QString tonatiuhFile = argv[1];
 
+   		//Tonatiuh --merge summary1 summary2 ...
+   		if( tonatiuhFile == QLatin1String( "--merge" ) )
+   		{
+   			QStringList summaryFiles;
+   			for( int arg = 2; arg < argc; ++arg )	summaryFiles<<QString( argv[arg] );
+   			delete splash;
+   			return MergeDistributedResults( summaryFiles );
+   		}
+
     	QFileInfo fileInfo( tonatiuhFile );
     	if( fileInfo.completeSuffix() == QLatin1String( "tnhs") )
     	{
@@ -161,12 +186,62 @@ int main( int argc, char ** argv )
     		QDir testDirectory( fileInfo.absolutePath() );
     		testDirectory.cd( "." );
 
+    		//Distributed ray tracing options:
+    		// --workers=N runs N local workers and merges their results.
+    		// --worker=K/N runs the script as the worker K of N.
+    		// --seed=S sets the master seed of the workers random generators.
+    		// --resume=FILE resumes the ray tracing from the checkpoint FILE.
+    		int workerIndex = -1;
+    		int numberOfWorkers = 0;
+    		unsigned long seed = 12345UL;
+    		QString checkpointFile;
+    		for( int arg = 2; arg < argc; ++arg )
+    		{
+    			QString option( argv[arg] );
+    			if( option.startsWith( QLatin1String( "--worker=" ) ) )
+    			{
+    				QStringList worker = option.mid( 9 ).split( QLatin1Char( '/' ) );
+    				if( worker.count() == 2 )
+    				{
+    					workerIndex = worker[0].toInt();
+    					numberOfWorkers = worker[1].toInt();
+    				}
+    			}
+    			else if( option.startsWith( QLatin1String( "--workers=" ) ) )
+    				numberOfWorkers = option.mid( 10 ).toInt();
+    			else if( option.startsWith( QLatin1String( "--seed=" ) ) )
+    				seed = option.mid( 7 ).toULong();
+    			else if( option.startsWith( QLatin1String( "--resume=" ) ) )
+    				checkpointFile = option.mid( 9 );
+    		}
+
+    		if( workerIndex < 0 && numberOfWorkers > 0 )
+    		{
+    			QStringList scriptArguments;
+    			scriptArguments<<fileInfo.absoluteFilePath();
+    			if( !checkpointFile.isEmpty() )
+    				scriptArguments<<QString( QLatin1String( "--resume=%1" ) ).arg( QFileInfo( checkpointFile ).absoluteFilePath() );
+
+    			QStringList summaryFiles;
+    			QString errorMessage;
+    			delete splash;
+    			if( !DistributedTrace::RunLocalWorkers( QApplication::applicationFilePath(), scriptArguments,
+    					numberOfWorkers, seed, &summaryFiles, &errorMessage ) )
+    			{
+    				std::cerr<<errorMessage.toStdString()<<std::endl;
+    				return -1;
+    			}
+    			return MergeDistributedResults( summaryFiles );
+    		}
+
     		QScriptEngine* interpreter = new QScriptEngine;
     		qScriptRegisterSequenceMetaType<QVector<QVariant> >(interpreter);
 
 
     		MainWindow* mw = new MainWindow( QLatin1String("") );
     		mw->SetPluginManager( &pluginManager );
+    		if( workerIndex >= 0 )	mw->SetDistributedWorker( workerIndex, numberOfWorkers, seed );
+    		if( !checkpointFile.isEmpty() )	mw->ResumeFromCheckpoint( checkpointFile );
     		QScriptValue tonatiuh = interpreter->newQObject( mw );
     		interpreter->globalObject().setProperty( "tonatiuh", tonatiuh );
 
@@ -36,6 +36,7 @@ Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez
 Juana Amieva, Azael Mancillas, Cesar Cantu, Iigo Les.
 ***************************************************************************/
 
+#include <algorithm>
 #include <cmath>
 
 #include <QFileDialog>
@@ -52,11 +53,13 @@ Juana Amieva, Azael Mancillas, Cesar Cantu, I
 #include "TSceneKit.h"
 #include "SceneModel.h"
 #include "InstanceNode.h"
+#include "LightCellSampling.h"
 #include "RandomDeviate.h"
 #include "TPhotonMap.h"
 #include "gc.h"
 #include "RayTracer.h"
 #include "RayTracerNoTr.h"
+#include "RayTracingScheduler.h"
 #include "TLightKit.h"
 #include "TLightShape.h"
 #include "Transform.h"
@@ -65,6 +68,22 @@ Juana Amieva, Azael Mancillas, Cesar Cantu, I
 #include "TShapeKit.h"
 #include "TTransmissivity.h"
 
+/******************************************
+ * FluxAnalysisTarget
+ *****************************************/
+
+/*!
+ * Creates a target for the side \a side of the surface \a nodeURL with a grid of \a height x \a width cells.
+ */
+FluxAnalysisTarget::FluxAnalysisTarget( QString nodeURL, QString side, int height, int width ):
+surfaceURL( nodeURL ),
+surfaceSide( side ),
+heightDivisions( height ),
+widthDivisions( width )
+{
+
+}
+
 /******************************************
  * FluxAnalysis
  *****************************************/
@@ -83,6 +102,7 @@ m_pRandomDeviate( randomDeviate ),
 m_pPhotonMap( 0 ),
 m_surfaceURL( "" ),
 m_tracedRays( 0 ),
+m_tracedChunks( 0 ),
 m_wPhoton( 0 ),
 m_photonCounts( 0 ),
 m_heightDivisions( 0 ),
@@ -95,7 +115,19 @@ m_maximumPhotons( 0 ),
 m_maximumPhotonsXCoord( 0 ),
 m_maximumPhotonsYCoord( 0 ),
 m_maximumPhotonsError( 0 ),
-m_totalPower( 0 )
+m_totalPhotons( 0 ),
+m_totalPower( 0 ),
+m_totalWeight( 0 ),
+m_totalSquaredWeight( 0 ),
+m_rouletteWeight( 0 ),
+m_stratifiedLight( false ),
+m_lightImportance( false ),
+m_lightUniformFraction( 0.1 ),
+m_randomFactory( 0 ),
+m_randomSeed( 0 ),
+m_metricValue( 0 ),
+m_relativeError( 0 ),
+m_confidenceInterval( 0 )
 {
 
 }
@@ -106,16 +138,7 @@ m_totalPower( 0 )
 FluxAnalysis::~FluxAnalysis()
 {
 	clearPhotonMap();
-
-	if( m_photonCounts )
-	{
-		for( int h = 0; h < m_heightDivisions; h++ )
-		{
-			delete[] m_photonCounts[h];
-		}
-
-		delete[] m_photonCounts;
-	}
+	ClearPhotonCounts();
 }
 
 /*
@@ -141,9 +164,9 @@ QString FluxAnalysis::GetSurfaceType( QString nodeURL )
 /*
  * Check if it the selected surface is suitable (cylinder, flat disk or flat rectangle) for the analysis
  */
-bool FluxAnalysis::CheckSurface()
+bool FluxAnalysis::CheckSurface( QString nodeURL )
 {
-	QString surfaceType = GetSurfaceType( m_surfaceURL );
+	QString surfaceType = GetSurfaceType( nodeURL );
 
 	if( ( surfaceType != "ShapeFlatRectangle" ) &&
 		( surfaceType != "ShapeFlatDisk" ) &&
@@ -156,23 +179,23 @@ bool FluxAnalysis::CheckSurface()
 /*
  * Check the surface side.
  */
-bool FluxAnalysis::CheckSurfaceSide()
+bool FluxAnalysis::CheckSurfaceSide( QString nodeURL, QString surfaceSide )
 {
-	QString surfaceType = GetSurfaceType( m_surfaceURL );
+	QString surfaceType = GetSurfaceType( nodeURL );
 
 	if( surfaceType == "ShapeFlatRectangle" )
 	{
-		if( ( m_surfaceSide != "FRONT" ) && ( m_surfaceSide != "BACK" ) )
+		if( ( surfaceSide != "FRONT" ) && ( surfaceSide != "BACK" ) )
 			return false;
 	}
 	else if( surfaceType == "ShapeFlatDisk" )
 	{
-		if( ( m_surfaceSide != "FRONT" ) && ( m_surfaceSide != "BACK" ) )
+		if( ( surfaceSide != "FRONT" ) && ( surfaceSide != "BACK" ) )
 			return false;
 	}
 	else if( surfaceType == "ShapeCylinder" )
 	{
-		if( ( m_surfaceSide != "INSIDE" ) && ( m_surfaceSide != "OUTSIDE" ) )
+		if( ( surfaceSide != "INSIDE" ) && ( surfaceSide != "OUTSIDE" ) )
 			return false;
 	}
 
@@ -187,22 +210,109 @@ void FluxAnalysis::RunFluxAnalysis( QString nodeURL, QString surfaceSide, unsign
 	m_surfaceURL = nodeURL;
 	m_surfaceSide = surfaceSide;
 
-	//Delete a photonCounts
-	if( m_photonCounts && m_photonCounts != 0 )
+	ClearPhotonCounts();
+	m_heightDivisions = heightDivisions;
+	m_widthDivisions = widthDivisions;
+
+	//Check if the surface and the surface side defined is suitable
+	if( CheckSurface( m_surfaceURL ) == false || CheckSurfaceSide( m_surfaceURL, m_surfaceSide ) == false ) return;
+
+	QVector< InstanceNode* > exportSuraceList;
+	QModelIndex nodeIndex = m_pCurrentSceneModel->IndexFromNodeUrl( m_surfaceURL );
+	if( !nodeIndex.isValid()  )	return;
+
+	InstanceNode* surfaceNode = m_pCurrentSceneModel->NodeFromIndex( nodeIndex );
+	if( !surfaceNode || surfaceNode == 0 )	return;
+	exportSuraceList.push_back( surfaceNode );
+
+	if( !Trace( exportSuraceList, nOfRays, increasePhotonMap ) )	return;
+
+	UpdatePhotonCounts();
+}
+
+/*
+ * Adds the side \a surfaceSide of the surface \a nodeURL to the targets of the multi target analysis, with a grid of
+ * \a heightDivisions x \a widthDivisions cells.
+ *
+ * Returns false if the surface or the side is not suitable for the analysis or the grid has less than 2 x 2 cells.
+ */
+bool FluxAnalysis::AddTarget( QString nodeURL, QString surfaceSide, int heightDivisions, int widthDivisions )
+{
+	if( heightDivisions < 2 || widthDivisions < 2 )	return false;
+	if( CheckSurface( nodeURL ) == false || CheckSurfaceSide( nodeURL, surfaceSide ) == false ) return false;
+
+	m_targets.push_back( FluxAnalysisTarget( nodeURL, surfaceSide, heightDivisions, widthDivisions ) );
+	return true;
+}
+
+/*
+ * Removes all the targets of the multi target analysis.
+ */
+void FluxAnalysis::ClearTargets()
+{
+	m_targets.clear();
+}
+
+/*
+ * Returns the number of targets of the multi target analysis.
+ */
+int FluxAnalysis::NumberOfTargets() const
+{
+	return m_targets.size();
+}
+
+/*
+ * Traces \a nOfRays rays storing the photons of all the targets in the same photon map, so the flux distribution
+ * of every target is computed from a single trace. The first target is selected after the trace.
+ */
+void FluxAnalysis::RunMultiTargetFluxAnalysis( unsigned long nOfRays, bool increasePhotonMap )
+{
+	ClearPhotonCounts();
+	if( m_targets.size() < 1 )	return;
+
+	QVector< InstanceNode* > exportSuraceList;
+	for( int t = 0; t < m_targets.size(); t++ )
 	{
-		for( int h = 0; h < m_heightDivisions; h++ )
-		{
-			delete[] m_photonCounts[h];
-		}
+		QModelIndex nodeIndex = m_pCurrentSceneModel->IndexFromNodeUrl( m_targets[t].surfaceURL );
+		if( !nodeIndex.isValid()  )	return;
 
-		delete[] m_photonCounts;
+		InstanceNode* surfaceNode = m_pCurrentSceneModel->NodeFromIndex( nodeIndex );
+		if( !surfaceNode || surfaceNode == 0 )	return;
+		if( !exportSuraceList.contains( surfaceNode ) )	exportSuraceList.push_back( surfaceNode );
 	}
-	m_photonCounts = 0;
-	m_heightDivisions = heightDivisions;
-	m_widthDivisions = widthDivisions;
 
+	if( !Trace( exportSuraceList, nOfRays, increasePhotonMap ) )	return;
+
+	SelectTarget( 0 );
+}
+
+/*
+ * Computes the flux distribution of the target \a index from the photon map. The flux values returned by the
+ * accessors are the ones of the selected target.
+ *
+ * Returns false if there is not photon map or the target does not exist.
+ */
+bool FluxAnalysis::SelectTarget( int index )
+{
+	if( !m_pPhotonMap )	return false;
+	if( index < 0 || index >= m_targets.size() )	return false;
+
+	m_surfaceURL = m_targets[index].surfaceURL;
+	m_surfaceSide = m_targets[index].surfaceSide;
+	UpdatePhotonCounts( m_targets[index].heightDivisions, m_targets[index].widthDivisions );
+	return true;
+}
+
+/*
+ * Traces \a nOfRays rays storing in the photon map the photons of the surfaces in \a exportSuraceList.
+ * The photon map is increased with the new photons if \a increasePhotonMap is true.
+ *
+ * Returns false if the scene is not ready for the trace.
+ */
+bool FluxAnalysis::Trace( const QVector< InstanceNode* >& exportSuraceList, unsigned long nOfRays, bool increasePhotonMap )
+{
 	//Check if there is a scene
-	if ( !m_pCurrentScene )  return;
+	if ( !m_pCurrentScene )  return false;
 
 	//Check if there is a transmissivity defined
 	TTransmissivity* transmissivity = 0;
@@ -211,32 +321,29 @@ void FluxAnalysis::RunFluxAnalysis( QString nodeURL, QString surfaceSide, unsign
 		transmissivity = static_cast< TTransmissivity* > ( m_pCurrentScene->getPart( "transmissivity", false ) );
 
 	//Check if there is a rootSeparator InstanceNode
-	if( !m_pRootSeparatorInstance ) return;
+	if( !m_pRootSeparatorInstance ) return false;
 
 	InstanceNode* sceneInstance = m_pRootSeparatorInstance->GetParent();
-	if ( !sceneInstance )  return;
+	if ( !sceneInstance )  return false;
 
 	//Check if there is a light and is properly configured
-	if ( !m_pCurrentScene->getPart( "lightList[0]", false ) )return;
+	if ( !m_pCurrentScene->getPart( "lightList[0]", false ) )return false;
 	TLightKit* lightKit = static_cast< TLightKit* >( m_pCurrentScene->getPart( "lightList[0]", false ) );
 
 	InstanceNode* lightInstance = sceneInstance->children[0];
-	if ( !lightInstance ) return;
+	if ( !lightInstance ) return false;
 
-	if( !lightKit->getPart( "tsunshape", false ) ) return;
+	if( !lightKit->getPart( "tsunshape", false ) ) return false;
 	TSunShape* sunShape = static_cast< TSunShape * >( lightKit->getPart( "tsunshape", false ) );
 
-	if( !lightKit->getPart( "icon", false ) ) return;
+	if( !lightKit->getPart( "icon", false ) ) return false;
 	TLightShape* raycastingSurface = static_cast< TLightShape * >( lightKit->getPart( "icon", false ) );
 
-	if( !lightKit->getPart( "transform" ,false ) ) return;
+	if( !lightKit->getPart( "transform" ,false ) ) return false;
 	SoTransform* lightTransform = static_cast< SoTransform * >( lightKit->getPart( "transform" ,false ) );
 
 	//Check if there is a random generator is defined.
-	if( !m_pRandomDeviate || m_pRandomDeviate== 0 )	return;
-
-	//Check if the surface and the surface side defined is suitable
-	if( CheckSurface() == false || CheckSurfaceSide() == false ) return;
+	if( !m_pRandomDeviate || m_pRandomDeviate== 0 )	return false;
 
 	//Create the photon map where photons are going to be stored
 	if( !m_pPhotonMap  || !increasePhotonMap )
@@ -246,21 +353,17 @@ void FluxAnalysis::RunFluxAnalysis( QString nodeURL, QString surfaceSide, unsign
 		m_pPhotonMap = new TPhotonMap();
 		m_pPhotonMap->SetBufferSize( HUGE_VAL );
 		m_tracedRays = 0;
+		m_tracedChunks = 0;
 		m_wPhoton = 0;
+		m_totalPhotons = 0;
 		m_totalPower = 0;
+		m_totalWeight = 0;
+		m_totalSquaredWeight = 0;
 	}
 
-	QVector< InstanceNode* > exportSuraceList;
-	QModelIndex nodeIndex = m_pCurrentSceneModel->IndexFromNodeUrl( m_surfaceURL );
-	if( !nodeIndex.isValid()  )	return;
-
-	InstanceNode* surfaceNode = m_pCurrentSceneModel->NodeFromIndex( nodeIndex );
-	if( !surfaceNode || surfaceNode == 0 )	return;
-	exportSuraceList.push_back( surfaceNode );
-
 	//UpdateLightSize();
 	TSeparatorKit* concentratorRoot = static_cast< TSeparatorKit* >( m_pCurrentScene->getPart( "childList[0]", false ) );
-	if ( !concentratorRoot )	return;
+	if ( !concentratorRoot )	return false;
 
 	SoGetBoundingBoxAction* bbAction = new SoGetBoundingBoxAction( SbViewportRegion() ) ;
 	concentratorRoot->getBoundingBox( bbAction );
@@ -284,20 +387,20 @@ void FluxAnalysis::RunFluxAnalysis( QString nodeURL, QString surfaceSide, unsign
 
 	m_pPhotonMap->SetConcentratorToWorld( m_pRootSeparatorInstance->GetIntersectionTransform() );
 
-	QStringList disabledNodes = QString( lightKit->disabledNodes.getValue().getString() ).split( ";", QString::SkipEmptyParts );
+	QSet< QString > disabledNodes = QString( lightKit->disabledNodes.getValue().getString() ).split( ";", QString::SkipEmptyParts ).toSet();
 	QVector< QPair< TShapeKit*, Transform > > surfacesList;
 	trf::ComputeFistStageSurfaceList( m_pRootSeparatorInstance, disabledNodes, &surfacesList );
 	lightKit->ComputeLightSourceArea( m_sunWidthDivisions, m_sunHeightDivisions, surfacesList );
-	if( surfacesList.count() < 1 )	return;
+	if( surfacesList.count() < 1 )	return false;
 
-	QVector< long > raysPerThread;
-	int maximumValueProgressScale = 100;
-
-	unsigned long  t1 = nOfRays/ maximumValueProgressScale;
-	for( int progressCount = 0; progressCount < maximumValueProgressScale; ++ progressCount )
-		raysPerThread<< t1;
-
-	if( ( t1 * maximumValueProgressScale ) < nOfRays )	raysPerThread<< ( nOfRays - ( t1* maximumValueProgressScale) );
+	RayTracingScheduler scheduler( nOfRays, QThread::idealThreadCount() );
+	if( m_randomFactory )
+	{
+		//The photon map increases with the chunks that follow the traced ones, with their own streams
+		scheduler.SetRandomStreams( m_randomFactory, m_randomSeed, 0, 1 );
+		scheduler.SetStart( 0, m_tracedChunks );
+	}
+	QVector< RayTracingScheduler* > raysPerThread = scheduler.ThreadsList();
 
 	Transform lightToWorld = tgf::TransformFromSoTransform( lightTransform );
 	lightInstance->SetIntersectionTransform( lightToWorld.GetInverse() );
@@ -305,30 +408,48 @@ void FluxAnalysis::RunFluxAnalysis( QString nodeURL, QString surfaceSide, unsign
 	// Create a progress dialog.
 	QProgressDialog dialog;
 	dialog.setLabelText( QString("Progressing using %1 thread(s)..." ).arg( QThread::idealThreadCount() ) );
+	dialog.setRange( 0, 100 );
 
 	// Create a QFutureWatcher and conncect signals and slots.
 	QFutureWatcher< void > futureWatcher;
 	QObject::connect(&futureWatcher, SIGNAL(finished()), &dialog, SLOT(reset()));
+	QObject::connect(&dialog, SIGNAL(canceled()), &scheduler, SLOT(Cancel()));
 	QObject::connect(&dialog, SIGNAL(canceled()), &futureWatcher, SLOT(cancel()));
-	QObject::connect(&futureWatcher, SIGNAL(progressRangeChanged(int, int)), &dialog, SLOT(setRange(int, int)));
-	QObject::connect(&futureWatcher, SIGNAL(progressValueChanged(int)), &dialog, SLOT(setValue(int)));
+	QObject::connect(&scheduler, SIGNAL(ProgressValueChanged(int)), &dialog, SLOT(setValue(int)));
+
+	LightCellSampling lightSampling( raycastingSurface->GetValidAreasCoord() );
+	lightSampling.SetStratified( m_stratifiedLight );
+	if( m_lightImportance )	lightSampling.SetImportance( m_lightCellStatistics, m_lightUniformFraction );
+	LightCellSampling* pLightSampling = ( m_stratifiedLight || m_lightImportance ) ? &lightSampling : 0;
 
 	QMutex mutex;
 	QMutex mutexPhotonMap;
 	QFuture< void > photonMap;
 	if( transmissivity )
-		photonMap = QtConcurrent::map( raysPerThread, RayTracer( m_pRootSeparatorInstance,
+	{
+		RayTracer rayTracer( m_pRootSeparatorInstance,
 							 lightInstance, raycastingSurface, sunShape, lightToWorld,
 							 transmissivity,
 							 *m_pRandomDeviate,
 							 &mutex, m_pPhotonMap, &mutexPhotonMap,
-							 exportSuraceList ) );
+							 exportSuraceList );
+		rayTracer.SetWeightedPhotons( m_rouletteWeight );
+		rayTracer.SetFirstSample( (unsigned long long) m_tracedRays );
+		rayTracer.SetLightSampling( pLightSampling );
+		photonMap = QtConcurrent::map( raysPerThread, rayTracer );
+	}
 	else
-		photonMap = QtConcurrent::map( raysPerThread, RayTracerNoTr( m_pRootSeparatorInstance,
+	{
+		RayTracerNoTr rayTracer( m_pRootSeparatorInstance,
 						lightInstance, raycastingSurface, sunShape, lightToWorld,
 						*m_pRandomDeviate,
 						&mutex, m_pPhotonMap, &mutexPhotonMap,
-						exportSuraceList ) );
+						exportSuraceList );
+		rayTracer.SetWeightedPhotons( m_rouletteWeight );
+		rayTracer.SetFirstSample( (unsigned long long) m_tracedRays );
+		rayTracer.SetLightSampling( pLightSampling );
+		photonMap = QtConcurrent::map( raysPerThread, rayTracer );
+	}
 
 	futureWatcher.setFuture( photonMap );
 
@@ -336,13 +457,95 @@ void FluxAnalysis::RunFluxAnalysis( QString nodeURL, QString surfaceSide, unsign
 	dialog.exec();
 	futureWatcher.waitForFinished();
 
-	m_tracedRays += nOfRays;
+	m_tracedRays += scheduler.TracedRays();
+	m_tracedChunks = scheduler.NextChunkIndex();
+	if( m_lightImportance )	lightSampling.UpdateStatistics( &m_lightCellStatistics );
 
 	double irradiance = sunShape->GetIrradiance();
 	double inputAperture = raycastingSurface->GetValidArea();
 	m_wPhoton = double ( inputAperture * irradiance ) / m_tracedRays;
 
-	UpdatePhotonCounts();
+	return true;
+}
+
+/*
+ * Runs the flux analysis in batches of \a raysPerBatch rays until the relative standard error of the \a metric
+ * falls below \a relativeErrorThreshold or \a maximumNumberOfRays rays have been traced.
+ *
+ * Returns true if the metric converged. The achieved error is available through relativeErrorValue() and
+ * confidenceIntervalValue().
+ */
+bool FluxAnalysis::RunConvergentFluxAnalysis( QString nodeURL, QString surfaceSide, unsigned long raysPerBatch, unsigned long maximumNumberOfRays,
+		ConvergenceMetric metric, double relativeErrorThreshold, int heightDivisions, int widthDivisions )
+{
+	m_metricValue = 0;
+	m_relativeError = 0;
+	m_confidenceInterval = 0;
+
+	if( raysPerBatch < 1 || relativeErrorThreshold <= 0 ) return false;
+	if( maximumNumberOfRays < raysPerBatch ) maximumNumberOfRays = raysPerBatch;
+
+	bool increasePhotonMap = false;
+	while( !increasePhotonMap || m_tracedRays < maximumNumberOfRays )
+	{
+		unsigned long previousTracedRays = increasePhotonMap ? m_tracedRays : 0;
+		unsigned long batchRays = std::min( raysPerBatch, maximumNumberOfRays - previousTracedRays );
+
+		RunFluxAnalysis( nodeURL, surfaceSide, batchRays, increasePhotonMap, heightDivisions, widthDivisions );
+		if( !m_photonCounts || m_tracedRays <= previousTracedRays ) return false;
+		increasePhotonMap = true;
+
+		UpdateStatisticalError( metric );
+		if( m_metricValue > 0 && m_relativeError < relativeErrorThreshold ) return true;
+
+		//The batch was canceled by the user
+		if( m_tracedRays - previousTracedRays < batchRays ) return false;
+	}
+
+	return false;
+}
+
+/*
+ * Computes the value of the \a metric and its relative standard error from the current photon counts.
+ *
+ * Photon counts are binomially distributed over the traced rays, so the relative standard error of the
+ * total power is sqrt( ( 1 - p ) / ( N p ) ), being p the fraction of the N rays that hit the surface side.
+ * For the peak flux the hottest cell is taken as a Poisson count and the relative error is 1 / sqrt( n ).
+ * A surface without photons has an undefined error and is reported with zero value and error.
+ */
+void FluxAnalysis::UpdateStatisticalError( ConvergenceMetric metric )
+{
+	m_metricValue = 0;
+	m_relativeError = 0;
+	m_confidenceInterval = 0;
+	if( m_tracedRays < 1 || m_totalPhotons < 1 ) return;
+
+	if( metric == PeakFlux )
+	{
+		double widthCell = ( m_xmax - m_xmin ) / m_widthDivisions;
+		double heightCell = ( m_ymax - m_ymin ) / m_heightDivisions;
+		double areaCell = widthCell * heightCell;
+		if( areaCell <= 0 || m_maximumPhotons <= 0.0 || m_totalSquaredWeight <= 0.0 ) return;
+
+		//Effective number of photons in the peak cell, assuming its weights are distributed as in the whole map
+		double effectivePhotons = m_maximumPhotons * m_totalWeight / m_totalSquaredWeight;
+		m_metricValue = m_maximumPhotons * m_wPhoton / areaCell;
+		m_relativeError = 1.0 / sqrt( effectivePhotons );
+	}
+	else
+	{
+		if( m_totalWeight <= 0.0 ) return;
+
+		//Each traced ray contributes the weight of its photons on the surface, zero if it misses it
+		double meanWeight = m_totalWeight / m_tracedRays;
+		double meanSquaredWeight = m_totalSquaredWeight / m_tracedRays;
+		double weightVariance = std::max( 0.0, meanSquaredWeight - meanWeight * meanWeight );
+		m_metricValue = m_totalPower;
+		m_relativeError = sqrt( weightVariance / m_tracedRays ) / meanWeight;
+	}
+
+	//Half width of the 95% confidence interval
+	m_confidenceInterval = 1.96 * m_relativeError * m_metricValue;
 }
 
 /*
@@ -350,7 +553,19 @@ void FluxAnalysis::RunFluxAnalysis( QString nodeURL, QString surfaceSide, unsign
  */
 void FluxAnalysis::UpdatePhotonCounts( int heightDivisions, int widthDivisions )
 {
-	//Delete a photonCounts
+	ClearPhotonCounts();
+
+	m_heightDivisions = heightDivisions;
+	m_widthDivisions = widthDivisions;
+
+	UpdatePhotonCounts();
+}
+
+/*
+ * Delete photon counts
+ */
+void FluxAnalysis::ClearPhotonCounts()
+{
 	if( m_photonCounts && (m_photonCounts != 0) )
 	{
 		for( int h = 0; h < m_heightDivisions; h++ )
@@ -360,11 +575,7 @@ void FluxAnalysis::UpdatePhotonCounts( int heightDivisions, int widthDivisions )
 
 		delete[] m_photonCounts;
 	}
-
-	m_heightDivisions = heightDivisions;
-	m_widthDivisions = widthDivisions;
-
-	UpdatePhotonCounts();
+	m_photonCounts = 0;
 }
 
 /*
@@ -375,10 +586,10 @@ void FluxAnalysis::UpdatePhotonCounts()
 	if( !m_pPhotonMap )	return;
 
 	//Create a new photonCounts
-	m_photonCounts = new int*[m_heightDivisions];
+	m_photonCounts = new double*[m_heightDivisions];
 	for( int h = 0; h < m_heightDivisions; h++ )
 	{
-		m_photonCounts[h] = new int[m_widthDivisions];
+		m_photonCounts[h] = new double[m_widthDivisions];
 		for( int w = 0; w < m_widthDivisions; w++ )
 			m_photonCounts[h][w] = 0;
 	}
@@ -387,6 +598,9 @@ void FluxAnalysis::UpdatePhotonCounts()
 	m_maximumPhotonsXCoord = 0;
 	m_maximumPhotonsYCoord = 0;
 	m_maximumPhotonsError = 0;
+	m_totalPhotons = 0;
+	m_totalWeight = 0;
+	m_totalSquaredWeight = 0;
 
 	QString surfaceType = GetSurfaceType( m_surfaceURL );
 	QModelIndex nodeIndex = m_pCurrentSceneModel->IndexFromNodeUrl( m_surfaceURL );
@@ -430,10 +644,10 @@ void FluxAnalysis::FluxAnalysisCylinder( InstanceNode* node )
 	int widthDivisionsError = m_widthDivisions-1;
 	int heightDivisionsError = m_heightDivisions-1;
 
-	int** photonCountsError = new int*[heightDivisionsError];
+	double** photonCountsError = new double*[heightDivisionsError];
 	for(int i = 0; i < heightDivisionsError; ++i)
 	{
-		photonCountsError[i] = new int[widthDivisionsError];
+		photonCountsError[i] = new double[widthDivisionsError];
 		for( int w = 0; w < widthDivisionsError; w++ )
 			photonCountsError[i][w] = 0;
 	}
@@ -451,12 +665,16 @@ void FluxAnalysis::FluxAnalysisCylinder( InstanceNode* node )
 
 	std::vector< Photon* > photonList = m_pPhotonMap->GetAllPhotons();
 	int totalPhotons = 0;
+	double totalWeight = 0.0;
+	double totalSquaredWeight = 0.0;
 	for( unsigned int p = 0; p < photonList.size(); p++ )
 	{
 		Photon* photon = photonList[p];
-		if( photon->side == activeSideID )
+		if( photon->intersectedSurface == node && photon->side == activeSideID )
 		{
 			totalPhotons++;
+			totalWeight += photon->weight;
+			totalSquaredWeight += photon->weight * photon->weight;
 			Point3D photonLocalCoord = worldToObject( photon->pos );
 			double phi  = atan2( photonLocalCoord.y, photonLocalCoord.x );
 			if( phi < 0.0 ) phi += 2* gc::Pi;
@@ -464,7 +682,7 @@ void FluxAnalysis::FluxAnalysisCylinder( InstanceNode* node )
 
 			int xbin = floor( ( arcLength - m_xmin )/( m_xmax - m_xmin ) * m_widthDivisions ) ;
 			int ybin = floor( ( photonLocalCoord.z - m_ymin )/( m_ymax - m_ymin ) * m_heightDivisions );
-			m_photonCounts[ybin][xbin] += 1;
+			m_photonCounts[ybin][xbin] += photon->weight;
 			if( m_maximumPhotons < m_photonCounts[ybin][xbin] )
 			{
 				m_maximumPhotons = m_photonCounts[ybin][xbin];
@@ -474,7 +692,7 @@ void FluxAnalysis::FluxAnalysisCylinder( InstanceNode* node )
 
 			int xbinE = floor( ( arcLength - m_xmin )/( m_xmax - m_xmin ) * widthDivisionsError ) ;
 			int ybinE = floor( ( photonLocalCoord.z - m_ymin )/( m_ymax - m_ymin ) * heightDivisionsError );
-			photonCountsError[ybinE][xbinE] += 1;
+			photonCountsError[ybinE][xbinE] += photon->weight;
 			if( m_maximumPhotonsError < photonCountsError[ybinE][xbinE] )
 			{
 				m_maximumPhotonsError = photonCountsError[ybinE][xbinE];
@@ -482,7 +700,10 @@ void FluxAnalysis::FluxAnalysisCylinder( InstanceNode* node )
 		}
 	}
 
-	m_totalPower = totalPhotons * m_wPhoton;
+	m_totalPhotons = totalPhotons;
+	m_totalWeight = totalWeight;
+	m_totalSquaredWeight = totalSquaredWeight;
+	m_totalPower = totalWeight * m_wPhoton;
 
 	if( photonCountsError )
 	{
@@ -513,10 +734,10 @@ void FluxAnalysis::FluxAnalysisFlatDisk( InstanceNode* node )
 	int widthDivisionsError = m_widthDivisions-1;
 	int heightDivisionsError = m_heightDivisions-1;
 
-	int** photonCountsError = new int*[heightDivisionsError];
+	double** photonCountsError = new double*[heightDivisionsError];
 	for(int i = 0; i < heightDivisionsError; ++i)
 	{
-		photonCountsError[i] = new int[widthDivisionsError];
+		photonCountsError[i] = new double[widthDivisionsError];
 		for( int w = 0; w < widthDivisionsError; w++ )
 			photonCountsError[i][w] = 0;
 	}
@@ -534,16 +755,20 @@ void FluxAnalysis::FluxAnalysisFlatDisk( InstanceNode* node )
 
 	std::vector< Photon* > photonList = m_pPhotonMap->GetAllPhotons();
 	int totalPhotons = 0;
+	double totalWeight = 0.0;
+	double totalSquaredWeight = 0.0;
 	for( unsigned int p = 0; p < photonList.size(); p++ )
 	{
 		Photon* photon = photonList[p];
-		if( photon->side == activeSideID )
+		if( photon->intersectedSurface == node && photon->side == activeSideID )
 		{
 			totalPhotons++;
+			totalWeight += photon->weight;
+			totalSquaredWeight += photon->weight * photon->weight;
 			Point3D photonLocalCoord = worldToObject( photon->pos );
 			int xbin = floor( ( photonLocalCoord.x - m_xmin )/( m_xmax - m_xmin ) * m_widthDivisions );
 			int ybin = floor( ( photonLocalCoord.z - m_ymin )/( m_ymax - m_ymin ) * m_heightDivisions );
-			m_photonCounts[ybin][xbin] += 1;
+			m_photonCounts[ybin][xbin] += photon->weight;
 			if( m_maximumPhotons < m_photonCounts[ybin][xbin] )
 			{
 				m_maximumPhotons = m_photonCounts[ybin][xbin];
@@ -553,7 +778,7 @@ void FluxAnalysis::FluxAnalysisFlatDisk( InstanceNode* node )
 
 			int xbinE = floor( ( photonLocalCoord.x - m_xmin )/( m_xmax - m_xmin ) * widthDivisionsError ) ;
 			int ybinE = floor( ( photonLocalCoord.z - m_ymin )/( m_ymax - m_ymin ) * heightDivisionsError );
-			photonCountsError[ybinE][xbinE] += 1;
+			photonCountsError[ybinE][xbinE] += photon->weight;
 			if( m_maximumPhotonsError < photonCountsError[ybinE][xbinE] )
 			{
 				m_maximumPhotonsError = photonCountsError[ybinE][xbinE];
@@ -561,7 +786,10 @@ void FluxAnalysis::FluxAnalysisFlatDisk( InstanceNode* node )
 		}
 	}
 
-	m_totalPower = totalPhotons * m_wPhoton;
+	m_totalPhotons = totalPhotons;
+	m_totalWeight = totalWeight;
+	m_totalSquaredWeight = totalSquaredWeight;
+	m_totalPower = totalWeight * m_wPhoton;
 
 	if( photonCountsError )
 	{
@@ -596,10 +824,10 @@ void FluxAnalysis::FluxAnalysisFlatRectangle( InstanceNode* node )
 	int widthDivisionsError = m_widthDivisions-1;
 	int heightDivisionsError = m_heightDivisions-1;
 
-	int** photonCountsError = new int*[heightDivisionsError];
+	double** photonCountsError = new double*[heightDivisionsError];
 	for(int i = 0; i < heightDivisionsError; ++i)
 	{
-		photonCountsError[i] = new int[widthDivisionsError];
+		photonCountsError[i] = new double[widthDivisionsError];
 		for( int w = 0; w < widthDivisionsError; w++ )
 			photonCountsError[i][w] = 0;
 	}
@@ -617,17 +845,21 @@ void FluxAnalysis::FluxAnalysisFlatRectangle( InstanceNode* node )
 
 	std::vector< Photon* > photonList = m_pPhotonMap->GetAllPhotons();
 	int totalPhotons = 0;
+	double totalWeight = 0.0;
+	double totalSquaredWeight = 0.0;
 	for( unsigned int p = 0; p < photonList.size(); p++ )
 	{
 		Photon* photon = photonList[p];
-		if( photon->side == activeSideID )
+		if( photon->intersectedSurface == node && photon->side == activeSideID )
 		{
 			totalPhotons++;
+			totalWeight += photon->weight;
+			totalSquaredWeight += photon->weight * photon->weight;
 			Point3D photonLocalCoord = worldToObject( photon->pos );
 			int xbin = floor( ( photonLocalCoord.x - m_xmin )/( m_xmax - m_xmin ) * m_widthDivisions ) ;
 			int ybin = floor( ( photonLocalCoord.z - m_ymin )/( m_ymax - m_ymin ) * m_heightDivisions );
 
-			m_photonCounts[ybin][xbin] += 1;
+			m_photonCounts[ybin][xbin] += photon->weight;
 			if( m_maximumPhotons < m_photonCounts[ybin][xbin] )
 			{
 				m_maximumPhotons = m_photonCounts[ybin][xbin];
@@ -637,7 +869,7 @@ void FluxAnalysis::FluxAnalysisFlatRectangle( InstanceNode* node )
 
 			int xbinE = floor( ( photonLocalCoord.x - m_xmin )/( m_xmax-m_xmin ) * widthDivisionsError ) ;
 			int ybinE = floor( ( photonLocalCoord.z - m_ymin )/( m_ymax-m_ymin ) * heightDivisionsError );
-			photonCountsError[ybinE][xbinE] += 1;
+			photonCountsError[ybinE][xbinE] += photon->weight;
 			if( m_maximumPhotonsError < photonCountsError[ybinE][xbinE] )
 			{
 				m_maximumPhotonsError = photonCountsError[ybinE][xbinE];
@@ -645,7 +877,10 @@ void FluxAnalysis::FluxAnalysisFlatRectangle( InstanceNode* node )
 		}
 	}
 
-	m_totalPower = totalPhotons * m_wPhoton;
+	m_totalPhotons = totalPhotons;
+	m_totalWeight = totalWeight;
+	m_totalSquaredWeight = totalSquaredWeight;
+	m_totalPower = totalWeight * m_wPhoton;
 
 	if( photonCountsError )
 	{
@@ -706,10 +941,79 @@ void FluxAnalysis::ExportAnalysis( QString directory, QString fileName, bool sav
 	exportFile.close();
 }
 
+/*
+ * Exports the flux distribution of each target of the multi target analysis to the file \a fileName followed by
+ * the number of the target, and a summary with the total power and the peak flux of the targets.
+ *
+ * Returns false if there is not photon map or a file can not be written.
+ */
+bool FluxAnalysis::ExportTargetsAnalysis( QString directory, QString fileName, bool saveCoords )
+{
+	if( m_pPhotonMap == 0 || !m_pPhotonMap ) return false;
+
+	if( directory.isEmpty() ) return false;
+
+	if( fileName.isEmpty() ) return false;
+
+	QFileInfo exportFileInfo( fileName );
+	QString baseName = fileName;
+	if( !exportFileInfo.completeSuffix().compare( "txt" ) )	baseName.chop( 4 );
+
+	QFile summaryFile( directory + "/" + baseName + "_summary.txt" );
+	if( !summaryFile.open( QIODevice::WriteOnly ) )	return false;
+	QTextStream out( &summaryFile );
+	out<<"Target\tSurface\tSide\tPower(W)\tPeakFlux(W/m2)\tPhotons"<<"\n";
+
+	for( int t = 0; t < m_targets.size(); t++ )
+	{
+		if( !SelectTarget( t ) || !m_photonCounts ) return false;
+
+		QString targetFileName = QString( "%1_%2.txt" ).arg( baseName, QString::number( t + 1 ) );
+		ExportAnalysis( directory, targetFileName, saveCoords );
+
+		double widthCell = ( m_xmax - m_xmin ) / m_widthDivisions;
+		double heightCell = ( m_ymax - m_ymin ) / m_heightDivisions;
+		double areaCell = widthCell * heightCell;
+		double peakFlux = ( areaCell > 0 ) ? m_maximumPhotons * m_wPhoton / areaCell : 0.0;
+
+		out<< t + 1 << "\t" << m_surfaceURL << "\t" << m_surfaceSide << "\t" << m_totalPower << "\t" << peakFlux << "\t" << m_totalPhotons << "\n";
+	}
+	summaryFile.close();
+
+	return true;
+}
+
+/*
+ * Exports the result of the convergent analysis to the file \a fileName followed by "_convergence": the \a metricName value,
+ * its 95% confidence interval, the relative error, the traced rays and whether the analysis \a converged.
+ *
+ * Returns false if the file can not be written.
+ */
+bool FluxAnalysis::ExportConvergence( QString directory, QString fileName, QString metricName, bool converged )
+{
+	if( directory.isEmpty() ) return false;
+
+	if( fileName.isEmpty() ) return false;
+
+	QFileInfo exportFileInfo( fileName );
+	QString baseName = fileName;
+	if( !exportFileInfo.completeSuffix().compare( "txt" ) )	baseName.chop( 4 );
+
+	QFile convergenceFile( directory + "/" + baseName + "_convergence.txt" );
+	if( !convergenceFile.open( QIODevice::WriteOnly ) )	return false;
+	QTextStream out( &convergenceFile );
+	out<<"Metric\tValue\tConfidenceInterval95\tRelativeError\tTracedRays\tConverged"<<"\n";
+	out<< metricName << "\t" << m_metricValue << "\t" << m_confidenceInterval << "\t" << m_relativeError << "\t"
+			<< m_tracedRays << "\t" << ( converged ? 1 : 0 ) << "\n";
+	convergenceFile.close();
+
+	return ( out.status() == QTextStream::Ok );
+}
+
 /*
  * Returns m_photoCounts.
  */
-int** FluxAnalysis::photonCountsValue()
+double** FluxAnalysis::photonCountsValue()
 {
 	return m_photonCounts;
 }
@@ -749,7 +1053,7 @@ double FluxAnalysis::ymaxValue()
 /*
  * Returns m_maximumPhotons value.
  */
-int FluxAnalysis::maximumPhotonsValue()
+double FluxAnalysis::maximumPhotonsValue()
 {
 	return m_maximumPhotons;
 }
@@ -773,7 +1077,7 @@ int FluxAnalysis::maximumPhotonsYCoordValue()
 /*
  * Returns m_maximumPhotonsError value.
  */
-int FluxAnalysis::maximumPhotonsErrorValue()
+double FluxAnalysis::maximumPhotonsErrorValue()
 {
 	return m_maximumPhotonsError;
 }
@@ -794,6 +1098,38 @@ double FluxAnalysis::totalPowerValue()
 	return m_totalPower;
 }
 
+/*
+ * Returns m_tracedRays value.
+ */
+unsigned long FluxAnalysis::tracedRaysValue()
+{
+	return m_tracedRays;
+}
+
+/*
+ * Returns the value of the metric computed in the last convergent analysis.
+ */
+double FluxAnalysis::metricValue()
+{
+	return m_metricValue;
+}
+
+/*
+ * Returns the relative standard error of the metric computed in the last convergent analysis.
+ */
+double FluxAnalysis::relativeErrorValue()
+{
+	return m_relativeError;
+}
+
+/*
+ * Returns the half width of the 95% confidence interval of the metric computed in the last convergent analysis.
+ */
+double FluxAnalysis::confidenceIntervalValue()
+{
+	return m_confidenceInterval;
+}
+
 /*
  * Clear photon map
  */
@@ -803,6 +1139,39 @@ void FluxAnalysis::clearPhotonMap()
 	delete m_pPhotonMap;
 	m_pPhotonMap = 0;
 	m_tracedRays = 0;
+	m_tracedChunks = 0;
 	m_wPhoton = 0;
 	m_totalPower = 0;
+	m_totalWeight = 0;
+	m_totalSquaredWeight = 0;
+}
+
+/*
+ * Traces energy-weighted photons with Russian roulette at \a rouletteWeight. Zero traces stochastic photons.
+ */
+void FluxAnalysis::SetWeightedPhotons( double rouletteWeight )
+{
+	m_rouletteWeight = rouletteWeight;
+}
+
+/*
+ * Sets the sampling of the light cells. With \a importance, each analysis batch traces more rays from the cells whose
+ * rays hit the analysed surface in the previous batches, keeping a \a uniformFraction of uniform rays.
+ */
+void FluxAnalysis::SetLightSampling( bool stratified, bool importance, double uniformFraction )
+{
+	m_stratifiedLight = stratified;
+	m_lightImportance = importance;
+	m_lightUniformFraction = uniformFraction;
+	m_lightCellStatistics.clear();
+}
+
+/*
+ * Traces each chunk of rays with its own generator of \a randomFactory, started with \a seed. Generators with substreams
+ * trace each ray with the substream of its ray number, so analyses of scene variants use common random numbers.
+ */
+void FluxAnalysis::SetRandomStreams( RandomDeviateFactory* randomFactory, unsigned long seed )
+{
+	m_randomFactory = randomFactory;
+	m_randomSeed = seed;
 }
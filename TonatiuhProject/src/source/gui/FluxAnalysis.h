@@ -39,41 +39,84 @@ Juana Amieva, Azael Mancillas, Cesar Cantu, I
 #ifndef FLUXANALYSIS_H_
 #define FLUXANALYSIS_H_
 
+#include <QString>
+#include <QVector>
+
+#include "LightCellSampling.h"
+
 class TSceneKit;
 class SceneModel;
 class InstanceNode;
 class RandomDeviate;
+class RandomDeviateFactory;
 class TPhotonMap;
 
+/*!
+ * A surface whose flux distribution is computed in a multi target analysis.
+ */
+struct FluxAnalysisTarget
+{
+	FluxAnalysisTarget( QString nodeURL = QString(), QString side = QString(), int height = 0, int width = 0 );
+
+	QString surfaceURL;
+	QString surfaceSide;
+	int heightDivisions;
+	int widthDivisions;
+};
 
 class FluxAnalysis
 {
 
 public:
+	enum ConvergenceMetric
+	{
+		PeakFlux = 0,
+		TotalPower = 1,
+	};
+
 	FluxAnalysis( TSceneKit* currentScene, SceneModel& currentSceneModel, InstanceNode* rootSeparatorInstance,
 			int sunWidthDivisions, int sunHeightDivisions, RandomDeviate* randomDeviate);
 	~FluxAnalysis();
 	QString GetSurfaceType( QString nodeURL );
 	void RunFluxAnalysis( QString nodeURL, QString surfaceSide, unsigned long nOfRays, bool increasePhotonMap, int heightDivisions, int widthDivisions );
+	bool RunConvergentFluxAnalysis( QString nodeURL, QString surfaceSide, unsigned long raysPerBatch, unsigned long maximumNumberOfRays,
+			ConvergenceMetric metric, double relativeErrorThreshold, int heightDivisions, int widthDivisions );
+	bool AddTarget( QString nodeURL, QString surfaceSide, int heightDivisions, int widthDivisions );
+	void ClearTargets();
+	int NumberOfTargets() const;
+	void RunMultiTargetFluxAnalysis( unsigned long nOfRays, bool increasePhotonMap );
+	bool SelectTarget( int index );
 	void UpdatePhotonCounts( int heightDivisions, int widthDivisions );
 	void ExportAnalysis( QString directory, QString fileName, bool saveCoords );
-	int** photonCountsValue();
+	bool ExportTargetsAnalysis( QString directory, QString fileName, bool saveCoords );
+	bool ExportConvergence( QString directory, QString fileName, QString metricName, bool converged );
+	double** photonCountsValue();
 	double xminValue();
 	double yminValue();
 	double xmaxValue();
 	double ymaxValue();
-	int maximumPhotonsValue();
+	double maximumPhotonsValue();
 	int maximumPhotonsXCoordValue();
 	int maximumPhotonsYCoordValue();
-	int maximumPhotonsErrorValue();
+	double maximumPhotonsErrorValue();
 	double wPhotonValue();
 	double totalPowerValue();
+	unsigned long tracedRaysValue();
+	double metricValue();
+	double relativeErrorValue();
+	double confidenceIntervalValue();
 	void clearPhotonMap();
+	void SetWeightedPhotons( double rouletteWeight );
+	void SetLightSampling( bool stratified, bool importance, double uniformFraction );
+	void SetRandomStreams( RandomDeviateFactory* randomFactory, unsigned long seed );
 
 private:
-	bool CheckSurface();
-	bool CheckSurfaceSide();
+	bool CheckSurface( QString nodeURL );
+	bool CheckSurfaceSide( QString nodeURL, QString surfaceSide );
+	bool Trace( const QVector< InstanceNode* >& exportSuraceList, unsigned long nOfRays, bool increasePhotonMap );
+	void ClearPhotonCounts();
 	void UpdatePhotonCounts();
+	void UpdateStatisticalError( ConvergenceMetric metric );
 	void FluxAnalysisCylinder( InstanceNode* node );
 	void FluxAnalysisFlatDisk( InstanceNode* node );
 	void FluxAnalysisFlatRectangle( InstanceNode* node );
@@ -89,21 +132,37 @@ private:
 
 	QString m_surfaceURL;
 	QString m_surfaceSide;
+	QVector< FluxAnalysisTarget > m_targets;
 	unsigned long m_tracedRays;
+	unsigned long m_tracedChunks;
 	double m_wPhoton;
 
-	int** m_photonCounts;
+	double** m_photonCounts;
 	int m_heightDivisions;
 	int m_widthDivisions;
 	double m_xmin;
 	double m_xmax;
 	double m_ymin;
 	double m_ymax;
-	int m_maximumPhotons;
+	double m_maximumPhotons;
 	int m_maximumPhotonsXCoord;
 	int m_maximumPhotonsYCoord;
-	int m_maximumPhotonsError;
+	double m_maximumPhotonsError;
+	int m_totalPhotons;
 	double m_totalPower;
+	double m_totalWeight;
+	double m_totalSquaredWeight;
+	double m_rouletteWeight;
+	bool m_stratifiedLight;
+	bool m_lightImportance;
+	double m_lightUniformFraction;
+	LightCellStatistics m_lightCellStatistics;
+	RandomDeviateFactory* m_randomFactory;
+	unsigned long m_randomSeed;
+
+	double m_metricValue;
+	double m_relativeError;
+	double m_confidenceInterval;
 
 protected:
 
@@ -160,6 +160,14 @@ FluxAnalysisDialog::~FluxAnalysisDialog()
 	delete m_pNOfRays;
 }
 
+/*!
+ * Traces each chunk of rays with its own generator of \a randomFactory, started with \a seed.
+ */
+void FluxAnalysisDialog::SetRandomStreams( RandomDeviateFactory* randomFactory, unsigned long seed )
+{
+	m_fluxAnalysis->SetRandomStreams( randomFactory, seed );
+}
+
 /*!
  * Resizes results widget elements sizes when the dialog windows size is changed.
  */
@@ -227,7 +235,7 @@ void FluxAnalysisDialog::SaveCoordsExport()
  */
 void FluxAnalysisDialog::ExportData()
 {
-	int** photonCounts = m_fluxAnalysis->photonCountsValue();
+	double** photonCounts = m_fluxAnalysis->photonCountsValue();
 	if( !photonCounts || photonCounts == 0 )
 	{
 		QString message = QString( tr( "Nothing available to export, first run the simulation" ) );
@@ -355,7 +363,7 @@ void FluxAnalysisDialog::UpdateAnalysis()
 
 	m_fluxAnalysis->UpdatePhotonCounts( heightValue.toInt(), withValue.toInt() );
 
-	int** photonCounts = m_fluxAnalysis->photonCountsValue();
+	double** photonCounts = m_fluxAnalysis->photonCountsValue();
 	if( !photonCounts || photonCounts == 0 ) return;
 
 	ClearCurrentAnalysis();
@@ -426,7 +434,7 @@ void FluxAnalysisDialog::UpdateStatistics( double totalPower, double minimumFlux
 /*
  * Updates the flux map plot
  */
-void FluxAnalysisDialog::UpdateFluxMapPlot( int** photonCounts, double wPhoton, int widthDivisions, int heightDivisions, double xmin, double ymin, double xmax, double ymax )
+void FluxAnalysisDialog::UpdateFluxMapPlot( double** photonCounts, double wPhoton, int widthDivisions, int heightDivisions, double xmin, double ymin, double xmax, double ymax )
 {
 	//Delete previous colormap, scale
 	contourPlotWidget->clearPlottables();
@@ -522,7 +530,7 @@ void FluxAnalysisDialog::CreateSectorPlots( double xmin, double ymin, double xma
 /*
  * Updates the sector plots
  */
-void FluxAnalysisDialog::UpdateSectorPlots( int** photonCounts, double wPhoton, int widthDivisions, int heightDivisions, double xmin, double ymin, double xmax, double ymax, double maximumFlux )
+void FluxAnalysisDialog::UpdateSectorPlots( double** photonCounts, double wPhoton, int widthDivisions, int heightDivisions, double xmin, double ymin, double xmax, double ymax, double maximumFlux )
 {
 	QCPItemLine* tickVLine  = ( QCPItemLine* ) contourPlotWidget->item( 0 );
 	QPointF pointVStart = tickVLine->start->coords();
@@ -631,7 +639,7 @@ void FluxAnalysisDialog::UpdateLabelsUnits()
  */
 void FluxAnalysisDialog::UpdateSectorPlotSlot()
 {
-	int** photonCounts = m_fluxAnalysis->photonCountsValue();
+	double** photonCounts = m_fluxAnalysis->photonCountsValue();
 	if( !photonCounts || photonCounts == 0 ) return;
 
 	double xmin = m_fluxAnalysis->xminValue();
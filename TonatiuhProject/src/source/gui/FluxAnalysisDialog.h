@@ -49,6 +49,7 @@ class InstanceNode;
 class SceneModel;
 class QIntValidator;
 class RandomDeviate;
+class RandomDeviateFactory;
 class TSceneKit;
 class FluxAnalysis;
 
@@ -63,6 +64,8 @@ public:
 			RandomDeviate* randomDeviate, QWidget* parent = 0 );
 	~FluxAnalysisDialog();
 
+	void SetRandomStreams( RandomDeviateFactory* randomFactory, unsigned long seed );
+
 protected:
 	void resizeEvent( QResizeEvent* event );
 
@@ -81,9 +84,9 @@ private slots:
 private:
 	void UpdateStatistics( double totalEnergy, double minimumFlux, double averageFlux, double maximumFlux,
 			double maxXCoord, double maxYCoord, double error, double uniformity, double gravityX, double gravityY );
-	void UpdateFluxMapPlot( int** photonCounts, double wPhoton, int widthDivisions, int heightDivisions, double xmin, double ymin, double xmax, double ymax );
+	void UpdateFluxMapPlot( double** photonCounts, double wPhoton, int widthDivisions, int heightDivisions, double xmin, double ymin, double xmax, double ymax );
 	void CreateSectorPlots( double xmin, double ymin, double xmax, double ymax );
-	void UpdateSectorPlots( int** photonCounts, double wPhoton, int widthDivisions, int heightDivisions, double xmin, double ymin, double xmax, double ymax, double maximumFlux );
+	void UpdateSectorPlots( double** photonCounts, double wPhoton, int widthDivisions, int heightDivisions, double xmin, double ymin, double xmax, double ymax, double maximumFlux );
 	void ClearCurrentAnalysis();
 	void UpdateSurfaceSides( QString selectedSurfaceURL );
 
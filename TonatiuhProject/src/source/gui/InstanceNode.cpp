@@ -40,6 +40,7 @@ Juana Amieva, Azael Mancillas, Cesar Cantu.
 
 #include <Inventor/nodes/SoNode.h>
 #include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/sensors/SoNodeSensor.h>
 
 #include "BBox.h"
 #include "DifferentialGeometry.h"
@@ -49,6 +50,7 @@ Juana Amieva, Azael Mancillas, Cesar Cantu.
 #include "TMaterial.h"
 #include "Transform.h"
 #include "TShape.h"
+#include "TSeparatorKit.h"
 #include "TShapeKit.h"
 #include "TLightKit.h"
 #include "TTracker.h"
@@ -56,26 +58,32 @@ Juana Amieva, Azael Mancillas, Cesar Cantu.
 
 
 InstanceNode::InstanceNode( SoNode* node )
-: m_coinNode( node ), m_parent( 0 )
+: m_coinNode( node ), m_parent( 0 ), m_isDirty( true ), m_isTransformDirty( true ), m_nodeSensor( 0 )
 {
+	AttachNodeSensor();
+	UpdateNodeURL();
 }
 
 InstanceNode::~InstanceNode()
 {
+		delete m_nodeSensor;
 		qDeleteAll( children );
 }
 
 /**
- * Returns node URL.
+ * Rebuilds the cached URL of this instance and its subtree from the parent URL and the node names.
+ *
+ * The URLs are rebuilt when an instance is moved. The node must be renamed through the scene model,
+ * which rebuilds the URLs of all its instances.
  */
-QString InstanceNode::GetNodeURL() const
+void InstanceNode::UpdateNodeURL()
 {
-   QString url;
-   if( GetParent() ) url = GetParent()->GetNodeURL();
-   url.append( QLatin1String( "/" ) );
-   const char* nodeName = m_coinNode->getName().getString();
-   url.append( QLatin1String( nodeName  ) );
-   return url;
+	m_nodeURL = m_parent ? m_parent->m_nodeURL : QString();
+	m_nodeURL.append( QLatin1String( "/" ) );
+	if( m_coinNode )	m_nodeURL.append( QLatin1String( m_coinNode->getName().getString() ) );
+
+	for( int index = 0; index < children.size(); ++index )
+		children[index]->UpdateNodeURL();
 }
 
 void InstanceNode::Print( int level ) const
@@ -95,6 +103,7 @@ void InstanceNode::AddChild( InstanceNode* child )
 {
     children.push_back( child );
     child->SetParent( this );
+    SetDirty( false );
 }
 /**
  * Inserts the \a instanceChild node as child number \a row.
@@ -104,11 +113,17 @@ void InstanceNode::InsertChild( int row, InstanceNode* instanceChild)
    if( row > children.size() ) row = children.size();
    children.insert( row, instanceChild);
    instanceChild->SetParent(this);
+   SetDirty( false );
 }
 
 
 //bool InstanceNode::Intersect( const Ray& ray, RandomDeviate& rand, InstanceNode** modelNode, Ray* outputRay )
-bool InstanceNode::Intersect( const Ray& ray, RandomDeviate& rand, bool* isShapeFront, InstanceNode** modelNode, Ray* outputRay )
+/**
+ * Intersects the \a ray with the node surfaces and computes the \a outputRay of the nearest one.
+ * If \a reflectance is not null, the materials do not absorb the ray stochastically and the fraction of the
+ * incident power carried by \a outputRay is returned in \a reflectance.
+**/
+bool InstanceNode::Intersect( const Ray& ray, RandomDeviate& rand, bool* isShapeFront, InstanceNode** modelNode, Ray* outputRay, double* reflectance )
 {
 
 	//Check if the ray intersects with the BoundingBox
@@ -123,7 +138,9 @@ bool InstanceNode::Intersect( const Ray& ray, RandomDeviate& rand, bool* isShape
          InstanceNode* intersectedChild = 0;
          Ray childOutputRay;
          bool childShapreFront = true;
-         bool isChildOutputRay = children[index]->Intersect( ray, rand, &childShapreFront, &intersectedChild, &childOutputRay );
+         double childReflectance = 1.0;
+         bool isChildOutputRay = children[index]->Intersect( ray, rand, &childShapreFront, &intersectedChild, &childOutputRay,
+        		 reflectance ? &childReflectance : 0 );
 
          if( ray.maxt < t )
          {
@@ -133,6 +150,7 @@ bool InstanceNode::Intersect( const Ray& ray, RandomDeviate& rand, bool* isShape
 
             *outputRay = childOutputRay;
             isOutputRay = isChildOutputRay;
+            if( reflectance )	*reflectance = childReflectance;
 
          }
       }
@@ -171,7 +189,10 @@ bool InstanceNode::Intersect( const Ray& ray, RandomDeviate& rand, bool* isShape
 			 if( tmaterial )
 			 {
 				 Ray surfaceOutputRay;
-				 if( tmaterial->OutputRay( childCoordinatesRay, &dg, rand, &surfaceOutputRay ) )
+				 bool isOutputRay = reflectance ?
+						 tmaterial->WeightedOutputRay( childCoordinatesRay, &dg, rand, &surfaceOutputRay, reflectance ) :
+						 tmaterial->OutputRay( childCoordinatesRay, &dg, rand, &surfaceOutputRay );
+				 if( isOutputRay )
 				 {
 					 *outputRay = m_transformOTW( surfaceOutputRay );
 					 return true;
@@ -231,6 +252,72 @@ void InstanceNode::SetIntersectionTransform( Transform nodeTransform )
 	m_transformOTW = m_transformWTO.GetInverse();
 }
 
+/**
+ * Marks the node intersection bounding box as outdated. If \a transformChanged is true, the node transform
+ * is also marked as outdated.
+ *
+ * The node ancestors are marked too because their bounding boxes depend on this node.
+ */
+void InstanceNode::SetDirty( bool transformChanged )
+{
+	if( transformChanged )	m_isTransformDirty = true;
+
+	//The ancestors of a dirty node are always dirty.
+	InstanceNode* node = this;
+	while( node && !node->m_isDirty )
+	{
+		node->m_isDirty = true;
+		node = node->m_parent;
+	}
+}
+
+/**
+ * Marks the node intersection bounding box and transform as updated.
+ */
+void InstanceNode::SetClean()
+{
+	m_isDirty = false;
+	m_isTransformDirty = false;
+}
+
+/**
+ * Attaches a sensor to the coin node to know when the node intersection data must be recomputed.
+ *
+ * Only separator and surface nodes have intersection data.
+ */
+void InstanceNode::AttachNodeSensor()
+{
+	if( m_nodeSensor )	m_nodeSensor->detach();
+	if( !m_coinNode )	return;
+
+	if( !m_coinNode->getTypeId().isDerivedFrom( TSeparatorKit::getClassTypeId() ) &&
+			!m_coinNode->getTypeId().isDerivedFrom( TShapeKit::getClassTypeId() ) )
+		return;
+
+	if( !m_nodeSensor )
+	{
+		m_nodeSensor = new SoNodeSensor( InstanceNode::nodeChanged, this );
+		m_nodeSensor->setPriority( 0 );
+	}
+	m_nodeSensor->attach( m_coinNode );
+}
+
+/**
+ * Updates the \a data instance state when its coin node or any node below it changes.
+ */
+void InstanceNode::nodeChanged( void* data, SoSensor* sensor )
+{
+	InstanceNode* instance = static_cast< InstanceNode* >( data );
+	SoNodeSensor* nodeSensor = static_cast< SoNodeSensor* >( sensor );
+
+	SoBaseKit* coinNode = static_cast< SoBaseKit* >( instance->m_coinNode );
+	SoNode* triggerNode = nodeSensor->getTriggerNode();
+
+	bool transformChanged = !triggerNode || ( triggerNode == coinNode ) ||
+			( triggerNode == coinNode->getPart( "transform", false ) );
+	instance->SetDirty( transformChanged );
+}
+
 QDataStream& operator<< ( QDataStream & s, const InstanceNode& node )
 {
 	s << node.GetNode();
@@ -52,6 +52,8 @@ Juana Amieva, Azael Mancillas, Cesar Cantu.
 class RandomDeviate;
 class Ray;
 class SoNode;
+class SoNodeSensor;
+class SoSensor;
 class TLightKit;
 class SceneModel;
 
@@ -75,9 +77,10 @@ public:
     SoNode* GetNode() const;
     InstanceNode* GetParent() const;
     QString GetNodeURL() const;
+    void UpdateNodeURL();
     void Print( int level ) const;
 
-    bool Intersect( const Ray& ray, RandomDeviate& rand, bool* isShapeFront, InstanceNode** modelNode, Ray* outputRay );
+    bool Intersect( const Ray& ray, RandomDeviate& rand, bool* isShapeFront, InstanceNode** modelNode, Ray* outputRay, double* reflectance = 0 );
 
     //template<class T> void RecursivlyApply(void (T::*func)(void));
     //template<class T,class Param1> void RecursivlyApply(void (T::*func)(Param1),Param1 param1);
@@ -93,14 +96,26 @@ public:
     void SetIntersectionBBox( BBox nodeBBox );
     void SetIntersectionTransform( Transform nodeTransform );
 
+    bool IsDirty() const;
+    bool IsTransformDirty() const;
+    void SetDirty( bool transformChanged );
+    void SetClean();
+
     QVector< InstanceNode* > children;
 
 private:
+    void AttachNodeSensor();
+    static void nodeChanged( void* data, SoSensor* sensor );
+
     SoNode* m_coinNode;
     InstanceNode* m_parent;
     BBox m_bbox;
     Transform m_transformWTO;
     Transform m_transformOTW;
+    bool m_isDirty;
+    bool m_isTransformDirty;
+    SoNodeSensor* m_nodeSensor;
+    QString m_nodeURL;
 };
 
 QDataStream & operator<< ( QDataStream & s, const InstanceNode& node );
@@ -110,11 +125,25 @@ bool operator==( const InstanceNode& thisNode,const InstanceNode& otherNode );
 inline void InstanceNode::SetParent( InstanceNode* parent )
 {
 	m_parent = parent;
+	UpdateNodeURL();
 }
 
 inline void InstanceNode::SetNode( SoNode* node )
 {
 	m_coinNode = node;
+	AttachNodeSensor();
+	UpdateNodeURL();
+	SetDirty( true );
+}
+
+/**
+ * Returns node URL.
+ *
+ * The URL is cached in each instance, so it can be read from the tracing threads without locking.
+ */
+inline QString InstanceNode::GetNodeURL() const
+{
+	return m_nodeURL;
 }
 
 inline SoNode* InstanceNode::GetNode() const
@@ -130,5 +159,21 @@ inline InstanceNode* InstanceNode::GetParent() const
 	return m_parent;
 }
 
+/**
+ * Returns true if the intersection bounding box of the node must be recomputed.
+ */
+inline bool InstanceNode::IsDirty() const
+{
+	return m_isDirty;
+}
+
+/**
+ * Returns true if the intersection transform of the node, and so the whole subtree, must be recomputed.
+ */
+inline bool InstanceNode::IsTransformDirty() const
+{
+	return m_isTransformDirty;
+}
+
 
 #endif /*INSTANCENODE_H_*/
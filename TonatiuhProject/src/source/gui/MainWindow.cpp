@@ -39,6 +39,7 @@ Juana Amieva, Azael Mancillas, Cesar Cantu.
 #include <iostream>
 
 #include <QCloseEvent>
+#include <QDataStream>
 #include <QDir>
 #include <QFileDialog>
 #include <QFuture>
@@ -49,6 +50,7 @@ Juana Amieva, Azael Mancillas, Cesar Cantu.
 #include <QProgressDialog>
 #include <QSettings>
 #include <QtConcurrentMap>
+#include <QtConcurrentRun>
 #include <QTime>
 #include <QUndoStack>
 #include <QUndoView>
@@ -112,13 +114,16 @@ Juana Amieva, Azael Mancillas, Cesar Cantu.
 #include "PhotonMapExport.h"
 #include "PhotonMapExportFactory.h"
 #include "PhotonMapExportSettings.h"
+#include "PhotonSurfaceIndex.h"
 #include "PluginManager.h"
 #include "ProgressUpdater.h"
 #include "RandomDeviate.h"
 #include "RandomDeviateFactory.h"
+#include "RayFile.h"
 #include "RayTraceDialog.h"
 #include "RayTracer.h"
 #include "RayTracerNoTr.h"
+#include "RayTracingScheduler.h"
 #include "SceneModel.h"
 #include "ScriptEditorDialog.h"
 #include "SunPositionCalculatorDialog.h"
@@ -133,6 +138,7 @@ Juana Amieva, Azael Mancillas, Cesar Cantu.
 #include "TransmissivityDialog.h"
 #include "trf.h"
 #include "TSceneKit.h"
+#include "TraceCheckpoint.h"
 #include "TSeparatorKit.h"
 #include "TShapeFactory.h"
 #include "TShapeKit.h"
@@ -183,10 +189,25 @@ m_coinNode_Buffer( 0 ),
 m_manipulators_Buffer( 0 ),
 m_tracedRays( 0 ),
 m_raysPerIteration( 10000 ),
+m_reproducibleTrace( false ),
+m_randomSeed( 12345 ),
+m_tracedChunks( 0 ),
+m_runIndex( 0 ),
+m_checkpointFileName( "" ),
+m_checkpointRays( 1000000 ),
+m_resumeCheckpoint( 0 ),
+m_rouletteWeight( 0.0 ),
+m_captureSurfaceURL( "" ),
+m_captureFileName( "" ),
+m_raySource( 0 ),
+m_stratifiedLight( false ),
+m_lightImportance( false ),
+m_lightUniformFraction( 0.1 ),
 m_heightDivisions( 200 ),
 m_widthDivisions( 200 ),
 m_drawPhotons( false ),
 m_drawRays( true ),
+m_drawingBudget( 100000 ),
 m_gridXElements( 0 ),
 m_gridZElements( 0 ),
 m_gridXSpacing( 0 ),
@@ -225,6 +246,8 @@ MainWindow::~MainWindow()
 	delete m_commandStack;
 	delete m_commandView;
 	delete m_rand;
+	delete m_resumeCheckpoint;
+	delete m_raySource;
 	delete[] m_recentFileActions;
 	delete m_pPhotonMap;
 }
@@ -505,7 +528,7 @@ void MainWindow::Open()
 
         QString fileName = QFileDialog::getOpenFileName( this,
                                tr( "Open" ), openDirectory,
-                               tr( "Tonatiuh files (*.tnh)" ) );
+                               tr( "Tonatiuh files (*.tnh *.tnhb)" ) );
 
     	if( fileName.isEmpty() ) return;
 
@@ -597,6 +620,7 @@ void MainWindow::RunFluxAnalysisRayTracer()
 	RandomDeviate* 	pRandomDeviate =  randomDeviateFactoryList[m_selectedRandomDeviate]->CreateRandomDeviate();
 
 	FluxAnalysisDialog dialog( coinScene, *m_sceneModel, rootSeparatorInstance, m_widthDivisions, m_heightDivisions, pRandomDeviate );
+	dialog.SetRandomStreams( randomDeviateFactoryList[m_selectedRandomDeviate], m_randomSeed );
 	dialog.exec();
 
 }
@@ -672,16 +696,25 @@ bool MainWindow::SaveAs()
 	QString saveDirectory = settings.value( "saveDirectory", QString( "." ) ).toString();
 
 	QString tonatiuhFilter( "Tonatiuh files (*.tnh)" );
+	QString binaryFilter( "Tonatiuh binary files (*.tnhb)" );
+	QString selectedFilter = tonatiuhFilter;
 	QString fileName = QFileDialog::getSaveFileName( this,
 	                       tr( "Save" ), saveDirectory,
-	                       tonatiuhFilter, &tonatiuhFilter );
+	                       tonatiuhFilter + QLatin1String( ";;" ) + binaryFilter, &selectedFilter );
 	if( fileName.isEmpty() ) return false;
 
 	QFileInfo file( fileName );
 	settings.setValue( "saveDirectory", file.absolutePath() );
 
-	if( file.completeSuffix().compare( "tnh" ) )
-		fileName.append( ".tnh" );
+	//A name that already ends with a known suffix keeps it, whatever filter was selected.
+	QString fileSuffix = file.suffix();
+	bool hasKnownSuffix = ( fileSuffix.compare( QLatin1String( "tnh" ), Qt::CaseInsensitive ) == 0 ) ||
+			( fileSuffix.compare( QLatin1String( "tnhb" ), Qt::CaseInsensitive ) == 0 );
+	if( !hasKnownSuffix )
+	{
+		QString suffix = ( selectedFilter == binaryFilter ) ? QLatin1String( "tnhb" ) : QLatin1String( "tnh" );
+		fileName.append( QLatin1String( "." ) + suffix );
+	}
 	return SaveFile( fileName );
 }
 
@@ -864,7 +897,7 @@ void MainWindow::ShowRayTracerOptionsDialog()
 	RayTraceDialog* options = new RayTraceDialog( m_raysPerIteration,
 			randomDeviateFactoryList, m_selectedRandomDeviate,
 			m_widthDivisions,m_heightDivisions,
-			m_drawRays, m_drawPhotons,
+			m_drawRays, m_drawPhotons, m_drawingBudget,
 			m_bufferPhotons, m_increasePhotonMap, this );
 	options->exec();
 
@@ -872,6 +905,7 @@ void MainWindow::ShowRayTracerOptionsDialog()
 	SetRandomDeviateType( randomDeviateFactoryList[options->GetRandomDeviateFactoryIndex()]->RandomDeviateName() );
 	SetRayCastingGrid( options->GetWidthDivisions(), options->GetHeightDivisions() );
 	SetRaysDrawingOptions( options->DrawRays(), options->DrawPhotons() );
+	SetRaysDrawingBudget( options->GetDrawingBudget() );
 	SetPhotonMapBufferSize( options->GetPhotonMapBufferSize() );
 	SetIncreasePhotonMap( options->IncreasePhotonMap() );
 
@@ -1113,6 +1147,21 @@ void MainWindow::AddExportSurfaceURL( QString nodeURL )
 	m_pExportModeSettings->exportSurfaceNodeList.push_back( nodeURL );
 }
 
+/*!
+ * Adds the side \a surfaceSide of the surface \a nodeURL to the targets of the multi target flux analysis.
+ * The flux distribution of the target is calculated in a grid of \a heightDivisions x \a widthDivisions cells.
+ */
+void MainWindow::AddFluxAnalysisTarget( QString nodeURL, QString surfaceSide, int heightDivisions, int widthDivisions )
+{
+	if( heightDivisions < 2 || widthDivisions < 2 )
+	{
+		emit Abort( tr( "AddFluxAnalysisTarget: The grid of the target must have at least 2 x 2 cells." ) );
+		return;
+	}
+
+	m_fluxTargets.push_back( FluxAnalysisTarget( nodeURL, surfaceSide, heightDivisions, widthDivisions ) );
+}
+
 /*!
  * Changes the light position to the position defined by \a azimuth and \a elevation.
  * The parameters are defined in degree.
@@ -1180,6 +1229,14 @@ void MainWindow::Clear()
 	StartOver( "" );
 }
 
+/*!
+ * Removes all the targets of the multi target flux analysis.
+ */
+void MainWindow::ClearFluxAnalysisTargets()
+{
+	m_fluxTargets.clear();
+}
+
 /*!
  * Copies current node to the clipboard.
  * The current node cannot be the model root node or concentrator node.
@@ -1745,7 +1802,7 @@ void MainWindow::Open( QString fileName )
 	}
 
 	QFileInfo file( fileName );
-	if( !file.exists() || !file.isFile() || file.suffix()!=QString("tnh") )
+	if( !file.exists() || !file.isFile() || ( ( file.suffix() != QString( "tnh" ) ) && ( file.suffix() != QString( "tnhb" ) ) ) )
 	{
 		QMessageBox::warning( this, QLatin1String( "Tonatiuh" ),
 				tr( "Open: Cannot open file:\n%1." ).arg( fileName ) );
@@ -1809,6 +1866,28 @@ void MainWindow::PasteLink()
 	Paste( m_selectionModel->currentIndex(), tgc::Shared );
 }
 
+/*!
+ * Resumes the ray tracing saved in the checkpoint \a fileName. The script must define the same scene and
+ * ray tracing parameters: the runs completed before the checkpoint are skipped and the interrupted run
+ * continues from the checkpoint next ray.
+ */
+void MainWindow::ResumeFromCheckpoint( QString fileName )
+{
+	TraceCheckpoint* checkpoint = new TraceCheckpoint;
+	if( !checkpoint->Read( m_distributedTrace.WorkerFileName( fileName ) ) )
+	{
+		delete checkpoint;
+		emit Abort( tr( "ResumeFromCheckpoint: The checkpoint file can not be read." ) );
+		return;
+	}
+
+	delete m_resumeCheckpoint;
+	m_resumeCheckpoint = checkpoint;
+	m_reproducibleTrace = true;
+	m_randomSeed = checkpoint->seed;
+	m_runIndex = 0;
+}
+
 /*!
  * Runs ray tracer to defined model and paramenters.
  */
@@ -1823,26 +1902,23 @@ void MainWindow::Run()
 	TTransmissivity* transmissivity = 0;
 
 	QDateTime startTime = QDateTime::currentDateTime();
-	if( ReadyForRaytracing( rootSeparatorInstance, lightInstance, lightTransform, sunShape, raycastingSurface, transmissivity ) )
-	{
-		if( !m_pPhotonMap->GetExportMode() )
-		{
-			if( !m_pExportModeSettings ) return;
-			else
-			{
 
-				PhotonMapExport* pExportMode = CreatePhotonMapExport();
-				if( !pExportMode )	return;
-				if( !m_pPhotonMap->SetExportMode( pExportMode )  ) return;
+	//Skip the runs completed before the resumed checkpoint
+	m_runIndex++;
+	if( m_resumeCheckpoint && ( m_runIndex < m_resumeCheckpoint->runIndex ||
+			( m_runIndex == m_resumeCheckpoint->runIndex && m_resumeCheckpoint->IsComplete() ) ) )
+	{
+		return;
+	}
 
-			}
-		}
+	if( ReadyForRaytracing( rootSeparatorInstance, lightInstance, lightTransform, sunShape, raycastingSurface, transmissivity ) )
+	{
+		if( !m_pExportModeSettings ) return;
 
 		QVector< InstanceNode* > exportSuraceList;
 		QStringList exportSurfaceURLList = m_pExportModeSettings->exportSurfaceNodeList;
 		for( int s = 0; s < exportSurfaceURLList.count(); s++ )
 		{
-			m_sceneModel->IndexFromNodeUrl( exportSurfaceURLList[s] );
 			InstanceNode* surfaceNode = m_sceneModel->NodeFromIndex( m_sceneModel->IndexFromNodeUrl( exportSurfaceURLList[s] ) );
 			exportSuraceList.push_back( surfaceNode );
 		}
@@ -1856,7 +1932,7 @@ void MainWindow::Run()
 		m_pPhotonMap->SetConcentratorToWorld( rootSeparatorInstance->GetIntersectionTransform() );
 
 		TLightKit* light = static_cast< TLightKit* > ( lightInstance->GetNode() );
-		QStringList disabledNodes = QString( light->disabledNodes.getValue().getString() ).split( ";", QString::SkipEmptyParts );
+		QSet< QString > disabledNodes = QString( light->disabledNodes.getValue().getString() ).split( ";", QString::SkipEmptyParts ).toSet();
 		QVector< QPair< TShapeKit*, Transform > > surfacesList;
 		trf::ComputeFistStageSurfaceList( rootSeparatorInstance, disabledNodes, &surfacesList );
 		light->ComputeLightSourceArea( m_widthDivisions, m_heightDivisions, surfacesList );
@@ -1868,48 +1944,195 @@ void MainWindow::Run()
 			return;
 		}
 
-		QVector< long > raysPerThread;
-		int maximumValueProgressScale = 100;
-		unsigned long  t1 = m_raysPerIteration / maximumValueProgressScale;
-		for( int progressCount = 0; progressCount < maximumValueProgressScale; ++ progressCount )
-			raysPerThread<< t1;
+		int numberOfThreads = QThread::idealThreadCount();
+		unsigned long raysToTrace = m_distributedTrace.WorkerRays( m_raysPerIteration );
+		if( m_raySource )
+		{
+			if( m_distributedTrace.IsWorker() )
+			{
+				emit Abort( tr( "Run: The rays of a ray file can not be traced by distributed workers." ) );
+				return;
+			}
+			raysToTrace = m_raySource->NumberOfRays();
+		}
+		unsigned long firstRay = 0;
+		QVector< RandomDeviateFactory* > randomDeviateFactoryList = m_pPluginManager->GetRandomDeviateFactories();
+
+		TraceCheckpoint checkpoint;
+		if( m_reproducibleTrace && ( !m_checkpointFileName.isEmpty() || m_resumeCheckpoint ) )
+		{
+			checkpoint.sceneHash = TraceCheckpoint::SceneHash( m_document->GetSceneKit() );
+			checkpoint.randomDeviateName = randomDeviateFactoryList[m_selectedRandomDeviate]->RandomDeviateName();
+			checkpoint.seed = m_randomSeed;
+			checkpoint.workerIndex = m_distributedTrace.WorkerIndex();
+			checkpoint.numberOfWorkers = m_distributedTrace.NumberOfWorkers();
+			checkpoint.runIndex = m_runIndex;
+			checkpoint.raysToTrace = raysToTrace;
+			if( !m_checkpointFileName.isEmpty() )
+				checkpoint.SetFileName( m_distributedTrace.WorkerFileName( m_checkpointFileName ) );
+		}
+
+		InstanceNode* captureSurface = 0;
+		RayFile captureFile;
+		if( !m_captureFileName.isEmpty() )
+		{
+			if( m_resumeCheckpoint )
+			{
+				emit Abort( tr( "Run: A ray tracing that captures rays can not be resumed." ) );
+				return;
+			}
+
+			QModelIndex captureIndex = m_sceneModel->IndexFromNodeUrl( m_captureSurfaceURL );
+			if( captureIndex.isValid() )	captureSurface = m_sceneModel->NodeFromIndex( captureIndex );
+			if( !captureSurface )
+			{
+				emit Abort( tr( "Run: The capture surface is not a valid node." ) );
+				return;
+			}
+
+			QString captureFileName = m_distributedTrace.WorkerFileName( m_captureFileName );
+			if( !captureFile.Create( captureFileName ) )
+			{
+				emit Abort( tr( "Run: The ray file %1 can not be created." ).arg( captureFileName ) );
+				return;
+			}
+		}
+
+		PhotonMapExport* pExportMode = 0;
+		if( !m_pPhotonMap->GetExportMode() )
+		{
+			pExportMode = CreatePhotonMapExport();
+			if( !pExportMode )	return;
+		}
 
-		if( ( t1 * maximumValueProgressScale ) < m_raysPerIteration )	raysPerThread<< ( m_raysPerIteration-( t1* maximumValueProgressScale) );
+		if( m_resumeCheckpoint )
+		{
+			TraceCheckpoint* resumed = m_resumeCheckpoint;
+			m_resumeCheckpoint = 0;
 
+			bool sameRun = ( resumed->runIndex == m_runIndex );
+			if( !checkpoint.IsSameTrace( *resumed ) || ( sameRun && resumed->raysToTrace != raysToTrace ) )
+			{
+				delete resumed;
+				delete pExportMode;
+				emit Abort( tr( "Run: The checkpoint was saved for a different scene or ray tracing parameters." ) );
+				return;
+			}
+
+			//The interrupted run keeps the photons map, and the next run only if the photon map is increased
+			m_tracedChunks = resumed->nextChunk;
+			if( sameRun || m_increasePhotonMap )
+			{
+				QDataStream exportState( resumed->exportState );
+				if( !pExportMode || !pExportMode->RestoreState( exportState ) )
+				{
+					delete resumed;
+					delete pExportMode;
+					emit Abort( tr( "Run: The photon map export can not be restored from the checkpoint." ) );
+					return;
+				}
+
+				if( sameRun )
+				{
+					m_tracedRays = resumed->previousTracedRays;
+					firstRay = resumed->nextRay;
+					numberOfThreads = resumed->numberOfThreads;
+				}
+				else	m_tracedRays = resumed->TracedRays();
+			}
+			delete resumed;
+		}
+
+		if( pExportMode && !m_pPhotonMap->SetExportMode( pExportMode ) )
+		{
+			emit Abort( tr( "Run: The photon map export can not be started with the selected parameters." ) );
+			return;
+		}
+
+		// Each chunk is traced with its own random stream, so the results do not depend on the threads.
+		RayTracingScheduler scheduler( raysToTrace, numberOfThreads );
+		int workerIndex = m_distributedTrace.IsWorker() ? m_distributedTrace.WorkerIndex() : 0;
+		int numberOfWorkers = m_distributedTrace.IsWorker() ? m_distributedTrace.NumberOfWorkers() : 1;
+		scheduler.SetRandomStreams( randomDeviateFactoryList[m_selectedRandomDeviate], m_randomSeed, workerIndex, numberOfWorkers );
+		scheduler.SetStart( firstRay, m_tracedChunks );
+
+		if( !checkpoint.FileName().isEmpty() )
+		{
+			checkpoint.numberOfThreads = numberOfThreads;
+			checkpoint.previousTracedRays = m_tracedRays;
+			checkpoint.SetExportMode( m_pPhotonMap->GetExportMode() );
+			scheduler.SetCheckpoint( &checkpoint, m_checkpointRays );
+		}
+		QVector< RayTracingScheduler* > raysPerThread = scheduler.ThreadsList();
+
+		// Each worker takes its sample points from its own block of the sample sequence.
+		unsigned long long firstSample = (unsigned long long) m_tracedRays;
+		if( m_distributedTrace.IsWorker() )	firstSample += (unsigned long long) m_distributedTrace.WorkerIndex() << 48;
 
 		Transform lightToWorld = tgf::TransformFromSoTransform( lightTransform );
 		lightInstance->SetIntersectionTransform( lightToWorld.GetInverse() );
 
-
+		// The tracing threads tag the photons with their surface index and export coordinates.
+		PhotonSurfaceIndex surfaceIndex;
+		surfaceIndex.AddSurface( lightInstance );
+		surfaceIndex.AddSurfaces( rootSeparatorInstance );
+		PhotonMapExport* exportMode = m_pPhotonMap->GetExportMode();
+		surfaceIndex.SetExportCoordinates( !exportMode || exportMode->IsSaveCoordinatesInGlobalSystemEnabled(),
+				rootSeparatorInstance->GetIntersectionTransform() );
 
 		// Create a progress dialog.
 		QProgressDialog dialog;
-		dialog.setLabelText( QString("Progressing using %1 thread(s)..." ).arg( QThread::idealThreadCount() ) );
+		dialog.setLabelText( QString("Progressing using %1 thread(s)..." ).arg( numberOfThreads ) );
+		dialog.setRange( 0, 100 );
 
 		// Create a QFutureWatcher and conncect signals and slots.
 		QFutureWatcher< void > futureWatcher;
 		QObject::connect(&futureWatcher, SIGNAL(finished()), &dialog, SLOT(reset()));
+		QObject::connect(&dialog, SIGNAL(canceled()), &scheduler, SLOT(Cancel()));
 		QObject::connect(&dialog, SIGNAL(canceled()), &futureWatcher, SLOT(cancel()));
-		QObject::connect(&futureWatcher, SIGNAL(progressRangeChanged(int, int)), &dialog, SLOT(setRange(int, int)));
-		QObject::connect(&futureWatcher, SIGNAL(progressValueChanged(int)), &dialog, SLOT(setValue(int)));
+		QObject::connect(&scheduler, SIGNAL(ProgressValueChanged(int)), &dialog, SLOT(setValue(int)));
+
+		LightCellSampling lightSampling( raycastingSurface->GetValidAreasCoord() );
+		lightSampling.SetStratified( m_stratifiedLight );
+		if( m_lightImportance )	lightSampling.SetImportance( m_lightCellStatistics, m_lightUniformFraction );
+		LightCellSampling* pLightSampling = ( m_stratifiedLight || m_lightImportance ) ? &lightSampling : 0;
 
 		QMutex mutex;
 		QMutex mutexPhotonMap;
 		QFuture< void > photonMap;
 		if( transmissivity )
-			 photonMap = QtConcurrent::map( raysPerThread, RayTracer(  rootSeparatorInstance,
+		{
+			RayTracer rayTracer(  rootSeparatorInstance,
 							 lightInstance, raycastingSurface, sunShape, lightToWorld,
 							 transmissivity,
 							 *m_rand,
 							 &mutex, m_pPhotonMap, &mutexPhotonMap,
-							 exportSuraceList ) );
-
+							 exportSuraceList );
+			rayTracer.SetWeightedPhotons( m_rouletteWeight );
+			if( captureSurface )	rayTracer.SetRayCapture( captureSurface, &captureFile );
+			rayTracer.SetRaySource( m_raySource );
+			rayTracer.SetFirstSample( firstSample );
+			rayTracer.SetLightSampling( pLightSampling );
+			rayTracer.SetSurfaceIndex( &surfaceIndex );
+			rayTracer.SetPhotonTally( exportMode ? exportMode->GetPhotonTally() : 0 );
+			photonMap = QtConcurrent::map( raysPerThread, rayTracer );
+		}
 		else
-			photonMap = QtConcurrent::map( raysPerThread, RayTracerNoTr(  rootSeparatorInstance,
+		{
+			RayTracerNoTr rayTracer(  rootSeparatorInstance,
 						lightInstance, raycastingSurface, sunShape, lightToWorld,
 						*m_rand,
 						&mutex, m_pPhotonMap, &mutexPhotonMap,
-						exportSuraceList ) );
+						exportSuraceList );
+			rayTracer.SetWeightedPhotons( m_rouletteWeight );
+			if( captureSurface )	rayTracer.SetRayCapture( captureSurface, &captureFile );
+			rayTracer.SetRaySource( m_raySource );
+			rayTracer.SetFirstSample( firstSample );
+			rayTracer.SetLightSampling( pLightSampling );
+			rayTracer.SetSurfaceIndex( &surfaceIndex );
+			rayTracer.SetPhotonTally( exportMode ? exportMode->GetPhotonTally() : 0 );
+			photonMap = QtConcurrent::map( raysPerThread, rayTracer );
+		}
 
 		futureWatcher.setFuture( photonMap );
 
@@ -1917,7 +2140,9 @@ void MainWindow::Run()
 		dialog.exec();
 		futureWatcher.waitForFinished();
 
-		m_tracedRays += m_raysPerIteration;
+		m_tracedRays += scheduler.TracedRays();
+		m_tracedChunks = scheduler.NextChunkIndex();
+		if( m_lightImportance )	lightSampling.UpdateStatistics( &m_lightCellStatistics );
 
 		if( exportSuraceList.count() < 1 )
 			ShowRaysIn3DView();
@@ -1931,9 +2156,44 @@ void MainWindow::Run()
 		double irradiance = sunShape->GetIrradiance();
 		double inputAperture = raycastingSurface->GetValidArea();
 		double wPhoton = ( inputAperture * irradiance ) / m_tracedRays;
+		if( m_raySource )	wPhoton = m_raySource->PowerPerRay() * m_raySource->NumberOfRays() / m_tracedRays;
+
+		// The export can take a while to write the last photons and build its index, out of the GUI thread.
+		{
+			QProgressDialog endDialog;
+			endDialog.setLabelText( tr( "Saving the photon map..." ) );
+			endDialog.setRange( 0, 0 );
+			endDialog.setCancelButton( 0 );
+
+			QFutureWatcher< void > endWatcher;
+			QObject::connect( &endWatcher, SIGNAL( finished() ), &endDialog, SLOT( reset() ) );
+			endWatcher.setFuture( QtConcurrent::run( m_pPhotonMap, &TPhotonMap::EndStore, wPhoton ) );
+
+			endDialog.exec();
+			endWatcher.waitForFinished();
+		}
 
-		m_pPhotonMap->EndStore( wPhoton );
+		if( captureSurface )
+		{
+			double rayPower = m_raySource ? m_raySource->PowerPerRay() : ( inputAperture * irradiance ) / scheduler.TracedRays();
+			if( !captureFile.Close( rayPower, scheduler.TracedRays() ) )
+				emit Abort( tr( "Run: The captured rays can not be written." ) );
+		}
 
+		if( !checkpoint.FileName().isEmpty() && !checkpoint.Save( m_pPhotonMap, scheduler.TracedRays(), m_tracedChunks ) )
+			emit Abort( tr( "Run: The ray tracing checkpoint can not be saved." ) );
+
+		if( m_distributedTrace.IsWorker() )
+		{
+			QMap< QString, QString > exportTypeParameters = m_pExportModeSettings->modeTypeParameters;
+			QString exportFile = exportTypeParameters.value( QLatin1String( "ExportFile" ),
+					exportTypeParameters.value( QLatin1String( "DBFilename" ), QLatin1String( "PhotonMap" ) ) );
+			m_distributedTrace.SetExport( m_pExportModeSettings->modeTypeName,
+					exportTypeParameters.value( QLatin1String( "ExportDirectory" ) ), exportFile );
+			m_distributedTrace.SetResults( m_tracedRays, inputAperture, irradiance );
+			if( !m_distributedTrace.WriteSummary() )
+				emit Abort( tr( "Run: The distributed ray tracing summary can not be written." ) );
+		}
 	}
 
 	QDateTime endTime = QDateTime::currentDateTime();
@@ -1969,9 +2229,12 @@ void MainWindow::RunFluxAnalysis( QString nodeURL, QString surfaceSide, unsigned
 
 	FluxAnalysis fluxAnalysis( coinScene, *m_sceneModel, rootSeparatorInstance, m_widthDivisions, m_heightDivisions, m_rand );
 
+	fluxAnalysis.SetWeightedPhotons( m_rouletteWeight );
+	fluxAnalysis.SetLightSampling( m_stratifiedLight, m_lightImportance, m_lightUniformFraction );
+	fluxAnalysis.SetRandomStreams( randomDeviateFactoryList[m_selectedRandomDeviate], m_randomSeed );
 	fluxAnalysis.RunFluxAnalysis( nodeURL, surfaceSide, nOfRays, false, heightDivisions, widthDivisions );
 
-	int** photonCounts = fluxAnalysis.photonCountsValue();
+	double** photonCounts = fluxAnalysis.photonCountsValue();
 	if( !photonCounts || photonCounts == 0 )
 	{
 		emit Abort( tr( "RunFluxAnalysis: Some parameter is not correctly defined.") );
@@ -1981,6 +2244,134 @@ void MainWindow::RunFluxAnalysis( QString nodeURL, QString surfaceSide, unsigned
 	fluxAnalysis.ExportAnalysis( directory, fileName, saveCoords );
 }
 
+/*
+ * Runs ray trace batches of \a raysPerBatch rays to calculate a flux distribution map in the surface of the node \a nodeURL
+ * related to the side \a surfaceSide until the relative standard error of the \a metric ("PeakFlux" or "TotalPower") is
+ * lower than \a relativeError or \a maximumNumberOfRays rays have been traced.
+ * The results will save in a file \a directory \a QString fileName, the coordinates of the cells depending on the variable \a saveCoord.
+ * The metric value, its confidence interval, the relative error and the traced rays are saved in the file \a fileName
+ * followed by "_convergence".
+ *
+ * Returns true if the metric converged.
+ */
+bool MainWindow::RunConvergentFluxAnalysis( QString nodeURL, QString surfaceSide, unsigned int raysPerBatch, unsigned int maximumNumberOfRays, QString metric, double relativeError,
+		int heightDivisions, int widthDivisions, QString directory, QString fileName, bool saveCoords )
+{
+	FluxAnalysis::ConvergenceMetric convergenceMetric;
+	if( metric == QLatin1String( "PeakFlux" ) )	convergenceMetric = FluxAnalysis::PeakFlux;
+	else if( metric == QLatin1String( "TotalPower" ) )	convergenceMetric = FluxAnalysis::TotalPower;
+	else
+	{
+		emit Abort( tr( "RunConvergentFluxAnalysis: Unknown convergence metric \"%1\"." ).arg( metric ) );
+		return false;
+	}
+
+	TSceneKit* coinScene = m_document->GetSceneKit();
+	if ( !coinScene )  return false;
+
+	TLightKit* lightKit = static_cast< TLightKit* >( coinScene->getPart( "lightList[0]", false ) );
+	if ( !lightKit )  return false;
+
+	InstanceNode*  rootSeparatorInstance = m_sceneModel->NodeFromIndex( sceneModelView->rootIndex() );
+	if ( !rootSeparatorInstance )  return false;
+
+	QVector< RandomDeviateFactory* > randomDeviateFactoryList = m_pPluginManager->GetRandomDeviateFactories();
+	//Check if there is a random generator selected;
+	if( m_selectedRandomDeviate == -1 )
+	{
+		if( randomDeviateFactoryList.size() > 0 ) m_selectedRandomDeviate = 0;
+		else	return false;
+	}
+
+	//Create the random generator
+	if( !m_rand )	m_rand =  randomDeviateFactoryList[m_selectedRandomDeviate]->CreateRandomDeviate();
+
+	FluxAnalysis fluxAnalysis( coinScene, *m_sceneModel, rootSeparatorInstance, m_widthDivisions, m_heightDivisions, m_rand );
+
+	fluxAnalysis.SetWeightedPhotons( m_rouletteWeight );
+	fluxAnalysis.SetLightSampling( m_stratifiedLight, m_lightImportance, m_lightUniformFraction );
+	fluxAnalysis.SetRandomStreams( randomDeviateFactoryList[m_selectedRandomDeviate], m_randomSeed );
+	bool converged = fluxAnalysis.RunConvergentFluxAnalysis( nodeURL, surfaceSide, raysPerBatch, maximumNumberOfRays,
+			convergenceMetric, relativeError, heightDivisions, widthDivisions );
+
+	double** photonCounts = fluxAnalysis.photonCountsValue();
+	if( !photonCounts || photonCounts == 0 )
+	{
+		emit Abort( tr( "RunConvergentFluxAnalysis: Some parameter is not correctly defined.") );
+		return false;
+	}
+
+	fluxAnalysis.ExportAnalysis( directory, fileName, saveCoords );
+	if( !fluxAnalysis.ExportConvergence( directory, fileName, metric, converged ) )
+	{
+		emit Abort( tr( "RunConvergentFluxAnalysis: The convergence results can not be saved.") );
+		return false;
+	}
+
+	return ( converged );
+}
+
+/*
+ * Runs a single ray trace of \a nOfRays rays to calculate the flux distribution maps of all the targets added with
+ * AddFluxAnalysisTarget. The map of each target is saved in \a directory in a file named \a fileName followed by the
+ * number of the target, with the coordinates of the cells depending on \a saveCoords, together with a summary file.
+ */
+void MainWindow::RunMultiTargetFluxAnalysis( unsigned int nOfRays, QString directory, QString fileName, bool saveCoords )
+{
+	if( m_fluxTargets.size() < 1 )
+	{
+		emit Abort( tr( "RunMultiTargetFluxAnalysis: There are not flux analysis targets defined.") );
+		return;
+	}
+
+	TSceneKit* coinScene = m_document->GetSceneKit();
+	if ( !coinScene )  return;
+
+	TLightKit* lightKit = static_cast< TLightKit* >( coinScene->getPart( "lightList[0]", false ) );
+	if ( !lightKit )  return;
+
+	InstanceNode*  rootSeparatorInstance = m_sceneModel->NodeFromIndex( sceneModelView->rootIndex() );
+	if ( !rootSeparatorInstance )  return;
+
+	QVector< RandomDeviateFactory* > randomDeviateFactoryList = m_pPluginManager->GetRandomDeviateFactories();
+	//Check if there is a random generator selected;
+	if( m_selectedRandomDeviate == -1 )
+	{
+		if( randomDeviateFactoryList.size() > 0 ) m_selectedRandomDeviate = 0;
+		else	return;
+	}
+
+	//Create the random generator
+	if( !m_rand )	m_rand =  randomDeviateFactoryList[m_selectedRandomDeviate]->CreateRandomDeviate();
+
+	FluxAnalysis fluxAnalysis( coinScene, *m_sceneModel, rootSeparatorInstance, m_widthDivisions, m_heightDivisions, m_rand );
+	for( int t = 0; t < m_fluxTargets.size(); t++ )
+	{
+		if( !fluxAnalysis.AddTarget( m_fluxTargets[t].surfaceURL, m_fluxTargets[t].surfaceSide,
+				m_fluxTargets[t].heightDivisions, m_fluxTargets[t].widthDivisions ) )
+		{
+			emit Abort( tr( "RunMultiTargetFluxAnalysis: The side %1 of the surface %2 is not a valid target." )
+					.arg( m_fluxTargets[t].surfaceSide, m_fluxTargets[t].surfaceURL ) );
+			return;
+		}
+	}
+
+	fluxAnalysis.SetWeightedPhotons( m_rouletteWeight );
+	fluxAnalysis.SetLightSampling( m_stratifiedLight, m_lightImportance, m_lightUniformFraction );
+	fluxAnalysis.SetRandomStreams( randomDeviateFactoryList[m_selectedRandomDeviate], m_randomSeed );
+	fluxAnalysis.RunMultiTargetFluxAnalysis( nOfRays, false );
+
+	double** photonCounts = fluxAnalysis.photonCountsValue();
+	if( !photonCounts || photonCounts == 0 )
+	{
+		emit Abort( tr( "RunMultiTargetFluxAnalysis: Some parameter is not correctly defined.") );
+		return;
+	}
+
+	if( !fluxAnalysis.ExportTargetsAnalysis( directory, fileName, saveCoords ) )
+		emit Abort( tr( "RunMultiTargetFluxAnalysis: The flux distributions can not be exported." ) );
+}
+
 /*!
  * Saves current tonatiuh model into \a fileName file.
  */
@@ -1992,9 +2383,10 @@ void MainWindow::SaveAs( QString fileName )
 		return;
 	}
 	QFileInfo fileInfo (fileName );
-	if( fileInfo.completeSuffix() != QLatin1String( "tnh" ) )
+	if( ( fileInfo.suffix().compare( QLatin1String( "tnh" ), Qt::CaseInsensitive ) != 0 ) &&
+			( fileInfo.suffix().compare( QLatin1String( "tnhb" ), Qt::CaseInsensitive ) != 0 ) )
 	{
-		emit Abort( tr( "SaveAs: The file defined is not a tonatiuh file. The suffix must be tnh.") );
+		emit Abort( tr( "SaveAs: The file defined is not a tonatiuh file. The suffix must be tnh or tnhb.") );
 		return;
 	}
 	SaveFile( fileName );
@@ -2027,6 +2419,46 @@ void MainWindow::SetAimingPointRelative()
 	SetAimingPointRelativity( true );
 }
 
+/*!
+ * Saves the ray tracing progress into \a fileName each time \a checkpointRays rays have been stored and when
+ * each run ends. The checkpoint can only be resumed if the rays are traced with per-chunk random streams,
+ * so the seeded ray tracing is enabled.
+ */
+void MainWindow::SetCheckpoint( QString fileName, unsigned int checkpointRays )
+{
+	if( fileName.isEmpty() || checkpointRays < 1 )
+	{
+		emit Abort( tr( "SetCheckpoint: Defined checkpoint is not valid." ) );
+		return;
+	}
+
+	m_checkpointFileName = fileName;
+	m_checkpointRays = checkpointRays;
+	m_reproducibleTrace = true;
+}
+
+/*!
+ * Sets this Tonatiuh as the worker \a workerIndex of a ray tracing distributed in \a numberOfWorkers processes.
+ * The worker traces its share of the rays per iteration with the stream \a workerIndex of the random generator
+ * started with \a seed, exports the photons with the "_worker<index>" suffix and writes a summary to merge the
+ * results.
+ */
+void MainWindow::SetDistributedWorker( int workerIndex, int numberOfWorkers, unsigned long seed )
+{
+	if( numberOfWorkers < 1 || workerIndex < 0 || workerIndex >= numberOfWorkers )
+	{
+		emit Abort( tr( "SetDistributedWorker: Defined worker is not valid." ) );
+		return;
+	}
+
+	m_distributedTrace = DistributedTrace( workerIndex, numberOfWorkers, seed );
+	m_reproducibleTrace = true;
+	m_randomSeed = seed;
+
+	delete m_rand;
+	m_rand = 0;
+}
+
 /*!
  *Sets to export all surfaces photons.
  */
@@ -2122,6 +2554,28 @@ void MainWindow::SetIncreasePhotonMap( bool increase )
 	m_increasePhotonMap = increase;
 }
 
+/*!
+ * Sets how the rays are distributed over the light cells. If \a stratified is true, the rays cycle through the
+ * cells instead of taking them at random. If \a importance is true, each run learns the fraction of the rays of each
+ * cell that reach the exported surfaces and the next runs trace more rays from the cells with more hits.
+ * A \a uniformFraction of the rays is kept uniform. The photons carry the weights that keep the results unbiased.
+ *
+ * Calling it again restarts the learning.
+ */
+void MainWindow::SetLightSampling( bool stratified, bool importance, double uniformFraction )
+{
+	if( importance && ( uniformFraction <= 0.0 || uniformFraction >= 1.0 ) )
+	{
+		emit Abort( tr( "SetLightSampling: The uniform fraction must be in the interval (0,1)." ) );
+		return;
+	}
+
+	m_stratifiedLight = stratified;
+	m_lightImportance = importance;
+	if( importance )	m_lightUniformFraction = uniformFraction;
+	m_lightCellStatistics.clear();
+}
+
 /*!
  * Sets \a nodeName as the current node name.
  */
@@ -2152,6 +2606,10 @@ void MainWindow::SetPhotonMapBufferSize( unsigned int nPhotons )
 
 /*!
  *Sets the random number generator type, \a typeName, for ray tracing.
+ *
+ * With a generator with substreams, such as "Common Random Numbers", each primary ray takes the substream defined by
+ * the seed of SetRandomSeed and its ray number. Ray tracings of two variants of a scene then trace the same primary
+ * rays, and their differences converge with fewer rays.
  */
 void MainWindow::SetRandomDeviateType( QString typeName )
 {
@@ -2178,6 +2636,57 @@ void MainWindow::SetRandomDeviateType( QString typeName )
 
 }
 
+/*!
+ * Traces the rays with random streams defined by \a seed. The rays are split into chunks whose size
+ * depends only on the number of rays, each chunk uses its own stream and the photons are stored in
+ * chunk order, so the ray tracing gives the same results with any number of threads.
+ */
+void MainWindow::SetRandomSeed( unsigned long seed )
+{
+	m_randomSeed = seed;
+	m_reproducibleTrace = true;
+}
+
+/*!
+ * Stops the rays that cross the surface \a surfaceURL and saves them in the ray file \a rayFileName, to trace them
+ * later with SetRaySource into the optics after the surface. The surface must have a virtual material.
+ * An empty \a surfaceURL disables the capture.
+ */
+void MainWindow::SetRayCapture( QString surfaceURL, QString rayFileName )
+{
+	if( surfaceURL.isEmpty() )
+	{
+		m_captureSurfaceURL.clear();
+		m_captureFileName.clear();
+		return;
+	}
+
+	if( rayFileName.isEmpty() )
+	{
+		emit Abort( tr( "SetRayCapture: There is no ray file defined." ) );
+		return;
+	}
+
+	QModelIndex nodeIndex = m_sceneModel->IndexFromNodeUrl( surfaceURL );
+	InstanceNode* surfaceNode = nodeIndex.isValid() ? m_sceneModel->NodeFromIndex( nodeIndex ) : 0;
+	if( !surfaceNode || !surfaceNode->GetNode()->getTypeId().isDerivedFrom( TShapeKit::getClassTypeId() ) )
+	{
+		emit Abort( tr( "SetRayCapture: Defined node url is not a valid surface." ) );
+		return;
+	}
+
+	TShapeKit* shapeKit = static_cast< TShapeKit* >( surfaceNode->GetNode() );
+	TMaterial* material = static_cast< TMaterial* >( shapeKit->getPart( "material", false ) );
+	if( !material || QString( material->getTypeId().getName().getString() ) != QLatin1String( "MaterialVirtual" ) )
+	{
+		emit Abort( tr( "SetRayCapture: The capture surface must have a virtual material." ) );
+		return;
+	}
+
+	m_captureSurfaceURL = surfaceURL;
+	m_captureFileName = rayFileName;
+}
+
 /*!
  * Sets the ray casting surface grid elemets to \a widthDivisions x \a heightDivisions.
  */
@@ -2185,6 +2694,37 @@ void MainWindow::SetRayCastingGrid( int widthDivisions, int heightDivisions )
 {
 	m_widthDivisions = widthDivisions;
 	m_heightDivisions = heightDivisions;
+	m_lightCellStatistics.clear();
+}
+
+/*!
+ * Traces the rays saved in the ray file \a rayFileName instead of the rays of the light. Each run traces all the
+ * rays of the file with the power they had when they were captured. An empty \a rayFileName traces the light rays.
+ */
+void MainWindow::SetRaySource( QString rayFileName )
+{
+	delete m_raySource;
+	m_raySource = 0;
+	if( rayFileName.isEmpty() )	return;
+
+	RayFile* rayFile = new RayFile;
+	if( !rayFile->Open( rayFileName ) || rayFile->NumberOfRays() < 1 )
+	{
+		delete rayFile;
+		emit Abort( tr( "SetRaySource: The file %1 is not a valid ray file or it has no rays." ).arg( rayFileName ) );
+		return;
+	}
+	m_raySource = rayFile;
+}
+
+/*!
+ * Sets \a maximumElements as the maximum number of rays and the maximum number of photons drawn in the 3D view.
+ * If the photon map stores more elements, they are decimated keeping the proportion of elements of each surface.
+ * Zero means that all the elements are drawn.
+ */
+void MainWindow::SetRaysDrawingBudget( unsigned int maximumElements )
+{
+	m_drawingBudget = maximumElements;
 }
 
 /*!
@@ -2386,6 +2926,23 @@ void MainWindow::SetValue( QString nodeUrl, QString parameter, QString value )
 	SetParameterValue( node, parameter, value );
 }
 
+/*!
+ * If \a enabled is true, each ray carries an energy weight that is reduced by the surface reflectance and the
+ * atmospheric transmittance instead of being absorbed stochastically. Rays whose weight falls below
+ * \a rouletteWeight are killed by Russian roulette. The exported photon maps include the weight of each photon.
+ */
+void MainWindow::SetWeightedPhotons( bool enabled, double rouletteWeight )
+{
+	if( enabled && ( rouletteWeight <= 0.0 || rouletteWeight > 1.0 ) )
+	{
+		emit Abort( tr( "SetWeightedPhotons: The roulette weight must be in the interval (0,1]." ) );
+		return;
+	}
+
+	if( enabled )	m_rouletteWeight = rouletteWeight;
+	else	m_rouletteWeight = 0.0;
+}
+
 
 //Manipulators actions
 void MainWindow::SoTransform_to_SoCenterballManip()
@@ -3005,6 +3562,7 @@ PhotonMapExport* MainWindow::CreatePhotonMapExport() const
 	pExportMode->SetSavePreviousNextPhotonsID( m_pExportModeSettings->exportPreviousNextPhotonID );
 	pExportMode->SetSaveSideEnabled( m_pExportModeSettings->exportIntersectionSurfaceSide );
     pExportMode->SetSaveSurfacesIDEnabled( m_pExportModeSettings->exportSurfaceID );
+	pExportMode->SetSaveWeightEnabled( ( m_rouletteWeight > 0.0 ) || m_raySource || m_lightImportance );
 
 
     if( m_pExportModeSettings->exportSurfaceNodeList.count() > 0 )
@@ -3016,7 +3574,10 @@ PhotonMapExport* MainWindow::CreatePhotonMapExport() const
     QMap< QString, QString >::const_iterator i = exportTypeParameters.constBegin();
     while( i != exportTypeParameters.constEnd() )
     {
-    	pExportMode->SetSaveParameterValue( i.key(), i.value() );
+    	if( i.key() == QLatin1String( "ExportFile" ) || i.key() == QLatin1String( "DBFilename" ) )
+    		pExportMode->SetSaveParameterValue( i.key(), m_distributedTrace.WorkerFileName( i.value() ) );
+    	else
+    		pExportMode->SetSaveParameterValue( i.key(), i.value() );
         ++i;
     }
 
@@ -3217,7 +3778,9 @@ bool MainWindow::ReadyForRaytracing( InstanceNode*& rootSeparatorInstance,
 	}
 
 	//Create the random generator
-	if( !m_rand )	m_rand =  randomDeviateFactoryList[m_selectedRandomDeviate]->CreateRandomDeviate();
+	if( !m_rand && m_distributedTrace.IsWorker() )
+		m_rand = randomDeviateFactoryList[m_selectedRandomDeviate]->CreateRandomDeviate( m_distributedTrace.Seed(), m_distributedTrace.WorkerIndex() );
+	else if( !m_rand )	m_rand =  randomDeviateFactoryList[m_selectedRandomDeviate]->CreateRandomDeviate();
 
 
 	//Create the photon map where photons are going to be stored
@@ -3851,22 +4414,30 @@ void MainWindow::ShowRaysIn3DView()
 
 	if( m_drawRays || m_drawPhotons )
 	{
-		SoSeparator* rays = new SoSeparator;
-		rays->setName( "Rays" );
+		std::vector< SbVec3f > points;
+		std::vector< SbVec3f > rayVertices;
+		std::vector< int32_t > rayLengths;
 
-		if( m_drawPhotons )
-		{
-			SoSeparator* points = trf::DrawPhotonMapPoints( *m_pPhotonMap );
-			rays->addChild(points);
-		}
+		// The elements to draw are selected out of the GUI thread.
+		QProgressDialog dialog;
+		dialog.setLabelText( tr( "Preparing rays drawing..." ) );
+		dialog.setRange( 0, 0 );
+		dialog.setCancelButton( 0 );
 
-		if( m_drawRays )
-		{
+		QFutureWatcher< void > futureWatcher;
+		QObject::connect( &futureWatcher, SIGNAL( finished() ), &dialog, SLOT( reset() ) );
+		futureWatcher.setFuture( QtConcurrent::run( trf::ComputePhotonMapDrawing, m_pPhotonMap, m_drawingBudget,
+				m_drawPhotons ? &points : 0, m_drawRays ? &rayVertices : 0, &rayLengths ) );
 
-			SoSeparator* currentRays = trf::DrawPhotonMapRays( *m_pPhotonMap, m_tracedRays );
-			if( currentRays )	rays->addChild( currentRays );
+		dialog.exec();
+		futureWatcher.waitForFinished();
+
+		SoSeparator* rays = new SoSeparator;
+		rays->setName( "Rays" );
+
+		if( m_drawPhotons )	rays->addChild( trf::DrawPhotonMapPoints( points ) );
+		if( m_drawRays )	rays->addChild( trf::DrawPhotonMapRays( rayVertices, rayLengths ) );
 
-		}
 		m_graphicsRoot->AddRays( rays );
 
 		actionDisplayRays->setEnabled( true );
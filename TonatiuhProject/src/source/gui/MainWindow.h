@@ -41,6 +41,9 @@ Juana Amieva, Azael Mancillas, Cesar Cantu.
 
 #include <Inventor/SbVec3f.h>
 
+#include "DistributedTrace.h"
+#include "FluxAnalysis.h"
+#include "LightCellSampling.h"
 #include "tgc.h"
 
 #include "ui_mainwindow.h"
@@ -55,6 +58,7 @@ class QDir;
 class QUndoStack;
 class QUndoView;
 class RandomDeviate;
+class RayFile;
 class SoDragger;
 class SoSelection;
 class SoSeparator;
@@ -66,6 +70,7 @@ class TPhotonMap;
 class PhotonToMemory;
 class TShapeFactory;
 class TSunShape;
+class TraceCheckpoint;
 class TTrackerFactory;
 class TTransmissivity;
 class SoCamera;
@@ -96,9 +101,11 @@ signals:
 
 public slots:
 	void AddExportSurfaceURL( QString nodeURL );
+	void AddFluxAnalysisTarget( QString nodeURL, QString surfaceSide, int heightDivisions, int widthDivisions );
 	void ChangeSunPosition( double azimuth, double elevation );
 	void ChangeSunPosition( int year, int month, int day, double hours, double minutes, double seconds, double latitude, double longitude );
 	void Clear();
+	void ClearFluxAnalysisTargets();
 	void Copy();
 	void Copy( QString nodeURL );
 	void CreateGroupNode();
@@ -118,14 +125,20 @@ public slots:
 	void Paste( QString nodeURL, QString pasteType = QString( "Shared" ) );
 	void PasteCopy();
 	void PasteLink();
+	void ResumeFromCheckpoint( QString fileName );
 	void Run();
 	void RunFluxAnalysis( QString nodeURL, QString surfaceSide, unsigned int nOfRays, int heightDivisions, int widthDivisions, QString directory, QString fileName, bool saveCoords );
+	bool RunConvergentFluxAnalysis( QString nodeURL, QString surfaceSide, unsigned int raysPerBatch, unsigned int maximumNumberOfRays, QString metric, double relativeError,
+			int heightDivisions, int widthDivisions, QString directory, QString fileName, bool saveCoords );
+	void RunMultiTargetFluxAnalysis( unsigned int nOfRays, QString directory, QString fileName, bool saveCoords );
 	bool Save();
 	void SaveComponent( QString componentFileName  );
 	void SaveAs( QString fileName );
     void SelectNode( QString nodeUrl );
 	void SetAimingPointAbsolute();
 	void SetAimingPointRelative();
+	void SetCheckpoint( QString fileName, unsigned int checkpointRays );
+	void SetDistributedWorker( int workerIndex, int numberOfWorkers, unsigned long seed );
 	void SetExportAllPhotonMap();
 	void SetExportCoordinates( bool enabled, bool global );
 	void SetExportIntersectionSurface( bool enabled );
@@ -134,10 +147,15 @@ public slots:
 	void SetExportPreviousNextPhotonID( bool enabled );
 	void SetExportTypeParameterValue( QString parameterName, QString parameterValue );
     void SetIncreasePhotonMap( bool increase );
+    void SetLightSampling( bool stratified, bool importance, double uniformFraction );
     void SetNodeName( QString nodeName );
     void SetPhotonMapBufferSize( unsigned int nPhotons );
     void SetRandomDeviateType( QString typeName );
+    void SetRandomSeed( unsigned long seed );
+    void SetRayCapture( QString surfaceURL, QString rayFileName );
     void SetRayCastingGrid( int widthDivisions, int heightDivisions );
+    void SetRaySource( QString rayFileName );
+    void SetRaysDrawingBudget( unsigned int maximumElements );
     void SetRaysDrawingOptions( bool drawRays, bool drawPhotons );
     void SetRaysPerIteration( unsigned int rays );
     void SetSunshape( QString sunshapeType );
@@ -145,6 +163,7 @@ public slots:
     void SetTransmissivity( QString transmissivityType );
     void SetTransmissivityParameter( QString parameter, QString value );
     void SetValue( QString nodeUrl, QString parameter, QString value );
+    void SetWeightedPhotons( bool enabled, double rouletteWeight );
 
 protected:
     void closeEvent( QCloseEvent* event );
@@ -292,11 +311,29 @@ private:
 
     unsigned long m_tracedRays;
     unsigned long m_raysPerIteration;
+    DistributedTrace m_distributedTrace;
+    bool m_reproducibleTrace;
+    unsigned long m_randomSeed;
+    unsigned long m_tracedChunks;
+    unsigned long m_runIndex;
+    QString m_checkpointFileName;
+    unsigned long m_checkpointRays;
+    TraceCheckpoint* m_resumeCheckpoint;
+    double m_rouletteWeight;
+    QString m_captureSurfaceURL;
+    QString m_captureFileName;
+    RayFile* m_raySource;
+    bool m_stratifiedLight;
+    bool m_lightImportance;
+    double m_lightUniformFraction;
+    LightCellStatistics m_lightCellStatistics;
+    QVector< FluxAnalysisTarget > m_fluxTargets;
     int m_heightDivisions;
     int m_widthDivisions;
 
     bool m_drawPhotons;
     bool m_drawRays;
+    unsigned long m_drawingBudget;
 
     int m_gridXElements;
     int m_gridZElements;
@@ -49,7 +49,8 @@ PhotonMapExport::PhotonMapExport()
  m_savePowerPerPhoton( false ),
  m_savePrevNexID( false ),
  m_saveSide( false ),
- m_saveSurfaceID( false )
+ m_saveSurfaceID( false ),
+ m_saveWeight( false )
 {
 
 }
@@ -62,6 +63,37 @@ PhotonMapExport::~PhotonMapExport()
 
 }
 
+/*!
+ * Returns the tally where the ray tracing counts the photons instead of storing them, or null if the export
+ * mode saves the photons.
+ */
+PhotonTally* PhotonMapExport::GetPhotonTally()
+{
+	return ( 0 );
+}
+
+/*!
+ * Restores the export state saved with SaveState from \a in, so the export continues where the checkpoint was saved.
+ * The photons exported after the checkpoint are discarded.
+ *
+ * Returns false if the export type does not support checkpoints or the state is not valid.
+ */
+bool PhotonMapExport::RestoreState( QDataStream& /*in*/ )
+{
+	return ( false );
+}
+
+/*!
+ * Saves to \a out the state needed to continue the export from this point. The photons stored until now must
+ * be already saved with SavePhotonMap.
+ *
+ * Returns false if the export type does not support checkpoints.
+ */
+bool PhotonMapExport::SaveState( QDataStream& /*out*/ ) const
+{
+	return ( false );
+}
+
 /*!
  * Sets the transformation to change from concentrator coordinates to world coordinates.
  */
@@ -96,6 +128,14 @@ void PhotonMapExport::SetSaveCoordinatesInGlobalSystemEnabled( bool enabled )
 	m_saveCoordinatesInGlobal = enabled;
 }
 
+/*!
+ * Returns true if the photons coordinates are exported in the scene global system.
+ */
+bool PhotonMapExport::IsSaveCoordinatesInGlobalSystemEnabled() const
+{
+	return ( m_saveCoordinatesInGlobal );
+}
+
 /*!
  *If \a enabled is true, the identifier of the previous and next photons will be exported.
  */
@@ -129,6 +169,14 @@ void  PhotonMapExport::SetSaveSurfacesURLList( QStringList surfacesURLList  )
 	m_saveSurfacesURLList = surfacesURLList;
 }
 
+/*!
+ * Sets enabled to save the photons weight. The power of each photon is its weight multiplied by the power per photon.
+ */
+void PhotonMapExport::SetSaveWeightEnabled( bool enabled )
+{
+	m_saveWeight = enabled;
+}
+
 /*!
  * Sets the sceneModel to export mode.
  */
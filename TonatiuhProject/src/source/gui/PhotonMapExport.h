@@ -41,10 +41,12 @@ Juana Amieva, Azael Mancillas, Cesar Cantu.
 
 #include <vector>
 
+#include <QDataStream>
 #include <QStringList>
 
 #include "Photon.h"
 
+class PhotonTally;
 class SceneModel;
 
 class PhotonMapExport
@@ -55,7 +57,11 @@ public:
 	virtual ~PhotonMapExport();
 
 	virtual void EndExport() = 0;
+	virtual PhotonTally* GetPhotonTally();
+	bool IsSaveCoordinatesInGlobalSystemEnabled() const;
+	virtual bool RestoreState( QDataStream& in );
 	virtual void SavePhotonMap( std::vector < Photon* > raysLists ) = 0;
+	virtual bool SaveState( QDataStream& out ) const;
 	void SetConcentratorToWorld( Transform concentratorToWorld );
 	virtual void SetPowerPerPhoton( double wPhoton ) = 0;
 
@@ -67,6 +73,7 @@ public:
 	void SetSaveSideEnabled( bool enabled );
 	void SetSaveSurfacesIDEnabled( bool enabled );
 	void SetSaveSurfacesURLList( QStringList surfacesURLList );
+	void SetSaveWeightEnabled( bool enabled );
 	void SetSceneModel( SceneModel& sceneModel );
 	virtual bool StartExport() = 0;
 
@@ -80,6 +87,7 @@ protected:
 	bool m_savePrevNexID;
 	bool m_saveSide;
 	bool m_saveSurfaceID;
+	bool m_saveWeight;
 	QStringList m_saveSurfacesURLList;
 
 };
@@ -52,6 +52,7 @@ RayTraceDialog::RayTraceDialog( QWidget * parent, Qt::WindowFlags f )
 :QDialog ( parent, f ),
  m_drawPhotons( false ),
  m_drawRays( false ),
+ m_drawingBudget( 100000 ),
  m_heightDivisions( 200 ),
  m_increasePhotonMap( false ),
  m_numRays( 0 ),
@@ -72,12 +73,13 @@ RayTraceDialog::RayTraceDialog( QWidget * parent, Qt::WindowFlags f )
 RayTraceDialog::RayTraceDialog( int numRays,
 		QVector< RandomDeviateFactory* > randomFactoryList, int selectedRandomFactory,
 		int widthDivisions, int heightDivisions,
-		bool drawRays, bool drawPhotons,
+		bool drawRays, bool drawPhotons, int drawingBudget,
 		int photonMapSize, bool increasePhotonMap,
 		QWidget * parent, Qt::WindowFlags f )
 :QDialog ( parent, f ),
  m_drawPhotons( drawPhotons ),
  m_drawRays( drawRays ),
+ m_drawingBudget( drawingBudget ),
  m_heightDivisions( heightDivisions ),
  m_increasePhotonMap( increasePhotonMap ),
  m_numRays( numRays ),
@@ -101,6 +103,7 @@ RayTraceDialog::RayTraceDialog( int numRays,
 
 	showRaysCheck->setChecked( m_drawRays );
 	showPhotonsCheck->setChecked( m_drawPhotons );
+	drawingBudgetSpin->setValue( m_drawingBudget );
 
 	bufferSizeSpin->setValue( m_photonMapBufferSize );
 	if ( m_increasePhotonMap )
@@ -136,6 +139,14 @@ bool RayTraceDialog::DrawRays() const
 	return m_drawRays;
 }
 
+/*!
+ * Returns the maximum number of rays and photons to draw.
+ */
+int RayTraceDialog::GetDrawingBudget() const
+{
+	return m_drawingBudget;
+}
+
 /**
  * Returns the the height divisions applied to the sun shape.
  */
@@ -205,6 +216,7 @@ void RayTraceDialog::saveChanges()
 
 	m_drawRays = showRaysCheck->isChecked();
 	m_drawPhotons = showPhotonsCheck->isChecked();
+	m_drawingBudget = drawingBudgetSpin->value();
 
 	m_photonMapBufferSize = bufferSizeSpin->value();
 	if( newMapRadio->isChecked() )
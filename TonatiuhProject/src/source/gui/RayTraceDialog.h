@@ -64,13 +64,14 @@ public:
 	RayTraceDialog( int numRays,
 			QVector< RandomDeviateFactory* > randomFactoryList, int selectedRandomFactory = 0,
 			int widthDivisions = 200,int heightDivisions = 200,
-			bool drawRays = true, bool drawPhotons = false,
+			bool drawRays = true, bool drawPhotons = false, int drawingBudget = 100000,
 			int photonMapSize = 1000000, bool increasePhotonMap = false,
 				QWidget * parent = 0, Qt::WindowFlags f = 0 );
     ~RayTraceDialog();
 
     bool DrawPhotons() const;
     bool DrawRays() const;
+    int GetDrawingBudget() const;
     int GetHeightDivisions() const;
     int GetNumRays() const;
     int GetPhotonMapBufferSize() const;
@@ -85,6 +86,7 @@ public slots:
 private:
 	bool m_drawPhotons;  /*!<This property holds whether photons are going to be drawn. */
 	bool m_drawRays;  /*!<This property holds whether rays are going to be drawn. */
+	int m_drawingBudget; /*!<Maximum number of rays and photons to draw. */
 	int m_heightDivisions; /*!<number of height divisions in the sun*/
 	bool m_increasePhotonMap; /*!<This property holds whether traced phtons are going to added to the old photon map. */
 	int m_numRays; /*!< Number of rays to trace. */
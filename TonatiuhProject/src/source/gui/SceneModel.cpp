@@ -64,7 +64,7 @@ Juana Amieva, Azael Mancillas, Cesar Cantu.
  * Creates an empty model.
  */
 SceneModel::SceneModel( QObject* parent)
-:QAbstractItemModel( parent ), m_coinRoot( 0 ), m_coinScene(0), m_instanceRoot( 0 )
+:QAbstractItemModel( parent ), m_coinRoot( 0 ), m_coinScene(0), m_instanceRoot( 0 ), m_isUrlIndexDirty( true )
 {
 
 }
@@ -96,6 +96,7 @@ void SceneModel::SetCoinScene( TSceneKit& coinScene )
 	beginResetModel();
 	if( m_instanceRoot )	Clear();
 	m_mapCoinQt.clear();
+	m_isUrlIndexDirty = true;
 	m_coinScene = 0;
     m_coinScene = &coinScene;
 
@@ -116,6 +117,7 @@ void SceneModel::Clear()
 
 	delete m_instanceRoot;
 	m_instanceRoot = 0;
+	m_isUrlIndexDirty = true;
 
 }
 
@@ -200,6 +202,7 @@ InstanceNode* SceneModel::AddInstanceNode( InstanceNode& instanceNodeParent, SoN
 	if( instanceNode )
 	{
 		instanceNodeParent.AddChild( instanceNode );
+		m_isUrlIndexDirty = true;
 		QList< InstanceNode* > instanceNodeList;
 		m_mapCoinQt.insert( std::make_pair( soNode, instanceNodeList ) );
 		m_mapCoinQt[soNode].append( instanceNode );
@@ -458,6 +461,7 @@ int SceneModel::InsertCoinNode( SoNode& coinChild, SoBaseKit& coinParent )
 
     	GenerateInstanceTree( *instanceChild );
 	}
+	m_isUrlIndexDirty = true;
 	emit layoutChanged();
 
 	return row;
@@ -491,7 +495,7 @@ void SceneModel::InsertLightNode( TLightKit& coinLight )
 
 	InstanceNode* instanceLight = new InstanceNode( &coinLight );
 	m_instanceRoot->InsertChild( 0, instanceLight );
-
+	m_isUrlIndexDirty = true;
 
 	emit LightNodeStateChanged( 1 );
 	emit layoutChanged();
@@ -526,10 +530,13 @@ void SceneModel::RemoveCoinNode( int row, SoBaseKit& coinParent )
 	    InstanceNode* instanceParent = instanceListParent[index];
 	    InstanceNode* instanceNode = instanceParent->children[row];
 	    instanceParent->children.remove(row);
+	    instanceParent->SetDirty( false );
+	    instanceNode->SetParent( 0 );
 
 	    QList<InstanceNode*>& instanceList = m_mapCoinQt[ instanceNode->GetNode()];
 		instanceList.removeAt( instanceList.indexOf( instanceNode ) );
 	}
+	m_isUrlIndexDirty = true;
 	emit layoutChanged();
 }
 
@@ -538,6 +545,7 @@ void SceneModel::RemoveLightNode( TLightKit& coinLight )
 	SoNodeKitListPart* lightList = static_cast< SoNodeKitListPart* >( m_coinScene->getPart( "lightList", true ) );
     if ( lightList ) lightList->removeChild( &coinLight );
     m_instanceRoot->children.remove( 0 );
+    m_isUrlIndexDirty = true;
 
 	SoSearchAction trackersSearch;
 	trackersSearch.setType( TTracker::getClassTypeId() );
@@ -679,6 +687,7 @@ bool SceneModel::Cut( SoBaseKit& coinParent, int row )
  *
  * If \a nodeUrl is not a valid node url, the function returns root node index.
  *
+ * The nodes are found in a hash of the node urls. The hash is rebuilt after the model changes.
  *
  * \sa IndexFromNodeUrl, NodeFromIndex, PathFromIndex.
 **/
@@ -689,33 +698,23 @@ QModelIndex SceneModel::IndexFromNodeUrl( QString nodeUrl ) const
 	if( ( nodeList.size() == 1 ) &&
 			( nodeList[0] == QLatin1String( "Light" ) ) )	return index( 0, 0 );
 
-	if( nodeList.size() > 0 )
-	{
-		QString nodeName = nodeList.last();
-		nodeList.removeLast();
+	if( ( nodeList.size() < 1 ) || !m_instanceRoot )	return QModelIndex();
 
-		QString parentNodeURL = QString( QLatin1String( "//" ) ) + nodeList.join( QLatin1String( "/" ) );
-		QModelIndex parentIndex = IndexFromNodeUrl( parentNodeURL );
-		InstanceNode* parentNode = NodeFromIndex( parentIndex );
+	QString indexUrl = nodeList.join( QLatin1String( "/" ) );
+	if( m_isUrlIndexDirty )	UpdateUrlIndex();
 
-		int child = 0;
-		int row = -1;
-		while( child < parentNode->children.count() )
-		{
-			if( parentNode->children[child]->GetNode()->getName()  == SbName( nodeName.toStdString().c_str() ) )
-			{
-				row = child;
-				break;
-			}
-			child++;
-		}
-		if( row < 0 )	return QModelIndex();
-		//if(nodeName == ".") return index(row+1, 0, parentIndex );
-		return index(row, 0, parentIndex );
+	InstanceNode* instanceNode = m_urlIndex.value( indexUrl, 0 );
+	if( !instanceNode )	return QModelIndex();
+	if( !IsNodeUrl( instanceNode, nodeList ) )
+	{
+		//The node has been renamed without the model. A freshly built index always passes this check.
+		UpdateUrlIndex();
+		instanceNode = m_urlIndex.value( indexUrl, 0 );
+		if( !instanceNode )	return QModelIndex();
 	}
-	else
-		return QModelIndex();
 
+	InstanceNode* parentNode = instanceNode->GetParent();
+	return createIndex( parentNode->children.indexOf( instanceNode ), 0, instanceNode );
 }
 
 /**
@@ -860,6 +859,7 @@ bool SceneModel::Paste( tgc::PasteType type, SoBaseKit& coinParent, SoNode& coin
     	m_mapCoinQt[ coinChild ].append( instanceChild );
 		GenerateInstanceTree( *instanceChild );
 	}
+	m_isUrlIndexDirty = true;
 
 	emit layoutChanged();
 	return true;
@@ -886,7 +886,9 @@ bool SceneModel::SetNodeName( SoNode* coinChild, QString newName )
 		}
 	}
 	coinChild->setName( newName.toStdString().c_str() );
-
+	for( int index = 0; index < nodeInstances.size(); ++index )
+		nodeInstances[index]->UpdateNodeURL();
+	m_isUrlIndexDirty = true;
 
 	emit layoutChanged();
 	return true;
@@ -916,10 +918,60 @@ void SceneModel::UpdateSceneModel()
 		if( lightKit ) lightKit->Update( sceneBox );
 	}
 	*/
+	m_isUrlIndexDirty = true;
 	emit layoutChanged();
 
 }
 
+/**
+ * Adds \a instanceNode and its subtree to the url hash, with \a nodeUrl as the node url. As in a search child by child
+ * from the root, a url is assigned to the first node with this url and the nodes with an empty name are not reachable.
+**/
+void SceneModel::AddToUrlIndex( InstanceNode* instanceNode, const QString& nodeUrl ) const
+{
+	if( m_urlIndex.contains( nodeUrl ) )	return;
+	m_urlIndex.insert( nodeUrl, instanceNode );
+
+	for( int child = 0; child < instanceNode->children.count(); ++child )
+	{
+		InstanceNode* childNode = instanceNode->children[child];
+		const char* childName = childNode->GetNode()->getName().getString();
+		if( childName[0] != '\0' )
+			AddToUrlIndex( childNode, nodeUrl + QLatin1String( "/" ) + QLatin1String( childName ) );
+	}
+}
+
+/**
+ * Returns true if the names of \a instanceNode and its ancestors up to the root are \a nodeNameList.
+**/
+bool SceneModel::IsNodeUrl( InstanceNode* instanceNode, const QStringList& nodeNameList ) const
+{
+	for( int n = nodeNameList.count() - 1; n >= 0; --n )
+	{
+		if( !instanceNode )	return false;
+		if( nodeNameList[n] != QLatin1String( instanceNode->GetNode()->getName().getString() ) )	return false;
+		instanceNode = instanceNode->GetParent();
+	}
+	return ( instanceNode == m_instanceRoot );
+}
+
+/**
+ * Rebuilds the hash from the node urls to the model nodes.
+**/
+void SceneModel::UpdateUrlIndex() const
+{
+	m_urlIndex.clear();
+	m_isUrlIndexDirty = false;
+	if( !m_instanceRoot )	return;
+
+	for( int child = 0; child < m_instanceRoot->children.count(); ++child )
+	{
+		InstanceNode* childNode = m_instanceRoot->children[child];
+		const char* childName = childNode->GetNode()->getName().getString();
+		if( childName[0] != '\0' )	AddToUrlIndex( childNode, QLatin1String( childName ) );
+	}
+}
+
 void SceneModel::DeleteInstanceTree( InstanceNode& instanceNode )
 {
 
@@ -934,12 +986,15 @@ void SceneModel::DeleteInstanceTree( InstanceNode& instanceNode )
 
 	QList<InstanceNode*>& instanceList = m_mapCoinQt[ instanceNode.GetNode()];
 	instanceList.removeAt( instanceList.indexOf( &instanceNode ) );
+	m_isUrlIndexDirty = true;
 
 	InstanceNode* instanceParent = instanceNode.GetParent();
 	if( instanceParent )
 	{
 		int row = instanceParent->children.indexOf( &instanceNode );
 		instanceParent->children.remove( row );
+		instanceParent->SetDirty( false );
+		instanceNode.SetParent( 0 );
 	}
 
 }
@@ -40,6 +40,7 @@ Juana Amieva, Azael Mancillas, Cesar Cantu.
 #define SCENEMODEL_H_
 
 #include <QAbstractItemModel>
+#include <QHash>
 
 #include "tgc.h"
 
@@ -115,6 +116,9 @@ private:
 //	void GenerateTAnalyzerKitSubTree( InstanceNode& instanceNodeParent, SoNode* parentNode );
 //	void GenerateSoNodeKitListPartSubTree( InstanceNode& instanceNodeParent, SoNode* parentNode );
 	void GenerateTSeparatorKitSubTree( InstanceNode& instanceNodeParent, SoNode* parentNode );
+	void AddToUrlIndex( InstanceNode* instanceNode, const QString& nodeUrl ) const;
+	bool IsNodeUrl( InstanceNode* instanceNode, const QStringList& nodeNameList ) const;
+	void UpdateUrlIndex() const;
 
 private:
 	SoSeparator* m_coinRoot;
@@ -122,6 +126,8 @@ private:
 	InstanceNode* m_instanceRoot;
 	InstanceNode* m_instanceConcentrator;
 	std::map< SoNode*, QList<InstanceNode*> > m_mapCoinQt;
+	mutable QHash< QString, InstanceNode* > m_urlIndex;
+	mutable bool m_isUrlIndexDirty;
 };
 
 #endif /*SCENEMODEL_H_*/
@@ -0,0 +1,602 @@
+/***************************************************************************
+Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+This file is part of Tonatiuh.
+
+Tonatiuh program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Acknowledgments:
+
+The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+then Chair of the Department of Engineering of the University of Texas at
+Brownsville. From May 2004 to July 2008, it was supported by the Department
+of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+During 2007, NREL also contributed to the validation of Tonatiuh under the
+framework of the Memorandum of Understanding signed with the Spanish
+National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez,
+Juana Amieva, Azael Mancillas, Cesar Cantu.
+***************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QMap>
+#include <QProcess>
+#include <QTextStream>
+
+#include "DistributedTrace.h"
+
+namespace
+{
+	/*!
+	 * Workers print this tag followed by the summary file name, so the launcher finds the summaries.
+	 */
+	const char* summaryTag = "Worker summary: ";
+
+	/*!
+	 * Columns and surfaces of a photon map exported by the "Binary_file" plugin.
+	 */
+	struct PhotonFileFormat
+	{
+		PhotonFileFormat()
+		:compressed( false )
+		{
+
+		}
+
+		QStringList columns;
+		QMap< unsigned long, QString > surfaces;
+		bool compressed;
+	};
+
+	/*!
+	 * Reads the columns and the surfaces URLs of the "<name>_parameters.txt" file \a fileName. The surfaces
+	 * are keyed by the identifier written before each URL, which need not be contiguous.
+	 */
+	bool ReadPhotonFileFormat( const QString& fileName, PhotonFileFormat* format )
+	{
+		QFile parametersFile( fileName );
+		if( !parametersFile.open( QIODevice::ReadOnly | QIODevice::Text ) )	return ( false );
+
+		QTextStream in( &parametersFile );
+		int section = 0;
+		while( !in.atEnd() )
+		{
+			QString line = in.readLine();
+			if( line == QLatin1String( "START PARAMETERS" ) )	section = 1;
+			else if( line == QLatin1String( "START SURFACES" ) )	section = 2;
+			else if( line == QLatin1String( "START COMPRESSION" ) )	format->compressed = true;
+			else if( line.startsWith( QLatin1String( "END " ) ) )	section = 0;
+			else if( section == 1 )	format->columns<<line;
+			else if( section == 2 )
+			{
+				int separator = line.indexOf( QLatin1Char( ' ' ) );
+				if( separator < 0 )	return ( false );
+
+				bool isId = false;
+				unsigned long surfaceId = line.left( separator ).toULong( &isId );
+				if( !isId || surfaceId == 0 )	return ( false );
+				format->surfaces.insert( surfaceId, line.mid( separator + 1 ) );
+			}
+		}
+
+		return ( !format->columns.isEmpty() && format->columns[0] == QLatin1String( "id" ) );
+	}
+
+	/*!
+	 * Returns the data files of the photon map \a fileName: "<name>.dat", "<name>_1.dat", "<name>_2.dat"...
+	 * or the shards "<name>_shard_1.dat", "<name>_shard_2.dat"...
+	 */
+	QStringList PhotonDataFiles( const QDir& directory, const QString& fileName )
+	{
+		QStringList dataFiles;
+
+		QString oneFile = directory.absoluteFilePath( QString( QLatin1String( "%1.dat" ) ).arg( fileName ) );
+		if( QFile::exists( oneFile ) )	return ( QStringList( oneFile ) );
+
+		int fileIndex = 1;
+		QString partialFile = directory.absoluteFilePath( QString( QLatin1String( "%1_%2.dat" ) ).arg( fileName, QString::number( fileIndex ) ) );
+		while( QFile::exists( partialFile ) )
+		{
+			dataFiles<<partialFile;
+			fileIndex++;
+			partialFile = directory.absoluteFilePath( QString( QLatin1String( "%1_%2.dat" ) ).arg( fileName, QString::number( fileIndex ) ) );
+		}
+		if( !dataFiles.isEmpty() )	return ( dataFiles );
+
+		int shardIndex = 1;
+		QString shardFile = directory.absoluteFilePath( QString( QLatin1String( "%1_shard_%2.dat" ) ).arg( fileName, QString::number( shardIndex ) ) );
+		while( QFile::exists( shardFile ) )
+		{
+			dataFiles<<shardFile;
+			shardIndex++;
+			shardFile = directory.absoluteFilePath( QString( QLatin1String( "%1_shard_%2.dat" ) ).arg( fileName, QString::number( shardIndex ) ) );
+		}
+		return ( dataFiles );
+	}
+
+	bool LessWorkerIndex( const DistributedTrace& a, const DistributedTrace& b )
+	{
+		return ( a.WorkerIndex() < b.WorkerIndex() );
+	}
+
+	/*!
+	 * Handles the output line \a outputLine of the worker \a workerIndex. The summary file names are
+	 * appended to \a summaryFiles and the rest of the lines are printed.
+	 */
+	void WorkerOutputLine( const QString& outputLine, int workerIndex, QStringList* summaryFiles )
+	{
+		QString line = outputLine.trimmed();
+		if( line.isEmpty() )	return;
+
+		if( line.startsWith( QLatin1String( summaryTag ) ) )
+			summaryFiles->push_back( line.mid( QString( QLatin1String( summaryTag ) ).length() ) );
+		else
+			std::cout<<"[worker "<<workerIndex<<"] "<<line.toStdString()<<std::endl;
+	}
+
+	/*!
+	 * Reads the output available from the \a worker process. The last line without end of line is
+	 * only read once the worker has \a finished.
+	 */
+	void ReadWorkerOutput( QProcess* worker, int workerIndex, bool finished, QStringList* summaryFiles )
+	{
+		while( worker->canReadLine() )
+			WorkerOutputLine( QString::fromLocal8Bit( worker->readLine() ), workerIndex, summaryFiles );
+		if( finished )
+			WorkerOutputLine( QString::fromLocal8Bit( worker->readAllStandardOutput() ), workerIndex, summaryFiles );
+
+		std::cerr<<worker->readAllStandardError().constData();
+	}
+}
+
+/*!
+ * Creates a not distributed ray tracing description.
+ */
+DistributedTrace::DistributedTrace()
+:m_workerIndex( -1 ),
+ m_numberOfWorkers( 0 ),
+ m_seed( 0 ),
+ m_tracedRays( 0.0 ),
+ m_inputAperture( 0.0 ),
+ m_irradiance( 0.0 )
+{
+
+}
+
+/*!
+ * Creates the description of the worker \a workerIndex of \a numberOfWorkers that share the master \a seed.
+ */
+DistributedTrace::DistributedTrace( int workerIndex, int numberOfWorkers, unsigned long seed )
+:m_workerIndex( workerIndex ),
+ m_numberOfWorkers( numberOfWorkers ),
+ m_seed( seed ),
+ m_tracedRays( 0.0 ),
+ m_inputAperture( 0.0 ),
+ m_irradiance( 0.0 )
+{
+
+}
+
+/*!
+ * Returns the rays of \a numberOfRays that this worker traces. The remainder of the division
+ * is given to the first workers.
+ */
+unsigned long DistributedTrace::WorkerRays( unsigned long numberOfRays ) const
+{
+	if( !IsWorker() || m_numberOfWorkers < 1 )	return ( numberOfRays );
+
+	unsigned long rays = numberOfRays / m_numberOfWorkers;
+	if( (unsigned long) m_workerIndex < ( numberOfRays % m_numberOfWorkers ) )	rays++;
+	return ( rays );
+}
+
+/*!
+ * Returns the name that this worker uses for the export file \a fileName.
+ */
+QString DistributedTrace::WorkerFileName( const QString& fileName ) const
+{
+	if( !IsWorker() )	return ( fileName );
+	return ( QString( QLatin1String( "%1_worker%2" ) ).arg( fileName, QString::number( m_workerIndex ) ) );
+}
+
+/*!
+ * Sets the photon map export type name and its base directory and file name.
+ */
+void DistributedTrace::SetExport( QString exportType, QString exportDirectory, QString exportFile )
+{
+	m_exportType = exportType;
+	m_exportDirectory = exportDirectory;
+	m_exportFile = exportFile;
+}
+
+/*!
+ * Sets the number of rays traced by the worker and the light values used to compute the power per photon.
+ */
+void DistributedTrace::SetResults( double tracedRays, double inputAperture, double irradiance )
+{
+	m_tracedRays = tracedRays;
+	m_inputAperture = inputAperture;
+	m_irradiance = irradiance;
+}
+
+/*!
+ * Returns the power of each photon for the traced rays.
+ */
+double DistributedTrace::PowerPerPhoton() const
+{
+	if( m_tracedRays < 1.0 )	return ( 0.0 );
+	return ( ( m_inputAperture * m_irradiance ) / m_tracedRays );
+}
+
+/*!
+ * Returns the summary file name: "<directory>/<export file>_worker<index>_summary.txt" for the workers
+ * and "<directory>/<export file>_summary.txt" for the merged results.
+ */
+QString DistributedTrace::SummaryFileName() const
+{
+	QDir exportDirectory( m_exportDirectory );
+	return ( exportDirectory.absoluteFilePath( QString( QLatin1String( "%1_summary.txt" ) ).arg( WorkerFileName( m_exportFile ) ) ) );
+}
+
+/*!
+ * Reads the worker summary \a fileName. Returns false if the file is not a valid worker summary.
+ */
+bool DistributedTrace::Read( const QString& fileName )
+{
+	QFile summaryFile( fileName );
+	if( !summaryFile.open( QIODevice::ReadOnly | QIODevice::Text ) )	return ( false );
+
+	m_workerIndex = -1;
+	m_numberOfWorkers = 0;
+
+	QTextStream in( &summaryFile );
+	while( !in.atEnd() )
+	{
+		QString line = in.readLine();
+		QString key = line.section( QLatin1Char( ' ' ), 0, 0 );
+		QString value = line.section( QLatin1Char( ' ' ), 1 );
+
+		if( key == QLatin1String( "worker" ) )	m_workerIndex = value.toInt();
+		else if( key == QLatin1String( "workers" ) )	m_numberOfWorkers = value.toInt();
+		else if( key == QLatin1String( "seed" ) )	m_seed = value.toULong();
+		else if( key == QLatin1String( "tracedRays" ) )	m_tracedRays = value.toDouble();
+		else if( key == QLatin1String( "inputAperture" ) )	m_inputAperture = value.toDouble();
+		else if( key == QLatin1String( "irradiance" ) )	m_irradiance = value.toDouble();
+		else if( key == QLatin1String( "exportType" ) )	m_exportType = value;
+		else if( key == QLatin1String( "exportDirectory" ) )	m_exportDirectory = value;
+		else if( key == QLatin1String( "exportFile" ) )	m_exportFile = value;
+	}
+
+	return ( m_workerIndex >= 0 && m_workerIndex < m_numberOfWorkers );
+}
+
+/*!
+ * Writes the summary to \a fileName.
+ */
+bool DistributedTrace::Write( const QString& fileName ) const
+{
+	QFile summaryFile( fileName );
+	if( !summaryFile.open( QIODevice::WriteOnly | QIODevice::Text ) )	return ( false );
+
+	QTextStream out( &summaryFile );
+	out.setRealNumberPrecision( 17 );
+	out<<"worker "<<m_workerIndex<<"\n";
+	out<<"workers "<<m_numberOfWorkers<<"\n";
+	out<<"seed "<<QString::number( m_seed )<<"\n";
+	out<<"tracedRays "<<m_tracedRays<<"\n";
+	out<<"inputAperture "<<m_inputAperture<<"\n";
+	out<<"irradiance "<<m_irradiance<<"\n";
+	out<<"powerPerPhoton "<<PowerPerPhoton()<<"\n";
+	out<<"exportType "<<m_exportType<<"\n";
+	out<<"exportDirectory "<<m_exportDirectory<<"\n";
+	out<<"exportFile "<<m_exportFile<<"\n";
+
+	return ( out.status() == QTextStream::Ok );
+}
+
+/*!
+ * Writes the summary to SummaryFileName() and prints its name to the standard output for the launcher.
+ */
+bool DistributedTrace::WriteSummary() const
+{
+	QString fileName = SummaryFileName();
+	if( !Write( fileName ) )	return ( false );
+
+	std::cout<<summaryTag<<fileName.toStdString()<<std::endl;
+	return ( true );
+}
+
+/*!
+ * Merges the results of the workers with the summaries \a summaryFiles. The workers are merged in index order
+ * whatever the order of \a summaryFiles, so the merged results only depend on the partial results.
+ *
+ * The power per photon is computed from the rays traced by all the workers. The photon maps exported with the
+ * "Binary_file" type are joined in "<export file>.dat" and "<export file>_parameters.txt". For the other export
+ * types only the merged summary, "<export file>_summary.txt", is written.
+ *
+ * Returns false and sets \a errorMessage if the summaries are not of the same ray tracing or a file cannot be read.
+ */
+bool DistributedTrace::Merge( const QStringList& summaryFiles, QString* errorMessage )
+{
+	QVector< DistributedTrace > workers;
+	for( int f = 0; f < summaryFiles.count(); ++f )
+	{
+		DistributedTrace worker;
+		if( !worker.Read( summaryFiles[f] ) )
+		{
+			*errorMessage = QString( QLatin1String( "Cannot read worker summary %1." ) ).arg( summaryFiles[f] );
+			return ( false );
+		}
+		workers.push_back( worker );
+	}
+	if( workers.isEmpty() )
+	{
+		*errorMessage = QLatin1String( "There are no worker summaries to merge." );
+		return ( false );
+	}
+	std::sort( workers.begin(), workers.end(), LessWorkerIndex );
+
+	const DistributedTrace& first = workers[0];
+	if( workers.count() != first.m_numberOfWorkers )
+	{
+		*errorMessage = QString( QLatin1String( "Expected %1 worker summaries, found %2." ) ).arg(
+				QString::number( first.m_numberOfWorkers ), QString::number( workers.count() ) );
+		return ( false );
+	}
+
+	double lightPower = first.m_inputAperture * first.m_irradiance;
+	double tracedRays = 0.0;
+	for( int w = 0; w < workers.count(); ++w )
+	{
+		const DistributedTrace& worker = workers[w];
+		if( worker.m_workerIndex != w )
+		{
+			*errorMessage = QString( QLatin1String( "Missing summary of worker %1." ) ).arg( w );
+			return ( false );
+		}
+		if( worker.m_numberOfWorkers != first.m_numberOfWorkers || worker.m_seed != first.m_seed
+				|| worker.m_exportType != first.m_exportType || worker.m_exportDirectory != first.m_exportDirectory
+				|| worker.m_exportFile != first.m_exportFile
+				|| fabs( worker.m_inputAperture * worker.m_irradiance - lightPower ) > 1.0e-9 * fabs( lightPower ) )
+		{
+			*errorMessage = QString( QLatin1String( "Worker %1 summary is not of the same ray tracing." ) ).arg( w );
+			return ( false );
+		}
+		tracedRays += worker.m_tracedRays;
+	}
+
+	DistributedTrace merged = first;
+	merged.m_workerIndex = -1;
+	merged.m_tracedRays = tracedRays;
+
+	if( first.m_exportType == QLatin1String( "Binary_file" ) &&
+			!MergePhotonFiles( workers, first.m_exportDirectory, first.m_exportFile, merged.PowerPerPhoton(), errorMessage ) )
+		return ( false );
+
+	if( !merged.Write( merged.SummaryFileName() ) )
+	{
+		*errorMessage = QString( QLatin1String( "Cannot write %1." ) ).arg( merged.SummaryFileName() );
+		return ( false );
+	}
+	return ( true );
+}
+
+/*!
+ * Runs \a numberOfWorkers processes of \a program with the script and options \a scriptArguments on this computer
+ * and waits until they finish. The summaries written by the workers are returned in \a summaryFiles.
+ *
+ * Returns false and sets \a errorMessage if any worker fails.
+ */
+bool DistributedTrace::RunLocalWorkers( const QString& program, const QStringList& scriptArguments, int numberOfWorkers,
+		unsigned long seed, QStringList* summaryFiles, QString* errorMessage )
+{
+	QVector< QProcess* > workers;
+	for( int w = 0; w < numberOfWorkers; ++w )
+	{
+		QStringList arguments( scriptArguments );
+		arguments<<QString( QLatin1String( "--worker=%1/%2" ) ).arg( QString::number( w ), QString::number( numberOfWorkers ) );
+		arguments<<QString( QLatin1String( "--seed=%1" ) ).arg( QString::number( seed ) );
+
+		QProcess* worker = new QProcess;
+		worker->start( program, arguments );
+		workers.push_back( worker );
+	}
+
+	//The outputs are read while the workers run, so no worker blocks writing to a full pipe.
+	QVector< bool > isRunning( numberOfWorkers, true );
+	int runningWorkers = numberOfWorkers;
+	while( runningWorkers > 0 )
+	{
+		for( int w = 0; w < numberOfWorkers; ++w )
+		{
+			if( !isRunning[w] )	continue;
+
+			QProcess* worker = workers[w];
+			bool workerFinished = worker->waitForFinished( 100 ) || ( worker->state() == QProcess::NotRunning );
+			ReadWorkerOutput( worker, w, workerFinished, summaryFiles );
+			if( workerFinished )
+			{
+				isRunning[w] = false;
+				runningWorkers--;
+			}
+		}
+	}
+
+	bool finished = true;
+	for( int w = 0; w < numberOfWorkers; ++w )
+	{
+		QProcess* worker = workers[w];
+		if( worker->exitStatus() != QProcess::NormalExit || worker->exitCode() != 0 )
+		{
+			*errorMessage = QString( QLatin1String( "Worker %1 failed." ) ).arg( w );
+			finished = false;
+		}
+		delete worker;
+	}
+	if( !finished )	return ( false );
+
+	if( summaryFiles->count() != numberOfWorkers )
+	{
+		*errorMessage = QString( QLatin1String( "Only %1 of %2 workers wrote a summary." ) ).arg(
+				QString::number( summaryFiles->count() ), QString::number( numberOfWorkers ) );
+		return ( false );
+	}
+	return ( true );
+}
+
+/*!
+ * Joins the "Binary_file" photon maps of the \a workers in \a directory into the photon map \a fileName.
+ * The photon identifiers of each worker are displaced by the photons of the previous workers and the surfaces
+ * identifiers are renumbered by first appearance.
+ */
+bool DistributedTrace::MergePhotonFiles( const QVector< DistributedTrace >& workers, const QString& directory,
+		const QString& fileName, double powerPerPhoton, QString* errorMessage )
+{
+	QDir exportDirectory( directory );
+
+	QString mergedFileName = exportDirectory.absoluteFilePath( QString( QLatin1String( "%1.dat" ) ).arg( fileName ) );
+	QFile mergedFile( mergedFileName );
+	if( !mergedFile.open( QIODevice::WriteOnly ) )
+	{
+		*errorMessage = QString( QLatin1String( "Cannot write %1." ) ).arg( mergedFileName );
+		return ( false );
+	}
+	QDataStream out( &mergedFile );
+
+	QStringList columns;
+	QStringList surfaces;
+	QHash< QString, int > surfaceIdentifiers;
+	double photonOffset = 0.0;
+	for( int w = 0; w < workers.count(); ++w )
+	{
+		QString workerFile = workers[w].WorkerFileName( fileName );
+
+		PhotonFileFormat format;
+		QString parametersFileName = exportDirectory.absoluteFilePath( QString( QLatin1String( "%1_parameters.txt" ) ).arg( workerFile ) );
+		if( !ReadPhotonFileFormat( parametersFileName, &format ) )
+		{
+			*errorMessage = QString( QLatin1String( "Cannot read %1." ) ).arg( parametersFileName );
+			return ( false );
+		}
+		if( format.compressed )
+		{
+			*errorMessage = QString( QLatin1String( "Worker %1 exported compressed photons. Only uncompressed photon maps can be merged." ) ).arg( w );
+			return ( false );
+		}
+		if( w == 0 )	columns = format.columns;
+		else if( format.columns != columns )
+		{
+			*errorMessage = QString( QLatin1String( "Worker %1 exported different photon data." ) ).arg( w );
+			return ( false );
+		}
+
+		//Identifiers not defined in the parameters file are mapped to -1.
+		unsigned long maximumId = format.surfaces.isEmpty() ? 0 : format.surfaces.lastKey();
+		std::vector< double > surfaceMap( maximumId + 1, -1.0 );
+		surfaceMap[0] = 0.0;
+		QMap< unsigned long, QString >::const_iterator surface = format.surfaces.constBegin();
+		for( ; surface != format.surfaces.constEnd(); ++surface )
+		{
+			if( !surfaceIdentifiers.contains( surface.value() ) )
+			{
+				surfaces<<surface.value();
+				surfaceIdentifiers.insert( surface.value(), surfaces.count() );
+			}
+			surfaceMap[surface.key()] = surfaceIdentifiers.value( surface.value() );
+		}
+
+		int nColumns = columns.count();
+		int previousColumn = columns.indexOf( QLatin1String( "previous ID" ) );
+		int nextColumn = columns.indexOf( QLatin1String( "next ID" ) );
+		int surfaceColumn = columns.indexOf( QLatin1String( "surface ID" ) );
+
+		double workerPhotons = 0.0;
+		std::vector< double > photon( nColumns );
+		QStringList dataFiles = PhotonDataFiles( exportDirectory, workerFile );
+		for( int f = 0; f < dataFiles.count(); ++f )
+		{
+			QFile dataFile( dataFiles[f] );
+			if( !dataFile.open( QIODevice::ReadOnly ) )
+			{
+				*errorMessage = QString( QLatin1String( "Cannot read %1." ) ).arg( dataFiles[f] );
+				return ( false );
+			}
+
+			QDataStream in( &dataFile );
+			while( !in.atEnd() )
+			{
+				for( int c = 0; c < nColumns; ++c )	in>>photon[c];
+				if( in.status() != QDataStream::Ok )
+				{
+					*errorMessage = QString( QLatin1String( "%1 is truncated." ) ).arg( dataFiles[f] );
+					return ( false );
+				}
+
+				photon[0] += photonOffset;
+				if( previousColumn > 0 && photon[previousColumn] > 0.0 )	photon[previousColumn] += photonOffset;
+				if( nextColumn > 0 && photon[nextColumn] > 0.0 )	photon[nextColumn] += photonOffset;
+				if( surfaceColumn > 0 )
+				{
+					unsigned long surfaceId = (unsigned long) photon[surfaceColumn];
+					if( surfaceId >= surfaceMap.size() || surfaceMap[surfaceId] < 0.0 )
+					{
+						*errorMessage = QString( QLatin1String( "%1 has an undefined surface identifier." ) ).arg( dataFiles[f] );
+						return ( false );
+					}
+					photon[surfaceColumn] = surfaceMap[surfaceId];
+				}
+
+				for( int c = 0; c < nColumns; ++c )	out<<photon[c];
+				workerPhotons++;
+			}
+		}
+		photonOffset += workerPhotons;
+	}
+	mergedFile.close();
+
+	QString parametersFileName = exportDirectory.absoluteFilePath( QString( QLatin1String( "%1_parameters.txt" ) ).arg( fileName ) );
+	QFile parametersFile( parametersFileName );
+	if( !parametersFile.open( QIODevice::WriteOnly ) )
+	{
+		*errorMessage = QString( QLatin1String( "Cannot write %1." ) ).arg( parametersFileName );
+		return ( false );
+	}
+
+	QTextStream parameters( &parametersFile );
+	parameters<<QString( QLatin1String( "START PARAMETERS\n" ) );
+	for( int c = 0; c < columns.count(); ++c )	parameters<<columns[c]<<QLatin1Char( '\n' );
+	parameters<<QString( QLatin1String( "END PARAMETERS\n" ) );
+	parameters<<QString( QLatin1String( "START SURFACES\n" ) );
+	for( int s = 0; s < surfaces.count(); ++s )
+		parameters<<QString( QLatin1String( "%1 %2\n" ) ).arg( QString::number( s + 1 ), surfaces[s] );
+	parameters<<QString( QLatin1String( "END SURFACES\n" ) );
+	parameters<<QString::number( powerPerPhoton, 'g', 17 );
+
+	return ( true );
+}
@@ -0,0 +1,100 @@
+/***************************************************************************
+Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+This file is part of Tonatiuh.
+
+Tonatiuh program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Acknowledgments:
+
+The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+then Chair of the Department of Engineering of the University of Texas at
+Brownsville. From May 2004 to July 2008, it was supported by the Department
+of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+During 2007, NREL also contributed to the validation of Tonatiuh under the
+framework of the Memorandum of Understanding signed with the Spanish
+National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez,
+Juana Amieva, Azael Mancillas, Cesar Cantu.
+***************************************************************************/
+
+#ifndef DISTRIBUTEDTRACE_H_
+#define DISTRIBUTEDTRACE_H_
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+//!  DistributedTrace class describes one worker process of a distributed ray tracing.
+/*!
+ * A distributed ray tracing runs the same script in \a numberOfWorkers processes. Each worker traces its
+ * share of the rays with its own random stream of the master \a seed, so the workers never use the same random
+ * numbers and a run with the same seed and number of workers always generates the same rays.
+ *
+ * Each worker exports its photons to files with the "_worker<index>" suffix and writes a summary with
+ * the number of traced rays and the light parameters. Merge joins the partial results and computes the
+ * power per photon from the total number of traced rays.
+*/
+class DistributedTrace
+{
+
+public:
+	DistributedTrace();
+	DistributedTrace( int workerIndex, int numberOfWorkers, unsigned long seed );
+
+	bool IsWorker() const { return ( m_workerIndex >= 0 ); };
+	int WorkerIndex() const { return ( m_workerIndex ); };
+	int NumberOfWorkers() const { return ( m_numberOfWorkers ); };
+	unsigned long Seed() const { return ( m_seed ); };
+
+	unsigned long WorkerRays( unsigned long numberOfRays ) const;
+	QString WorkerFileName( const QString& fileName ) const;
+
+	void SetExport( QString exportType, QString exportDirectory, QString exportFile );
+	void SetResults( double tracedRays, double inputAperture, double irradiance );
+	double TracedRays() const { return ( m_tracedRays ); };
+	double PowerPerPhoton() const;
+
+	QString SummaryFileName() const;
+	bool Read( const QString& fileName );
+	bool Write( const QString& fileName ) const;
+	bool WriteSummary() const;
+
+	static bool Merge( const QStringList& summaryFiles, QString* errorMessage );
+	static bool RunLocalWorkers( const QString& program, const QStringList& scriptArguments, int numberOfWorkers,
+			unsigned long seed, QStringList* summaryFiles, QString* errorMessage );
+
+private:
+	static bool MergePhotonFiles( const QVector< DistributedTrace >& workers, const QString& directory,
+			const QString& fileName, double powerPerPhoton, QString* errorMessage );
+
+	int m_workerIndex;
+	int m_numberOfWorkers;
+	unsigned long m_seed;
+	double m_tracedRays;
+	double m_inputAperture;
+	double m_irradiance;
+	QString m_exportType;
+	QString m_exportDirectory;
+	QString m_exportFile;
+};
+
+#endif /* DISTRIBUTEDTRACE_H_ */
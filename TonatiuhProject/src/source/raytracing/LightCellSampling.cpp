@@ -0,0 +1,203 @@
+/***************************************************************************
+Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+This file is part of Tonatiuh.
+
+Tonatiuh program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Acknowledgments:
+
+The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+then Chair of the Department of Engineering of the University of Texas at
+Brownsville. From May 2004 to July 2008, it was supported by the Department
+of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+During 2007, NREL also contributed to the validation of Tonatiuh under the
+framework of the Memorandum of Understanding signed with the Spanish
+National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez,
+Juana Amieva, Azael Mancillas, Cesar Cantu.
+***************************************************************************/
+
+#include <algorithm>
+
+#include <QMutexLocker>
+
+#include "LightCellSampling.h"
+#include "RandomDeviate.h"
+
+LightCellTally::LightCellTally( int numberOfCells )
+:rays( numberOfCells, 0.0 ),
+ hits( numberOfCells, 0.0 )
+{
+}
+
+/*!
+ * Counts a ray traced from the \a cell. Negative cells, rays that do not come from the light, are not counted.
+ */
+void LightCellTally::Add( int cell, bool hit )
+{
+	if( cell < 0 || cell >= (int) rays.size() )	return;
+	rays[cell] += 1.0;
+	if( hit )	hits[cell] += 1.0;
+}
+
+/*!
+ * Creates the sampling of the light \a cells, the valid areas of the light shape. The cells are chosen uniformly.
+ */
+LightCellSampling::LightCellSampling( const std::vector< QPair< int, int > >& cells )
+:m_cells( cells ),
+ m_stratified( false ),
+ m_tally( cells.size() )
+{
+}
+
+/*!
+ * Sets whether the samples cycle through the cells, \a stratified, or take them at random.
+ */
+void LightCellSampling::SetStratified( bool stratified )
+{
+	m_stratified = stratified;
+}
+
+/*!
+ * Sets the probability of each cell from its hit probability in the \a statistics mixed with a \a uniformFraction
+ * of uniform probability. The cells without statistics take the mean hit probability.
+ *
+ * Returns false, and the cells are chosen uniformly, if the statistics have no hits for these cells.
+ */
+bool LightCellSampling::SetImportance( const LightCellStatistics& statistics, double uniformFraction )
+{
+	m_cumulativeProbability.clear();
+	m_cellWeights.clear();
+
+	int numberOfCells = m_cells.size();
+	if( numberOfCells < 1 || uniformFraction >= 1.0 )	return false;
+	if( uniformFraction < 0.0 )	uniformFraction = 0.0;
+
+	std::vector< double > importance( numberOfCells, -1.0 );
+	double totalImportance = 0.0;
+	int knownCells = 0;
+	for( int c = 0; c < numberOfCells; ++c )
+	{
+		LightCellStatistics::const_iterator cellStatistics = statistics.find( m_cells[c] );
+		if( cellStatistics == statistics.end() || cellStatistics.value().first <= 0.0 )	continue;
+		importance[c] = cellStatistics.value().second / cellStatistics.value().first;
+		totalImportance += importance[c];
+		++knownCells;
+	}
+	if( knownCells < 1 || totalImportance <= 0.0 )	return false;
+
+	double meanImportance = totalImportance / knownCells;
+	for( int c = 0; c < numberOfCells; ++c )
+	{
+		if( importance[c] >= 0.0 )	continue;
+		importance[c] = meanImportance;
+		totalImportance += meanImportance;
+	}
+
+	m_cumulativeProbability.resize( numberOfCells );
+	m_cellWeights.resize( numberOfCells );
+	double cumulativeProbability = 0.0;
+	for( int c = 0; c < numberOfCells; ++c )
+	{
+		double probability = ( 1.0 - uniformFraction ) * importance[c] / totalImportance + uniformFraction / numberOfCells;
+		cumulativeProbability += probability;
+		m_cumulativeProbability[c] = cumulativeProbability;
+		m_cellWeights[c] = ( probability > 0.0 ) ? 1.0 / ( numberOfCells * probability ) : 0.0;
+	}
+	m_cumulativeProbability[numberOfCells - 1] = 1.0;
+
+	return true;
+}
+
+bool LightCellSampling::IsStratified() const
+{
+	return ( m_stratified );
+}
+
+bool LightCellSampling::HasImportance() const
+{
+	return ( !m_cumulativeProbability.empty() );
+}
+
+int LightCellSampling::NumberOfCells() const
+{
+	return ( m_cells.size() );
+}
+
+/*!
+ * Returns the cell of the sample \a sampleIndex and multiplies the \a rayWeight by the cell weight.
+ * Only the dimension 0 of the sample is used. With stratification, the N rays of a cycle share the jitter of the
+ * sample \a sampleIndex / N, so the other dimensions of the ray must be sampled with the whole \a sampleIndex:
+ * otherwise, the rays of a cycle that take the same cell would be the same ray.
+ */
+int LightCellSampling::SampleCell( unsigned long long sampleIndex, RandomDeviate& rand, double* rayWeight ) const
+{
+	int numberOfCells = m_cells.size();
+	if( numberOfCells < 1 )	return -1;
+
+	double u;
+	if( m_stratified )
+	{
+		unsigned long long stratum = sampleIndex % numberOfCells;
+		u = ( stratum + rand.Sample( sampleIndex / numberOfCells, 0 ) ) / numberOfCells;
+		if( m_cumulativeProbability.empty() )	return ( int( stratum ) );
+	}
+	else
+	{
+		u = rand.Sample( sampleIndex, 0 );
+		if( m_cumulativeProbability.empty() )	return ( int( u * numberOfCells ) );
+	}
+
+	int cell = std::upper_bound( m_cumulativeProbability.begin(), m_cumulativeProbability.end(), u ) - m_cumulativeProbability.begin();
+	if( cell >= numberOfCells )	cell = numberOfCells - 1;
+	*rayWeight *= m_cellWeights[cell];
+	return ( cell );
+}
+
+/*!
+ * Adds the rays counted in the thread \a tally and resets it.
+ */
+void LightCellSampling::AddTally( LightCellTally& tally )
+{
+	QMutexLocker locker( &m_tallyMutex );
+	for( unsigned int c = 0; c < tally.rays.size() && c < m_tally.rays.size(); ++c )
+	{
+		m_tally.rays[c] += tally.rays[c];
+		m_tally.hits[c] += tally.hits[c];
+	}
+	std::fill( tally.rays.begin(), tally.rays.end(), 0.0 );
+	std::fill( tally.hits.begin(), tally.hits.end(), 0.0 );
+}
+
+/*!
+ * Adds the rays traced from each cell to the \a statistics of the previous ray tracings.
+ */
+void LightCellSampling::UpdateStatistics( LightCellStatistics* statistics ) const
+{
+	for( unsigned int c = 0; c < m_cells.size(); ++c )
+	{
+		if( m_tally.rays[c] <= 0.0 )	continue;
+		QPair< double, double >& cellStatistics = ( *statistics )[m_cells[c]];
+		cellStatistics.first += m_tally.rays[c];
+		cellStatistics.second += m_tally.hits[c];
+	}
+}
@@ -0,0 +1,109 @@
+/***************************************************************************
+Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+This file is part of Tonatiuh.
+
+Tonatiuh program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Acknowledgments:
+
+The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+then Chair of the Department of Engineering of the University of Texas at
+Brownsville. From May 2004 to July 2008, it was supported by the Department
+of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+During 2007, NREL also contributed to the validation of Tonatiuh under the
+framework of the Memorandum of Understanding signed with the Spanish
+National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez,
+Juana Amieva, Azael Mancillas, Cesar Cantu.
+***************************************************************************/
+
+#ifndef LIGHTCELLSAMPLING_H_
+#define LIGHTCELLSAMPLING_H_
+
+#include <vector>
+
+#include <QHash>
+#include <QMutex>
+#include <QPair>
+
+class RandomDeviate;
+
+//! Number of traced rays and number of hit rays of each light cell, identified by its grid coordinates.
+typedef QHash< QPair< int, int >, QPair< double, double > > LightCellStatistics;
+
+//!  LightCellTally struct counts the rays that a thread traces from each light cell.
+/*!
+ * A ray is a hit ray if it stores a photon in the exported surfaces, or in any surface when all
+ * surfaces are exported.
+*/
+struct LightCellTally
+{
+	explicit LightCellTally( int numberOfCells = 0 );
+	void Add( int cell, bool hit );
+
+	std::vector< double > rays;
+	std::vector< double > hits;
+};
+
+//!  LightCellSampling class chooses the light cell of each primary ray.
+/*!
+ * Without options each ray takes a cell at random with the same probability. With stratification, the
+ * sample n takes the stratum n mod N of the N cells with a jittered position, so each chunk of rays cycles through
+ * all the cells and the cells take the same number of rays.
+ *
+ * With an importance map, the cells are chosen with a probability proportional to their hit probability,
+ * learned from the statistics of previous ray tracings, mixed with a uniform fraction so that every cell can still be
+ * chosen. The weight of the ray is multiplied by 1 / ( N * p ) to keep the expected power of each cell.
+ *
+ * The ray tracing threads share the sampling and add their tallies to it.
+*/
+class LightCellSampling
+{
+
+public:
+	explicit LightCellSampling( const std::vector< QPair< int, int > >& cells );
+
+	void SetStratified( bool stratified );
+	bool SetImportance( const LightCellStatistics& statistics, double uniformFraction );
+	bool IsStratified() const;
+	bool HasImportance() const;
+
+	int NumberOfCells() const;
+	int SampleCell( unsigned long long sampleIndex, RandomDeviate& rand, double* rayWeight ) const;
+
+	void AddTally( LightCellTally& tally );
+	void UpdateStatistics( LightCellStatistics* statistics ) const;
+
+private:
+	std::vector< QPair< int, int > > m_cells;
+	bool m_stratified;
+	std::vector< double > m_cumulativeProbability;
+	std::vector< double > m_cellWeights;
+
+	QMutex m_tallyMutex;
+	LightCellTally m_tally;
+
+	LightCellSampling( const LightCellSampling& );
+	void operator=( const LightCellSampling& );
+};
+
+#endif /* LIGHTCELLSAMPLING_H_ */
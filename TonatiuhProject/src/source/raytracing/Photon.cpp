@@ -39,19 +39,21 @@ Juana Amieva, Azael Mancillas, Cesar Cantu.
 #include "Photon.h"
 
 Photon::Photon( )
-:id( -1 ), pos( Point3D()), side(-1 ), intersectedSurface(0 ), isAbsorbed( -1 )
+:id( -1 ), pos( Point3D()), side(-1 ), intersectedSurface(0 ), isAbsorbed( -1 ), weight( 1.0 ), absorbedWeight( 0.0 ), surfaceId( 0 ), exportPos( Point3D() )
 {
 
 }
 
 Photon::Photon( const Photon& photon )
-:id( photon.id ), pos( photon.pos ), side( photon.side ), intersectedSurface( photon.intersectedSurface ), isAbsorbed( photon.isAbsorbed )
+:id( photon.id ), pos( photon.pos ), side( photon.side ), intersectedSurface( photon.intersectedSurface ), isAbsorbed( photon.isAbsorbed ), weight( photon.weight ),
+ absorbedWeight( photon.absorbedWeight ), surfaceId( photon.surfaceId ), exportPos( photon.exportPos )
 {
 
 }
 
-Photon::Photon( Point3D pos, int side, double id, InstanceNode* intersectedSurface, int absorbedPhoton  )
-:id(id), pos(pos), side( side ), intersectedSurface( intersectedSurface ), isAbsorbed( absorbedPhoton)
+Photon::Photon( Point3D pos, int side, double id, InstanceNode* intersectedSurface, int absorbedPhoton, double photonWeight )
+:id(id), pos(pos), side( side ), intersectedSurface( intersectedSurface ), isAbsorbed( absorbedPhoton), weight( photonWeight ),
+ absorbedWeight( ( absorbedPhoton > 0 ) ? photonWeight : 0.0 ), surfaceId( 0 ), exportPos( pos )
 {
 
 }
@@ -46,14 +46,23 @@ struct Photon
 {
 	Photon( );
 	Photon( const Photon& photon );
-	Photon( Point3D pos, int side, double id = 0, InstanceNode* intersectedSurface = 0, int absorbedPhoton = 0 );
+	Photon( Point3D pos, int side, double id = 0, InstanceNode* intersectedSurface = 0, int absorbedPhoton = 0, double photonWeight = 1.0 );
 	~Photon();
 
 	double id;
 	Point3D pos;
 	int side;
 	InstanceNode* intersectedSurface;
+	//! One if the ray ends absorbed by the intersected surface. The reflection and the light photons have zero.
 	int isAbsorbed;
+	double weight;
+	//! Weight absorbed by the intersected surface: the weight of an absorbed photon, and weight * ( 1 - reflectance ) for a reflection with energy-weighted photons.
+	double absorbedWeight;
+
+	//! Index of the intersected surface assigned by the tracer. Zero if the photon is not tagged.
+	int surfaceId;
+	//! Position in the export coordinate system, global or local to the surface, computed by the tracer.
+	Point3D exportPos;
 };
 
 #endif /*PHOTON_H_*/
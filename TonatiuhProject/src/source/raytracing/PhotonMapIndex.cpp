@@ -0,0 +1,733 @@
+/***************************************************************************
+Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+This file is part of Tonatiuh.
+
+Tonatiuh program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Acknowledgments:
+
+The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+then Chair of the Department of Engineering of the University of Texas at
+Brownsville. From May 2004 to July 2008, it was supported by the Department
+of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+During 2007, NREL also contributed to the validation of Tonatiuh under the
+framework of the Memorandum of Understanding signed with the Spanish
+National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez,
+Juana Amieva, Azael Mancillas, Cesar Cantu.
+***************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <QDataStream>
+#include <QDir>
+#include <QFileInfo>
+#include <QMap>
+#include <QtEndian>
+#include <QVector>
+
+#include "PhotonMapIndex.h"
+#include "Point3D.h"
+
+namespace
+{
+	const char photonIndexMagic[8] = { 'T', 'N', 'H', 'P', 'I', 'D', 'X', '\0' };
+	const quint32 photonIndexVersion = 1;
+	const int maximumDivisions = 1024;
+	const int maximumBuckets = 256;
+	const unsigned long bucketBufferEntries = 4096;
+	const unsigned long recordsPerBlock = 1 << 15;
+
+	struct PhotonIndexHeader
+	{
+		char magic[8];
+		quint32 version;
+		quint32 numberOfColumns;
+		quint32 numberOfFiles;
+		quint32 numberOfSurfaces;
+		quint64 numberOfPhotons;
+		quint64 numberOfCells;
+	};
+
+	struct PhotonIndexDataFile
+	{
+		char fileName[256];
+		quint64 numberOfRecords;
+	};
+
+	struct PhotonIndexGrid
+	{
+		qint32 surfaceId;
+		qint32 divisions[3];
+		double min[3];
+		double cellSize[3];
+		quint64 firstCell;
+		quint64 numberOfPhotons;
+	};
+
+	/*
+	 * A photon placed in a bucket file with its position in the sorted index.
+	 */
+	struct PhotonBucketEntry
+	{
+		quint64 entry;
+		PhotonIndexEntry indexEntry;
+	};
+
+	/*
+	 * Reports the progress of the data file scans to a PhotonMapIndexProgress. Each scan is a quarter of the build.
+	 */
+	class BuildProgress
+	{
+
+	public:
+		BuildProgress( PhotonMapIndexProgress* progress, quint64 numberOfRecords )
+		:m_progress( progress ),
+		 m_numberOfRecords( std::max( numberOfRecords, quint64( 1 ) ) ),
+		 m_step( 0 ),
+		 m_percent( -1 )
+		{
+
+		}
+
+		void SetStep( int step )
+		{
+			m_step = step;
+			SetRecord( 0 );
+		}
+
+		void SetRecord( quint64 record )
+		{
+			int percent = int( 25 * m_step + ( 25 * record ) / m_numberOfRecords );
+			if( m_progress && percent != m_percent )	m_progress->SetProgress( percent );
+			m_percent = percent;
+		}
+
+	private:
+		PhotonMapIndexProgress* m_progress;
+		quint64 m_numberOfRecords;
+		int m_step;
+		int m_percent;
+	};
+
+	struct SurfaceBounds
+	{
+		SurfaceBounds()
+		:numberOfPhotons( 0 )
+		{
+
+		}
+
+		quint64 numberOfPhotons;
+		double min[3];
+		double max[3];
+	};
+
+	int CellCoordinate( const PhotonIndexGrid& grid, int axis, double value )
+	{
+		double cell = std::floor( ( value - grid.min[axis] ) / grid.cellSize[axis] );
+		if( !( cell > 0.0 ) )	return ( 0 );
+		if( cell >= grid.divisions[axis] )	return ( grid.divisions[axis] - 1 );
+		return ( int( cell ) );
+	}
+
+	quint64 CellIndex( const PhotonIndexGrid& grid, int i, int j, int k )
+	{
+		return ( grid.firstCell + ( quint64( k ) * grid.divisions[1] + j ) * grid.divisions[0] + i );
+	}
+
+	quint64 CellIndex( const PhotonIndexGrid& grid, const double position[3] )
+	{
+		return ( CellIndex( grid, CellCoordinate( grid, 0, position[0] ), CellCoordinate( grid, 1, position[1] ),
+				CellCoordinate( grid, 2, position[2] ) ) );
+	}
+
+	/*
+	 * Returns a grid over \a bounds with about \a photonsPerCell photons per cell. The axes where the photons
+	 * have no extent, as the normal of a flat surface in local coordinates, are not divided.
+	 */
+	PhotonIndexGrid SurfaceGrid( int surfaceId, const SurfaceBounds& bounds, unsigned long photonsPerCell )
+	{
+		PhotonIndexGrid grid;
+		grid.surfaceId = surfaceId;
+		grid.firstCell = 0;
+		grid.numberOfPhotons = bounds.numberOfPhotons;
+
+		double extent[3];
+		double maximumExtent = 0.0;
+		for( int a = 0; a < 3; ++a )
+		{
+			extent[a] = bounds.max[a] - bounds.min[a];
+			maximumExtent = std::max( maximumExtent, extent[a] );
+		}
+
+		int nActive = 0;
+		double volume = 1.0;
+		for( int a = 0; a < 3; ++a )
+		{
+			if( extent[a] > 1e-6 * maximumExtent && extent[a] > 0.0 )
+			{
+				nActive++;
+				volume *= extent[a];
+			}
+			else	extent[a] = 0.0;
+		}
+
+		double nCells = std::max( 1.0, double( bounds.numberOfPhotons ) / photonsPerCell );
+		double cellSize = ( nActive > 0 ) ? std::pow( volume / nCells, 1.0 / nActive ) : 0.0;
+		for( int a = 0; a < 3; ++a )
+		{
+			grid.min[a] = bounds.min[a];
+			grid.divisions[a] = 1;
+			if( extent[a] > 0.0 )
+				grid.divisions[a] = int( std::min( double( maximumDivisions ), std::max( 1.0, std::ceil( extent[a] / cellSize ) ) ) );
+			grid.cellSize[a] = ( extent[a] > 0.0 ) ? extent[a] / grid.divisions[a] : 1.0;
+		}
+		return ( grid );
+	}
+
+	double ReadDouble( const uchar* data )
+	{
+		quint64 bits = qFromBigEndian< quint64 >( data );
+		double value;
+		memcpy( &value, &bits, sizeof( value ) );
+		return ( value );
+	}
+
+	/*
+	 * Reads the photons of \a dataFiles, records of \a nColumns big endian doubles, in blocks and calls \a visitor
+	 * with the record number, the surface identifier and the position of each one. Returns false if a file can not
+	 * be read.
+	 */
+	template< class Visitor >
+	bool ScanPhotons( const QStringList& dataFiles, int nColumns, int coordinatesColumn, int surfaceColumn, Visitor& visitor,
+			BuildProgress& progress )
+	{
+		int recordSize = 8 * nColumns;
+		QByteArray block( int( recordsPerBlock * recordSize ), '\0' );
+		double position[3];
+		quint64 record = 0;
+		for( int f = 0; f < dataFiles.count(); ++f )
+		{
+			QFile dataFile( dataFiles[f] );
+			if( !dataFile.open( QIODevice::ReadOnly ) )	return ( false );
+
+			quint64 nRecords = dataFile.size() / recordSize;
+			for( quint64 r = 0; r < nRecords; r += recordsPerBlock )
+			{
+				quint64 nBlockRecords = std::min( quint64( recordsPerBlock ), nRecords - r );
+				qint64 blockSize = qint64( nBlockRecords * recordSize );
+				if( dataFile.read( block.data(), blockSize ) != blockSize )	return ( false );
+
+				const uchar* values = reinterpret_cast< const uchar* >( block.constData() );
+				for( quint64 b = 0; b < nBlockRecords; ++b, ++record, values += recordSize )
+				{
+					for( int a = 0; a < 3; ++a )	position[a] = ReadDouble( values + 8 * ( coordinatesColumn + a ) );
+					visitor( record, int( ReadDouble( values + 8 * surfaceColumn ) ), position );
+				}
+				progress.SetRecord( record );
+			}
+		}
+		return ( true );
+	}
+
+	struct BoundsVisitor
+	{
+		void operator()( quint64, int surfaceId, const double* position )
+		{
+			SurfaceBounds& bounds = surfaces[surfaceId];
+			for( int a = 0; a < 3; ++a )
+			{
+				if( bounds.numberOfPhotons == 0 || position[a] < bounds.min[a] )	bounds.min[a] = position[a];
+				if( bounds.numberOfPhotons == 0 || position[a] > bounds.max[a] )	bounds.max[a] = position[a];
+			}
+			bounds.numberOfPhotons++;
+		}
+
+		QMap< int, SurfaceBounds > surfaces;
+	};
+
+	struct CountVisitor
+	{
+		CountVisitor( const std::vector< PhotonIndexGrid >& grids, const QHash< int, int >& surfaceGrids, quint64 numberOfCells )
+		:m_grids( grids ),
+		 m_surfaceGrids( surfaceGrids ),
+		 cellCounts( numberOfCells, 0 )
+		{
+
+		}
+
+		void operator()( quint64, int surfaceId, const double* position )
+		{
+			cellCounts[CellIndex( m_grids[m_surfaceGrids.value( surfaceId )], position )]++;
+		}
+
+		const std::vector< PhotonIndexGrid >& m_grids;
+		const QHash< int, int >& m_surfaceGrids;
+		std::vector< quint64 > cellCounts;
+	};
+
+	/*
+	 * Appends each photon to the bucket file of its position in the sorted index. The bucket b has the
+	 * entries in [b * bucketSize, ( b + 1 ) * bucketSize).
+	 */
+	struct BucketVisitor
+	{
+		BucketVisitor( const std::vector< PhotonIndexGrid >& grids, const QHash< int, int >& surfaceGrids,
+				const std::vector< quint64 >& cellStart, quint64 bucketSize, const QVector< QFile* >& bucketFiles )
+		:m_grids( grids ),
+		 m_surfaceGrids( surfaceGrids ),
+		 m_cursors( cellStart.begin(), cellStart.end() - 1 ),
+		 m_bucketSize( bucketSize ),
+		 m_bucketFiles( bucketFiles ),
+		 m_buffers( bucketFiles.size() ),
+		 isWritten( true )
+		{
+
+		}
+
+		void operator()( quint64 record, int surfaceId, const double* position )
+		{
+			PhotonBucketEntry bucketEntry;
+			bucketEntry.entry = m_cursors[CellIndex( m_grids[m_surfaceGrids.value( surfaceId )], position )]++;
+			for( int a = 0; a < 3; ++a )	bucketEntry.indexEntry.position[a] = position[a];
+			bucketEntry.indexEntry.record = record;
+
+			int bucket = int( bucketEntry.entry / m_bucketSize );
+			m_buffers[bucket].push_back( bucketEntry );
+			if( m_buffers[bucket].size() == bucketBufferEntries )	FlushBucket( bucket );
+		}
+
+		void Flush()
+		{
+			for( int b = 0; b < m_buffers.size(); ++b )	FlushBucket( b );
+		}
+
+		void FlushBucket( int bucket )
+		{
+			std::vector< PhotonBucketEntry >& buffer = m_buffers[bucket];
+			if( buffer.empty() )	return;
+
+			qint64 bufferSize = buffer.size() * sizeof( PhotonBucketEntry );
+			isWritten = isWritten && ( m_bucketFiles[bucket]->write( reinterpret_cast< const char* >( &buffer[0] ), bufferSize ) == bufferSize );
+			buffer.clear();
+		}
+
+		const std::vector< PhotonIndexGrid >& m_grids;
+		const QHash< int, int >& m_surfaceGrids;
+		std::vector< quint64 > m_cursors;
+		quint64 m_bucketSize;
+		const QVector< QFile* >& m_bucketFiles;
+		QVector< std::vector< PhotonBucketEntry > > m_buffers;
+		bool isWritten;
+	};
+
+	/*
+	 * Writes to \a indexFile the \a numberOfEntries sorted entries of the photons in \a bucketFile, that
+	 * start in the entry \a firstEntry. Returns false if the bucket can not be read or the index written.
+	 */
+	bool WriteBucket( QFile* bucketFile, quint64 firstEntry, unsigned long numberOfEntries, QFile* indexFile )
+	{
+		if( !bucketFile->seek( 0 ) )	return ( false );
+
+		std::vector< PhotonIndexEntry > entries( numberOfEntries );
+		std::vector< PhotonBucketEntry > buffer( bucketBufferEntries );
+		unsigned long nEntries = 0;
+		while( nEntries < numberOfEntries )
+		{
+			qint64 bufferSize = std::min( bucketBufferEntries, numberOfEntries - nEntries ) * sizeof( PhotonBucketEntry );
+			if( bucketFile->read( reinterpret_cast< char* >( &buffer[0] ), bufferSize ) != bufferSize )	return ( false );
+
+			for( unsigned long e = 0; e < bufferSize / sizeof( PhotonBucketEntry ); ++e, ++nEntries )
+			{
+				quint64 entry = buffer[e].entry - firstEntry;
+				if( entry >= numberOfEntries )	return ( false );
+				entries[entry] = buffer[e].indexEntry;
+			}
+		}
+
+		qint64 entriesSize = entries.size() * sizeof( PhotonIndexEntry );
+		return ( indexFile->write( reinterpret_cast< const char* >( &entries[0] ), entriesSize ) == entriesSize );
+	}
+}
+
+/*!
+ * Creates a closed index.
+ */
+PhotonMapIndex::PhotonMapIndex()
+:m_data( 0 ),
+ m_gridsOffset( 0 ),
+ m_cellsOffset( 0 ),
+ m_entriesOffset( 0 ),
+ m_numberOfPhotons( 0 ),
+ m_numberOfColumns( 0 )
+{
+
+}
+
+/*!
+ * Closes the index.
+ */
+PhotonMapIndex::~PhotonMapIndex()
+{
+	Close();
+}
+
+/*!
+ * Builds the index \a fileName of the photons in \a dataFiles, with the values named \a columns for each photon,
+ * as in the "<name>_parameters.txt" file of the export. The columns must include the coordinates and the surface
+ * identifier. The grid of each surface has about \a photonsPerCell photons per cell.
+ *
+ * The data files are read three times: to compute the surfaces bounding boxes, to count the photons of each cell
+ * and to append each photon to the bucket file of its range of sorted entries. Then each bucket is sorted in
+ * memory and written to the index. A bucket has \a entriesInMemory entries, or more if the photon map needs more
+ * than 256 buckets. The index is written to a temporary file that replaces \a fileName when it is complete.
+ *
+ * If \a progress is not null, it receives the progress of the build.
+ *
+ * Returns false and the reason in \a errorMessage if the index can not be built.
+ */
+bool PhotonMapIndex::Build( const QString& fileName, const QStringList& dataFiles, const QStringList& columns,
+		unsigned long photonsPerCell, QString* errorMessage, PhotonMapIndexProgress* progress,
+		unsigned long entriesInMemory )
+{
+	int nColumns = columns.count();
+	int coordinatesColumn = columns.indexOf( QLatin1String( "x" ) );
+	int surfaceColumn = columns.indexOf( QLatin1String( "surface ID" ) );
+	if( coordinatesColumn < 0 || columns.indexOf( QLatin1String( "y" ) ) != coordinatesColumn + 1 ||
+			columns.indexOf( QLatin1String( "z" ) ) != coordinatesColumn + 2 || surfaceColumn < 0 )
+	{
+		*errorMessage = QLatin1String( "The photon map does not have the coordinates and the surface identifiers." );
+		return ( false );
+	}
+	if( photonsPerCell < 1 )	photonsPerCell = 1;
+	if( entriesInMemory < 1 )	entriesInMemory = 1;
+
+	quint64 numberOfRecords = 0;
+	std::vector< PhotonIndexDataFile > files( dataFiles.count() );
+	for( int f = 0; f < dataFiles.count(); ++f )
+	{
+		QFileInfo dataFileInfo( dataFiles[f] );
+		QByteArray dataFileName = dataFileInfo.fileName().toUtf8();
+		if( dataFileName.size() >= int( sizeof( files[f].fileName ) ) || dataFileInfo.size() % ( 8 * nColumns ) != 0 )
+		{
+			*errorMessage = QString( QLatin1String( "%1 is not a valid photon map data file." ) ).arg( dataFiles[f] );
+			return ( false );
+		}
+
+		memset( files[f].fileName, 0, sizeof( files[f].fileName ) );
+		memcpy( files[f].fileName, dataFileName.constData(), dataFileName.size() );
+		files[f].numberOfRecords = dataFileInfo.size() / ( 8 * nColumns );
+		numberOfRecords += files[f].numberOfRecords;
+	}
+
+	BuildProgress buildProgress( progress, numberOfRecords );
+	BoundsVisitor bounds;
+	if( !ScanPhotons( dataFiles, nColumns, coordinatesColumn, surfaceColumn, bounds, buildProgress ) )
+	{
+		*errorMessage = QLatin1String( "Cannot read the photon map data files." );
+		return ( false );
+	}
+
+	std::vector< PhotonIndexGrid > grids;
+	QHash< int, int > surfaceGrids;
+	quint64 numberOfCells = 0;
+	quint64 numberOfPhotons = 0;
+	for( QMap< int, SurfaceBounds >::const_iterator s = bounds.surfaces.constBegin(); s != bounds.surfaces.constEnd(); ++s )
+	{
+		PhotonIndexGrid grid = SurfaceGrid( s.key(), s.value(), photonsPerCell );
+		grid.firstCell = numberOfCells;
+		numberOfCells += quint64( grid.divisions[0] ) * grid.divisions[1] * grid.divisions[2];
+		numberOfPhotons += grid.numberOfPhotons;
+
+		surfaceGrids.insert( s.key(), int( grids.size() ) );
+		grids.push_back( grid );
+	}
+
+	buildProgress.SetStep( 1 );
+	CountVisitor counter( grids, surfaceGrids, numberOfCells );
+	if( !ScanPhotons( dataFiles, nColumns, coordinatesColumn, surfaceColumn, counter, buildProgress ) )
+	{
+		*errorMessage = QLatin1String( "Cannot read the photon map data files." );
+		return ( false );
+	}
+
+	std::vector< quint64 > cellStart( numberOfCells + 1, 0 );
+	for( quint64 c = 0; c < numberOfCells; ++c )
+		cellStart[c + 1] = cellStart[c] + counter.cellCounts[c];
+
+	PhotonIndexHeader header;
+	memcpy( header.magic, photonIndexMagic, sizeof( photonIndexMagic ) );
+	header.version = photonIndexVersion;
+	header.numberOfColumns = nColumns;
+	header.numberOfFiles = files.size();
+	header.numberOfSurfaces = grids.size();
+	header.numberOfPhotons = numberOfPhotons;
+	header.numberOfCells = numberOfCells;
+
+	quint64 bucketSize = std::max( quint64( entriesInMemory ), ( numberOfPhotons + maximumBuckets - 1 ) / maximumBuckets );
+	int nBuckets = int( ( numberOfPhotons + bucketSize - 1 ) / bucketSize );
+	QVector< QFile* > bucketFiles;
+	bool isWritten = true;
+	for( int b = 0; isWritten && b < nBuckets; ++b )
+	{
+		bucketFiles.push_back( new QFile( QString( QLatin1String( "%1.bucket%2" ) ).arg( fileName, QString::number( b ) ) ) );
+		isWritten = bucketFiles[b]->open( QIODevice::ReadWrite | QIODevice::Truncate );
+	}
+
+	bool isRead = true;
+	if( isWritten )
+	{
+		buildProgress.SetStep( 2 );
+		BucketVisitor bucketer( grids, surfaceGrids, cellStart, bucketSize, bucketFiles );
+		isRead = ScanPhotons( dataFiles, nColumns, coordinatesColumn, surfaceColumn, bucketer, buildProgress );
+		bucketer.Flush();
+		isWritten = bucketer.isWritten;
+	}
+
+	QString temporaryFileName = fileName + QLatin1String( ".tmp" );
+	QFile indexFile( temporaryFileName );
+	isWritten = isRead && isWritten && indexFile.open( QIODevice::WriteOnly | QIODevice::Truncate );
+
+	isWritten = isWritten && ( indexFile.write( reinterpret_cast< const char* >( &header ), sizeof( header ) ) == qint64( sizeof( header ) ) );
+	if( !files.empty() )
+		isWritten = isWritten && ( indexFile.write( reinterpret_cast< const char* >( &files[0] ), files.size() * sizeof( PhotonIndexDataFile ) )
+				== qint64( files.size() * sizeof( PhotonIndexDataFile ) ) );
+	if( !grids.empty() )
+		isWritten = isWritten && ( indexFile.write( reinterpret_cast< const char* >( &grids[0] ), grids.size() * sizeof( PhotonIndexGrid ) )
+				== qint64( grids.size() * sizeof( PhotonIndexGrid ) ) );
+	isWritten = isWritten && ( indexFile.write( reinterpret_cast< const char* >( &cellStart[0] ), cellStart.size() * sizeof( quint64 ) )
+			== qint64( cellStart.size() * sizeof( quint64 ) ) );
+
+	buildProgress.SetStep( 3 );
+	for( int b = 0; isWritten && b < nBuckets; ++b )
+	{
+		quint64 firstEntry = b * bucketSize;
+		isWritten = WriteBucket( bucketFiles[b], firstEntry, ( unsigned long ) std::min( bucketSize, numberOfPhotons - firstEntry ), &indexFile );
+		buildProgress.SetRecord( std::min( firstEntry + bucketSize, numberOfPhotons ) );
+	}
+	isWritten = isWritten && indexFile.flush();
+	indexFile.close();
+
+	for( int b = 0; b < bucketFiles.size(); ++b )
+	{
+		bucketFiles[b]->close();
+		bucketFiles[b]->remove();
+		delete bucketFiles[b];
+	}
+
+	if( isWritten )
+	{
+		QFile::remove( fileName );
+		isWritten = QFile::rename( temporaryFileName, fileName );
+	}
+	if( !isWritten )	QFile::remove( temporaryFileName );
+
+	if( !isRead )	*errorMessage = QLatin1String( "Cannot read the photon map data files." );
+	else if( !isWritten )	*errorMessage = QString( QLatin1String( "Cannot write %1." ) ).arg( fileName );
+	else	buildProgress.SetStep( 4 );
+	return ( isRead && isWritten );
+}
+
+/*!
+ * Opens the index \a fileName. The data files of the photon map must be in the directory of the index.
+ * Returns false if the file is not a valid index.
+ */
+bool PhotonMapIndex::Open( const QString& fileName )
+{
+	Close();
+
+	m_file.setFileName( fileName );
+	if( !m_file.open( QIODevice::ReadOnly ) )	return ( false );
+
+	PhotonIndexHeader header;
+	if( m_file.read( reinterpret_cast< char* >( &header ), sizeof( header ) ) != qint64( sizeof( header ) ) ||
+			memcmp( header.magic, photonIndexMagic, sizeof( photonIndexMagic ) ) != 0 || header.version != photonIndexVersion )
+	{
+		Close();
+		return ( false );
+	}
+
+	m_gridsOffset = sizeof( header ) + qint64( header.numberOfFiles ) * sizeof( PhotonIndexDataFile );
+	m_cellsOffset = m_gridsOffset + qint64( header.numberOfSurfaces ) * sizeof( PhotonIndexGrid );
+	m_entriesOffset = m_cellsOffset + qint64( header.numberOfCells + 1 ) * sizeof( quint64 );
+	if( m_file.size() != m_entriesOffset + qint64( header.numberOfPhotons * sizeof( PhotonIndexEntry ) ) )
+	{
+		Close();
+		return ( false );
+	}
+
+	m_data = m_file.map( 0, m_file.size() );
+	if( !m_data )
+	{
+		Close();
+		return ( false );
+	}
+
+	QDir indexDirectory = QFileInfo( fileName ).absoluteDir();
+	const PhotonIndexDataFile* files = reinterpret_cast< const PhotonIndexDataFile* >( m_data + sizeof( header ) );
+	for( quint32 f = 0; f < header.numberOfFiles; ++f )
+	{
+		QByteArray dataFileName( files[f].fileName, int( strnlen( files[f].fileName, sizeof( files[f].fileName ) ) ) );
+		m_dataFiles<<indexDirectory.absoluteFilePath( QString::fromUtf8( dataFileName.constData(), dataFileName.size() ) );
+		m_dataFileRecords.push_back( files[f].numberOfRecords );
+	}
+
+	const PhotonIndexGrid* grids = reinterpret_cast< const PhotonIndexGrid* >( m_data + m_gridsOffset );
+	for( quint32 s = 0; s < header.numberOfSurfaces; ++s )
+		m_surfaceGrids.insert( grids[s].surfaceId, int( s ) );
+
+	m_numberOfPhotons = header.numberOfPhotons;
+	m_numberOfColumns = header.numberOfColumns;
+	return ( true );
+}
+
+/*!
+ * Closes the index file.
+ */
+void PhotonMapIndex::Close()
+{
+	m_file.close();
+	m_data = 0;
+	m_gridsOffset = 0;
+	m_cellsOffset = 0;
+	m_entriesOffset = 0;
+	m_numberOfPhotons = 0;
+	m_numberOfColumns = 0;
+	m_dataFiles.clear();
+	m_dataFileRecords.clear();
+	m_surfaceGrids.clear();
+}
+
+/*!
+ * Returns the identifiers of the surfaces with photons, in increasing order.
+ */
+QList< int > PhotonMapIndex::Surfaces() const
+{
+	QList< int > surfaces = m_surfaceGrids.keys();
+	std::sort( surfaces.begin(), surfaces.end() );
+	return ( surfaces );
+}
+
+/*!
+ * Returns the photons of the surface \a surfaceId.
+ */
+std::vector< PhotonIndexEntry > PhotonMapIndex::SurfacePhotons( int surfaceId ) const
+{
+	std::vector< PhotonIndexEntry > photons;
+	if( !m_data || !m_surfaceGrids.contains( surfaceId ) )	return ( photons );
+
+	const PhotonIndexGrid& grid = reinterpret_cast< const PhotonIndexGrid* >( m_data + m_gridsOffset )[m_surfaceGrids.value( surfaceId )];
+	const quint64* cellStart = reinterpret_cast< const quint64* >( m_data + m_cellsOffset );
+	const PhotonIndexEntry* entries = reinterpret_cast< const PhotonIndexEntry* >( m_data + m_entriesOffset );
+
+	quint64 firstEntry = cellStart[grid.firstCell];
+	photons.assign( entries + firstEntry, entries + firstEntry + grid.numberOfPhotons );
+	return ( photons );
+}
+
+/*!
+ * Returns the photons of the surface \a surfaceId inside the box from \a pMin to \a pMax, boundary included.
+ * Only the cells of the grid that overlap the box are read.
+ */
+std::vector< PhotonIndexEntry > PhotonMapIndex::BoxPhotons( int surfaceId, const Point3D& pMin, const Point3D& pMax ) const
+{
+	std::vector< PhotonIndexEntry > photons;
+	if( !m_data || !m_surfaceGrids.contains( surfaceId ) )	return ( photons );
+	if( pMin.x > pMax.x || pMin.y > pMax.y || pMin.z > pMax.z )	return ( photons );
+
+	const PhotonIndexGrid& grid = reinterpret_cast< const PhotonIndexGrid* >( m_data + m_gridsOffset )[m_surfaceGrids.value( surfaceId )];
+	const quint64* cellStart = reinterpret_cast< const quint64* >( m_data + m_cellsOffset );
+	const PhotonIndexEntry* entries = reinterpret_cast< const PhotonIndexEntry* >( m_data + m_entriesOffset );
+
+	double lower[3] = { pMin.x, pMin.y, pMin.z };
+	double upper[3] = { pMax.x, pMax.y, pMax.z };
+	int first[3];
+	int last[3];
+	for( int a = 0; a < 3; ++a )
+	{
+		first[a] = CellCoordinate( grid, a, lower[a] );
+		last[a] = CellCoordinate( grid, a, upper[a] );
+	}
+
+	//The cells of a row along x are contiguous
+	for( int k = first[2]; k <= last[2]; ++k )
+	{
+		for( int j = first[1]; j <= last[1]; ++j )
+		{
+			quint64 rowEnd = cellStart[CellIndex( grid, last[0], j, k ) + 1];
+			for( quint64 e = cellStart[CellIndex( grid, first[0], j, k )]; e < rowEnd; ++e )
+			{
+				const PhotonIndexEntry& entry = entries[e];
+				if( entry.position[0] >= lower[0] && entry.position[0] <= upper[0] &&
+						entry.position[1] >= lower[1] && entry.position[1] <= upper[1] &&
+						entry.position[2] >= lower[2] && entry.position[2] <= upper[2] )
+					photons.push_back( entry );
+			}
+		}
+	}
+	return ( photons );
+}
+
+/*!
+ * Returns the photons of the surface \a surfaceId at a distance from \a center not greater than \a radius.
+ */
+std::vector< PhotonIndexEntry > PhotonMapIndex::RadiusPhotons( int surfaceId, const Point3D& center, double radius ) const
+{
+	std::vector< PhotonIndexEntry > boxPhotons = BoxPhotons( surfaceId,
+			Point3D( center.x - radius, center.y - radius, center.z - radius ),
+			Point3D( center.x + radius, center.y + radius, center.z + radius ) );
+
+	std::vector< PhotonIndexEntry > photons;
+	for( unsigned long p = 0; p < boxPhotons.size(); ++p )
+	{
+		double dx = boxPhotons[p].position[0] - center.x;
+		double dy = boxPhotons[p].position[1] - center.y;
+		double dz = boxPhotons[p].position[2] - center.z;
+		if( dx * dx + dy * dy + dz * dz <= radius * radius )	photons.push_back( boxPhotons[p] );
+	}
+	return ( photons );
+}
+
+/*!
+ * Reads in \a values all the exported values of the photon with the record number \a record.
+ */
+bool PhotonMapIndex::ReadPhoton( quint64 record, std::vector< double >* values ) const
+{
+	int f = 0;
+	while( f < m_dataFiles.count() && record >= m_dataFileRecords[f] )
+	{
+		record -= m_dataFileRecords[f];
+		f++;
+	}
+	if( f >= m_dataFiles.count() )	return ( false );
+
+	QFile dataFile( m_dataFiles[f] );
+	if( !dataFile.open( QIODevice::ReadOnly ) || !dataFile.seek( qint64( record ) * 8 * m_numberOfColumns ) )	return ( false );
+
+	QDataStream in( &dataFile );
+	values->resize( m_numberOfColumns );
+	for( int c = 0; c < m_numberOfColumns; ++c )	in>>( *values )[c];
+	return ( in.status() == QDataStream::Ok );
+}
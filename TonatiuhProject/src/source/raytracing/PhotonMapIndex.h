@@ -0,0 +1,120 @@
+/***************************************************************************
+Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+This file is part of Tonatiuh.
+
+Tonatiuh program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Acknowledgments:
+
+The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+then Chair of the Department of Engineering of the University of Texas at
+Brownsville. From May 2004 to July 2008, it was supported by the Department
+of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+During 2007, NREL also contributed to the validation of Tonatiuh under the
+framework of the Memorandum of Understanding signed with the Spanish
+National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez,
+Juana Amieva, Azael Mancillas, Cesar Cantu.
+***************************************************************************/
+
+#ifndef PHOTONMAPINDEX_H_
+#define PHOTONMAPINDEX_H_
+
+#include <vector>
+
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+class Point3D;
+
+//!  PhotonIndexEntry struct is a photon of the spatial index: its exported coordinates and its record number.
+/*!
+ * The record number is the position of the photon in the data files of the photon map, counting the records of
+ * the previous files.
+*/
+struct PhotonIndexEntry
+{
+	double position[3];
+	quint64 record;
+};
+
+//!  PhotonMapIndexProgress class receives the progress of the index build.
+/*!
+ * SetProgress is called from the thread that builds the index.
+*/
+class PhotonMapIndexProgress
+{
+
+public:
+	virtual ~PhotonMapIndexProgress() {};
+	virtual void SetProgress( int percent ) = 0;
+};
+
+//!  PhotonMapIndex class is a spatial index over the photons of an exported photon map.
+/*!
+ * The index has a uniform grid for each surface identifier over the bounding box of its photons, in the exported
+ * coordinates. The photons are stored sorted by surface and grid cell, so the photons of a surface or of a region
+ * of a surface are read without scanning the photon map data files.
+ *
+ * The index is built from the uncompressed data files of the "Binary_file" export. The file is in native byte
+ * order and is memory mapped to answer the queries.
+*/
+class PhotonMapIndex
+{
+
+public:
+	PhotonMapIndex();
+	~PhotonMapIndex();
+
+	static bool Build( const QString& fileName, const QStringList& dataFiles, const QStringList& columns,
+			unsigned long photonsPerCell, QString* errorMessage, PhotonMapIndexProgress* progress = 0,
+			unsigned long entriesInMemory = 1 << 22 );
+
+	bool Open( const QString& fileName );
+	void Close();
+
+	unsigned long NumberOfPhotons() const { return ( m_numberOfPhotons ); };
+	QList< int > Surfaces() const;
+
+	std::vector< PhotonIndexEntry > SurfacePhotons( int surfaceId ) const;
+	std::vector< PhotonIndexEntry > BoxPhotons( int surfaceId, const Point3D& pMin, const Point3D& pMax ) const;
+	std::vector< PhotonIndexEntry > RadiusPhotons( int surfaceId, const Point3D& center, double radius ) const;
+
+	bool ReadPhoton( quint64 record, std::vector< double >* values ) const;
+
+private:
+	QFile m_file;
+	const uchar* m_data;
+	qint64 m_gridsOffset;
+	qint64 m_cellsOffset;
+	qint64 m_entriesOffset;
+	unsigned long m_numberOfPhotons;
+	int m_numberOfColumns;
+	QStringList m_dataFiles;
+	std::vector< quint64 > m_dataFileRecords;
+	QHash< int, int > m_surfaceGrids;
+};
+
+#endif /* PHOTONMAPINDEX_H_ */
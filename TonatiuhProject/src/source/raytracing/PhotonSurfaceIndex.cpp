@@ -0,0 +1,131 @@
+/***************************************************************************
+Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+This file is part of Tonatiuh.
+
+Tonatiuh program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Acknowledgments:
+
+The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+then Chair of the Department of Engineering of the University of Texas at
+Brownsville. From May 2004 to July 2008, it was supported by the Department
+of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+During 2007, NREL also contributed to the validation of Tonatiuh under the
+framework of the Memorandum of Understanding signed with the Spanish
+National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez,
+Juana Amieva, Azael Mancillas, Cesar Cantu.
+***************************************************************************/
+
+#include "InstanceNode.h"
+#include "Photon.h"
+#include "PhotonSurfaceIndex.h"
+#include "TShapeKit.h"
+
+/*!
+ * Creates an empty index that tags the photons with global coordinates.
+ */
+PhotonSurfaceIndex::PhotonSurfaceIndex()
+:m_globalCoordinates( true ),
+ m_concentratorToWorld( 1.0, 0.0, 0.0, 0.0,
+		 0.0, 1.0, 0.0, 0.0,
+		 0.0, 0.0, 1.0, 0.0,
+		 0.0, 0.0, 0.0, 1.0 )
+{
+
+}
+
+/*!
+ * Adds \a surface to the index with its current world to object transform. A surface is only indexed once.
+ */
+void PhotonSurfaceIndex::AddSurface( InstanceNode* surface )
+{
+	if( !surface || m_surfaceIds.contains( surface ) )	return;
+
+	m_surfaces.push_back( surface );
+	m_surfaceWorldToObject.push_back( surface->GetIntersectionTransform() );
+	m_surfaceIds.insert( surface, m_surfaces.size() );
+}
+
+/*!
+ * Adds the shape kits of the sub-tree with top node \a instanceNode in tree order. The world to object transforms
+ * must be computed before.
+ */
+void PhotonSurfaceIndex::AddSurfaces( InstanceNode* instanceNode )
+{
+	if( !instanceNode || !instanceNode->GetNode() )	return;
+
+	if( instanceNode->GetNode()->getTypeId().isDerivedFrom( TShapeKit::getClassTypeId() ) )
+		AddSurface( instanceNode );
+	else
+	{
+		for( int index = 0; index < instanceNode->children.count(); ++index )
+			AddSurfaces( instanceNode->children[index] );
+	}
+}
+
+/*!
+ * Tags the photons with the coordinates in the scene system if \a global is true, transforming them with
+ * \a concentratorToWorld. Otherwise, tags the photons with the coordinates local to their surface.
+ */
+void PhotonSurfaceIndex::SetExportCoordinates( bool global, Transform concentratorToWorld )
+{
+	m_globalCoordinates = global;
+	m_concentratorToWorld = concentratorToWorld;
+}
+
+/*!
+ * Returns the number of indexed surfaces.
+ */
+int PhotonSurfaceIndex::NumberOfSurfaces() const
+{
+	return ( m_surfaces.size() );
+}
+
+/*!
+ * Returns the surface with index \a surfaceId, or null if there is no surface with this index.
+ */
+InstanceNode* PhotonSurfaceIndex::Surface( int surfaceId ) const
+{
+	if( surfaceId < 1 || surfaceId > m_surfaces.size() )	return ( 0 );
+	return ( m_surfaces[surfaceId - 1] );
+}
+
+/*!
+ * Returns the index of \a surface, or zero if the surface is not indexed.
+ */
+int PhotonSurfaceIndex::SurfaceId( InstanceNode* surface ) const
+{
+	return ( m_surfaceIds.value( surface, 0 ) );
+}
+
+/*!
+ * Sets the surface index and the export coordinates of \a photon.
+ */
+void PhotonSurfaceIndex::Tag( Photon* photon ) const
+{
+	photon->surfaceId = photon->intersectedSurface ? SurfaceId( photon->intersectedSurface ) : 0;
+
+	if( m_globalCoordinates )	photon->exportPos = m_concentratorToWorld( photon->pos );
+	else if( photon->surfaceId > 0 )	photon->exportPos = m_surfaceWorldToObject[photon->surfaceId - 1]( photon->pos );
+	else	photon->exportPos = photon->pos;
+}
@@ -0,0 +1,158 @@
+/***************************************************************************
+Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+This file is part of Tonatiuh.
+
+Tonatiuh program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Acknowledgments:
+
+The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+then Chair of the Department of Engineering of the University of Texas at
+Brownsville. From May 2004 to July 2008, it was supported by the Department
+of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+During 2007, NREL also contributed to the validation of Tonatiuh under the
+framework of the Memorandum of Understanding signed with the Spanish
+National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez,
+Juana Amieva, Azael Mancillas, Cesar Cantu.
+***************************************************************************/
+
+#include <QMutexLocker>
+
+#include "Photon.h"
+#include "PhotonTally.h"
+
+namespace
+{
+	/*
+	 * Resizes \a counts to store the surface identifier \a surfaceId.
+	 */
+	void ReserveSurface( PhotonTallyCounts& counts, unsigned long surfaceId )
+	{
+		if( surfaceId < counts.surfaces.size() )	return;
+
+		counts.hits.resize( 2 * surfaceId + 2, 0.0 );
+		counts.absorbedHits.resize( 2 * surfaceId + 2, 0.0 );
+		counts.weights.resize( 2 * surfaceId + 2, 0.0 );
+		counts.absorbedWeights.resize( 2 * surfaceId + 2, 0.0 );
+		counts.surfaces.resize( surfaceId + 1, 0 );
+	}
+}
+
+/*!
+ * Adds the photons of \a photonsVector to the counts of their surfaces and sides.
+ */
+void PhotonTallyCounts::Add( const std::vector< Photon >& photonsVector )
+{
+	for( unsigned long p = 0; p < photonsVector.size(); ++p )
+	{
+		const Photon& photon = photonsVector[p];
+		unsigned long surfaceId = ( photon.surfaceId > 0 ) ? photon.surfaceId : 0;
+		ReserveSurface( *this, surfaceId );
+		if( !surfaces[surfaceId] )	surfaces[surfaceId] = photon.intersectedSurface;
+
+		unsigned long index = 2 * surfaceId + ( ( photon.side > 0 ) ? 1 : 0 );
+		hits[index] += 1.0;
+		weights[index] += photon.weight;
+		if( photon.isAbsorbed > 0 )	absorbedHits[index] += 1.0;
+		absorbedWeights[index] += photon.absorbedWeight;
+	}
+}
+
+/*!
+ * Adds \a counts to these counts.
+ */
+void PhotonTallyCounts::Add( const PhotonTallyCounts& counts )
+{
+	if( counts.surfaces.empty() )	return;
+	ReserveSurface( *this, counts.surfaces.size() - 1 );
+
+	for( unsigned long s = 0; s < counts.surfaces.size(); ++s )
+		if( !surfaces[s] )	surfaces[s] = counts.surfaces[s];
+
+	for( unsigned long i = 0; i < counts.hits.size(); ++i )
+	{
+		hits[i] += counts.hits[i];
+		absorbedHits[i] += counts.absorbedHits[i];
+		weights[i] += counts.weights[i];
+		absorbedWeights[i] += counts.absorbedWeights[i];
+	}
+}
+
+/*!
+ * Removes all the counts.
+ */
+void PhotonTallyCounts::Clear()
+{
+	hits.clear();
+	absorbedHits.clear();
+	weights.clear();
+	absorbedWeights.clear();
+	surfaces.clear();
+}
+
+/*!
+ * Creates an empty tally.
+ */
+PhotonTally::PhotonTally()
+{
+
+}
+
+/*!
+ * Adds the \a counts of a thread to the tally and clears them.
+ *
+ * Called from the ray tracing threads.
+ */
+void PhotonTally::AddTally( PhotonTallyCounts& counts )
+{
+	QMutexLocker locker( &m_mutex );
+	m_counts.Add( counts );
+	counts.Clear();
+}
+
+/*!
+ * Removes all the counts of the tally.
+ */
+void PhotonTally::Clear()
+{
+	QMutexLocker locker( &m_mutex );
+	m_counts.Clear();
+}
+
+/*!
+ * Returns the counts tallied until now.
+ */
+PhotonTallyCounts PhotonTally::Counts() const
+{
+	QMutexLocker locker( &m_mutex );
+	return ( m_counts );
+}
+
+/*!
+ * Replaces the counts of the tally with \a counts, to restore a saved tally.
+ */
+void PhotonTally::SetCounts( const PhotonTallyCounts& counts )
+{
+	QMutexLocker locker( &m_mutex );
+	m_counts = counts;
+}
@@ -0,0 +1,95 @@
+/***************************************************************************
+Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+This file is part of Tonatiuh.
+
+Tonatiuh program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Acknowledgments:
+
+The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+then Chair of the Department of Engineering of the University of Texas at
+Brownsville. From May 2004 to July 2008, it was supported by the Department
+of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+During 2007, NREL also contributed to the validation of Tonatiuh under the
+framework of the Memorandum of Understanding signed with the Spanish
+National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez,
+Juana Amieva, Azael Mancillas, Cesar Cantu.
+***************************************************************************/
+
+#ifndef PHOTONTALLY_H_
+#define PHOTONTALLY_H_
+
+#include <vector>
+
+#include <QMutex>
+
+class InstanceNode;
+struct Photon;
+
+//!  PhotonTallyCounts struct accumulates the photons of a thread by surface identifier and side.
+/*!
+ * The counts of the surface identifier s and side k are at the index 2 * s + k. The weights are the sums
+ * of the photon weights, the power in units of the power per photon. The absorbed hits are the rays that end
+ * absorbed and the absorbed weights also include the power absorbed by the reflections with energy-weighted
+ * photons. The vectors grow with the identifiers found.
+*/
+struct PhotonTallyCounts
+{
+	void Add( const std::vector< Photon >& photonsVector );
+	void Add( const PhotonTallyCounts& counts );
+	void Clear();
+	int NumberOfSurfaces() const { return ( int( surfaces.size() ) ); };
+
+	std::vector< double > hits;
+	std::vector< double > absorbedHits;
+	std::vector< double > weights;
+	std::vector< double > absorbedWeights;
+	std::vector< InstanceNode* > surfaces;
+};
+
+//!  PhotonTally class is the energy balance of a ray tracing by surface and side.
+/*!
+ * The photons are tallied instead of stored in the photon map. The ray tracing threads count their photons
+ * in their own PhotonTallyCounts and add them to the tally, so the counting needs no synchronization per photon.
+ * The photons must have the surface identifiers of a PhotonSurfaceIndex.
+*/
+class PhotonTally
+{
+
+public:
+	PhotonTally();
+
+	void AddTally( PhotonTallyCounts& counts );
+	void Clear();
+	PhotonTallyCounts Counts() const;
+	void SetCounts( const PhotonTallyCounts& counts );
+
+private:
+	mutable QMutex m_mutex;
+	PhotonTallyCounts m_counts;
+
+	PhotonTally( const PhotonTally& );
+	void operator=( const PhotonTally& );
+};
+
+#endif /* PHOTONTALLY_H_ */
@@ -0,0 +1,248 @@
+/***************************************************************************
+Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+This file is part of Tonatiuh.
+
+Tonatiuh program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Acknowledgments:
+
+The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+then Chair of the Department of Engineering of the University of Texas at
+Brownsville. From May 2004 to July 2008, it was supported by the Department
+of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+During 2007, NREL also contributed to the validation of Tonatiuh under the
+framework of the Memorandum of Understanding signed with the Spanish
+National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez,
+Juana Amieva, Azael Mancillas, Cesar Cantu.
+***************************************************************************/
+
+#include <algorithm>
+#include <cstring>
+
+#include "Ray.h"
+#include "RayFile.h"
+
+namespace
+{
+	const char rayFileMagic[8] = { 'T', 'N', 'H', 'R', 'A', 'Y', 'S', '\0' };
+	const quint32 rayFileVersion = 1;
+
+	struct RayFileHeader
+	{
+		char magic[8];
+		quint32 version;
+		quint32 recordSize;
+		double powerPerRay;
+		quint64 tracedRays;
+		quint64 numberOfRays;
+	};
+
+	bool RayIndexLessThan( const RayFileRecord& record1, const RayFileRecord& record2 )
+	{
+		return ( record1.rayIndex < record2.rayIndex );
+	}
+}
+
+/*!
+ * Creates a closed ray file.
+ */
+RayFile::RayFile()
+:m_isWriting( false ),
+ m_isWriteFailed( false ),
+ m_records( 0 ),
+ m_numberOfRays( 0 ),
+ m_powerPerRay( 0.0 ),
+ m_tracedRays( 0 )
+{
+
+}
+
+/*!
+ * Closes the file. A file created to write rays is left without the rays power if Close was not called.
+ */
+RayFile::~RayFile()
+{
+	m_file.close();
+}
+
+/*!
+ * Creates the ray file \a fileName to write rays. Returns false if the file can not be written.
+ */
+bool RayFile::Create( const QString& fileName )
+{
+	m_file.close();
+	m_isWriteFailed = false;
+	m_records = 0;
+	m_numberOfRays = 0;
+	m_powerPerRay = 0.0;
+	m_tracedRays = 0;
+
+	//Read access is needed to map the records and sort them in Close
+	m_file.setFileName( fileName );
+	if( !m_file.open( QIODevice::ReadWrite | QIODevice::Truncate ) )	return ( false );
+
+	m_isWriting = true;
+	return ( WriteHeader() );
+}
+
+/*!
+ * Appends the \a records to the file and clears them. Returns false if the records can not be written.
+ * After a failed write no more records are written and Close returns false.
+ *
+ * Called from the ray tracing threads, so the records are appended in any order. Close sorts them.
+ */
+bool RayFile::Write( std::vector< RayFileRecord >& records )
+{
+	if( records.size() < 1 )	return ( true );
+
+	m_mutex.lock();
+	if( m_isWriting && !m_isWriteFailed )
+	{
+		qint64 recordsSize = qint64( records.size() * sizeof( RayFileRecord ) );
+		if( m_file.write( reinterpret_cast< const char* >( &records[0] ), recordsSize ) == recordsSize )
+			m_numberOfRays += records.size();
+		else
+			m_isWriteFailed = true;
+	}
+	bool isWritten = m_isWriting && !m_isWriteFailed;
+	m_mutex.unlock();
+
+	records.clear();
+	return ( isWritten );
+}
+
+/*!
+ * Sorts the records by their ray index, saves the power of each ray, \a powerPerRay, and the number of rays traced
+ * to capture the rays, \a tracedRays, and closes the file. The order of the rays in the file does not depend
+ * on the ray tracing threads. Returns false if the header or any of the records could not be written.
+ */
+bool RayFile::Close( double powerPerRay, unsigned long tracedRays )
+{
+	if( !m_isWriting )	return ( false );
+
+	m_powerPerRay = powerPerRay;
+	m_tracedRays = tracedRays;
+	bool isWritten = !m_isWriteFailed && m_file.flush();
+	if( isWritten && m_numberOfRays > 1 )
+	{
+		qint64 recordsSize = qint64( m_numberOfRays * sizeof( RayFileRecord ) );
+		uchar* records = m_file.map( sizeof( RayFileHeader ), recordsSize );
+		if( records )
+		{
+			RayFileRecord* firstRecord = reinterpret_cast< RayFileRecord* >( records );
+			std::sort( firstRecord, firstRecord + m_numberOfRays, RayIndexLessThan );
+			isWritten = m_file.unmap( records );
+		}
+		else
+			isWritten = false;
+	}
+	isWritten = isWritten && m_file.seek( 0 ) && WriteHeader() && m_file.flush();
+	m_file.close();
+	m_isWriting = false;
+	return ( isWritten );
+}
+
+/*!
+ * Opens the ray file \a fileName to read its rays. Returns false if the file is not a valid ray file.
+ */
+bool RayFile::Open( const QString& fileName )
+{
+	m_file.close();
+	m_isWriting = false;
+	m_records = 0;
+	m_numberOfRays = 0;
+
+	m_file.setFileName( fileName );
+	if( !m_file.open( QIODevice::ReadOnly ) )	return ( false );
+
+	RayFileHeader header;
+	if( m_file.read( reinterpret_cast< char* >( &header ), sizeof( header ) ) != qint64( sizeof( header ) ) )	return ( false );
+	if( memcmp( header.magic, rayFileMagic, sizeof( rayFileMagic ) ) != 0 ||
+			header.version != rayFileVersion || header.recordSize != sizeof( RayFileRecord ) )
+		return ( false );
+
+	qint64 recordsSize = qint64( header.numberOfRays * sizeof( RayFileRecord ) );
+	if( m_file.size() != qint64( sizeof( header ) ) + recordsSize )	return ( false );
+
+	if( header.numberOfRays > 0 )
+	{
+		uchar* records = m_file.map( sizeof( header ), recordsSize );
+		if( !records )	return ( false );
+		m_records = reinterpret_cast< const RayFileRecord* >( records );
+	}
+
+	m_numberOfRays = header.numberOfRays;
+	m_powerPerRay = header.powerPerRay;
+	m_tracedRays = header.tracedRays;
+	return ( true );
+}
+
+/*!
+ * Reads the ray number \a index in \a ray and its weight in \a weight. If \a rayIndex is not null, it is set to
+ * the number of the primary ray that was captured.
+ *
+ * Called from the ray tracing threads.
+ */
+bool RayFile::ReadRay( unsigned long index, Ray* ray, double* weight, unsigned long long* rayIndex ) const
+{
+	if( !m_records || index >= m_numberOfRays )	return ( false );
+
+	const RayFileRecord& record = m_records[index];
+	*ray = Ray( Point3D( record.origin[0], record.origin[1], record.origin[2] ),
+			Vector3D( record.direction[0], record.direction[1], record.direction[2] ) );
+	*weight = record.weight;
+	if( rayIndex )	*rayIndex = record.rayIndex;
+	return ( true );
+}
+
+/*!
+ * Returns the record of the \a ray with weight \a weight for the primary ray number \a rayIndex.
+ */
+RayFileRecord RayFile::Record( const Ray& ray, double weight, unsigned long rayIndex )
+{
+	RayFileRecord record;
+	record.origin[0] = ray.origin.x;
+	record.origin[1] = ray.origin.y;
+	record.origin[2] = ray.origin.z;
+	record.direction[0] = float( ray.direction().x );
+	record.direction[1] = float( ray.direction().y );
+	record.direction[2] = float( ray.direction().z );
+	record.weight = float( weight );
+	record.rayIndex = rayIndex;
+	return ( record );
+}
+
+/*!
+ * Writes the file header at the current position.
+ */
+bool RayFile::WriteHeader()
+{
+	RayFileHeader header;
+	memcpy( header.magic, rayFileMagic, sizeof( rayFileMagic ) );
+	header.version = rayFileVersion;
+	header.recordSize = sizeof( RayFileRecord );
+	header.powerPerRay = m_powerPerRay;
+	header.tracedRays = m_tracedRays;
+	header.numberOfRays = m_numberOfRays;
+	return ( m_file.write( reinterpret_cast< const char* >( &header ), sizeof( header ) ) == qint64( sizeof( header ) ) );
+}
@@ -0,0 +1,107 @@
+/***************************************************************************
+Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+This file is part of Tonatiuh.
+
+Tonatiuh program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Acknowledgments:
+
+The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+then Chair of the Department of Engineering of the University of Texas at
+Brownsville. From May 2004 to July 2008, it was supported by the Department
+of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+During 2007, NREL also contributed to the validation of Tonatiuh under the
+framework of the Memorandum of Understanding signed with the Spanish
+National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez,
+Juana Amieva, Azael Mancillas, Cesar Cantu.
+***************************************************************************/
+
+#ifndef RAYFILE_H_
+#define RAYFILE_H_
+
+#include <vector>
+
+#include <QFile>
+#include <QMutex>
+#include <QString>
+
+class Ray;
+
+//!  RayFileRecord struct is the state of a ray stored in a ray file.
+/*!
+ * The direction and the weight are stored in single precision to keep the files compact. The ray index is the
+ * number of the primary ray in the ray tracing run, so with random streams it defines the chunk of the ray and
+ * its position in the chunk random stream.
+*/
+struct RayFileRecord
+{
+	double origin[3];
+	float direction[3];
+	float weight;
+	quint64 rayIndex;
+};
+
+//!  RayFile class stores the rays that cross a surface to trace them again into other optics.
+/*!
+ * A ray tracing with a capture surface stops the rays that cross it and writes their state in a ray file.
+ * The ray file can then be used as the light of a scene that contains only the optics after the capture surface,
+ * so the first stages of a system are traced once for all the designs of the next stages.
+ *
+ * The file has a header with the power of each ray and the number of rays traced to capture them, followed by
+ * the records in native byte order, sorted by ray index. The records are memory mapped to read them.
+*/
+class RayFile
+{
+
+public:
+	RayFile();
+	~RayFile();
+
+	bool Create( const QString& fileName );
+	bool Write( std::vector< RayFileRecord >& records );
+	bool Close( double powerPerRay, unsigned long tracedRays );
+
+	bool Open( const QString& fileName );
+	bool ReadRay( unsigned long index, Ray* ray, double* weight, unsigned long long* rayIndex = 0 ) const;
+
+	QString FileName() const { return ( m_file.fileName() ); };
+	unsigned long NumberOfRays() const { return ( m_numberOfRays ); };
+	double PowerPerRay() const { return ( m_powerPerRay ); };
+	unsigned long TracedRays() const { return ( m_tracedRays ); };
+
+	static RayFileRecord Record( const Ray& ray, double weight, unsigned long rayIndex );
+
+private:
+	bool WriteHeader();
+
+	QFile m_file;
+	QMutex m_mutex;
+	bool m_isWriting;
+	bool m_isWriteFailed;
+	const RayFileRecord* m_records;
+	unsigned long m_numberOfRays;
+	double m_powerPerRay;
+	unsigned long m_tracedRays;
+};
+
+#endif /* RAYFILE_H_ */
@@ -36,12 +36,19 @@ Contributors: Javier Garcia-Barberena, Iï¿½aki Perez, Inigo Pagola,  Gilda Ji
 Juana Amieva, Azael Mancillas, Cesar Cantu.
 ***************************************************************************/
 
+#include <algorithm>
+
 #include <QPoint>
 
 #include "DifferentialGeometry.h"
+#include "LightCellSampling.h"
 #include "ParallelRandomDeviate.h"
+#include "PhotonSurfaceIndex.h"
+#include "PhotonTally.h"
 #include "Ray.h"
+#include "RayFile.h"
 #include "RayTracerNoTr.h"
+#include "RayTracingScheduler.h"
 #include "TPhotonMap.h"
 #include "TLightShape.h"
 #include "TSunShape.h"
@@ -64,24 +71,120 @@ m_lightToWorld( lightToWorld ),
 m_pRand( &rand ),
 m_mutex( mutex ),
 m_photonMap( photonMap ),
-m_pPhotonMapMutex( mutexPhotonMap )
+m_pPhotonMapMutex( mutexPhotonMap ),
+m_rouletteWeight( 0.0 ),
+m_captureSurface( 0 ),
+m_captureFile( 0 ),
+m_raySource( 0 ),
+m_firstSample( 0 ),
+m_lightSampling( 0 ),
+m_surfaceIndex( 0 ),
+m_photonTally( 0 )
 {
 	m_validAreasVector = m_lightShape->GetValidAreasCoord();
 }
 
+/*!
+ * Traces the rays as energy-weighted photons. The rays are not absorbed stochastically by the materials:
+ * each ray carries a weight, the fraction of its initial power, that is multiplied by the reflectance of each
+ * surface. The rays with a weight lower than \a rouletteWeight play Russian roulette.
+ *
+ * If \a rouletteWeight is zero, the rays are absorbed stochastically and all photons have weight one.
+ */
+void RayTracerNoTr::SetWeightedPhotons( double rouletteWeight )
+{
+	m_rouletteWeight = ( rouletteWeight > 0.0 ) ? std::min( rouletteWeight, 1.0 ) : 0.0;
+}
+
+/*!
+ * Stops the rays that cross the \a captureSurface and writes them in the \a captureFile. The capture surface
+ * should have a virtual material, so the captured rays are the rays that cross it.
+ */
+void RayTracerNoTr::SetRayCapture( InstanceNode* captureSurface, RayFile* captureFile )
+{
+	m_captureSurface = captureSurface;
+	m_captureFile = captureFile;
+}
+
+/*!
+ * Traces the rays of \a rayFile instead of the rays of the light. The ray number n of the ray tracing is
+ * the ray number n of the file and starts with the weight saved in the file. With common random numbers, it takes
+ * the substream of the primary ray that was captured.
+ */
+void RayTracerNoTr::SetRaySource( RayFile* rayFile )
+{
+	m_raySource = rayFile;
+}
+
+/*!
+ * Sets the sample index of the first ray of this ray tracing. The primary ray n takes the sample point
+ * \a firstSample + n of the random generator, so successive ray tracings continue the sample sequence
+ * instead of repeating it.
+ */
+void RayTracerNoTr::SetFirstSample( unsigned long long firstSample )
+{
+	m_firstSample = firstSample;
+}
+
+/*!
+ * Chooses the light cells of the primary rays with \a lightSampling instead of uniformly at random, and counts in it
+ * the rays traced from each cell. The sampling must have the valid areas of the light shape as cells.
+ */
+void RayTracerNoTr::SetLightSampling( LightCellSampling* lightSampling )
+{
+	if( lightSampling && lightSampling->NumberOfCells() != (int) m_validAreasVector.size() )	return;
+	m_lightSampling = lightSampling;
+}
+
+/*!
+ * Tags the photons with the surface index and the export coordinates of \a surfaceIndex in the tracing threads.
+ */
+void RayTracerNoTr::SetSurfaceIndex( const PhotonSurfaceIndex* surfaceIndex )
+{
+	m_surfaceIndex = surfaceIndex;
+}
+
+/*!
+ * Counts the photons in \a photonTally by surface and side instead of storing them in the photon map.
+ * The photons of the chunks traced with random streams are stored in chunk order and the photon map adds
+ * them to the tally of its export mode.
+ */
+void RayTracerNoTr::SetPhotonTally( PhotonTally* photonTally )
+{
+	m_photonTally = photonTally;
+}
+
 //generating the ray
-bool RayTracerNoTr::NewPrimitiveRay( Ray* ray, ParallelRandomDeviate& rand )
+bool RayTracerNoTr::NewPrimitiveRay( unsigned long rayIndex, Ray* ray, double* rayWeight, int* lightCell, RandomDeviate& rand )
 {
+	*lightCell = -1;
+	if( m_raySource )
+	{
+		// a captured ray takes the substream of the primary ray it comes from, whatever its position in the file
+		unsigned long long capturedRayIndex = 0;
+		if( !m_raySource->ReadRay( rayIndex, ray, rayWeight, &capturedRayIndex ) )	return false;
+		rand.StartSubstream( m_firstSample + capturedRayIndex );
+		return true;
+	}
+
+	// with common random numbers, each primary ray takes the numbers of its own substream
+	rand.StartSubstream( m_firstSample + rayIndex );
+
 	if( m_validAreasVector.size() < 1 )	return false;
-	int area = int ( rand.RandomDouble() * m_validAreasVector.size() );
+	// sample dimensions: 0 the light cell, 1 and 2 the position in the cell, 3 and next the sunshape
+	unsigned long long sampleIndex = m_firstSample + rayIndex;
+	int area;
+	if( m_lightSampling )	area = m_lightSampling->SampleCell( sampleIndex, rand, rayWeight );
+	else	area = int ( rand.Sample( sampleIndex, 0 ) * m_validAreasVector.size() );
+	*lightCell = area;
 
 	QPair< int, int > areaIndex = m_validAreasVector[area] ;
 
 	//generating the photon
-	Point3D origin = m_lightShape->Sample( rand.RandomDouble(), rand.RandomDouble(), areaIndex.first, areaIndex.second );
+	Point3D origin = m_lightShape->Sample( rand.Sample( sampleIndex, 1 ), rand.Sample( sampleIndex, 2 ), areaIndex.first, areaIndex.second );
 	//generating the ray direction
 	Vector3D direction;
-	m_lightSunShape->GenerateRayDirection( direction, rand );
+	m_lightSunShape->GenerateRayDirection( direction, rand, sampleIndex, 3 );
 	//generatin the ray
 	*ray =  m_lightToWorld( Ray( origin, direction ) );
 
@@ -89,32 +192,135 @@ bool RayTracerNoTr::NewPrimitiveRay( Ray* ray, ParallelRandomDeviate& rand )
 }
 
 /*!
- * Traces \a numberOfRays rays.
+ * Traces \a numberOfRays rays and stores the photons in the photon map.
  */
 void RayTracerNoTr::operator()( double numberOfRays )
 {
+	std::vector< Photon > photonsVector;
+	std::vector< RayFileRecord > capturedRays;
+	LightCellTally cellTally( m_lightSampling ? m_lightSampling->NumberOfCells() : 0 );
+	ParallelRandomDeviate rand( m_pRand, m_mutex );
+
+	TraceRays( 0, numberOfRays, rand, photonsVector, capturedRays, cellTally );
+	if( m_photonTally )
+	{
+		PhotonTallyCounts photonCounts;
+		photonCounts.Add( photonsVector );
+		m_photonTally->AddTally( photonCounts );
+	}
+	else	StorePhotons( photonsVector );
+	if( m_captureFile )	m_captureFile->Write( capturedRays );
+	if( m_lightSampling )	m_lightSampling->AddTally( cellTally );
+}
+
+/*!
+ * Traces the rays assigned by the \a scheduler until there are no more rays to trace.
+ *
+ * The random deviate and the photons vector are reused for all the chunks traced by the thread.
+ * If the scheduler has random streams, each chunk is traced with its stream and stored in chunk order.
+ */
+void RayTracerNoTr::operator()( RayTracingScheduler* scheduler )
+{
+	std::vector< Photon > photonsVector;
+	std::vector< RayFileRecord > capturedRays;
+	LightCellTally cellTally( m_lightSampling ? m_lightSampling->NumberOfCells() : 0 );
+	ParallelRandomDeviate rand( m_pRand, m_mutex );
+	PhotonTallyCounts photonCounts;
+
+	unsigned long firstRay = 0;
+	unsigned long numberOfRays = 0;
+	unsigned long chunkIndex = 0;
+	while( scheduler->NextChunk( &firstRay, &numberOfRays, &chunkIndex ) )
+	{
+		RandomDeviate* chunkRand = scheduler->CreateRandomDeviate( chunkIndex );
+		if( chunkRand )
+		{
+			TraceRays( firstRay, numberOfRays, *chunkRand, photonsVector, capturedRays, cellTally );
+			delete chunkRand;
+			scheduler->StoreChunk( chunkIndex, numberOfRays, photonsVector, m_photonMap, m_pPhotonMapMutex );
+		}
+		else
+		{
+			TraceRays( firstRay, numberOfRays, rand, photonsVector, capturedRays, cellTally );
+			if( m_photonTally )	photonCounts.Add( photonsVector );
+			else	StorePhotons( photonsVector );
+		}
+		photonsVector.clear();
+		if( m_captureFile )	m_captureFile->Write( capturedRays );
+
+		scheduler->ChunkFinished( numberOfRays );
+	}
+	if( m_photonTally )	m_photonTally->AddTally( photonCounts );
+	if( m_lightSampling )	m_lightSampling->AddTally( cellTally );
+}
+
+void RayTracerNoTr::TraceRays( unsigned long firstRay, double numberOfRays, RandomDeviate& rand,
+		std::vector< Photon >& photonsVector, std::vector< RayFileRecord >& capturedRays,
+		LightCellTally& cellTally )
+{
+	std::size_t firstPhoton = photonsVector.size();
 	if( m_exportSuraceList.size() < 1 )
-		RayTracerCreatingAllPhotons( numberOfRays );
+		RayTracerCreatingAllPhotons( firstRay, numberOfRays, rand, photonsVector, capturedRays, cellTally );
 	else if( m_exportSuraceList.size() > 0 &&  m_exportSuraceList.contains( m_lightNode ) )
-		RayTracerCreatingLightPhotons( numberOfRays );
+		RayTracerCreatingLightPhotons( firstRay, numberOfRays, rand, photonsVector, capturedRays, cellTally );
 	else
-		RayTracerNotCreatingLightPhotons( numberOfRays );
+		RayTracerNotCreatingLightPhotons( firstRay, numberOfRays, rand, photonsVector, capturedRays, cellTally );
+
+	if( m_surfaceIndex )
+	{
+		for( std::size_t p = firstPhoton; p < photonsVector.size(); ++p )
+			m_surfaceIndex->Tag( &photonsVector[p] );
+	}
 }
 
 /*!
- * Traces \a numberOfRays rays and creates photons for all intersections.
+ * Plays Russian roulette with a ray of weight \a rayWeight lower than the roulette weight: the ray survives with
+ * probability rayWeight / rouletteWeight and then its weight is the roulette weight, so the expected power is kept.
+ *
+ * Returns false and sets \a rayWeight to zero if the ray is killed.
  */
-void RayTracerNoTr::RayTracerCreatingAllPhotons(  double numberOfRays  )
+bool RayTracerNoTr::RussianRoulette( double* rayWeight, RandomDeviate& rand ) const
 {
-	std::vector< Photon > photonsVector;
-	ParallelRandomDeviate rand( m_pRand, m_mutex );
+	if( *rayWeight >= m_rouletteWeight )	return ( true );
+
+	if( rand.RandomDouble() * m_rouletteWeight < *rayWeight )
+	{
+		*rayWeight = m_rouletteWeight;
+		return ( true );
+	}
+	*rayWeight = 0.0;
+	return ( false );
+}
+
+/*!
+ * Stores the photons of \a photonsVector in the photon map.
+ */
+void RayTracerNoTr::StorePhotons( std::vector< Photon >& photonsVector )
+{
+	if( photonsVector.size() < 1 )	return;
 
+	m_pPhotonMapMutex->lock();
+	m_photonMap->StoreRays( photonsVector );
+	m_pPhotonMapMutex->unlock();
+}
+
+/*!
+ * Traces \a numberOfRays rays and creates photons for all intersections.
+ * The photons are appended to \a photonsVector.
+ */
+void RayTracerNoTr::RayTracerCreatingAllPhotons( unsigned long firstRay, double numberOfRays, RandomDeviate& rand,
+		std::vector< Photon >& photonsVector, std::vector< RayFileRecord >& capturedRays,
+		LightCellTally& cellTally )
+{
 	for(  unsigned long  i = 0; i < numberOfRays; ++i )
 	{
 		Ray ray;
-		if( NewPrimitiveRay( &ray, rand ) )
+		double rayWeight = 1.0;
+		int lightCell = -1;
+		if( NewPrimitiveRay( firstRay + i, &ray, &rayWeight, &lightCell, rand ) )
 		{
-			photonsVector.push_back( Photon( ray.origin, 1, 0, m_lightNode ) );
+			photonsVector.push_back( Photon( ray.origin, 1, 0, m_lightNode, 0, rayWeight ) );
+			std::size_t firstPhoton = photonsVector.size();
 			int rayLength = 0;
 
 			InstanceNode* intersectedSurface = 0;
@@ -122,61 +328,68 @@ void RayTracerNoTr::RayTracerCreatingAllPhotons(  double numberOfRays  )
 
 			//Trace the ray
 			bool isReflectedRay = true;
+			bool isCapturedRay = false;
 			while( isReflectedRay )
 			{
 				intersectedSurface = 0;
 				isFront = 0;
 				Ray reflectedRay;
-				isReflectedRay = m_rootNode->Intersect( ray, rand, &isFront, &intersectedSurface, &reflectedRay );
+				double reflectance = 1.0;
+				isReflectedRay = m_rootNode->Intersect( ray, rand, &isFront, &intersectedSurface, &reflectedRay,
+						( m_rouletteWeight > 0.0 ) ? &reflectance : 0 );
 
 				if( isReflectedRay )
 				{
-					photonsVector.push_back( Photon( (ray)( ray.maxt ), isFront, ++rayLength, intersectedSurface, 1) );
+					photonsVector.push_back( Photon( (ray)( ray.maxt ), isFront, ++rayLength, intersectedSurface, 0, rayWeight ) );
+					photonsVector.back().absorbedWeight = ( 1.0 - reflectance ) * rayWeight;
 
 					//Prepare node and ray for next iteration
 					ray = reflectedRay;
+					rayWeight *= reflectance;
+					if( !RussianRoulette( &rayWeight, rand ) )	isReflectedRay = false;
+					if( isReflectedRay && m_captureFile && intersectedSurface == m_captureSurface )
+					{
+						capturedRays.push_back( RayFile::Record( ray, rayWeight, firstRay + i ) );
+						isReflectedRay = false;
+						isCapturedRay = true;
+					}
 				}
 
 			}
 
-			if( !(rayLength == 0 && ray.maxt == HUGE_VAL) )
+			if( ( rayWeight > 0.0 ) && !isCapturedRay && !( rayLength == 0 && ray.maxt == HUGE_VAL ) )
 			{
 				if( ray.maxt == HUGE_VAL  )
 				{
 					ray.maxt = 0.1;
-					photonsVector.push_back( Photon( (ray)( ray.maxt ), 0, ++rayLength, intersectedSurface) );
+					photonsVector.push_back( Photon( (ray)( ray.maxt ), 0, ++rayLength, intersectedSurface, 0, rayWeight ) );
 				}
 				else
-					photonsVector.push_back( Photon( (ray)( ray.maxt ), isFront, ++rayLength, intersectedSurface, 1 ) );
+					photonsVector.push_back( Photon( (ray)( ray.maxt ), isFront, ++rayLength, intersectedSurface, 1, rayWeight ) );
 			}
-
+			cellTally.Add( lightCell, photonsVector.size() > firstPhoton );
 		}
 
 	}
-
-	photonsVector.resize( photonsVector.size() );
-
-	m_pPhotonMapMutex->lock();
-	m_photonMap->StoreRays( photonsVector );
-	m_pPhotonMapMutex->unlock();
-
-
 }
 
 /*!
  * Traces \a numberOfRays rays. Creates photons for the ray origin and to the selected surfaces
+ * The photons are appended to \a photonsVector.
  */
-void RayTracerNoTr::RayTracerCreatingLightPhotons(  double numberOfRays  )
+void RayTracerNoTr::RayTracerCreatingLightPhotons( unsigned long firstRay, double numberOfRays, RandomDeviate& rand,
+		std::vector< Photon >& photonsVector, std::vector< RayFileRecord >& capturedRays,
+		LightCellTally& cellTally )
 {
-	std::vector< Photon > photonsVector;
-	ParallelRandomDeviate rand( m_pRand, m_mutex );
-
 	for(  unsigned long  i = 0; i < numberOfRays; ++i )
 	{
 		Ray ray;
-		if( NewPrimitiveRay( &ray, rand ) )
+		double rayWeight = 1.0;
+		int lightCell = -1;
+		if( NewPrimitiveRay( firstRay + i, &ray, &rayWeight, &lightCell, rand ) )
 		{
-			photonsVector.push_back( Photon( ray.origin, 1, 0, m_lightNode ) );
+			photonsVector.push_back( Photon( ray.origin, 1, 0, m_lightNode, 0, rayWeight ) );
+			std::size_t firstPhoton = photonsVector.size();
 			int rayLength = 0;
 
 			InstanceNode* intersectedSurface = 0;
@@ -184,60 +397,71 @@ void RayTracerNoTr::RayTracerCreatingLightPhotons(  double numberOfRays  )
 
 			//Trace the ray
 			bool isReflectedRay = true;
+			bool isCapturedRay = false;
 			while( isReflectedRay )
 			{
 				intersectedSurface = 0;
 				isFront = 0;
 				Ray reflectedRay;
-				isReflectedRay = m_rootNode->Intersect( ray, rand, &isFront, &intersectedSurface, &reflectedRay );
+				double reflectance = 1.0;
+				isReflectedRay = m_rootNode->Intersect( ray, rand, &isFront, &intersectedSurface, &reflectedRay,
+						( m_rouletteWeight > 0.0 ) ? &reflectance : 0 );
 
 				if( isReflectedRay )
 				{
 					if( m_exportSuraceList.contains( intersectedSurface ) )
-						photonsVector.push_back( Photon( (ray)( ray.maxt ), isFront, ++rayLength, intersectedSurface, 1 ) );
+					{
+						photonsVector.push_back( Photon( (ray)( ray.maxt ), isFront, ++rayLength, intersectedSurface, 0, rayWeight ) );
+						photonsVector.back().absorbedWeight = ( 1.0 - reflectance ) * rayWeight;
+					}
 
 					//Prepare node and ray for next iteration
 					ray = reflectedRay;
+					rayWeight *= reflectance;
+					if( !RussianRoulette( &rayWeight, rand ) )	isReflectedRay = false;
+					if( isReflectedRay && m_captureFile && intersectedSurface == m_captureSurface )
+					{
+						capturedRays.push_back( RayFile::Record( ray, rayWeight, firstRay + i ) );
+						isReflectedRay = false;
+						isCapturedRay = true;
+					}
 				}
 
 			}
 
-			if( m_exportSuraceList.contains( intersectedSurface ) && !(rayLength == 0 && ray.maxt == HUGE_VAL) )
+			if( m_exportSuraceList.contains( intersectedSurface ) && ( rayWeight > 0.0 ) && !isCapturedRay && !( rayLength == 0 && ray.maxt == HUGE_VAL ) )
 			{
 				if( ray.maxt == HUGE_VAL  )
 				{
 					ray.maxt = 0.1;
-					photonsVector.push_back( Photon( (ray)( ray.maxt ), 0, ++rayLength, intersectedSurface) );
+					photonsVector.push_back( Photon( (ray)( ray.maxt ), 0, ++rayLength, intersectedSurface, 0, rayWeight ) );
 				}
 				else
-					photonsVector.push_back( Photon( (ray)( ray.maxt ), isFront, ++rayLength, intersectedSurface) );
+					photonsVector.push_back( Photon( (ray)( ray.maxt ), isFront, ++rayLength, intersectedSurface, 1, rayWeight ) );
 			}
-
+			cellTally.Add( lightCell, photonsVector.size() > firstPhoton );
 		}
 
 	}
-	photonsVector.resize( photonsVector.size() );
-
-	m_pPhotonMapMutex->lock();
-	m_photonMap->StoreRays( photonsVector );
-	m_pPhotonMapMutex->unlock();
-
 }
 
 /*!
  * Traces \a numberOfRays rays. Creates photons for the selected surfaces.
+ * The photons are appended to \a photonsVector.
  * Photons for the rays origin will not be created.
  */
-void RayTracerNoTr::RayTracerNotCreatingLightPhotons(  double numberOfRays  )
+void RayTracerNoTr::RayTracerNotCreatingLightPhotons( unsigned long firstRay, double numberOfRays, RandomDeviate& rand,
+		std::vector< Photon >& photonsVector, std::vector< RayFileRecord >& capturedRays,
+		LightCellTally& cellTally )
 {
-	std::vector< Photon > photonsVector;
-	ParallelRandomDeviate rand( m_pRand, m_mutex );
-
 	for(  unsigned long  i = 0; i < numberOfRays; ++i )
 	{
 		Ray ray;
-		if( NewPrimitiveRay( &ray, rand ) )
+		double rayWeight = 1.0;
+		int lightCell = -1;
+		if( NewPrimitiveRay( firstRay + i, &ray, &rayWeight, &lightCell, rand ) )
 		{
+			std::size_t firstPhoton = photonsVector.size();
 			int rayLength = 0;
 
 			InstanceNode* intersectedSurface = 0;
@@ -245,42 +469,50 @@ void RayTracerNoTr::RayTracerNotCreatingLightPhotons(  double numberOfRays  )
 
 			//Trace the ray
 			bool isReflectedRay = true;
+			bool isCapturedRay = false;
 			while( isReflectedRay )
 			{
 				intersectedSurface = 0;
 				isFront = 0;
 				Ray reflectedRay;
-				isReflectedRay = m_rootNode->Intersect( ray, rand, &isFront, &intersectedSurface, &reflectedRay );
+				double reflectance = 1.0;
+				isReflectedRay = m_rootNode->Intersect( ray, rand, &isFront, &intersectedSurface, &reflectedRay,
+						( m_rouletteWeight > 0.0 ) ? &reflectance : 0 );
 
 				if( isReflectedRay )
 				{
 					if( m_exportSuraceList.contains( intersectedSurface ) )
-						photonsVector.push_back( Photon( (ray)( ray.maxt ), isFront, ++rayLength, intersectedSurface, 1) );
+					{
+						photonsVector.push_back( Photon( (ray)( ray.maxt ), isFront, ++rayLength, intersectedSurface, 0, rayWeight ) );
+						photonsVector.back().absorbedWeight = ( 1.0 - reflectance ) * rayWeight;
+					}
 
 					//Prepare node and ray for next iteration
 					ray = reflectedRay;
+					rayWeight *= reflectance;
+					if( !RussianRoulette( &rayWeight, rand ) )	isReflectedRay = false;
+					if( isReflectedRay && m_captureFile && intersectedSurface == m_captureSurface )
+					{
+						capturedRays.push_back( RayFile::Record( ray, rayWeight, firstRay + i ) );
+						isReflectedRay = false;
+						isCapturedRay = true;
+					}
 				}
 
 			}
 
-			if( m_exportSuraceList.contains( intersectedSurface ) && !(rayLength == 0 && ray.maxt == HUGE_VAL) )
+			if( m_exportSuraceList.contains( intersectedSurface ) && ( rayWeight > 0.0 ) && !isCapturedRay && !( rayLength == 0 && ray.maxt == HUGE_VAL ) )
 			{
 				if( ray.maxt == HUGE_VAL  )
 				{
 					ray.maxt = 0.1;
-					photonsVector.push_back( Photon( (ray)( ray.maxt ), 0, ++rayLength, intersectedSurface) );
+					photonsVector.push_back( Photon( (ray)( ray.maxt ), 0, ++rayLength, intersectedSurface, 0, rayWeight ) );
 				}
 				else
-					photonsVector.push_back( Photon( (ray)( ray.maxt ), isFront, ++rayLength, intersectedSurface) );
+					photonsVector.push_back( Photon( (ray)( ray.maxt ), isFront, ++rayLength, intersectedSurface, 1, rayWeight ) );
 			}
-
+			cellTally.Add( lightCell, photonsVector.size() > firstPhoton );
 		}
 
 	}
-	photonsVector.resize( photonsVector.size() );
-
-	m_pPhotonMapMutex->lock();
-	m_photonMap->StoreRays( photonsVector );
-	m_pPhotonMapMutex->unlock();
-
 }
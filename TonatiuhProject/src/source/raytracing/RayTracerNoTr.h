@@ -50,10 +50,17 @@ Juana Amieva, Azael Mancillas, Cesar Cantu.
 
 
 class InstanceNode;
+class LightCellSampling;
+struct LightCellTally;
 class ParallelRandomDeviate;
 struct Photon;
+class PhotonSurfaceIndex;
+class PhotonTally;
 class RandomDeviate;
+class RayFile;
+struct RayFileRecord;
 struct RayTracerPhoton;
+class RayTracingScheduler;
 class QMutex;
 class QPoint;
 class TPhotonMap;
@@ -75,14 +82,33 @@ public:
 		       QMutex* mutexPhotonMap,
 		       QVector< InstanceNode* > exportSuraceList );
 
+	void SetWeightedPhotons( double rouletteWeight );
+	void SetRayCapture( InstanceNode* captureSurface, RayFile* captureFile );
+	void SetRaySource( RayFile* rayFile );
+	void SetFirstSample( unsigned long long firstSample );
+	void SetLightSampling( LightCellSampling* lightSampling );
+	void SetSurfaceIndex( const PhotonSurfaceIndex* surfaceIndex );
+	void SetPhotonTally( PhotonTally* photonTally );
+
 	typedef void result_type;
 	void operator()( double numberOfRays );
+	void operator()( RayTracingScheduler* scheduler );
 
 
 private:
-	void RayTracerCreatingAllPhotons(  double numberOfRays  );
-	void RayTracerCreatingLightPhotons(  double numberOfRays  );
-	void RayTracerNotCreatingLightPhotons(  double numberOfRays  );
+	void TraceRays( unsigned long firstRay, double numberOfRays, RandomDeviate& rand,
+			std::vector< Photon >& photonsVector, std::vector< RayFileRecord >& capturedRays,
+			LightCellTally& cellTally );
+	void StorePhotons( std::vector< Photon >& photonsVector );
+	void RayTracerCreatingAllPhotons( unsigned long firstRay, double numberOfRays, RandomDeviate& rand,
+			std::vector< Photon >& photonsVector, std::vector< RayFileRecord >& capturedRays,
+			LightCellTally& cellTally );
+	void RayTracerCreatingLightPhotons( unsigned long firstRay, double numberOfRays, RandomDeviate& rand,
+			std::vector< Photon >& photonsVector, std::vector< RayFileRecord >& capturedRays,
+			LightCellTally& cellTally );
+	void RayTracerNotCreatingLightPhotons( unsigned long firstRay, double numberOfRays, RandomDeviate& rand,
+			std::vector< Photon >& photonsVector, std::vector< RayFileRecord >& capturedRays,
+			LightCellTally& cellTally );
 
     QVector< InstanceNode* > m_exportSuraceList;
 	InstanceNode* m_rootNode;
@@ -95,8 +121,17 @@ private:
 	TPhotonMap* m_photonMap;
     QMutex* m_pPhotonMapMutex;
 	std::vector< QPair< int, int > >  m_validAreasVector;
-
-	bool NewPrimitiveRay( Ray* ray, ParallelRandomDeviate& rand );
+	double m_rouletteWeight;
+	InstanceNode* m_captureSurface;
+	RayFile* m_captureFile;
+	RayFile* m_raySource;
+	unsigned long long m_firstSample;
+	LightCellSampling* m_lightSampling;
+	const PhotonSurfaceIndex* m_surfaceIndex;
+	PhotonTally* m_photonTally;
+
+	bool NewPrimitiveRay( unsigned long rayIndex, Ray* ray, double* rayWeight, int* lightCell, RandomDeviate& rand );
+	bool RussianRoulette( double* rayWeight, RandomDeviate& rand ) const;
 };
 
 
@@ -0,0 +1,269 @@
+/***************************************************************************
+Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+This file is part of Tonatiuh.
+
+Tonatiuh program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Acknowledgments:
+
+The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+then Chair of the Department of Engineering of the University of Texas at
+Brownsville. From May 2004 to July 2008, it was supported by the Department
+of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+During 2007, NREL also contributed to the validation of Tonatiuh under the
+framework of the Memorandum of Understanding signed with the Spanish
+National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez,
+Juana Amieva, Azael Mancillas, Cesar Cantu.
+***************************************************************************/
+
+#include <algorithm>
+
+#include <QMutexLocker>
+
+#include "RandomDeviate.h"
+#include "RandomDeviateFactory.h"
+#include "RayTracingScheduler.h"
+#include "TPhotonMap.h"
+#include "TraceCheckpoint.h"
+
+/*!
+ * Creates a scheduler to trace \a numberOfRays rays with \a numberOfThreads threads.
+ *
+ * The chunks will have at least \a minimumChunkSize rays, unless there are too few rays to keep all the threads busy.
+ *
+ * The chunks traced with random streams have all the same size, from \a numberOfRays and \a minimumChunkSize only:
+ * between 100 and 1000 chunks, of \a minimumChunkSize rays if possible.
+ */
+RayTracingScheduler::RayTracingScheduler( unsigned long numberOfRays, int numberOfThreads, unsigned long minimumChunkSize, QObject* parent )
+:QObject( parent ),
+ m_numberOfRays( numberOfRays ),
+ m_numberOfThreads( numberOfThreads ),
+ m_minimumChunkSize( minimumChunkSize ),
+ m_maximumChunkSize( 1 ),
+ m_streamChunkSize( 1 ),
+ m_nextRay( 0 ),
+ m_tracedRays( 0 ),
+ m_progressValue( 0 ),
+ m_isCanceled( false ),
+ m_nextChunk( 0 ),
+ m_randomFactory( 0 ),
+ m_seed( 0 ),
+ m_firstStream( 0 ),
+ m_streamsStep( 1 ),
+ m_nextStoredChunk( 0 ),
+ m_storedRays( 0 ),
+ m_firstUnstoredChunk( 0 ),
+ m_maximumPendingChunks( 1 ),
+ m_checkpoint( 0 ),
+ m_checkpointRays( 0 ),
+ m_lastCheckpointRay( 0 )
+{
+	if( m_numberOfThreads < 1 )	m_numberOfThreads = 1;
+	m_maximumPendingChunks = 4 * m_numberOfThreads;
+
+	m_streamChunkSize = std::max( ( m_numberOfRays + 999 ) / 1000, std::min( m_minimumChunkSize, ( m_numberOfRays + 99 ) / 100 ) );
+	if( m_streamChunkSize < 1 )	m_streamChunkSize = 1;
+
+	unsigned long raysPerThread = m_numberOfRays / ( 4 * m_numberOfThreads );
+	if( raysPerThread < m_minimumChunkSize )	m_minimumChunkSize = raysPerThread;
+	if( m_minimumChunkSize < 1 )	m_minimumChunkSize = 1;
+
+	//At least 100 chunks to keep the progress dialog updated
+	m_maximumChunkSize = m_numberOfRays / 100;
+	if( m_maximumChunkSize < m_minimumChunkSize )	m_maximumChunkSize = m_minimumChunkSize;
+}
+
+RayTracingScheduler::~RayTracingScheduler()
+{
+
+}
+
+/*!
+ * Returns a list with an entry for each thread to use with QtConcurrent::map.
+ */
+QVector< RayTracingScheduler* > RayTracingScheduler::ThreadsList()
+{
+	return QVector< RayTracingScheduler* >( m_numberOfThreads, this );
+}
+
+/*!
+ * Assigns the next chunk of rays to the caller thread. The chunk rays are \a numberOfRays rays starting from the ray number \a firstRay.
+ * If \a chunkIndex is not null, it is set to the chunk number.
+ *
+ * With random streams, the caller waits while there are too many chunks assigned but not stored with StoreChunk.
+ *
+ * Returns false if there are no more rays to trace or the ray tracing has been canceled.
+ */
+bool RayTracingScheduler::NextChunk( unsigned long* firstRay, unsigned long* numberOfRays, unsigned long* chunkIndex )
+{
+	QMutexLocker locker( &m_mutex );
+	while( m_randomFactory && !m_isCanceled && ( m_nextRay < m_numberOfRays )
+			&& ( m_nextChunk - m_firstUnstoredChunk >= m_maximumPendingChunks ) )
+		m_chunkStored.wait( &m_mutex );
+	if( m_isCanceled || ( m_nextRay >= m_numberOfRays ) )	return false;
+
+	unsigned long remainingRays = m_numberOfRays - m_nextRay;
+	unsigned long chunkSize = remainingRays / ( 2 * m_numberOfThreads );
+	if( chunkSize < m_minimumChunkSize )	chunkSize = m_minimumChunkSize;
+	if( chunkSize > m_maximumChunkSize )	chunkSize = m_maximumChunkSize;
+
+	//The rays of a chunk with a random stream must not depend on the number of threads
+	if( m_randomFactory )	chunkSize = m_streamChunkSize;
+	if( chunkSize > remainingRays )	chunkSize = remainingRays;
+
+	*firstRay = m_nextRay;
+	*numberOfRays = chunkSize;
+	if( chunkIndex )	*chunkIndex = m_nextChunk;
+	m_nextRay += chunkSize;
+	m_nextChunk++;
+	return true;
+}
+
+/*!
+ * Updates the progress with a chunk of \a numberOfRays traced rays.
+ */
+void RayTracingScheduler::ChunkFinished( unsigned long numberOfRays )
+{
+	int progressValue = 0;
+	{
+		QMutexLocker locker( &m_mutex );
+		m_tracedRays += numberOfRays;
+		progressValue = int( ( 100.0 * m_tracedRays ) / m_numberOfRays );
+		if( progressValue == m_progressValue )	return;
+		m_progressValue = progressValue;
+	}
+
+	emit ProgressValueChanged( progressValue );
+}
+
+/*!
+ * Returns the number of traced rays. If the ray tracing has been canceled, it could be less than the number of rays to trace.
+ */
+unsigned long RayTracingScheduler::TracedRays() const
+{
+	QMutexLocker locker( &m_mutex );
+	return m_tracedRays;
+}
+
+/*!
+ * Saves a checkpoint with \a checkpoint each time \a checkpointRays rays are stored.
+ * The checkpoints are saved only if random streams are set.
+ */
+void RayTracingScheduler::SetCheckpoint( TraceCheckpoint* checkpoint, unsigned long checkpointRays )
+{
+	m_checkpoint = checkpoint;
+	m_checkpointRays = checkpointRays;
+}
+
+/*!
+ * Sets to trace each chunk with its own random stream. The chunk \a n uses the stream \a firstStream + n * \a streamsStep
+ * of the \a randomFactory generator started with \a seed.
+ */
+void RayTracingScheduler::SetRandomStreams( RandomDeviateFactory* randomFactory, unsigned long seed, unsigned long firstStream, unsigned long streamsStep )
+{
+	m_randomFactory = randomFactory;
+	m_seed = seed;
+	m_firstStream = firstStream;
+	m_streamsStep = ( streamsStep > 0 ) ? streamsStep : 1;
+}
+
+/*!
+ * Starts the ray tracing at the ray \a firstRay, with \a firstChunk as the number of the first chunk.
+ * The rays before \a firstRay are counted as traced.
+ */
+void RayTracingScheduler::SetStart( unsigned long firstRay, unsigned long firstChunk )
+{
+	QMutexLocker locker( &m_mutex );
+	m_nextRay = firstRay;
+	m_tracedRays = firstRay;
+	m_nextChunk = firstChunk;
+	m_nextStoredChunk = firstChunk;
+	m_firstUnstoredChunk = firstChunk;
+	m_storedRays = firstRay;
+	m_lastCheckpointRay = firstRay;
+}
+
+/*!
+ * Returns a new random generator for the chunk \a chunkIndex. The caller must delete it.
+ * Returns null if random streams are not set.
+ */
+RandomDeviate* RayTracingScheduler::CreateRandomDeviate( unsigned long chunkIndex ) const
+{
+	if( !m_randomFactory )	return 0;
+	return m_randomFactory->CreateRandomDeviate( m_seed, m_firstStream + chunkIndex * m_streamsStep );
+}
+
+/*!
+ * Returns the number of the chunk that follows the last assigned chunk.
+ */
+unsigned long RayTracingScheduler::NextChunkIndex() const
+{
+	QMutexLocker locker( &m_mutex );
+	return ( m_nextChunk );
+}
+
+/*!
+ * Stores the \a photons of the chunk \a chunkIndex, with \a numberOfRays rays, in \a photonMap. The chunks are stored
+ * in chunk order: the photons of a chunk that finishes before the previous ones are kept until those are stored.
+ * \a photons is empty after the call.
+ *
+ * \a photonMapMutex must be the same for all the calls. Each chunk assigned with random streams must be stored,
+ * even if it has no photons, or NextChunk will stop assigning chunks.
+ */
+void RayTracingScheduler::StoreChunk( unsigned long chunkIndex, unsigned long numberOfRays, std::vector< Photon >& photons,
+		TPhotonMap* photonMap, QMutex* photonMapMutex )
+{
+	QMutexLocker locker( photonMapMutex );
+	m_pendingChunks[chunkIndex].swap( photons );
+	m_pendingRays.insert( chunkIndex, numberOfRays );
+
+	while( m_pendingChunks.contains( m_nextStoredChunk ) )
+	{
+		std::vector< Photon >& chunkPhotons = m_pendingChunks[m_nextStoredChunk];
+		if( chunkPhotons.size() > 0 )	photonMap->StoreRays( chunkPhotons );
+		m_pendingChunks.remove( m_nextStoredChunk );
+		m_storedRays += m_pendingRays.take( m_nextStoredChunk );
+		m_nextStoredChunk++;
+
+		if( m_checkpoint && m_checkpointRays > 0 && ( m_storedRays - m_lastCheckpointRay ) >= m_checkpointRays )
+		{
+			m_checkpoint->Save( photonMap, m_storedRays, m_nextStoredChunk );
+			m_lastCheckpointRay = m_storedRays;
+		}
+	}
+
+	QMutexLocker schedulerLocker( &m_mutex );
+	if( m_firstUnstoredChunk == m_nextStoredChunk )	return;
+	m_firstUnstoredChunk = m_nextStoredChunk;
+	m_chunkStored.wakeAll();
+}
+
+/*!
+ * Stops assigning rays to the threads. The chunks that are being traced are completed.
+ */
+void RayTracingScheduler::Cancel()
+{
+	QMutexLocker locker( &m_mutex );
+	m_isCanceled = true;
+	m_chunkStored.wakeAll();
+}
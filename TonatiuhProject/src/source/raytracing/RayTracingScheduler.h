@@ -0,0 +1,133 @@
+/***************************************************************************
+Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+This file is part of Tonatiuh.
+
+Tonatiuh program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Acknowledgments:
+
+The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+then Chair of the Department of Engineering of the University of Texas at
+Brownsville. From May 2004 to July 2008, it was supported by the Department
+of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+During 2007, NREL also contributed to the validation of Tonatiuh under the
+framework of the Memorandum of Understanding signed with the Spanish
+National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez,
+Juana Amieva, Azael Mancillas, Cesar Cantu.
+***************************************************************************/
+
+#ifndef RAYTRACINGSCHEDULER_H_
+#define RAYTRACINGSCHEDULER_H_
+
+#include <vector>
+
+#include <QMap>
+#include <QMutex>
+#include <QObject>
+#include <QVector>
+#include <QWaitCondition>
+
+#include "Photon.h"
+
+class RandomDeviate;
+class RandomDeviateFactory;
+class TPhotonMap;
+class TraceCheckpoint;
+
+//!  RayTracingScheduler class distributes the rays to trace between the ray tracing threads.
+/*!
+ * Each thread asks the scheduler for a new chunk of rays when it finishes the previous one. The chunks sizes
+ * decrease as the work ends (guided scheduling), so the threads finish at the same time even if the rays
+ * have different number of intersections.
+ *
+ * The chunks are assigned always in the same order, so the chunk number \a n always contains the same rays.
+ *
+ * If random streams are set, each chunk is traced with its own random stream and its photons are stored in
+ * chunk order. The chunks then have a fixed size that depends only on the number of rays, so the results of
+ * a ray tracing depend neither on the threads timing nor on the number of threads. A ray tracing started
+ * with SetStart from a checkpoint continues with the same chunks and streams.
+ *
+ * To bound the memory used by the chunks that wait to be stored, NextChunk does not assign a new chunk with
+ * random streams while there are four chunks per thread assigned but not stored. Then, the scheduler keeps at
+ * most the photons of 4 * numberOfThreads chunks of the fixed size.
+*/
+class RayTracingScheduler : public QObject
+{
+	Q_OBJECT
+
+public:
+	RayTracingScheduler( unsigned long numberOfRays, int numberOfThreads, unsigned long minimumChunkSize = 1000, QObject* parent = 0 );
+	~RayTracingScheduler();
+
+	QVector< RayTracingScheduler* > ThreadsList();
+	bool NextChunk( unsigned long* firstRay, unsigned long* numberOfRays, unsigned long* chunkIndex = 0 );
+	void ChunkFinished( unsigned long numberOfRays );
+	unsigned long TracedRays() const;
+
+	void SetCheckpoint( TraceCheckpoint* checkpoint, unsigned long checkpointRays );
+	void SetRandomStreams( RandomDeviateFactory* randomFactory, unsigned long seed, unsigned long firstStream, unsigned long streamsStep );
+	void SetStart( unsigned long firstRay, unsigned long firstChunk );
+
+	RandomDeviate* CreateRandomDeviate( unsigned long chunkIndex ) const;
+	unsigned long NextChunkIndex() const;
+	void StoreChunk( unsigned long chunkIndex, unsigned long numberOfRays, std::vector< Photon >& photons,
+			TPhotonMap* photonMap, QMutex* photonMapMutex );
+
+public slots:
+	void Cancel();
+
+signals:
+	void ProgressValueChanged( int value );
+
+private:
+	mutable QMutex m_mutex;
+	unsigned long m_numberOfRays;
+	int m_numberOfThreads;
+	unsigned long m_minimumChunkSize;
+	unsigned long m_maximumChunkSize;
+	unsigned long m_streamChunkSize;
+	unsigned long m_nextRay;
+	unsigned long m_tracedRays;
+	int m_progressValue;
+	bool m_isCanceled;
+
+	unsigned long m_nextChunk;
+	RandomDeviateFactory* m_randomFactory;
+	unsigned long m_seed;
+	unsigned long m_firstStream;
+	unsigned long m_streamsStep;
+
+	QMap< unsigned long, std::vector< Photon > > m_pendingChunks;
+	QMap< unsigned long, unsigned long > m_pendingRays;
+	unsigned long m_nextStoredChunk;
+	unsigned long m_storedRays;
+	unsigned long m_firstUnstoredChunk;
+	unsigned long m_maximumPendingChunks;
+	QWaitCondition m_chunkStored;
+
+	TraceCheckpoint* m_checkpoint;
+	unsigned long m_checkpointRays;
+	unsigned long m_lastCheckpointRay;
+};
+
+#endif /* RAYTRACINGSCHEDULER_H_ */
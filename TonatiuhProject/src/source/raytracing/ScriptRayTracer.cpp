@@ -360,7 +360,7 @@ int ScriptRayTracer::Trace()
 	trf::ComputeSceneTreeMap( rootSeparatorInstance, Transform( new Matrix4x4 ), true );
 
 	TLightKit* light = static_cast< TLightKit* > ( lightInstance->GetNode() );
-	QStringList disabledNodes = QString( light->disabledNodes.getValue().getString() ).split( ";", QString::SkipEmptyParts );
+	QSet< QString > disabledNodes = QString( light->disabledNodes.getValue().getString() ).split( ";", QString::SkipEmptyParts ).toSet();
 	QVector< QPair< TShapeKit*, Transform > > surfacesList;
 	trf::ComputeFistStageSurfaceList( rootSeparatorInstance, disabledNodes, &surfacesList );
 	light->ComputeLightSourceArea( m_widthDivisions, m_heightDivisions, surfacesList );
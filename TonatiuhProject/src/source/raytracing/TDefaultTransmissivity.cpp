@@ -61,3 +61,8 @@ bool TDefaultTransmissivity::IsTransmitted( double /*distance*/, RandomDeviate&
 {
 	return true;
 }
+
+double TDefaultTransmissivity::Transmittance( double /*distance*/ ) const
+{
+	return ( 1.0 );
+}
@@ -55,3 +55,16 @@ TMaterial::TMaterial()
 TMaterial::~TMaterial()
 {
 }
+
+/*!
+ * Computes the \a outputRay for the \a incident ray without absorbing it stochastically: the fraction of the
+ * incident power carried by the output ray is returned in \a reflectance. Returns false if there is no output ray.
+ *
+ * The default implementation absorbs the ray as OutputRay does and sets \a reflectance to one, which keeps
+ * the results unbiased for the materials that do not compute their reflectance.
+ */
+bool TMaterial::WeightedOutputRay( const Ray& incident, DifferentialGeometry* dg, RandomDeviate& rand, Ray* outputRay, double* reflectance ) const
+{
+	*reflectance = 1.0;
+	return ( OutputRay( incident, dg, rand, outputRay ) );
+}
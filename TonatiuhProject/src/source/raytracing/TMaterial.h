@@ -55,6 +55,7 @@ public:
 
 	virtual QString getIcon() = 0;
 	virtual bool OutputRay( const Ray& incident, DifferentialGeometry* dg, RandomDeviate& rand, Ray* outputRay  ) const = 0;
+	virtual bool WeightedOutputRay( const Ray& incident, DifferentialGeometry* dg, RandomDeviate& rand, Ray* outputRay, double* reflectance ) const;
 
 protected:
 	TMaterial();
@@ -37,6 +37,7 @@
  ***************************************************************************/
 
 #include "PhotonMapExport.h"
+#include "PhotonTally.h"
 #include "TPhotonMap.h"
 
 /*!
@@ -73,6 +74,16 @@ TPhotonMap::~TPhotonMap()
  * Checks where the photon map has to be saved and saves them.
  */
 void TPhotonMap::EndStore( double wPhoton )
+{
+	Flush();
+	if( m_pExportPhotonMap )	m_pExportPhotonMap->SetPowerPerPhoton( wPhoton );
+	if( m_pExportPhotonMap )	m_pExportPhotonMap->EndExport();
+}
+
+/*!
+ * Saves the photons of the buffer with the export mode and empties the buffer. The export is not ended.
+ */
+void TPhotonMap::Flush()
 {
 	if( m_storedPhotonsInBuffer  > 0 )
 	{
@@ -90,8 +101,6 @@ void TPhotonMap::EndStore( double wPhoton )
 		m_storedPhotonsInBuffer = 0;
 
 	}
-	if( m_pExportPhotonMap )	m_pExportPhotonMap->SetPowerPerPhoton( wPhoton );
-	if( m_pExportPhotonMap )	m_pExportPhotonMap->EndExport();
 }
 
 /*!
@@ -145,6 +154,17 @@ bool TPhotonMap::SetExportMode( PhotonMapExport* pExportPhotonMap )
 void TPhotonMap::StoreRays( std::vector< Photon >& raysList )
 {
 	unsigned int raysListSize = raysList.size();
+
+	//The export mode tallies the photons instead of saving them
+	PhotonTally* photonTally = m_pExportPhotonMap ? m_pExportPhotonMap->GetPhotonTally() : 0;
+	if( photonTally )
+	{
+		PhotonTallyCounts photonCounts;
+		photonCounts.Add( raysList );
+		photonTally->AddTally( photonCounts );
+		m_storedAllPhotons += raysListSize;
+		return;
+	}
 	if( ( m_storedPhotonsInBuffer > 0 ) && ( ( m_storedPhotonsInBuffer + raysListSize )  > m_bufferSize ) )
 	{
 		if( m_pExportPhotonMap ) m_pExportPhotonMap->SavePhotonMap( m_photonsInMemory );
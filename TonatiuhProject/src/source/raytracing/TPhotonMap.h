@@ -50,6 +50,7 @@ public:
 	~TPhotonMap();
 
     void EndStore( double wPhoton );
+    void Flush();
 	std::vector< Photon* > GetAllPhotons() const;
 	PhotonMapExport* GetExportMode( ) const;
 	void SetBufferSize( unsigned long nPhotons );
@@ -36,6 +36,8 @@ Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez
 Juana Amieva, Azael Mancillas, Cesar Cantu.
 ***************************************************************************/
 
+#include <QtConcurrentMap>
+
 #include <Inventor/nodes/SoTransform.h>
 #include <Inventor/nodekits/SoNodeKitListPart.h>
 
@@ -51,6 +53,26 @@ Juana Amieva, Azael Mancillas, Cesar Cantu.
 
 SO_KIT_SOURCE(TSceneKit);
 
+/*!
+ * Functor to evaluate the trackers of the scene in parallel.
+ */
+struct TrackerEvaluator
+{
+	TrackerEvaluator( const Vector3D& sunVector )
+	:m_sunVector( sunVector )
+	{
+
+	}
+
+	typedef void result_type;
+	void operator()( TSceneKit::TrackerSolution& solution ) const
+	{
+		solution.isValid = solution.tracker->ComputeTrackerMatrix( m_sunVector, solution.parentWTO, &solution.trackerMatrix );
+	}
+
+	Vector3D m_sunVector;
+};
+
 /**
  * Does initialization common for all objects of the TSceneKit class.
  * This includes setting up the type system, among other things.
@@ -139,47 +161,71 @@ void TSceneKit::UpdateSunPosition( double azimuthValue, double zenithValue )
 	SoNodeKitListPart* sunNodePartList = static_cast< SoNodeKitListPart* >( sunNode->getPart( "childList", true ) );
 	if( !sunNodePartList )	return;
 
+	QVector< TrackerSolution > trackersList;
 	for( int index = 0; index < sunNodePartList->getNumChildren(); ++index )
 	{
 		SoBaseKit* coinChild = static_cast< SoBaseKit* >( sunNodePartList->getChild( index ) );
-		UpdateTrackersTransform( coinChild, sunVector, sceneOTW );
+		CollectTrackers( coinChild, sceneOTW, &trackersList );
 	}
 
+	UpdateTrackersTransform( trackersList, sunVector );
+
 }
 
 /*!
- * Updates all trackers transform for the current sun angles.
+ * Appends to \a trackersList the trackers defined in \a branch with the world to object transformation of their parent.
+ * \a parentOTW is the object to world transformation of the \a branch parent.
  */
-void TSceneKit::UpdateTrackersTransform( SoBaseKit* branch, Vector3D sunVector, Transform parentOTW )
+void TSceneKit::CollectTrackers( SoBaseKit* branch, const Transform& parentOTW, QVector< TrackerSolution >* trackersList )
 {
 	if( !branch )	return;
 
 	SoNode* tracker = branch->getPart( "tracker", false );
 	if( tracker )
 	{
-
-		TTracker* trackerNode = static_cast< TTracker* >( tracker );
-		trackerNode->Evaluate( sunVector, parentOTW.GetInverse() );
+		TrackerSolution solution;
+		solution.tracker = static_cast< TTracker* >( tracker );
+		solution.parentWTO = parentOTW.GetInverse();
+		solution.isValid = false;
+		trackersList->push_back( solution );
 		return;
 	}
 
 	if( branch->getTypeId().isDerivedFrom( TSeparatorKit::getClassTypeId() ) )
 	{
+		SoNodeKitListPart* coinPartList = static_cast< SoNodeKitListPart* >( branch->getPart( "childList", false ) );
+		if( !coinPartList || coinPartList->getNumChildren() < 1 )	return;
+
 		SoTransform* nodeTransform = static_cast< SoTransform* >(branch->getPart( "transform", true ) );
 		Transform nodeTransformationOTW = tgf::TransformFromSoTransform( nodeTransform );
-		//Transform nodeTransformationWTO = groupNode->GetTrasformation().GetInverse();
 		Transform nodeOTW = nodeTransformationOTW * parentOTW;
 
-		SoNodeKitListPart* coinPartList = static_cast< SoNodeKitListPart* >( branch->getPart( "childList", false ) );
-		if ( coinPartList )
+		for( int index = 0; index < coinPartList->getNumChildren(); ++index )
 		{
-			for( int index = 0; index < coinPartList->getNumChildren(); ++index )
-			{
-				SoBaseKit* coinChild = static_cast< SoBaseKit* >( coinPartList->getChild( index ) );
-				if( coinChild )		UpdateTrackersTransform( coinChild, sunVector, nodeOTW );
-			}
+			SoBaseKit* coinChild = static_cast< SoBaseKit* >( coinPartList->getChild( index ) );
+			if( coinChild )		CollectTrackers( coinChild, nodeOTW, trackersList );
 		}
-
 	}
+}
 
+/*!
+ * Updates all trackers in \a trackersList for the sun direction \a sunVector.
+ *
+ * The trackers are evaluated in parallel and the results are applied to the scene afterwards in a single pass,
+ * notifying the scene observers only once.
+ */
+void TSceneKit::UpdateTrackersTransform( QVector< TrackerSolution >& trackersList, const Vector3D& sunVector )
+{
+	if( trackersList.isEmpty() )	return;
+
+	QtConcurrent::blockingMap( trackersList, TrackerEvaluator( sunVector ) );
+
+	SbBool notify = enableNotify( FALSE );
+	for( int index = 0; index < trackersList.size(); ++index )
+	{
+		const TrackerSolution& solution = trackersList[index];
+		if( solution.isValid )	solution.tracker->SetEngineOutputMatrix( solution.trackerMatrix );
+	}
+	enableNotify( notify );
+	touch();
 }
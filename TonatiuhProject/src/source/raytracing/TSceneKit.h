@@ -39,15 +39,19 @@ Juana Amieva, Azael Mancillas, Cesar Cantu.
 #ifndef TSCENEKIT_H_
 #define TSCENEKIT_H_
 
+#include <QVector>
+
+#include <Inventor/SbMatrix.h>
 #include <Inventor/nodekits/SoSceneKit.h>
 #include <Inventor/actions/SoSearchAction.h>
+#include "Transform.h"
 #include "TSeparatorKit.h"
 #include "trt.h"
 #include "tgf.h"
 
 class QString;
+class TTracker;
 class Vector3D;
-class Transform;
 
 class TSceneKit : public SoSceneKit
 {
@@ -57,6 +61,18 @@ class TSceneKit : public SoSceneKit
  	SO_KIT_CATALOG_ENTRY_HEADER( transmissivity );
 
 public:
+    /*!
+     * Tracker of the scene with the transformation needed to evaluate it
+     * and the result of the last evaluation.
+     */
+    struct TrackerSolution
+    {
+    	TTracker* tracker;
+    	Transform parentWTO;
+    	SbMatrix trackerMatrix;
+    	bool isValid;
+    };
+
  	TSceneKit();
     static void initClass();
 
@@ -71,7 +87,9 @@ public:
     trt::TONATIUH_REAL zenith;
 protected:
     virtual ~TSceneKit();
-    void UpdateTrackersTransform( SoBaseKit* branch, Vector3D sunVector, Transform parentOTW );
+
+    void CollectTrackers( SoBaseKit* branch, const Transform& parentOTW, QVector< TrackerSolution >* trackersList );
+    void UpdateTrackersTransform( QVector< TrackerSolution >& trackersList, const Vector3D& sunVector );
 };
 
 
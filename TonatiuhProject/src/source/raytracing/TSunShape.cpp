@@ -52,3 +52,15 @@ TSunShape::TSunShape()
 TSunShape::~TSunShape()
 {
 }
+
+/*!
+ * Generates the direction of the primary ray \a sampleIndex taking its random numbers from the sample
+ * dimensions starting at \a firstDimension.
+ *
+ * Sunshapes that do not sample by dimensions generate the direction from the random number stream.
+ */
+void TSunShape::GenerateRayDirection( Vector3D& direction, RandomDeviate& rand,
+		unsigned long long /*sampleIndex*/, int /*firstDimension*/ ) const
+{
+	GenerateRayDirection( direction, rand );
+}
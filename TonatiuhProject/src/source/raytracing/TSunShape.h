@@ -56,6 +56,8 @@ public:
     static void initClass();
 
 	virtual void GenerateRayDirection( Vector3D& direction, RandomDeviate& rand ) const = 0;
+	virtual void GenerateRayDirection( Vector3D& direction, RandomDeviate& rand,
+			unsigned long long sampleIndex, int firstDimension ) const;
 	virtual double GetIrradiance() const = 0;
     virtual double GetThetaMax() const = 0;
 
@@ -108,9 +108,46 @@ void TTracker::ConnectParentTranform(SoTransform* parentTransform)
 }
 
 
-void TTracker::Evaluate( Vector3D /*sunVector*/, Transform /*parentWT0*/ )
-{
-
+/*!
+ * Computes the tracker orientation for the sun direction \a sunVectorW and sets it as the engine output.
+ */
+void TTracker::Evaluate( Vector3D sunVectorW, Transform parentWT0 )
+{
+	SbMatrix trackerMatrix;
+	if( ComputeTrackerMatrix( sunVectorW, parentWT0, &trackerMatrix ) )
+		SetEngineOutputMatrix( trackerMatrix );
+}
+
+/*!
+ * Computes in \a trackerMatrix the transformation the tracker applies to its parent node for the
+ * world sun vector \a sunVectorW. \a parentWT0 is the world to object transformation of the parent node.
+ *
+ * Returns false if the tracker orientation cannot be computed and the current output must be kept.
+ *
+ * This method can be called simultaneously from several threads. It must not modify the tracker nor
+ * copy \a parentWT0.
+ */
+bool TTracker::ComputeTrackerMatrix( const Vector3D& /*sunVectorW*/, const Transform& /*parentWT0*/, SbMatrix* /*trackerMatrix*/ ) const
+{
+	return ( false );
+}
+
+/*!
+ * Sets the engine outputs to the transformation defined by \a trackerMatrix.
+ */
+void TTracker::SetEngineOutputMatrix( const SbMatrix& trackerMatrix )
+{
+	SbVec3f translation;
+	SbRotation rotation;
+	SbVec3f scaleFactor;
+	SbRotation scaleOrientation;
+	trackerMatrix.getTransform( translation, rotation, scaleFactor, scaleOrientation, SbVec3f( 0.0, 0.0, 0.0 ) );
+
+	SO_ENGINE_OUTPUT( outputTranslation, SoSFVec3f, setValue( translation ) );
+	SO_ENGINE_OUTPUT( outputRotation, SoSFRotation, setValue( rotation ) );
+	SO_ENGINE_OUTPUT( outputScaleFactor, SoSFVec3f, setValue( scaleFactor ) );
+	SO_ENGINE_OUTPUT( outputScaleOrientation, SoSFRotation, setValue( scaleOrientation ) );
+	SO_ENGINE_OUTPUT( outputCenter, SoSFVec3f, setValue( SbVec3f( 0.0, 0.0, 0.0 ) ) );
 }
 
 void TTracker::SetEngineOutput(SoTransform* newTransform)
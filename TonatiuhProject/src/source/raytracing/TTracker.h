@@ -39,6 +39,7 @@ Juana Amieva, Azael Mancillas, Cesar Cantu.
 #ifndef TTRACKER_H_
 #define TTRACKER_H_
 
+#include <Inventor/SbMatrix.h>
 #include <Inventor/engines/SoNodeEngine.h>
 #include <Inventor/engines/SoSubNodeEngine.h>
 #include <Inventor/nodes/SoTransform.h>
@@ -72,6 +73,8 @@ public:
 	//double GetZenith() { return m_zenith.getValue();};
 
 	virtual void Evaluate( Vector3D sunVectorW, Transform parentWT0 );
+	virtual bool ComputeTrackerMatrix( const Vector3D& sunVectorW, const Transform& parentWT0, SbMatrix* trackerMatrix ) const;
+	void SetEngineOutputMatrix( const SbMatrix& trackerMatrix );
 
 protected:
 	//Constructor
@@ -54,6 +54,7 @@ public:
     static void initClass();
 
 	virtual bool IsTransmitted( double distance, RandomDeviate& rand ) const = 0;
+	virtual double Transmittance( double distance ) const = 0;
 
 protected:
 	TTransmissivity();
@@ -0,0 +1,225 @@
+/***************************************************************************
+Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+This file is part of Tonatiuh.
+
+Tonatiuh program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Acknowledgments:
+
+The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+then Chair of the Department of Engineering of the University of Texas at
+Brownsville. From May 2004 to July 2008, it was supported by the Department
+of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+During 2007, NREL also contributed to the validation of Tonatiuh under the
+framework of the Memorandum of Understanding signed with the Spanish
+National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez,
+Juana Amieva, Azael Mancillas, Cesar Cantu.
+***************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QFile>
+
+#if defined( Q_OS_WIN )
+#include <windows.h>
+#endif
+
+#include <Inventor/SoOutput.h>
+#include <Inventor/actions/SoWriteAction.h>
+#include <Inventor/nodes/SoNode.h>
+
+#include "PhotonMapExport.h"
+#include "TPhotonMap.h"
+#include "TraceCheckpoint.h"
+
+namespace
+{
+	const quint32 checkpointMagic = 0x544E4843;
+
+	/*!
+	 * Renames \a fileName to \a newName, replacing \a newName if it exists. The replacement is atomic,
+	 * so \a newName is always either the previous file or the new one.
+	 */
+	bool RenameOver( const QString& fileName, const QString& newName )
+	{
+#if defined( Q_OS_WIN )
+		return ( MoveFileExW( reinterpret_cast< const wchar_t* >( fileName.utf16() ), reinterpret_cast< const wchar_t* >( newName.utf16() ),
+				MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH ) != 0 );
+#else
+		return ( rename( QFile::encodeName( fileName ).constData(), QFile::encodeName( newName ).constData() ) == 0 );
+#endif
+	}
+	const quint32 checkpointVersion = 1;
+
+	/*!
+	 * SoOutput buffer reallocation function.
+	 */
+	void* ReallocBuffer( void* buffer, size_t size )
+	{
+		return realloc( buffer, size );
+	}
+}
+
+/*!
+ * Creates an empty checkpoint.
+ */
+TraceCheckpoint::TraceCheckpoint()
+:seed( 0 ),
+ workerIndex( -1 ),
+ numberOfWorkers( 0 ),
+ numberOfThreads( 1 ),
+ runIndex( 0 ),
+ raysToTrace( 0 ),
+ nextRay( 0 ),
+ nextChunk( 0 ),
+ previousTracedRays( 0 ),
+ m_exportMode( 0 )
+{
+
+}
+
+/*!
+ * Returns true if \a other checkpoint was saved tracing the same scene with the same parameters.
+ */
+bool TraceCheckpoint::IsSameTrace( const TraceCheckpoint& other ) const
+{
+	return ( sceneHash == other.sceneHash &&
+			randomDeviateName == other.randomDeviateName &&
+			seed == other.seed &&
+			workerIndex == other.workerIndex &&
+			numberOfWorkers == other.numberOfWorkers );
+}
+
+/*!
+ * Reads the checkpoint file \a fileName. Returns false if the file is not a valid checkpoint.
+ */
+bool TraceCheckpoint::Read( const QString& fileName )
+{
+	QFile checkpointFile( fileName );
+	if( !checkpointFile.open( QIODevice::ReadOnly ) )	return ( false );
+
+	QDataStream in( &checkpointFile );
+	quint32 magic;
+	quint32 version;
+	in>>magic>>version;
+	if( magic != checkpointMagic || version != checkpointVersion )	return ( false );
+
+	quint64 seedValue, run, rays, ray, chunk, tracedRays;
+	qint32 worker, workers, threads;
+	in>>sceneHash>>randomDeviateName>>seedValue>>worker>>workers>>threads;
+	in>>run>>rays>>ray>>chunk>>tracedRays>>exportState;
+	if( in.status() != QDataStream::Ok )	return ( false );
+
+	seed = seedValue;
+	workerIndex = worker;
+	numberOfWorkers = workers;
+	numberOfThreads = threads;
+	runIndex = run;
+	raysToTrace = rays;
+	nextRay = ray;
+	nextChunk = chunk;
+	previousTracedRays = tracedRays;
+	m_fileName = fileName;
+	return ( true );
+}
+
+/*!
+ * Saves a checkpoint after \a storedRays rays of the run have been stored in \a photonMap and \a nextChunkIndex is
+ * the next chunk to store. The photons in the photon map buffer are exported before the export state is saved.
+ *
+ * Called from the ray tracing threads while the photon map is locked.
+ */
+bool TraceCheckpoint::Save( TPhotonMap* photonMap, unsigned long storedRays, unsigned long nextChunkIndex )
+{
+	if( !m_exportMode )	return ( false );
+
+	photonMap->Flush();
+
+	QByteArray state;
+	QDataStream stateStream( &state, QIODevice::WriteOnly );
+	if( !m_exportMode->SaveState( stateStream ) )
+	{
+		std::cerr<<"The photon map export type does not support checkpoints."<<std::endl;
+		return ( false );
+	}
+
+	exportState = state;
+	nextRay = storedRays;
+	nextChunk = nextChunkIndex;
+	if( !Write() )
+	{
+		std::cerr<<"Cannot write the checkpoint "<<m_fileName.toStdString()<<"."<<std::endl;
+		return ( false );
+	}
+	return ( true );
+}
+
+/*!
+ * Writes the checkpoint to FileName(). The new checkpoint is written to a temporary file that is renamed over
+ * the previous one only when it is complete, so an interruption never leaves the checkpoint missing or partial.
+ */
+bool TraceCheckpoint::Write() const
+{
+	QString temporaryFileName = m_fileName + QLatin1String( ".tmp" );
+	QFile checkpointFile( temporaryFileName );
+	if( !checkpointFile.open( QIODevice::WriteOnly ) )	return ( false );
+
+	QDataStream out( &checkpointFile );
+	out<<checkpointMagic<<checkpointVersion;
+	out<<sceneHash<<randomDeviateName<<quint64( seed )<<qint32( workerIndex )<<qint32( numberOfWorkers )<<qint32( numberOfThreads );
+	out<<quint64( runIndex )<<quint64( raysToTrace )<<quint64( nextRay )<<quint64( nextChunk )<<quint64( previousTracedRays )<<exportState;
+	checkpointFile.close();
+	if( ( out.status() != QDataStream::Ok ) || ( checkpointFile.error() != QFile::NoError ) )
+	{
+		QFile::remove( temporaryFileName );
+		return ( false );
+	}
+
+	return ( RenameOver( temporaryFileName, m_fileName ) );
+}
+
+/*!
+ * Returns the SHA-1 hash of the \a scene written in Inventor format.
+ */
+QByteArray TraceCheckpoint::SceneHash( SoNode* scene )
+{
+	if( !scene )	return ( QByteArray() );
+
+	SoWriteAction writeAction;
+	SoOutput* output = writeAction.getOutput();
+	output->setBuffer( malloc( 1024 ), 1024, ReallocBuffer );
+	writeAction.apply( scene );
+
+	void* buffer = 0;
+	size_t bufferSize = 0;
+	output->getBuffer( buffer, bufferSize );
+
+	QByteArray hash = QCryptographicHash::hash( QByteArray::fromRawData( static_cast< const char* >( buffer ), int( bufferSize ) ),
+			QCryptographicHash::Sha1 );
+	free( buffer );
+	return ( hash );
+}
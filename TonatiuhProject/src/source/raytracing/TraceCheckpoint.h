@@ -0,0 +1,96 @@
+/***************************************************************************
+Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+This file is part of Tonatiuh.
+
+Tonatiuh program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Acknowledgments:
+
+The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+then Chair of the Department of Engineering of the University of Texas at
+Brownsville. From May 2004 to July 2008, it was supported by the Department
+of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+During 2007, NREL also contributed to the validation of Tonatiuh under the
+framework of the Memorandum of Understanding signed with the Spanish
+National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez,
+Juana Amieva, Azael Mancillas, Cesar Cantu.
+***************************************************************************/
+
+#ifndef TRACECHECKPOINT_H_
+#define TRACECHECKPOINT_H_
+
+#include <QByteArray>
+#include <QString>
+
+class PhotonMapExport;
+class SoNode;
+class TPhotonMap;
+
+//!  TraceCheckpoint class stores the progress of a ray tracing to resume it after an interruption.
+/*!
+ * A checkpoint is saved while the rays are traced, each time a number of rays has been stored, and when each run ends.
+ * It stores the position of the ray tracing (run number, next ray and next chunk), the number of traced rays
+ * and the photon map export state. The random numbers do not need to be saved: each chunk is traced with its own
+ * random stream, so the next chunk number defines the random state.
+ *
+ * The scene hash and the ray tracing parameters are saved to check that the resumed ray tracing is the same.
+*/
+class TraceCheckpoint
+{
+
+public:
+	TraceCheckpoint();
+
+	QString FileName() const { return ( m_fileName ); };
+	void SetFileName( const QString& fileName ) { m_fileName = fileName; };
+	void SetExportMode( PhotonMapExport* exportMode ) { m_exportMode = exportMode; };
+
+	bool IsComplete() const { return ( nextRay >= raysToTrace ); };
+	bool IsSameTrace( const TraceCheckpoint& other ) const;
+	unsigned long TracedRays() const { return ( previousTracedRays + nextRay ); };
+
+	bool Read( const QString& fileName );
+	bool Save( TPhotonMap* photonMap, unsigned long storedRays, unsigned long nextChunkIndex );
+	bool Write() const;
+
+	static QByteArray SceneHash( SoNode* scene );
+
+	QByteArray sceneHash;
+	QString randomDeviateName;
+	unsigned long seed;
+	int workerIndex;
+	int numberOfWorkers;
+	int numberOfThreads;
+	unsigned long runIndex;
+	unsigned long raysToTrace;
+	unsigned long nextRay;
+	unsigned long nextChunk;
+	unsigned long previousTracedRays;
+	QByteArray exportState;
+
+private:
+	QString m_fileName;
+	PhotonMapExport* m_exportMode;
+};
+
+#endif /* TRACECHECKPOINT_H_ */
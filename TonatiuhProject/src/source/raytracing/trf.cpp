@@ -36,10 +36,12 @@ Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez
 Juana Amieva, Azael Mancillas, Cesar Cantu.
 ***************************************************************************/
 
+#include <algorithm>
 #include <cmath>
 #include <vector>
 
 #include <QFile>
+#include <QHash>
 #include <QTextStream>
 
 #include <Inventor/nodes/SoCoordinate3.h>
@@ -61,26 +63,202 @@ Juana Amieva, Azael Mancillas, Cesar Cantu.
 #include "trf.h"
 #include "TShapeKit.h"
 
+namespace
+{
+	struct SurfaceShare
+	{
+		InstanceNode* surface;
+		unsigned long elements;
+		unsigned long quota;
+	};
 
-SoSeparator* trf::DrawPhotonMapPoints( const TPhotonMap& map )
+	bool MoreElements( const SurfaceShare& share1, const SurfaceShare& share2 )
+	{
+		return ( share1.elements > share2.elements );
+	}
+}
+
+/*!
+ * Returns the indexes of at most \a maximumElements elements, stratified by the surface of \a elementSurfaces.
+ *
+ * Each surface keeps a share of \a maximumElements proportional to its number of elements, and at least one
+ * element, so that small surfaces are still represented. The elements that those minimums add over the budget
+ * are taken from the surfaces with more elements. If there are more surfaces than \a maximumElements, only the
+ * surfaces with more elements keep one element each. The elements of each surface are taken at regular
+ * intervals. If \a maximumElements is zero or there are not more elements, all the indexes are returned.
+ */
+std::vector< unsigned long > trf::SelectStratified( const std::vector< InstanceNode* >& elementSurfaces, unsigned long maximumElements )
 {
+	unsigned long numberOfElements = elementSurfaces.size();
+	std::vector< unsigned long > selected;
+	if( ( maximumElements == 0 ) || ( numberOfElements <= maximumElements ) )
+	{
+		selected.reserve( numberOfElements );
+		for( unsigned long e = 0; e < numberOfElements; ++e )	selected.push_back( e );
+		return selected;
+	}
 
-	SoSeparator* drawpoints = new SoSeparator;
-	SoCoordinate3* points = new SoCoordinate3;
-	std::vector< Photon* > photonsList = map.GetAllPhotons();
-    unsigned int numRays=0;
+	//The surfaces in order of their first element, so that the ties are always resolved the same way
+	QHash< InstanceNode*, unsigned long > surfaceShareIndex;
+	std::vector< SurfaceShare > shares;
+	for( unsigned long e = 0; e < numberOfElements; ++e )
+	{
+		InstanceNode* surface = elementSurfaces[e];
+		if( !surfaceShareIndex.contains( surface ) )
+		{
+			surfaceShareIndex.insert( surface, shares.size() );
+			SurfaceShare share = { surface, 0, 0 };
+			shares.push_back( share );
+		}
+		shares[surfaceShareIndex.value( surface )].elements++;
+	}
+	std::stable_sort( shares.begin(), shares.end(), MoreElements );
 
-	for( unsigned int i = 0; i < photonsList.size(); i++)
+	unsigned long numberOfSurfaces = shares.size();
+	unsigned long totalQuota = 0;
+	for( unsigned long s = 0; s < numberOfSurfaces; ++s )
 	{
-		Point3D photon = photonsList[i]->pos;
-		points->point.set1Value( numRays, photon.x, photon.y, photon.z );
-		numRays++;
+		if( numberOfSurfaces > maximumElements )	shares[s].quota = ( s < maximumElements ) ? 1 : 0;
+		else
+		{
+			unsigned long quota = ( unsigned long ) ( double( maximumElements ) * shares[s].elements / numberOfElements );
+			shares[s].quota = std::max( quota, 1UL );
+		}
+		totalQuota += shares[s].quota;
+	}
+
+	//There are at most maximumElements surfaces here, so the minimums of one element fit in the budget
+	while( totalQuota > maximumElements )
+	{
+		for( unsigned long s = 0; s < numberOfSurfaces && totalQuota > maximumElements; ++s )
+		{
+			if( shares[s].quota < 2 )	continue;
+			shares[s].quota--;
+			totalQuota--;
+		}
 	}
 
+	QHash< InstanceNode*, unsigned long > surfaceElements;
+	QHash< InstanceNode*, unsigned long > surfaceQuota;
+	for( unsigned long s = 0; s < numberOfSurfaces; ++s )
+	{
+		surfaceElements.insert( shares[s].surface, shares[s].elements );
+		surfaceQuota.insert( shares[s].surface, shares[s].quota );
+	}
+
+	selected.reserve( totalQuota );
+	QHash< InstanceNode*, unsigned long > surfaceVisited;
+	for( unsigned long e = 0; e < numberOfElements; ++e )
+	{
+		InstanceNode* surface = elementSurfaces[e];
+		unsigned long count = surfaceElements.value( surface );
+		unsigned long quota = surfaceQuota.value( surface );
+		unsigned long visited = surfaceVisited[surface]++;
+
+		//The element is selected when it starts a new interval of count / quota elements
+		if( ( visited * quota ) / count != ( ( visited + 1 ) * quota ) / count )	selected.push_back( e );
+	}
+	return selected;
+}
+
+/*!
+ * Computes the positions of the photons of \a photonsList to draw. If \a maximumPhotons is not zero,
+ * at most \a maximumPhotons photons, stratified by intersected surface, are drawn.
+ */
+void trf::ComputePhotonMapPoints( const std::vector< Photon* >& photonsList, unsigned long maximumPhotons, std::vector< SbVec3f >* points )
+{
+	std::vector< InstanceNode* > photonSurfaces( photonsList.size() );
+	for( unsigned long p = 0; p < photonsList.size(); ++p )
+		photonSurfaces[p] = photonsList[p]->intersectedSurface;
+
+	std::vector< unsigned long > selected = SelectStratified( photonSurfaces, maximumPhotons );
+	points->clear();
+	points->reserve( selected.size() );
+	for( unsigned long s = 0; s < selected.size(); ++s )
+	{
+		const Point3D& position = photonsList[selected[s]]->pos;
+		points->push_back( SbVec3f( position.x, position.y, position.z ) );
+	}
+}
+
+/*!
+ * Computes the vertices of the rays stored in \a photonsList and the number of vertices of each ray.
+ * A ray starts with a photon with zero id. If \a maximumRays is not zero, at most \a maximumRays rays,
+ * stratified by the surface where each ray finishes, are drawn.
+ */
+void trf::ComputePhotonMapRays( const std::vector< Photon* >& photonsList, unsigned long maximumRays,
+		std::vector< SbVec3f >* rayVertices, std::vector< int32_t >* rayLengths )
+{
+	std::vector< unsigned long > rayStart;
+	std::vector< InstanceNode* > raySurfaces;
+	unsigned long photonIndex = 0;
+	while( photonIndex < photonsList.size() )
+	{
+		rayStart.push_back( photonIndex );
+		do
+		{
+			photonIndex++;
+		}while( photonIndex < photonsList.size() && photonsList[photonIndex]->id > 0 );
+
+		raySurfaces.push_back( photonsList[photonIndex - 1]->intersectedSurface );
+	}
+	rayStart.push_back( photonsList.size() );
+
+	std::vector< unsigned long > selected = SelectStratified( raySurfaces, maximumRays );
+	rayVertices->clear();
+	rayLengths->clear();
+	rayLengths->reserve( selected.size() );
+	for( unsigned long s = 0; s < selected.size(); ++s )
+	{
+		unsigned long ray = selected[s];
+		for( unsigned long p = rayStart[ray]; p < rayStart[ray + 1]; ++p )
+		{
+			const Point3D& position = photonsList[p]->pos;
+			rayVertices->push_back( SbVec3f( position.x, position.y, position.z ) );
+		}
+		rayLengths->push_back( rayStart[ray + 1] - rayStart[ray] );
+	}
+}
+
+/*!
+ * Computes the photons and the rays of the \a map to draw, at most \a maximumElements of each of them.
+ * The photons are only computed if \a points is not null and the rays if \a rayVertices is not null.
+ *
+ * It does not create any Coin node, so it can be run out of the GUI thread.
+ */
+void trf::ComputePhotonMapDrawing( const TPhotonMap* map, unsigned long maximumElements, std::vector< SbVec3f >* points,
+		std::vector< SbVec3f >* rayVertices, std::vector< int32_t >* rayLengths )
+{
+	if( !map )	return;
+
+	std::vector< Photon* > photonsList = map->GetAllPhotons();
+	if( points )	ComputePhotonMapPoints( photonsList, maximumElements, points );
+	if( rayVertices && rayLengths )	ComputePhotonMapRays( photonsList, maximumElements, rayVertices, rayLengths );
+}
+
+/*!
+ * Creates the node to draw the photons of the \a map. If \a maximumPhotons is not zero, at most \a maximumPhotons photons are drawn.
+ */
+SoSeparator* trf::DrawPhotonMapPoints( const TPhotonMap& map, unsigned long maximumPhotons )
+{
+	std::vector< SbVec3f > points;
+	ComputePhotonMapPoints( map.GetAllPhotons(), maximumPhotons, &points );
+	return DrawPhotonMapPoints( points );
+}
+
+/*!
+ * Creates the node to draw the photons at \a points.
+ */
+SoSeparator* trf::DrawPhotonMapPoints( const std::vector< SbVec3f >& points )
+{
+	SoSeparator* drawpoints = new SoSeparator;
+	SoCoordinate3* coordinates = new SoCoordinate3;
+	if( points.size() > 0 )	coordinates->point.setValues( 0, points.size(), &points[0] );
+
 	SoMaterial* myMaterial = new SoMaterial;
 	myMaterial->diffuseColor.setValue(1.0, 1.0, 0.0);
 	drawpoints->addChild(myMaterial);
-	drawpoints->addChild(points);
+	drawpoints->addChild(coordinates);
 
 	SoDrawStyle* drawstyle = new SoDrawStyle;
 	drawstyle->pointSize = 3;
@@ -93,51 +271,35 @@ SoSeparator* trf::DrawPhotonMapPoints( const TPhotonMap& map )
 
 }
 
-SoSeparator* trf::DrawPhotonMapRays( const TPhotonMap& map, unsigned long /*numberOfRays*/ )
+/*!
+ * Creates the node to draw the rays of the \a map. If \a maximumRays is not zero, at most \a maximumRays rays are drawn.
+ */
+SoSeparator* trf::DrawPhotonMapRays( const TPhotonMap& map, unsigned long /*numberOfRays*/, unsigned long maximumRays )
 {
+	std::vector< SbVec3f > rayVertices;
+	std::vector< int32_t > rayLengths;
+	ComputePhotonMapRays( map.GetAllPhotons(), maximumRays, &rayVertices, &rayLengths );
+	return DrawPhotonMapRays( rayVertices, rayLengths );
+}
 
+/*!
+ * Creates the node to draw the rays defined by \a rayVertices. \a rayLengths stores the number of vertices of each ray.
+ */
+SoSeparator* trf::DrawPhotonMapRays( const std::vector< SbVec3f >& rayVertices, const std::vector< int32_t >& rayLengths )
+{
 	SoSeparator* drawrays = new SoSeparator;
 	SoCoordinate3* points = new SoCoordinate3;
-
-	QVector< int >	rayLengths;
-	std::vector< Photon* > allRaysLists = map.GetAllPhotons();
-
-
-	int nRay = 0;
-	unsigned int photonIndex = 0;
-	while( photonIndex < allRaysLists.size() )
-	{
-		unsigned long rayLength = 0;
-		do
-		{
-			Photon* photon = allRaysLists[photonIndex];
-			Point3D photonPosistion = photon->pos;
-			points->point.set1Value( photonIndex, photonPosistion.x, photonPosistion.y, photonPosistion.z );
-			photonIndex++;
-			rayLength++;
-		}while( photonIndex < allRaysLists.size() && allRaysLists[photonIndex]->id > 0 );
-
-
-		rayLengths.push_back( rayLength );
-		nRay++;
-
-	}
+	if( rayVertices.size() > 0 )	points->point.setValues( 0, rayVertices.size(), &rayVertices[0] );
 
 	SoMaterial* myMaterial = new SoMaterial;
 	myMaterial->diffuseColor.setValue(1.0f, 1.0f, 0.8f);
 	drawrays->addChild( myMaterial );
 	drawrays->addChild( points );
 
-	int* lines = new int[rayLengths.size()];
-	for( int l = 0; l < rayLengths.size(); l++ )
-		lines[l] =  rayLengths[l];
-
 	SoLineSet* lineset = new SoLineSet;
-	lineset->numVertices.setValues( 0, rayLengths.size(), lines );
+	if( rayLengths.size() > 0 )	lineset->numVertices.setValues( 0, rayLengths.size(), &rayLengths[0] );
 	drawrays->addChild( lineset );
 
-
-	delete[] lines;
 	return drawrays;
 
 }
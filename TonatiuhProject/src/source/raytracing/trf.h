@@ -41,12 +41,14 @@ Juana Amieva, Azael Mancillas, Cesar Cantu.
 
 #include <QMap>
 #include <QPair>
+#include <QSet>
 #include <QStringList>
 
 #include <Inventor/actions/SoGetBoundingBoxAction.h>
 #include <Inventor/actions/SoGetMatrixAction.h>
 #include <Inventor/nodes/SoTransform.h>
 #include <Inventor/nodes/SoNode.h>
+#include <Inventor/SbVec3f.h>
 
 #include "Photon.h"
 #include "TPhotonMap.h"
@@ -66,12 +68,21 @@ class TPhotonMap;
 
 namespace trf
 {
-	void ComputeSceneTreeMap( InstanceNode* instanceNode, Transform parentWTO, bool insertInSurfaceList );
-	void ComputeFistStageSurfaceList( InstanceNode* instanceNode, QStringList disabledNodesURL, QVector< QPair< TShapeKit*, Transform > >* surfacesList);
+	void ComputeSceneTreeMap( InstanceNode* instanceNode, Transform parentWTO, bool insertInSurfaceList, bool forceUpdate = false );
+	void ComputeFistStageSurfaceList( InstanceNode* instanceNode, const QSet< QString >& disabledNodesURL, QVector< QPair< TShapeKit*, Transform > >* surfacesList);
 	void CreatePhotonMap( TPhotonMap*& photonMap, QPair< TPhotonMap* ,  std::vector < Photon  > > photonsList );
 
-	SoSeparator* DrawPhotonMapPoints( const TPhotonMap& map);
-	SoSeparator* DrawPhotonMapRays( const TPhotonMap& map, unsigned long numberOfRays );
+	std::vector< unsigned long > SelectStratified( const std::vector< InstanceNode* >& elementSurfaces, unsigned long maximumElements );
+	void ComputePhotonMapPoints( const std::vector< Photon* >& photonsList, unsigned long maximumPhotons, std::vector< SbVec3f >* points );
+	void ComputePhotonMapRays( const std::vector< Photon* >& photonsList, unsigned long maximumRays,
+			std::vector< SbVec3f >* rayVertices, std::vector< int32_t >* rayLengths );
+	void ComputePhotonMapDrawing( const TPhotonMap* map, unsigned long maximumElements, std::vector< SbVec3f >* points,
+			std::vector< SbVec3f >* rayVertices, std::vector< int32_t >* rayLengths );
+
+	SoSeparator* DrawPhotonMapPoints( const TPhotonMap& map, unsigned long maximumPhotons = 0 );
+	SoSeparator* DrawPhotonMapPoints( const std::vector< SbVec3f >& points );
+	SoSeparator* DrawPhotonMapRays( const TPhotonMap& map, unsigned long numberOfRays, unsigned long maximumRays = 0 );
+	SoSeparator* DrawPhotonMapRays( const std::vector< SbVec3f >& rayVertices, const std::vector< int32_t >& rayLengths );
 	Transform GetObjectToWorld(SoPath* nodePath);
 }
 
@@ -79,29 +90,40 @@ namespace trf
  * Compute a map with the InstanceNodes of sub-tree with top node \a instanceNode.
  *
  *The map stores for each InstanceNode its BBox and its transform in global coordinates.
+ *
+ * Only the nodes modified since the last call are recomputed. \a forceUpdate must be true to recompute
+ * all the sub-tree, for example if \a parentWTO is not the same as in the last call.
  **/
-inline void trf::ComputeSceneTreeMap( InstanceNode* instanceNode, Transform parentWTO, bool insertInSurfaceList )
+inline void trf::ComputeSceneTreeMap( InstanceNode* instanceNode, Transform parentWTO, bool insertInSurfaceList, bool forceUpdate )
 {
 
 	if( !instanceNode ) return;
+	if( !forceUpdate && !instanceNode->IsDirty() ) return;
 	SoBaseKit* coinNode = static_cast< SoBaseKit* > ( instanceNode->GetNode() );
 	if( !coinNode ) return;
 
+	bool updateTransform = forceUpdate || instanceNode->IsTransformDirty();
 	if( coinNode->getTypeId().isDerivedFrom( TSeparatorKit::getClassTypeId() ) )
 	{
-		SoTransform* nodeTransform = static_cast< SoTransform* >(coinNode->getPart( "transform", true ) );
-		Transform objectToWorld = tgf::TransformFromSoTransform( nodeTransform );
-		Transform worldToObject = objectToWorld.GetInverse();
+		Transform nodeWTO;
+		if( updateTransform )
+		{
+			SoTransform* nodeTransform = static_cast< SoTransform* >(coinNode->getPart( "transform", true ) );
+			Transform objectToWorld = tgf::TransformFromSoTransform( nodeTransform );
+			Transform worldToObject = objectToWorld.GetInverse();
 
-		BBox nodeBB;
-		Transform nodeWTO(worldToObject * parentWTO );
-		instanceNode->SetIntersectionTransform( nodeWTO );
+			nodeWTO = worldToObject * parentWTO;
+			instanceNode->SetIntersectionTransform( nodeWTO );
+		}
+		else
+			nodeWTO = instanceNode->GetIntersectionTransform();
 
+		BBox nodeBB;
 		bool insertChildInSurfaceList=insertInSurfaceList;
 		for( int index = 0; index < instanceNode->children.count() ; ++index )
 		{
 			InstanceNode* childInstance = instanceNode->children[index];
-			ComputeSceneTreeMap(childInstance, nodeWTO, insertChildInSurfaceList );
+			ComputeSceneTreeMap(childInstance, nodeWTO, insertChildInSurfaceList, updateTransform );
 
 			nodeBB = Union( nodeBB, childInstance->GetIntersectionBBox() );
 		}
@@ -149,12 +171,14 @@ inline void trf::ComputeSceneTreeMap( InstanceNode* instanceNode, Transform pare
 		}
 
 	}
+
+	instanceNode->SetClean();
 }
 
-inline void trf::ComputeFistStageSurfaceList( InstanceNode* instanceNode, QStringList disabledNodesURL, QVector< QPair< TShapeKit*, Transform > >* surfacesList)
+inline void trf::ComputeFistStageSurfaceList( InstanceNode* instanceNode, const QSet< QString >& disabledNodesURL, QVector< QPair< TShapeKit*, Transform > >* surfacesList)
 {
 	if( !instanceNode ) return;
-	if( disabledNodesURL.contains( instanceNode->GetNodeURL() ) )	return;
+	if( !disabledNodesURL.isEmpty() && disabledNodesURL.contains( instanceNode->GetNodeURL() ) )	return;
 
 	SoBaseKit* coinNode = static_cast< SoBaseKit* > ( instanceNode->GetNode() );
 	if( !coinNode ) return;
@@ -58,3 +58,20 @@ void ParallelRandomDeviate::FillArray( double* array, const unsigned long arrayS
 	m_pRand->FillArray( array, arraySize );
 	m_mutex->unlock();
 }
+
+/*!
+ * Returns the number of dimensions of the shared generator.
+ */
+unsigned int ParallelRandomDeviate::NumberOfDimensions( ) const
+{
+	return m_pRand->NumberOfDimensions();
+}
+
+/*!
+ * Returns the coordinate of the shared generator point. The points do not depend on the generator state,
+ * so they are read without locking the generator.
+ */
+double ParallelRandomDeviate::SampleCoordinate( unsigned long long sampleIndex, unsigned int dimension ) const
+{
+	return m_pRand->SampleCoordinate( sampleIndex, dimension );
+}
@@ -53,6 +53,8 @@ public:
 	ParallelRandomDeviate( RandomDeviate* rand, QMutex* mutex, unsigned long arraySize = 100000, QObject* parent = 0 );
 	virtual ~ParallelRandomDeviate( );
     void FillArray( double* array, const unsigned long arraySize );
+    unsigned int NumberOfDimensions( ) const;
+    double SampleCoordinate( unsigned long long sampleIndex, unsigned int dimension ) const;
 
 private:
     RandomDeviate* m_pRand;
@@ -42,6 +42,15 @@ Juana Amieva, Azael Mancillas, Cesar Cantu.
 //!  RandomDeviate is the base class for random generators.
 /*!
   A random generator class can be written based on this class.
+
+  Besides the flat stream of RandomDouble(), the ray tracer asks for the coordinates of sample points with
+  Sample( sampleIndex, dimension ): the primary ray number \a sampleIndex and a fixed dimension for each
+  sampled variable. Quasi-random generators return the coordinate \a dimension of their point \a sampleIndex
+  for the first NumberOfDimensions() dimensions. Pseudo-random generators do not have dimensions and
+  Sample returns the next number of the stream.
+
+  Generators with substreams restart at the substream of each primary ray with StartSubstream, so the same ray
+  takes the same random numbers in different ray tracings.
 */
 
 class RandomDeviate
@@ -53,7 +62,17 @@ public:
     unsigned long NumbersGenerated( ) const;
     unsigned long NumbersProvided( ) const;
     double RandomDouble( );
-  
+
+    virtual unsigned int NumberOfDimensions( ) const;
+    virtual double SampleCoordinate( unsigned long long sampleIndex, unsigned int dimension ) const;
+    double Sample( unsigned long long sampleIndex, int dimension );
+
+    virtual bool HasSubstreams( ) const;
+    bool StartSubstream( unsigned long long substreamIndex );
+
+protected:
+    virtual void SetSubstream( unsigned long long substreamIndex );
+
 private:
      const unsigned long m_arraySize;
      double* m_randomNumber;
@@ -83,6 +102,63 @@ inline double RandomDeviate::RandomDouble( )
 	return m_randomNumber[m_nextRandomNumber++];
 }
 
+/*!
+ * Returns the number of dimensions of the quasi-random points. Pseudo-random generators have no dimensions.
+ */
+inline unsigned int RandomDeviate::NumberOfDimensions( ) const
+{
+	return 0;
+}
+
+/*!
+ * Returns the coordinate \a dimension, in [0,1), of the quasi-random point \a sampleIndex.
+ * Only called for dimensions lower than NumberOfDimensions(). The points must not depend on the generator state,
+ * so that the threads can share them.
+ */
+inline double RandomDeviate::SampleCoordinate( unsigned long long /*sampleIndex*/, unsigned int /*dimension*/ ) const
+{
+	return 0.0;
+}
+
+/*!
+ * Returns the coordinate \a dimension of the sample point \a sampleIndex if the generator has that dimension.
+ * Otherwise, and for negative dimensions, returns the next random number.
+ */
+inline double RandomDeviate::Sample( unsigned long long sampleIndex, int dimension )
+{
+	if( dimension >= 0 && (unsigned int) dimension < NumberOfDimensions() )
+		return SampleCoordinate( sampleIndex, dimension );
+	return RandomDouble();
+}
+
+/*!
+ * Returns true if the generator can restart at any substream.
+ */
+inline bool RandomDeviate::HasSubstreams( ) const
+{
+	return false;
+}
+
+/*!
+ * Restarts the generator at the substream \a substreamIndex and discards the generated numbers not provided yet.
+ * Returns false, and the generator continues its stream, if the generator has no substreams.
+ */
+inline bool RandomDeviate::StartSubstream( unsigned long long substreamIndex )
+{
+	if( !HasSubstreams() )	return false;
+
+	SetSubstream( substreamIndex );
+	m_nextRandomNumber = m_arraySize;
+	return true;
+}
+
+/*!
+ * Sets the state of the generator at the start of the substream \a substreamIndex.
+ */
+inline void RandomDeviate::SetSubstream( unsigned long long /*substreamIndex*/ )
+{
+}
+
 inline unsigned long RandomDeviate::NumbersGenerated( ) const
 {
 	return m_numbersGenerated;
@@ -49,6 +49,10 @@ class RandomDeviate;
 //!  RandomDeviateFactory is the interface for random generators plugins.
 /*!
   A random generator plugin must implement the following interface to load as a valid plugin for Toantiuh.
+
+  CreateRandomDeviate( seed, streamIndex ) must return generators whose sequences are reproducible for the same
+  \a seed and do not overlap for different \a streamIndex values. Distributed ray tracing gives one stream to
+  each worker process.
 */
 
 class RandomDeviateFactory
@@ -57,8 +61,9 @@ public:
     virtual QString RandomDeviateName() const  = 0;
     virtual QIcon RandomDeviateIcon() const = 0;
     virtual RandomDeviate* CreateRandomDeviate( ) const = 0;
+    virtual RandomDeviate* CreateRandomDeviate( unsigned long seed, unsigned long streamIndex ) const = 0;
 };
 
-Q_DECLARE_INTERFACE( RandomDeviateFactory, "tonatiuh.RandomDeviateFactory")
+Q_DECLARE_INTERFACE( RandomDeviateFactory, "tonatiuh.RandomDeviateFactory/2.0")
 
 #endif /* RANDOMDEVIATEFACTORY_H_ */
@@ -0,0 +1,214 @@
+/***************************************************************************
+Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+This file is part of Tonatiuh.
+
+Tonatiuh program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Acknowledgments:
+
+The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+then Chair of the Department of Engineering of the University of Texas at
+Brownsville. From May 2004 to July 2008, it was supported by the Department
+of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+During 2007, NREL also contributed to the validation of Tonatiuh under the
+framework of the Memorandum of Understanding signed with the Spanish
+National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez,
+Juana Amieva, Azael Mancillas, Cesar Cantu.
+***************************************************************************/
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QTextStream>
+
+#include <gtest/gtest.h>
+
+#include "DistributedTrace.h"
+
+namespace
+{
+	/*!
+	 * Writes a "Binary_file" photon map. The surfaces take the identifiers \a surfaceIds, or 1, 2, 3... if it is empty.
+	 */
+	void WritePartialPhotonMap( const QDir& directory, const QString& fileName, const QStringList& surfaces,
+			const QVector< double >& photons, double powerPerPhoton, const QList< int >& surfaceIds = QList< int >() )
+	{
+		QFile dataFile( directory.absoluteFilePath( fileName + QLatin1String( ".dat" ) ) );
+		dataFile.open( QIODevice::WriteOnly );
+		QDataStream data( &dataFile );
+		for( int i = 0; i < photons.count(); ++i )	data<<photons[i];
+		dataFile.close();
+
+		QFile parametersFile( directory.absoluteFilePath( fileName + QLatin1String( "_parameters.txt" ) ) );
+		parametersFile.open( QIODevice::WriteOnly );
+		QTextStream parameters( &parametersFile );
+		parameters<<"START PARAMETERS\nid\nprevious ID\nnext ID\nsurface ID\nEND PARAMETERS\n";
+		parameters<<"START SURFACES\n";
+		for( int s = 0; s < surfaces.count(); ++s )
+			parameters<<( surfaceIds.isEmpty() ? s + 1 : surfaceIds[s] )<<" "<<surfaces[s]<<"\n";
+		parameters<<"END SURFACES\n"<<powerPerPhoton;
+	}
+}
+
+TEST( DistributedTraceTests, WorkersShareAllRays )
+{
+	unsigned long numberOfRays = 1000003;
+	int numberOfWorkers = 7;
+
+	unsigned long tracedRays = 0;
+	for( int w = 0; w < numberOfWorkers; ++w )
+	{
+		DistributedTrace worker( w, numberOfWorkers, 1 );
+		unsigned long workerRays = worker.WorkerRays( numberOfRays );
+		EXPECT_GE( workerRays, numberOfRays / numberOfWorkers );
+		EXPECT_LE( workerRays, numberOfRays / numberOfWorkers + 1 );
+		tracedRays += workerRays;
+	}
+	EXPECT_EQ( tracedRays, numberOfRays );
+
+	DistributedTrace notDistributed;
+	EXPECT_EQ( notDistributed.WorkerRays( numberOfRays ), numberOfRays );
+	EXPECT_EQ( notDistributed.WorkerFileName( QLatin1String( "PhotonMap" ) ), QString( QLatin1String( "PhotonMap" ) ) );
+}
+
+TEST( DistributedTraceTests, MergeUsesTotalTracedRays )
+{
+	QDir directory( QDir::temp() );
+	directory.mkdir( QLatin1String( "DistributedTraceTests" ) );
+	directory.cd( QLatin1String( "DistributedTraceTests" ) );
+
+	QStringList summaryFiles;
+	for( int w = 1; w >= 0; --w )
+	{
+		DistributedTrace worker( w, 2, 5 );
+		worker.SetExport( QLatin1String( "Binary_file" ), directory.absolutePath(), QLatin1String( "PhotonMap" ) );
+		worker.SetResults( 100.0 * ( w + 1 ), 10.0, 1000.0 );
+		ASSERT_TRUE( worker.Write( worker.SummaryFileName() ) );
+		summaryFiles<<worker.SummaryFileName();
+	}
+
+	// id, previous ID, next ID, surface ID
+	QVector< double > photons0;
+	photons0<<1<<0<<2<<0<<2<<1<<0<<1;
+	WritePartialPhotonMap( directory, QLatin1String( "PhotonMap_worker0" ), QStringList( QLatin1String( "//Root/A" ) ), photons0, 100.0 );
+
+	QVector< double > photons1;
+	photons1<<1<<0<<0<<1<<2<<0<<0<<2;
+	QStringList surfaces1;
+	surfaces1<<QLatin1String( "//Root/B" )<<QLatin1String( "//Root/A" );
+	WritePartialPhotonMap( directory, QLatin1String( "PhotonMap_worker1" ), surfaces1, photons1, 50.0 );
+
+	QString errorMessage;
+	ASSERT_TRUE( DistributedTrace::Merge( summaryFiles, &errorMessage ) ) << errorMessage.toStdString();
+
+	DistributedTrace merged;
+	EXPECT_FALSE( merged.Read( directory.absoluteFilePath( QLatin1String( "PhotonMap_summary.txt" ) ) ) );
+	EXPECT_DOUBLE_EQ( merged.TracedRays(), 300.0 );
+	EXPECT_DOUBLE_EQ( merged.PowerPerPhoton(), 10.0 * 1000.0 / 300.0 );
+
+	QFile mergedFile( directory.absoluteFilePath( QLatin1String( "PhotonMap.dat" ) ) );
+	ASSERT_TRUE( mergedFile.open( QIODevice::ReadOnly ) );
+	QDataStream in( &mergedFile );
+	QVector< double > mergedPhotons;
+	while( !in.atEnd() )
+	{
+		double value;
+		in>>value;
+		mergedPhotons<<value;
+	}
+
+	QVector< double > expectedPhotons;
+	expectedPhotons<<1<<0<<2<<0<<2<<1<<0<<1<<3<<0<<0<<2<<4<<0<<0<<1;
+	EXPECT_EQ( mergedPhotons, expectedPhotons );
+
+	QFile parametersFile( directory.absoluteFilePath( QLatin1String( "PhotonMap_parameters.txt" ) ) );
+	ASSERT_TRUE( parametersFile.open( QIODevice::ReadOnly ) );
+	QStringList parameters = QString( parametersFile.readAll() ).split( QLatin1Char( '\n' ) );
+	EXPECT_TRUE( parameters.contains( QLatin1String( "1 //Root/A" ) ) );
+	EXPECT_TRUE( parameters.contains( QLatin1String( "2 //Root/B" ) ) );
+	EXPECT_DOUBLE_EQ( parameters.last().toDouble(), 10.0 * 1000.0 / 300.0 );
+}
+
+TEST( DistributedTraceTests, MergeKeepsSparseSurfaceIdentifiers )
+{
+	QDir directory( QDir::temp() );
+	directory.mkdir( QLatin1String( "DistributedTraceSparseTests" ) );
+	directory.cd( QLatin1String( "DistributedTraceSparseTests" ) );
+
+	QStringList summaryFiles;
+	for( int w = 0; w < 2; ++w )
+	{
+		DistributedTrace worker( w, 2, 5 );
+		worker.SetExport( QLatin1String( "Binary_file" ), directory.absolutePath(), QLatin1String( "PhotonMap" ) );
+		worker.SetResults( 100.0, 10.0, 1000.0 );
+		ASSERT_TRUE( worker.Write( worker.SummaryFileName() ) );
+		summaryFiles<<worker.SummaryFileName();
+	}
+
+	// id, previous ID, next ID, surface ID. The surface identifiers are tree order indices with gaps.
+	QVector< double > photons0;
+	photons0<<1<<0<<2<<3<<2<<1<<0<<7<<3<<0<<0<<0;
+	QStringList surfaces0;
+	surfaces0<<QLatin1String( "//Root/A" )<<QLatin1String( "//Root/B" );
+	QList< int > surfaceIds0;
+	surfaceIds0<<3<<7;
+	WritePartialPhotonMap( directory, QLatin1String( "PhotonMap_worker0" ), surfaces0, photons0, 100.0, surfaceIds0 );
+
+	QVector< double > photons1;
+	photons1<<1<<0<<0<<5<<2<<0<<0<<2;
+	QStringList surfaces1;
+	surfaces1<<QLatin1String( "//Root/B" )<<QLatin1String( "//Root/C" );
+	QList< int > surfaceIds1;
+	surfaceIds1<<2<<5;
+	WritePartialPhotonMap( directory, QLatin1String( "PhotonMap_worker1" ), surfaces1, photons1, 100.0, surfaceIds1 );
+
+	QString errorMessage;
+	ASSERT_TRUE( DistributedTrace::Merge( summaryFiles, &errorMessage ) ) << errorMessage.toStdString();
+
+	QFile mergedFile( directory.absoluteFilePath( QLatin1String( "PhotonMap.dat" ) ) );
+	ASSERT_TRUE( mergedFile.open( QIODevice::ReadOnly ) );
+	QDataStream in( &mergedFile );
+	QVector< double > mergedPhotons;
+	while( !in.atEnd() )
+	{
+		double value;
+		in>>value;
+		mergedPhotons<<value;
+	}
+
+	QVector< double > expectedPhotons;
+	expectedPhotons<<1<<0<<2<<1<<2<<1<<0<<2<<3<<0<<0<<0<<4<<0<<0<<3<<5<<0<<0<<2;
+	EXPECT_EQ( mergedPhotons, expectedPhotons );
+
+	QFile parametersFile( directory.absoluteFilePath( QLatin1String( "PhotonMap_parameters.txt" ) ) );
+	ASSERT_TRUE( parametersFile.open( QIODevice::ReadOnly ) );
+	QStringList parameters = QString( parametersFile.readAll() ).split( QLatin1Char( '\n' ) );
+	EXPECT_TRUE( parameters.contains( QLatin1String( "1 //Root/A" ) ) );
+	EXPECT_TRUE( parameters.contains( QLatin1String( "2 //Root/B" ) ) );
+	EXPECT_TRUE( parameters.contains( QLatin1String( "3 //Root/C" ) ) );
+
+	//A photon on an identifier that the parameters file does not define can not be merged.
+	photons1<<3<<0<<0<<4;
+	WritePartialPhotonMap( directory, QLatin1String( "PhotonMap_worker1" ), surfaces1, photons1, 100.0, surfaceIds1 );
+	EXPECT_FALSE( DistributedTrace::Merge( summaryFiles, &errorMessage ) );
+}
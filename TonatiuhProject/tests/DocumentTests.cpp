@@ -0,0 +1,134 @@
+/***************************************************************************
+ Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+ This file is part of Tonatiuh.
+
+ Tonatiuh program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+ Acknowledgments:
+
+ The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+ then Chair of the Department of Engineering of the University of Texas at
+ Brownsville. From May 2004 to July 2008, it was supported by the Department
+ of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+ the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+ During 2007, NREL also contributed to the validation of Tonatiuh under the
+ framework of the Memorandum of Understanding signed with the Spanish
+ National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+ Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+ direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+ Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+ Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola, Gilda Jimenez,
+ Juana Amieva, Azael Mancillas, Cesar Cantu.
+ ***************************************************************************/
+
+#include <cstdlib>
+
+#include <QDir>
+#include <QFile>
+
+#include <Inventor/actions/SoWriteAction.h>
+#include <Inventor/nodekits/SoNodeKitListPart.h>
+#include <Inventor/nodes/SoTransform.h>
+
+#include <gtest/gtest.h>
+
+#include "Document.h"
+#include "TSceneKit.h"
+#include "TSeparatorKit.h"
+#include "TShapeKit.h"
+#include "TSquare.h"
+
+namespace
+{
+	void* ReallocBuffer( void* buffer, size_t size )
+	{
+		return realloc( buffer, size );
+	}
+
+	/*!
+	 * Returns the Inventor ASCII representation of \a node.
+	 */
+	QByteArray SceneText( SoNode* node )
+	{
+		SoWriteAction writeAction;
+		writeAction.getOutput()->setBuffer( malloc( 1024 ), 1024, ReallocBuffer );
+		writeAction.apply( node );
+
+		void* buffer = 0;
+		size_t size = 0;
+		writeAction.getOutput()->getBuffer( buffer, size );
+		QByteArray text( static_cast< const char* >( buffer ), int( size ) );
+		free( buffer );
+		return text;
+	}
+
+	/*!
+	 * Adds to the \a document scene a separator with a transformation and a square.
+	 */
+	void AddSquare( Document& document )
+	{
+		TSeparatorKit* separatorKit = new TSeparatorKit;
+		separatorKit->setName( "SquareNode" );
+		SoTransform* transform = static_cast< SoTransform* >( separatorKit->getPart( "transform", true ) );
+		transform->translation.setValue( 1.0, 2.0, 3.0 );
+
+		TSquare* square = new TSquare;
+		square->m_sideLength.setValue( 2.5 );
+		TShapeKit* shapeKit = new TShapeKit;
+		shapeKit->setPart( "shape", square );
+		static_cast< SoNodeKitListPart* >( separatorKit->getPart( "childList", true ) )->addChild( shapeKit );
+
+		static_cast< SoNodeKitListPart* >( document.GetSceneKit()->getPart( "childList", true ) )->addChild( separatorKit );
+	}
+}
+
+TEST( DocumentTests, BinaryFileName )
+{
+	EXPECT_TRUE( Document::IsBinaryFile( "scene.tnhb" ) );
+	EXPECT_TRUE( Document::IsBinaryFile( "/home/user/scene.TNHB" ) );
+	EXPECT_FALSE( Document::IsBinaryFile( "scene.tnh" ) );
+	EXPECT_FALSE( Document::IsBinaryFile( "scene.tnhs" ) );
+}
+
+TEST( DocumentTests, BinaryFileRoundTrip )
+{
+	Document document;
+	AddSquare( document );
+
+	QString textFileName = QDir::temp().absoluteFilePath( "DocumentTests.tnh" );
+	QString binaryFileName = QDir::temp().absoluteFilePath( "DocumentTests.tnhb" );
+	ASSERT_TRUE( document.WriteFile( textFileName ) );
+	ASSERT_TRUE( document.WriteFile( binaryFileName ) );
+
+	QFile binaryFile( binaryFileName );
+	ASSERT_TRUE( binaryFile.open( QIODevice::ReadOnly ) );
+	EXPECT_TRUE( binaryFile.readLine().contains( "binary" ) );
+	binaryFile.close();
+
+	Document textDocument;
+	ASSERT_TRUE( textDocument.ReadFile( textFileName ) );
+	Document binaryDocument;
+	ASSERT_TRUE( binaryDocument.ReadFile( binaryFileName ) );
+
+	QByteArray sceneText = SceneText( document.GetSceneKit() );
+	EXPECT_EQ( sceneText, SceneText( textDocument.GetSceneKit() ) );
+	EXPECT_EQ( sceneText, SceneText( binaryDocument.GetSceneKit() ) );
+
+	QDir::temp().remove( "DocumentTests.tnh" );
+	QDir::temp().remove( "DocumentTests.tnhb" );
+}
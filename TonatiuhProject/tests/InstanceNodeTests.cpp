@@ -0,0 +1,143 @@
+/***************************************************************************
+ Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+ This file is part of Tonatiuh.
+
+ Tonatiuh program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+ Acknowledgments:
+
+ The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+ then Chair of the Department of Engineering of the University of Texas at
+ Brownsville. From May 2004 to July 2008, it was supported by the Department
+ of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+ the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+ During 2007, NREL also contributed to the validation of Tonatiuh under the
+ framework of the Memorandum of Understanding signed with the Spanish
+ National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+ Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+ direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+ Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+ Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola, Gilda Jimenez,
+ Juana Amieva, Azael Mancillas, Cesar Cantu.
+ ***************************************************************************/
+
+#include <Inventor/nodekits/SoNodeKitListPart.h>
+#include <Inventor/nodes/SoTransform.h>
+
+#include <gtest/gtest.h>
+
+#include "InstanceNode.h"
+#include "Matrix4x4.h"
+#include "Point3D.h"
+#include "Transform.h"
+#include "trf.h"
+#include "TSeparatorKit.h"
+
+TEST( InstanceNodeTests, NewNodeIsDirty )
+{
+	TSeparatorKit* separatorKit = new TSeparatorKit;
+	separatorKit->ref();
+
+	InstanceNode* instance = new InstanceNode( separatorKit );
+	EXPECT_TRUE( instance->IsDirty() );
+	EXPECT_TRUE( instance->IsTransformDirty() );
+
+	delete instance;
+	separatorKit->unref();
+}
+
+TEST( InstanceNodeTests, ComputeSceneTreeMapCleansTree )
+{
+	TSeparatorKit* parentKit = new TSeparatorKit;
+	parentKit->ref();
+	TSeparatorKit* childKit = new TSeparatorKit;
+	static_cast< SoNodeKitListPart* >( parentKit->getPart( "childList", true ) )->addChild( childKit );
+
+	InstanceNode* parentInstance = new InstanceNode( parentKit );
+	InstanceNode* childInstance = new InstanceNode( childKit );
+	parentInstance->AddChild( childInstance );
+
+	trf::ComputeSceneTreeMap( parentInstance, Transform( new Matrix4x4 ), true );
+	EXPECT_FALSE( parentInstance->IsDirty() );
+	EXPECT_FALSE( childInstance->IsDirty() );
+	EXPECT_FALSE( childInstance->IsTransformDirty() );
+
+	delete parentInstance;
+	parentKit->unref();
+}
+
+TEST( InstanceNodeTests, TransformChangeMarksAncestors )
+{
+	TSeparatorKit* parentKit = new TSeparatorKit;
+	parentKit->ref();
+	TSeparatorKit* childKit = new TSeparatorKit;
+	static_cast< SoNodeKitListPart* >( parentKit->getPart( "childList", true ) )->addChild( childKit );
+	SoTransform* childTransform = static_cast< SoTransform* >( childKit->getPart( "transform", true ) );
+
+	InstanceNode* parentInstance = new InstanceNode( parentKit );
+	InstanceNode* childInstance = new InstanceNode( childKit );
+	parentInstance->AddChild( childInstance );
+	trf::ComputeSceneTreeMap( parentInstance, Transform( new Matrix4x4 ), true );
+
+	childTransform->translation.setValue( 1.0, 2.0, 3.0 );
+	EXPECT_TRUE( childInstance->IsTransformDirty() );
+	EXPECT_TRUE( parentInstance->IsDirty() );
+	EXPECT_FALSE( parentInstance->IsTransformDirty() );
+
+	trf::ComputeSceneTreeMap( parentInstance, Transform( new Matrix4x4 ), true );
+	EXPECT_FALSE( parentInstance->IsDirty() );
+	EXPECT_FALSE( childInstance->IsDirty() );
+
+	Point3D childOrigin = childInstance->GetIntersectionTransform().GetInverse()( Point3D( 0.0, 0.0, 0.0 ) );
+	EXPECT_DOUBLE_EQ( childOrigin.x, 1.0 );
+	EXPECT_DOUBLE_EQ( childOrigin.y, 2.0 );
+	EXPECT_DOUBLE_EQ( childOrigin.z, 3.0 );
+
+	delete parentInstance;
+	parentKit->unref();
+}
+
+TEST( InstanceNodeTests, NodeURLFollowsRenameAndMove )
+{
+	TSeparatorKit* rootKit = new TSeparatorKit;
+	rootKit->ref();
+	rootKit->setName( "Root" );
+	TSeparatorKit* parentKit = new TSeparatorKit;
+	parentKit->setName( "Parent" );
+	TSeparatorKit* childKit = new TSeparatorKit;
+	childKit->setName( "Child" );
+
+	InstanceNode* rootInstance = new InstanceNode( rootKit );
+	InstanceNode* parentInstance = new InstanceNode( parentKit );
+	InstanceNode* childInstance = new InstanceNode( childKit );
+	rootInstance->AddChild( parentInstance );
+	parentInstance->AddChild( childInstance );
+	EXPECT_EQ( childInstance->GetNodeURL(), QString( "/Root/Parent/Child" ) );
+
+	parentKit->setName( "Renamed" );
+	parentInstance->UpdateNodeURL();
+	EXPECT_EQ( childInstance->GetNodeURL(), QString( "/Root/Renamed/Child" ) );
+
+	parentInstance->children.remove( 0 );
+	rootInstance->AddChild( childInstance );
+	EXPECT_EQ( childInstance->GetNodeURL(), QString( "/Root/Child" ) );
+	EXPECT_EQ( parentInstance->GetNodeURL(), QString( "/Root/Renamed" ) );
+
+	delete rootInstance;
+	rootKit->unref();
+}
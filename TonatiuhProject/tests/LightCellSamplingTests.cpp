@@ -0,0 +1,173 @@
+/***************************************************************************
+Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+This file is part of Tonatiuh.
+
+Tonatiuh program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Acknowledgments:
+
+The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+then Chair of the Department of Engineering of the University of Texas at
+Brownsville. From May 2004 to July 2008, it was supported by the Department
+of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+During 2007, NREL also contributed to the validation of Tonatiuh under the
+framework of the Memorandum of Understanding signed with the Spanish
+National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez,
+Juana Amieva, Azael Mancillas, Cesar Cantu.
+***************************************************************************/
+
+#include <cmath>
+#include <set>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "LightCellSampling.h"
+#include "RandomDeviate.h"
+
+namespace
+{
+	//Generator that returns 0.05, 0.15, ..., 0.95 and starts again
+	class TenthsDeviate : public RandomDeviate
+	{
+	public:
+		TenthsDeviate() : RandomDeviate( 10 ) {}
+		void FillArray( double* array, const unsigned long arraySize )
+		{
+			for( unsigned long i = 0; i < arraySize; ++i )	array[i] = ( ( i % 10 ) + 0.5 ) / 10;
+		}
+	};
+
+	//Quasi-random generator whose point n has the coordinates frac( ( n + 0.5 ) * ( d + 1 ) * golden ratio )
+	class GoldenDeviate : public RandomDeviate
+	{
+	public:
+		GoldenDeviate() : RandomDeviate( 10 ) {}
+		void FillArray( double* array, const unsigned long arraySize )
+		{
+			for( unsigned long i = 0; i < arraySize; ++i )	array[i] = 0.5;
+		}
+		unsigned int NumberOfDimensions() const { return 4; }
+		double SampleCoordinate( unsigned long long sampleIndex, unsigned int dimension ) const
+		{
+			double x = ( sampleIndex + 0.5 ) * ( dimension + 1 ) * 0.6180339887498949;
+			return ( x - std::floor( x ) );
+		}
+	};
+
+	std::vector< QPair< int, int > > GridCells( int numberOfCells )
+	{
+		std::vector< QPair< int, int > > cells;
+		for( int c = 0; c < numberOfCells; ++c )	cells.push_back( QPair< int, int >( 0, c ) );
+		return cells;
+	}
+}
+
+TEST( LightCellSamplingTests, StratifiedSamplesCycleThroughCells )
+{
+	TenthsDeviate rand;
+	LightCellSampling sampling( GridCells( 3 ) );
+	sampling.SetStratified( true );
+
+	for( unsigned long long s = 0; s < 9; ++s )
+	{
+		double weight = 1.0;
+		EXPECT_EQ( int( s % 3 ), sampling.SampleCell( s, rand, &weight ) );
+		EXPECT_DOUBLE_EQ( 1.0, weight );
+	}
+}
+
+TEST( LightCellSamplingTests, ImportanceWeightsKeepTheRaysPower )
+{
+	LightCellStatistics statistics;
+	statistics[QPair< int, int >( 0, 0 )] = QPair< double, double >( 100, 100 );
+	statistics[QPair< int, int >( 0, 1 )] = QPair< double, double >( 100, 0 );
+
+	TenthsDeviate rand;
+	LightCellSampling sampling( GridCells( 2 ) );
+	ASSERT_TRUE( sampling.SetImportance( statistics, 0.2 ) );
+
+	//The first cell takes 90% of the rays and the second one 10%
+	int raysPerCell[2] = { 0, 0 };
+	double totalWeight = 0.0;
+	for( unsigned long long s = 0; s < 10; ++s )
+	{
+		double weight = 1.0;
+		int cell = sampling.SampleCell( s, rand, &weight );
+		ASSERT_TRUE( cell == 0 || cell == 1 );
+		++raysPerCell[cell];
+		totalWeight += weight;
+	}
+	EXPECT_EQ( 9, raysPerCell[0] );
+	EXPECT_EQ( 1, raysPerCell[1] );
+	EXPECT_NEAR( 10.0, totalWeight, 1.0e-9 );
+}
+
+TEST( LightCellSamplingTests, RaysOfACycleHaveDistinctSamples )
+{
+	LightCellStatistics statistics;
+	statistics[QPair< int, int >( 0, 0 )] = QPair< double, double >( 100, 100 );
+	statistics[QPair< int, int >( 0, 1 )] = QPair< double, double >( 100, 0 );
+
+	GoldenDeviate rand;
+	LightCellSampling sampling( GridCells( 2 ) );
+	sampling.SetStratified( true );
+	ASSERT_TRUE( sampling.SetImportance( statistics, 0.2 ) );
+
+	//The primary ray takes its position and direction from the dimensions 1 to 3 of its sample
+	std::set< std::vector< double > > rays;
+	int raysInFirstCell = 0;
+	for( unsigned long long s = 0; s < 20; ++s )
+	{
+		double weight = 1.0;
+		int cell = sampling.SampleCell( s, rand, &weight );
+		if( cell == 0 )	++raysInFirstCell;
+
+		std::vector< double > ray( 1, cell );
+		for( int d = 1; d < 4; ++d )	ray.push_back( rand.Sample( s, d ) );
+		rays.insert( ray );
+	}
+	EXPECT_GT( raysInFirstCell, 10 );
+	EXPECT_EQ( 20u, rays.size() );
+}
+
+TEST( LightCellSamplingTests, TalliesUpdateTheStatistics )
+{
+	LightCellSampling sampling( GridCells( 2 ) );
+	LightCellTally tally( sampling.NumberOfCells() );
+	tally.Add( 0, true );
+	tally.Add( 0, false );
+	tally.Add( 1, false );
+	tally.Add( -1, true );
+	sampling.AddTally( tally );
+	EXPECT_DOUBLE_EQ( 0.0, tally.rays[0] );
+
+	LightCellStatistics statistics;
+	sampling.UpdateStatistics( &statistics );
+	QPair< double, double > firstCell = statistics[QPair< int, int >( 0, 0 )];
+	QPair< double, double > secondCell = statistics[QPair< int, int >( 0, 1 )];
+	EXPECT_DOUBLE_EQ( 2.0, firstCell.first );
+	EXPECT_DOUBLE_EQ( 1.0, firstCell.second );
+	EXPECT_DOUBLE_EQ( 1.0, secondCell.first );
+	EXPECT_DOUBLE_EQ( 0.0, secondCell.second );
+}
@@ -0,0 +1,223 @@
+/***************************************************************************
+Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+This file is part of Tonatiuh.
+
+Tonatiuh program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Acknowledgments:
+
+The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+then Chair of the Department of Engineering of the University of Texas at
+Brownsville. From May 2004 to July 2008, it was supported by the Department
+of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+During 2007, NREL also contributed to the validation of Tonatiuh under the
+framework of the Memorandum of Understanding signed with the Spanish
+National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez,
+Juana Amieva, Azael Mancillas, Cesar Cantu.
+***************************************************************************/
+
+#include <cstring>
+#include <vector>
+
+#include <QByteArray>
+#include <QDir>
+#include <QFile>
+#include <QtEndian>
+
+#include <gtest/gtest.h>
+
+#include "MeshLoader.h"
+
+namespace
+{
+	QString WriteFile( QString name, QByteArray data )
+	{
+		QString fileName = QDir::temp().absoluteFilePath( name );
+		QFile file( fileName );
+		if( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )	return ( QString() );
+		file.write( data );
+		file.close();
+		return ( fileName );
+	}
+
+	void AppendFloat( QByteArray* data, float value )
+	{
+		quint32 bits;
+		memcpy( &bits, &value, sizeof( float ) );
+		uchar bytes[4];
+		qToLittleEndian( bits, bytes );
+		data->append( reinterpret_cast< const char* >( bytes ), 4 );
+	}
+
+	/*!
+	 * Binary STL of the unit square in the z = 0 plane. The second facet is wound against its normal.
+	 */
+	QByteArray SquareBinarySTL( quint32 nFacets )
+	{
+		QByteArray data( "solid written by a CAD tool that also uses this keyword" );
+		data.append( QByteArray( 80 - data.size(), ' ' ) );
+		uchar count[4];
+		qToLittleEndian( nFacets, count );
+		data.append( reinterpret_cast< const char* >( count ), 4 );
+
+		const float facets[2][12] = { { 0, 0, 1,  0, 0, 0,  1, 0, 0,  1, 1, 0 },
+									{ 0, 0, 1,  0, 0, 0,  0, 1, 0,  1, 1, 0 } };
+		for( int f = 0; f < 2; ++f )
+		{
+			for( int k = 0; k < 12; ++k )	AppendFloat( &data, facets[f][k] );
+			data.append( QByteArray( 2, '\0' ) );
+		}
+		return ( data );
+	}
+
+	/*!
+	 * Returns the z component of the winding normal of the triangle \a t of \a loader.
+	 */
+	double WindingZ( const MeshLoader& loader, unsigned long t )
+	{
+		const std::vector< unsigned int >& indices = loader.GetIndices();
+		const std::vector< float >& vertices = loader.GetVertices();
+		const float* a = &vertices[3 * indices[3 * t]];
+		const float* b = &vertices[3 * indices[3 * t + 1]];
+		const float* c = &vertices[3 * indices[3 * t + 2]];
+		return ( ( b[0] - a[0] ) * ( c[1] - a[1] ) - ( b[1] - a[1] ) * ( c[0] - a[0] ) );
+	}
+}
+
+TEST( MeshLoaderTests, AsciiSTLFacetsFollowFileNormals )
+{
+	QByteArray data( "solid square\n"
+			" facet normal 0 0 1\n"
+			"  outer loop\n"
+			"   vertex 0 0 0\n"
+			"   vertex 1.0 0 0\n"
+			"   vertex 1 1e0 0\n"
+			"  endloop\n"
+			" endfacet\n"
+			" facet normal 0.0 0.0 1.0\r\n"
+			"  outer loop\r\n"
+			"   vertex 0 0 0\r\n"
+			"   vertex 0 1 0\r\n"
+			"   vertex 1 1 0\r\n"
+			"  endloop\r\n"
+			" endfacet\r\n"
+			"endsolid square\n" );
+	QString fileName = WriteFile( QLatin1String( "MeshLoaderTests_ascii.stl" ), data );
+
+	MeshLoader loader;
+	ASSERT_TRUE( loader.Load( fileName ) ) << loader.GetErrorMessage().toStdString();
+	EXPECT_EQ( loader.GetNumberOfFileTriangles(), 2ul );
+	EXPECT_EQ( loader.GetNumberOfTriangles(), 2ul );
+	EXPECT_EQ( loader.GetNumberOfVertices(), 4ul );
+	EXPECT_GT( WindingZ( loader, 0 ), 0.0 );
+	EXPECT_GT( WindingZ( loader, 1 ), 0.0 );
+
+	QFile::remove( fileName );
+}
+
+TEST( MeshLoaderTests, AsciiSTLWithoutNormalFails )
+{
+	QByteArray data( "solid square\n"
+			" facet\n"
+			"  outer loop\n"
+			"   vertex 0 0 0\n"
+			"   vertex 1 0 0\n"
+			"   vertex 1 1 0\n"
+			"  endloop\n"
+			" endfacet\n"
+			"endsolid square\n" );
+	QString fileName = WriteFile( QLatin1String( "MeshLoaderTests_nonormal.stl" ), data );
+
+	MeshLoader loader;
+	EXPECT_FALSE( loader.Load( fileName ) );
+	EXPECT_FALSE( loader.GetErrorMessage().isEmpty() );
+
+	QFile::remove( fileName );
+}
+
+TEST( MeshLoaderTests, BinarySTLWithSolidHeaderAndPadding )
+{
+	QByteArray data = SquareBinarySTL( 2 );
+	data.append( QByteArray( 17, '\0' ) );
+	QString fileName = WriteFile( QLatin1String( "MeshLoaderTests_binary.stl" ), data );
+
+	MeshLoader loader;
+	ASSERT_TRUE( loader.Load( fileName ) ) << loader.GetErrorMessage().toStdString();
+	EXPECT_EQ( loader.GetNumberOfFileTriangles(), 2ul );
+	EXPECT_EQ( loader.GetNumberOfTriangles(), 2ul );
+	EXPECT_EQ( loader.GetNumberOfVertices(), 4ul );
+	EXPECT_GT( WindingZ( loader, 0 ), 0.0 );
+	EXPECT_GT( WindingZ( loader, 1 ), 0.0 );
+
+	QFile::remove( fileName );
+}
+
+TEST( MeshLoaderTests, TruncatedBinarySTLFails )
+{
+	QByteArray data = SquareBinarySTL( 3 );
+	data[0] = 'S';
+	QString fileName = WriteFile( QLatin1String( "MeshLoaderTests_truncated.stl" ), data );
+
+	MeshLoader loader;
+	EXPECT_FALSE( loader.Load( fileName ) );
+	EXPECT_FALSE( loader.GetErrorMessage().isEmpty() );
+
+	QFile::remove( fileName );
+}
+
+TEST( MeshLoaderTests, OBJPolygonsAreTriangulated )
+{
+	QByteArray data( "# unit square\n"
+			"o square\n"
+			"v 0 0 0\n"
+			"v 1 0 0\n"
+			"v 1 1 0\n"
+			"v 0 1 0\n"
+			"vn 0 0 1\n"
+			"vt 0 0\n"
+			"f 1//1 2//1 3//1 4//1\n"
+			"v 2 0 0\n"
+			"f 2/1 -1/1 3/1\n" );
+	QString fileName = WriteFile( QLatin1String( "MeshLoaderTests_square.obj" ), data );
+
+	MeshLoader loader;
+	ASSERT_TRUE( loader.Load( fileName ) ) << loader.GetErrorMessage().toStdString();
+	EXPECT_EQ( loader.GetNumberOfFileTriangles(), 3ul );
+	EXPECT_EQ( loader.GetNumberOfTriangles(), 3ul );
+	EXPECT_EQ( loader.GetNumberOfVertices(), 5ul );
+	EXPECT_GT( WindingZ( loader, 0 ), 0.0 );
+	EXPECT_GT( WindingZ( loader, 1 ), 0.0 );
+	EXPECT_GT( WindingZ( loader, 2 ), 0.0 );
+
+	QFile::remove( fileName );
+}
+
+TEST( MeshLoaderTests, OBJWithMissingVertexFails )
+{
+	QString fileName = WriteFile( QLatin1String( "MeshLoaderTests_wrong.obj" ), QByteArray( "v 0 0 0\nv 1 0 0\nf 1 2 3\n" ) );
+
+	MeshLoader loader;
+	EXPECT_FALSE( loader.Load( fileName ) );
+
+	QFile::remove( fileName );
+}
@@ -0,0 +1,194 @@
+/***************************************************************************
+Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+This file is part of Tonatiuh.
+
+Tonatiuh program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Acknowledgments:
+
+The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+then Chair of the Department of Engineering of the University of Texas at
+Brownsville. From May 2004 to July 2008, it was supported by the Department
+of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+During 2007, NREL also contributed to the validation of Tonatiuh under the
+framework of the Memorandum of Understanding signed with the Spanish
+National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez,
+Juana Amieva, Azael Mancillas, Cesar Cantu.
+***************************************************************************/
+
+#include <vector>
+
+#include <QByteArray>
+
+#include <gtest/gtest.h>
+
+#include "Photon.h"
+#include "PhotonChunkCodec.h"
+#include "Point3D.h"
+
+namespace
+{
+	const int allFields = PhotonChunkCodec::Coordinates | PhotonChunkCodec::Side | PhotonChunkCodec::PrevNextID
+			| PhotonChunkCodec::SurfaceID | PhotonChunkCodec::Weight;
+
+	/*!
+	 * Two rays as the tracer stores them: the first photon of each ray has identifier 0 and the
+	 * next ones count the intersections of the ray.
+	 */
+	std::vector< Photon > TwoRays()
+	{
+		double ids[5] = { 0, 1, 2, 0, 1 };
+		int surfaceIds[5] = { 0, 3, 1, 0, 2 };
+		std::vector< Photon > photons;
+		for( int i = 0; i < 5; ++i )
+		{
+			Photon photon( Point3D( i, 2 * i, -i ), i % 2, ids[i], 0, 0, 1.0 - 0.125 * i );
+			photon.surfaceId = surfaceIds[i];
+			photon.exportPos = Point3D( 0.5 + i, 1.0 / ( i + 1 ), -1000.25 * i );
+			photons.push_back( photon );
+		}
+		return ( photons );
+	}
+
+	std::vector< Photon* > PhotonPointers( std::vector< Photon >& photons )
+	{
+		std::vector< Photon* > raysLists;
+		for( unsigned long i = 0; i < photons.size(); ++i )
+			raysLists.push_back( &photons[i] );
+		return ( raysLists );
+	}
+
+	/*!
+	 * Returns the values the uncompressed data files store for \a numberOfPhotons photons of \a raysLists
+	 * from \a startIndex with the \a fields columns.
+	 */
+	std::vector< double > ExpectedValues( int fields, const std::vector< Photon* >& raysLists, unsigned long firstIndex,
+			unsigned long startIndex, unsigned long numberOfPhotons, double firstPhotonID )
+	{
+		std::vector< double > values;
+		for( unsigned long i = 0; i < numberOfPhotons; ++i )
+		{
+			unsigned long index = startIndex + i;
+			const Photon* photon = raysLists[index];
+			double photonID = firstPhotonID + i;
+			values.push_back( photonID );
+			if( fields & PhotonChunkCodec::Coordinates )
+			{
+				values.push_back( photon->exportPos.x );
+				values.push_back( photon->exportPos.y );
+				values.push_back( photon->exportPos.z );
+			}
+			if( fields & PhotonChunkCodec::Side )	values.push_back( photon->side );
+			if( fields & PhotonChunkCodec::PrevNextID )
+			{
+				values.push_back( ( ( index > firstIndex ) && ( photon->id > 0 ) ) ? photonID - 1 : 0.0 );
+				values.push_back( ( ( index + 1 < raysLists.size() ) && ( raysLists[index + 1]->id > 0 ) ) ? photonID + 1 : 0.0 );
+			}
+			if( fields & PhotonChunkCodec::SurfaceID )	values.push_back( photon->surfaceId );
+			if( fields & PhotonChunkCodec::Weight )	values.push_back( photon->weight );
+		}
+		return ( values );
+	}
+}
+
+TEST( PhotonChunkCodecTests, RoundTripsEveryFieldCombination )
+{
+	std::vector< Photon > photons = TwoRays();
+	std::vector< Photon* > raysLists = PhotonPointers( photons );
+
+	for( int fields = 0; fields <= allFields; ++fields )
+	{
+		PhotonChunkCodec codec( fields );
+		QByteArray payload = codec.Encode( raysLists, 0, 0, raysLists.size() );
+
+		std::vector< double > values;
+		ASSERT_TRUE( codec.Decode( payload, raysLists.size(), 11, &values ) )<<"fields "<<fields;
+		EXPECT_EQ( ExpectedValues( fields, raysLists, 0, 0, raysLists.size(), 11 ), values )<<"fields "<<fields;
+		EXPECT_EQ( raysLists.size() * codec.NumberOfColumns(), values.size() );
+	}
+}
+
+TEST( PhotonChunkCodecTests, KeepsPrevNextLinksAcrossChunkBoundaries )
+{
+	std::vector< Photon > photons = TwoRays();
+	std::vector< Photon* > raysLists = PhotonPointers( photons );
+	PhotonChunkCodec codec( PhotonChunkCodec::PrevNextID );
+
+	//The second photon of the first ray ends the first chunk and the third one starts the second chunk.
+	std::vector< double > first;
+	ASSERT_TRUE( codec.Decode( codec.Encode( raysLists, 0, 0, 2 ), 2, 1, &first ) );
+	std::vector< double > second;
+	ASSERT_TRUE( codec.Decode( codec.Encode( raysLists, 0, 2, 3 ), 3, 3, &second ) );
+
+	EXPECT_EQ( 1, first[4] );
+	EXPECT_EQ( 3, first[5] );
+	EXPECT_EQ( 2, second[1] );
+	EXPECT_EQ( 0, second[2] );
+
+	//The second ray starts in the second chunk.
+	EXPECT_EQ( 0, second[4] );
+	EXPECT_EQ( 5, second[5] );
+	EXPECT_EQ( 4, second[7] );
+	EXPECT_EQ( 0, second[8] );
+
+	//A photon that starts an export call has no previous photon link, the previous photon is in other call.
+	std::vector< double > call;
+	ASSERT_TRUE( codec.Decode( codec.Encode( raysLists, 2, 2, 3 ), 3, 3, &call ) );
+	EXPECT_EQ( 0, call[1] );
+	EXPECT_EQ( 0, call[2] );
+}
+
+TEST( PhotonChunkCodecTests, PacksTheSurfaceIdentifiersInTheNeededBits )
+{
+	int flagsFields = PhotonChunkCodec::Side | PhotonChunkCodec::PrevNextID | PhotonChunkCodec::SurfaceID;
+	int maximumIDs[4] = { 0, 1, 255, 2147483647 };
+	for( int m = 0; m < 4; ++m )
+	{
+		std::vector< Photon > photons = TwoRays();
+		for( unsigned long i = 0; i < photons.size(); ++i )
+			photons[i].surfaceId = ( i % 2 ) ? maximumIDs[m] : 0;
+		std::vector< Photon* > raysLists = PhotonPointers( photons );
+
+		int fieldsList[2] = { flagsFields, PhotonChunkCodec::SurfaceID };
+		for( int f = 0; f < 2; ++f )
+		{
+			PhotonChunkCodec codec( fieldsList[f] );
+			std::vector< double > values;
+			ASSERT_TRUE( codec.Decode( codec.Encode( raysLists, 0, 0, raysLists.size() ), raysLists.size(), 1, &values ) );
+			EXPECT_EQ( ExpectedValues( fieldsList[f], raysLists, 0, 0, raysLists.size(), 1 ), values )
+					<<"maximum identifier "<<maximumIDs[m]<<", fields "<<fieldsList[f];
+		}
+	}
+}
+
+TEST( PhotonChunkCodecTests, RejectsTruncatedPayloads )
+{
+	std::vector< Photon > photons = TwoRays();
+	std::vector< Photon* > raysLists = PhotonPointers( photons );
+	PhotonChunkCodec codec( allFields );
+	QByteArray payload = codec.Encode( raysLists, 0, 0, raysLists.size() );
+
+	std::vector< double > values;
+	EXPECT_FALSE( codec.Decode( payload, raysLists.size() + 1, 1, &values ) );
+	EXPECT_FALSE( codec.Decode( qCompress( qUncompress( payload ).left( 40 ) ), raysLists.size(), 1, &values ) );
+}
@@ -0,0 +1,137 @@
+/***************************************************************************
+ Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+ This file is part of Tonatiuh.
+
+ Tonatiuh program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+ Acknowledgments:
+
+ The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+ then Chair of the Department of Engineering of the University of Texas at
+ Brownsville. From May 2004 to July 2008, it was supported by the Department
+ of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+ the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+ During 2007, NREL also contributed to the validation of Tonatiuh under the
+ framework of the Memorandum of Understanding signed with the Spanish
+ National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+ Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+ direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+ Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+ Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola, Gilda Jimenez,
+ Juana Amieva, Azael Mancillas, Cesar Cantu.
+ ***************************************************************************/
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "InstanceNode.h"
+#include "Photon.h"
+#include "Point3D.h"
+#include "trf.h"
+
+TEST( PhotonMapDrawingTests, SelectStratifiedKeepsAllUnderBudget )
+{
+	InstanceNode surface( 0 );
+	std::vector< InstanceNode* > elementSurfaces( 10, &surface );
+
+	EXPECT_EQ( trf::SelectStratified( elementSurfaces, 0 ).size(), 10u );
+	EXPECT_EQ( trf::SelectStratified( elementSurfaces, 10 ).size(), 10u );
+}
+
+TEST( PhotonMapDrawingTests, SelectStratifiedKeepsSurfaceProportions )
+{
+	InstanceNode largeSurface( 0 );
+	InstanceNode smallSurface( 0 );
+
+	std::vector< InstanceNode* > elementSurfaces;
+	for( int e = 0; e < 9000; ++e )	elementSurfaces.push_back( &largeSurface );
+	for( int e = 0; e < 1000; ++e )	elementSurfaces.push_back( &smallSurface );
+	elementSurfaces.push_back( 0 );
+
+	std::vector< unsigned long > selected = trf::SelectStratified( elementSurfaces, 100 );
+
+	int largeSelected = 0;
+	int smallSelected = 0;
+	int otherSelected = 0;
+	for( unsigned int s = 0; s < selected.size(); ++s )
+	{
+		if( elementSurfaces[selected[s]] == &largeSurface )	largeSelected++;
+		else if( elementSurfaces[selected[s]] == &smallSurface )	smallSelected++;
+		else	otherSelected++;
+	}
+
+	EXPECT_EQ( largeSelected, 89 );
+	EXPECT_EQ( smallSelected, 9 );
+	EXPECT_EQ( otherSelected, 1 );
+	for( unsigned int s = 1; s < selected.size(); ++s )
+		EXPECT_LT( selected[s - 1], selected[s] );
+}
+
+TEST( PhotonMapDrawingTests, SelectStratifiedKeepsTheBudget )
+{
+	InstanceNode largeSurface( 0 );
+	std::vector< InstanceNode* > smallSurfaces;
+	for( int s = 0; s < 10; ++s )	smallSurfaces.push_back( new InstanceNode( 0 ) );
+
+	std::vector< InstanceNode* > elementSurfaces;
+	for( int e = 0; e < 1000; ++e )	elementSurfaces.push_back( &largeSurface );
+	for( unsigned int s = 0; s < smallSurfaces.size(); ++s )	elementSurfaces.push_back( smallSurfaces[s] );
+
+	//The minimums of one element are taken from the large surface
+	std::vector< unsigned long > selected = trf::SelectStratified( elementSurfaces, 20 );
+	EXPECT_EQ( selected.size(), 20u );
+	for( unsigned int s = 0; s < 10; ++s )	EXPECT_EQ( selected[s], 100 * s + 99 );
+	for( unsigned int s = 10; s < 20; ++s )	EXPECT_EQ( selected[s], 990 + s );
+
+	//With more surfaces than the budget, the large surface keeps one element
+	selected = trf::SelectStratified( elementSurfaces, 5 );
+	ASSERT_EQ( selected.size(), 5u );
+	for( unsigned int s = 0; s < selected.size(); ++s )	EXPECT_EQ( selected[s], 999 + s );
+
+	for( unsigned int s = 0; s < smallSurfaces.size(); ++s )	delete smallSurfaces[s];
+}
+
+TEST( PhotonMapDrawingTests, ComputeRaysKeepsWholeRays )
+{
+	InstanceNode surface( 0 );
+
+	std::vector< Photon* > photonsList;
+	for( int ray = 0; ray < 100; ++ray )
+	{
+		photonsList.push_back( new Photon( Point3D( ray, 0.0, 0.0 ), 1, 0 ) );
+		photonsList.push_back( new Photon( Point3D( ray, 1.0, 0.0 ), 1, 1, &surface ) );
+		photonsList.push_back( new Photon( Point3D( ray, 2.0, 0.0 ), 1, 2, &surface ) );
+	}
+
+	std::vector< SbVec3f > rayVertices;
+	std::vector< int32_t > rayLengths;
+	trf::ComputePhotonMapRays( photonsList, 10, &rayVertices, &rayLengths );
+
+	ASSERT_EQ( rayLengths.size(), 10u );
+	EXPECT_EQ( rayVertices.size(), 30u );
+	for( unsigned int r = 0; r < rayLengths.size(); ++r )
+	{
+		EXPECT_EQ( rayLengths[r], 3 );
+		EXPECT_FLOAT_EQ( rayVertices[3 * r][1], 0.0f );
+		EXPECT_FLOAT_EQ( rayVertices[3 * r + 2][1], 2.0f );
+	}
+
+	for( unsigned int p = 0; p < photonsList.size(); ++p )
+		delete photonsList[p];
+}
@@ -0,0 +1,190 @@
+/***************************************************************************
+Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+This file is part of Tonatiuh.
+
+Tonatiuh program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Acknowledgments:
+
+The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+then Chair of the Department of Engineering of the University of Texas at
+Brownsville. From May 2004 to July 2008, it was supported by the Department
+of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+During 2007, NREL also contributed to the validation of Tonatiuh under the
+framework of the Memorandum of Understanding signed with the Spanish
+National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez,
+Juana Amieva, Azael Mancillas, Cesar Cantu.
+***************************************************************************/
+
+#include <vector>
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QStringList>
+
+#include <gtest/gtest.h>
+
+#include "PhotonMapIndex.h"
+#include "Point3D.h"
+
+namespace
+{
+	struct ProgressRecorder : public PhotonMapIndexProgress
+	{
+		void SetProgress( int percent )
+		{
+			values.push_back( percent );
+		}
+
+		std::vector< int > values;
+	};
+}
+
+TEST( PhotonMapIndexTests, QueriesReturnTheSurfacePhotonsInTheRegion )
+{
+	QDir directory = QDir::temp();
+	QString dataFileName = directory.absoluteFilePath( QLatin1String( "PhotonMapIndexTests.dat" ) );
+	QString indexFileName = directory.absoluteFilePath( QLatin1String( "PhotonMapIndexTests.pmi" ) );
+
+	QStringList columns;
+	columns<<QLatin1String( "id" )<<QLatin1String( "x" )<<QLatin1String( "y" )<<QLatin1String( "z" )
+			<<QLatin1String( "side" )<<QLatin1String( "surface ID" );
+
+	//A 10x10 grid of photons on the plane z = 0 of surface 2 and a photon on surface 1
+	{
+		QFile dataFile( dataFileName );
+		ASSERT_TRUE( dataFile.open( QIODevice::WriteOnly ) );
+		QDataStream out( &dataFile );
+		out<<1.0<<5.0<<5.0<<5.0<<1.0<<1.0;
+		for( int p = 0; p < 100; ++p )
+			out<<double( p + 2 )<<double( p % 10 )<<double( p / 10 )<<0.0<<1.0<<2.0;
+	}
+
+	QString errorMessage;
+	ASSERT_TRUE( PhotonMapIndex::Build( indexFileName, QStringList( dataFileName ), columns, 4, &errorMessage ) );
+
+	{
+		PhotonMapIndex index;
+		ASSERT_TRUE( index.Open( indexFileName ) );
+		EXPECT_EQ( 101ul, index.NumberOfPhotons() );
+		ASSERT_EQ( 2, index.Surfaces().count() );
+		EXPECT_EQ( 1, index.Surfaces()[0] );
+		EXPECT_EQ( 2, index.Surfaces()[1] );
+
+		EXPECT_EQ( 1u, index.SurfacePhotons( 1 ).size() );
+		EXPECT_EQ( 100u, index.SurfacePhotons( 2 ).size() );
+		EXPECT_TRUE( index.SurfacePhotons( 3 ).empty() );
+
+		std::vector< PhotonIndexEntry > boxPhotons = index.BoxPhotons( 2, Point3D( 2.5, 3.0, -1.0 ), Point3D( 4.5, 4.0, 1.0 ) );
+		EXPECT_EQ( 4u, boxPhotons.size() );
+		for( unsigned int p = 0; p < boxPhotons.size(); ++p )
+		{
+			EXPECT_GE( boxPhotons[p].position[0], 2.5 );
+			EXPECT_LE( boxPhotons[p].position[0], 4.5 );
+			EXPECT_GE( boxPhotons[p].position[1], 3.0 );
+			EXPECT_LE( boxPhotons[p].position[1], 4.0 );
+		}
+		EXPECT_TRUE( index.BoxPhotons( 1, Point3D( 0.0, 0.0, 0.0 ), Point3D( 1.0, 1.0, 1.0 ) ).empty() );
+
+		EXPECT_EQ( 5u, index.RadiusPhotons( 2, Point3D( 5.0, 5.0, 0.0 ), 1.0 ).size() );
+
+		std::vector< PhotonIndexEntry > surfacePhotons = index.SurfacePhotons( 1 );
+		std::vector< double > values;
+		ASSERT_TRUE( index.ReadPhoton( surfacePhotons[0].record, &values ) );
+		ASSERT_EQ( 6u, values.size() );
+		EXPECT_DOUBLE_EQ( 1.0, values[0] );
+		EXPECT_DOUBLE_EQ( 5.0, values[3] );
+		EXPECT_FALSE( index.ReadPhoton( 101, &values ) );
+	}
+
+	QFile::remove( dataFileName );
+	QFile::remove( indexFileName );
+}
+
+TEST( PhotonMapIndexTests, SmallBucketsBuildTheSameIndex )
+{
+	QDir directory = QDir::temp();
+	QStringList dataFileNames;
+	dataFileNames<<directory.absoluteFilePath( QLatin1String( "PhotonMapIndexTests_1.dat" ) )
+			<<directory.absoluteFilePath( QLatin1String( "PhotonMapIndexTests_2.dat" ) );
+	QString indexFileName = directory.absoluteFilePath( QLatin1String( "PhotonMapIndexTests.pmi" ) );
+	QString bucketsIndexFileName = directory.absoluteFilePath( QLatin1String( "PhotonMapIndexTests_buckets.pmi" ) );
+
+	QStringList columns;
+	columns<<QLatin1String( "id" )<<QLatin1String( "x" )<<QLatin1String( "y" )<<QLatin1String( "z" )<<QLatin1String( "surface ID" );
+
+	//Photons of three surfaces spread in two data files
+	for( int f = 0; f < 2; ++f )
+	{
+		QFile dataFile( dataFileNames[f] );
+		ASSERT_TRUE( dataFile.open( QIODevice::WriteOnly ) );
+		QDataStream out( &dataFile );
+		for( int p = 0; p < 150; ++p )
+			out<<double( 150 * f + p + 1 )<<double( ( 7 * p ) % 13 )<<double( ( 11 * p ) % 17 )<<double( f )<<double( p % 3 + 1 );
+	}
+
+	QString errorMessage;
+	ASSERT_TRUE( PhotonMapIndex::Build( indexFileName, dataFileNames, columns, 5, &errorMessage ) );
+
+	ProgressRecorder progress;
+	ASSERT_TRUE( PhotonMapIndex::Build( bucketsIndexFileName, dataFileNames, columns, 5, &errorMessage, &progress, 7 ) );
+
+	ASSERT_FALSE( progress.values.empty() );
+	for( unsigned int p = 1; p < progress.values.size(); ++p )
+		EXPECT_GT( progress.values[p], progress.values[p - 1] );
+	EXPECT_EQ( 100, progress.values.back() );
+
+	QFile indexFile( indexFileName );
+	QFile bucketsIndexFile( bucketsIndexFileName );
+	ASSERT_TRUE( indexFile.open( QIODevice::ReadOnly ) );
+	ASSERT_TRUE( bucketsIndexFile.open( QIODevice::ReadOnly ) );
+	EXPECT_TRUE( indexFile.readAll() == bucketsIndexFile.readAll() );
+	indexFile.close();
+	bucketsIndexFile.close();
+
+	{
+		PhotonMapIndex index;
+		ASSERT_TRUE( index.Open( bucketsIndexFileName ) );
+		EXPECT_EQ( 300ul, index.NumberOfPhotons() );
+		for( int s = 1; s <= 3; ++s )
+		{
+			std::vector< PhotonIndexEntry > surfacePhotons = index.SurfacePhotons( s );
+			ASSERT_EQ( 100u, surfacePhotons.size() );
+
+			std::vector< double > values;
+			for( unsigned int p = 0; p < surfacePhotons.size(); ++p )
+			{
+				ASSERT_TRUE( index.ReadPhoton( surfacePhotons[p].record, &values ) );
+				EXPECT_DOUBLE_EQ( double( s ), values[4] );
+				EXPECT_DOUBLE_EQ( surfacePhotons[p].position[0], values[1] );
+				EXPECT_DOUBLE_EQ( surfacePhotons[p].position[2], values[3] );
+			}
+		}
+	}
+
+	QFile::remove( dataFileNames[0] );
+	QFile::remove( dataFileNames[1] );
+	QFile::remove( indexFileName );
+	QFile::remove( bucketsIndexFileName );
+}
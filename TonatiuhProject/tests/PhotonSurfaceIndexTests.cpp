@@ -0,0 +1,120 @@
+/***************************************************************************
+Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+This file is part of Tonatiuh.
+
+Tonatiuh program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Acknowledgments:
+
+The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+then Chair of the Department of Engineering of the University of Texas at
+Brownsville. From May 2004 to July 2008, it was supported by the Department
+of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+During 2007, NREL also contributed to the validation of Tonatiuh under the
+framework of the Memorandum of Understanding signed with the Spanish
+National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez,
+Juana Amieva, Azael Mancillas, Cesar Cantu.
+***************************************************************************/
+
+#include <Inventor/nodekits/SoNodeKitListPart.h>
+
+#include <gtest/gtest.h>
+
+#include "InstanceNode.h"
+#include "Photon.h"
+#include "PhotonSurfaceIndex.h"
+#include "Point3D.h"
+#include "Transform.h"
+#include "TSeparatorKit.h"
+#include "TShapeKit.h"
+
+namespace
+{
+	Transform Translation( double x, double y, double z )
+	{
+		return ( Transform( 1.0, 0.0, 0.0, x,
+				0.0, 1.0, 0.0, y,
+				0.0, 0.0, 1.0, z,
+				0.0, 0.0, 0.0, 1.0 ) );
+	}
+}
+
+TEST( PhotonSurfaceIndexTests, IndexesTheShapeKitsInTreeOrder )
+{
+	TSeparatorKit* separatorKit = new TSeparatorKit;
+	separatorKit->ref();
+	TShapeKit* firstShapeKit = new TShapeKit;
+	TShapeKit* secondShapeKit = new TShapeKit;
+	SoNodeKitListPart* childList = static_cast< SoNodeKitListPart* >( separatorKit->getPart( "childList", true ) );
+	childList->addChild( firstShapeKit );
+	childList->addChild( secondShapeKit );
+
+	InstanceNode* separatorInstance = new InstanceNode( separatorKit );
+	InstanceNode* firstShapeInstance = new InstanceNode( firstShapeKit );
+	InstanceNode* secondShapeInstance = new InstanceNode( secondShapeKit );
+	separatorInstance->AddChild( firstShapeInstance );
+	separatorInstance->AddChild( secondShapeInstance );
+
+	PhotonSurfaceIndex surfaceIndex;
+	surfaceIndex.AddSurfaces( separatorInstance );
+	surfaceIndex.AddSurface( firstShapeInstance );
+
+	EXPECT_EQ( 2, surfaceIndex.NumberOfSurfaces() );
+	EXPECT_EQ( 1, surfaceIndex.SurfaceId( firstShapeInstance ) );
+	EXPECT_EQ( 2, surfaceIndex.SurfaceId( secondShapeInstance ) );
+	EXPECT_EQ( 0, surfaceIndex.SurfaceId( separatorInstance ) );
+	EXPECT_EQ( secondShapeInstance, surfaceIndex.Surface( 2 ) );
+	EXPECT_TRUE( surfaceIndex.Surface( 3 ) == 0 );
+
+	delete separatorInstance;
+	separatorKit->unref();
+}
+
+TEST( PhotonSurfaceIndexTests, TagsTheExportCoordinates )
+{
+	InstanceNode* surface = new InstanceNode( 0 );
+	surface->SetIntersectionTransform( Translation( -1.0, 0.0, 0.0 ) );
+
+	PhotonSurfaceIndex surfaceIndex;
+	surfaceIndex.AddSurface( surface );
+
+	Photon surfacePhoton( Point3D( 2.0, 3.0, 4.0 ), 1, 1, surface );
+	Photon otherPhoton( Point3D( 2.0, 3.0, 4.0 ), 1, 1, 0 );
+
+	surfaceIndex.SetExportCoordinates( false, Translation( 0.0, 0.0, 10.0 ) );
+	surfaceIndex.Tag( &surfacePhoton );
+	surfaceIndex.Tag( &otherPhoton );
+	EXPECT_EQ( 1, surfacePhoton.surfaceId );
+	EXPECT_DOUBLE_EQ( 1.0, surfacePhoton.exportPos.x );
+	EXPECT_DOUBLE_EQ( 4.0, surfacePhoton.exportPos.z );
+	EXPECT_EQ( 0, otherPhoton.surfaceId );
+	EXPECT_DOUBLE_EQ( 2.0, otherPhoton.exportPos.x );
+
+	surfaceIndex.SetExportCoordinates( true, Translation( 0.0, 0.0, 10.0 ) );
+	surfaceIndex.Tag( &surfacePhoton );
+	EXPECT_EQ( 1, surfacePhoton.surfaceId );
+	EXPECT_DOUBLE_EQ( 2.0, surfacePhoton.exportPos.x );
+	EXPECT_DOUBLE_EQ( 14.0, surfacePhoton.exportPos.z );
+
+	delete surface;
+}
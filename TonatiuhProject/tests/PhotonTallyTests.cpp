@@ -0,0 +1,196 @@
+/***************************************************************************
+Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+This file is part of Tonatiuh.
+
+Tonatiuh program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Acknowledgments:
+
+The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+then Chair of the Department of Engineering of the University of Texas at
+Brownsville. From May 2004 to July 2008, it was supported by the Department
+of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+During 2007, NREL also contributed to the validation of Tonatiuh under the
+framework of the Memorandum of Understanding signed with the Spanish
+National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez,
+Juana Amieva, Azael Mancillas, Cesar Cantu.
+***************************************************************************/
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "Photon.h"
+#include "PhotonTally.h"
+#include "Point3D.h"
+
+namespace
+{
+	const int lightSurfaceId = 1;
+
+	/*!
+	 * Appends the photons of a ray to a photons vector as the ray tracer does: a light photon, a photon for
+	 * each reflection and a last photon where the ray is absorbed or leaves the scene.
+	 */
+	class TracedRay
+	{
+
+	public:
+		TracedRay( std::vector< Photon >* photons, double weight = 1.0 )
+		:m_photons( photons ),
+		 m_weight( weight ),
+		 m_rayLength( 0 )
+		{
+			Append( Photon( Point3D( 0.0, 0.0, 0.0 ), 1, 0, 0, 0, m_weight ), lightSurfaceId );
+		}
+
+		void Reflect( int surfaceId, int side, double reflectance = 1.0 )
+		{
+			Append( Photon( Point3D( 0.0, 0.0, 0.0 ), side, ++m_rayLength, 0, 0, m_weight ), surfaceId );
+			m_photons->back().absorbedWeight = ( 1.0 - reflectance ) * m_weight;
+			m_weight *= reflectance;
+		}
+
+		void Absorb( int surfaceId, int side )
+		{
+			Append( Photon( Point3D( 0.0, 0.0, 0.0 ), side, ++m_rayLength, 0, 1, m_weight ), surfaceId );
+		}
+
+		void Leave()
+		{
+			Append( Photon( Point3D( 0.0, 0.0, 0.0 ), 0, ++m_rayLength, 0, 0, m_weight ), 0 );
+		}
+
+	private:
+		void Append( Photon photon, int surfaceId )
+		{
+			photon.surfaceId = surfaceId;
+			m_photons->push_back( photon );
+		}
+
+		std::vector< Photon >* m_photons;
+		double m_weight;
+		int m_rayLength;
+	};
+}
+
+TEST( PhotonTallyTests, CountsThePhotonsBySurfaceAndSide )
+{
+	std::vector< Photon > photons;
+	TracedRay absorbedRay( &photons );
+	absorbedRay.Reflect( 2, 1 );
+	absorbedRay.Absorb( 3, 0 );
+	TracedRay lostRay( &photons );
+	lostRay.Reflect( 2, 1 );
+	lostRay.Reflect( 2, 0 );
+	lostRay.Leave();
+	TracedRay directRay( &photons );
+	directRay.Absorb( 2, 1 );
+
+	PhotonTallyCounts counts;
+	counts.Add( photons );
+
+	EXPECT_EQ( 4, counts.NumberOfSurfaces() );
+	EXPECT_DOUBLE_EQ( 3.0, counts.hits[3] );
+	EXPECT_DOUBLE_EQ( 0.0, counts.absorbedHits[3] );
+	EXPECT_DOUBLE_EQ( 0.0, counts.absorbedWeights[3] );
+
+	EXPECT_DOUBLE_EQ( 3.0, counts.hits[5] );
+	EXPECT_DOUBLE_EQ( 1.0, counts.absorbedHits[5] );
+	EXPECT_DOUBLE_EQ( 3.0, counts.weights[5] );
+	EXPECT_DOUBLE_EQ( 1.0, counts.absorbedWeights[5] );
+	EXPECT_DOUBLE_EQ( 1.0, counts.hits[4] );
+	EXPECT_DOUBLE_EQ( 0.0, counts.absorbedHits[4] );
+
+	EXPECT_DOUBLE_EQ( 1.0, counts.hits[6] );
+	EXPECT_DOUBLE_EQ( 1.0, counts.absorbedHits[6] );
+	EXPECT_DOUBLE_EQ( 1.0, counts.absorbedWeights[6] );
+
+	EXPECT_DOUBLE_EQ( 1.0, counts.hits[0] );
+	EXPECT_DOUBLE_EQ( 0.0, counts.absorbedHits[0] );
+	EXPECT_DOUBLE_EQ( 0.0, counts.absorbedWeights[0] );
+}
+
+TEST( PhotonTallyTests, WeightedReflectionsAbsorbTheWeightTheyLose )
+{
+	std::vector< Photon > photons;
+	TracedRay absorbedRay( &photons );
+	absorbedRay.Reflect( 2, 1, 0.9 );
+	absorbedRay.Reflect( 3, 1, 0.5 );
+	absorbedRay.Absorb( 4, 0 );
+	TracedRay lostRay( &photons );
+	lostRay.Reflect( 2, 1, 0.8 );
+	lostRay.Leave();
+
+	PhotonTallyCounts counts;
+	counts.Add( photons );
+
+	EXPECT_DOUBLE_EQ( 2.0, counts.hits[5] );
+	EXPECT_DOUBLE_EQ( 0.0, counts.absorbedHits[5] );
+	EXPECT_DOUBLE_EQ( 2.0, counts.weights[5] );
+	EXPECT_DOUBLE_EQ( 0.3, counts.absorbedWeights[5] );
+
+	EXPECT_DOUBLE_EQ( 0.9, counts.weights[7] );
+	EXPECT_DOUBLE_EQ( 0.45, counts.absorbedWeights[7] );
+
+	EXPECT_DOUBLE_EQ( 1.0, counts.absorbedHits[8] );
+	EXPECT_DOUBLE_EQ( 0.45, counts.weights[8] );
+	EXPECT_DOUBLE_EQ( 0.45, counts.absorbedWeights[8] );
+
+	//The emitted power is absorbed by the surfaces or leaves the scene
+	double absorbedWeight = 0.0;
+	for( unsigned int i = 2; i < counts.absorbedWeights.size(); ++i )
+		absorbedWeight += counts.absorbedWeights[i];
+	EXPECT_DOUBLE_EQ( counts.weights[3], absorbedWeight + counts.weights[0] );
+}
+
+TEST( PhotonTallyTests, AddTallyMergesAndClearsTheThreadCounts )
+{
+	std::vector< Photon > firstPhotons;
+	TracedRay firstRay( &firstPhotons );
+	firstRay.Absorb( 2, 0 );
+	std::vector< Photon > secondPhotons;
+	TracedRay secondRay( &secondPhotons, 0.25 );
+	secondRay.Reflect( 3, 1 );
+	secondRay.Absorb( 2, 0 );
+
+	PhotonTally tally;
+	PhotonTallyCounts threadCounts;
+	threadCounts.Add( firstPhotons );
+	tally.AddTally( threadCounts );
+	EXPECT_EQ( 0, threadCounts.NumberOfSurfaces() );
+
+	threadCounts.Add( secondPhotons );
+	tally.AddTally( threadCounts );
+
+	PhotonTallyCounts counts = tally.Counts();
+	EXPECT_EQ( 4, counts.NumberOfSurfaces() );
+	EXPECT_DOUBLE_EQ( 2.0, counts.hits[4] );
+	EXPECT_DOUBLE_EQ( 2.0, counts.absorbedHits[4] );
+	EXPECT_DOUBLE_EQ( 1.25, counts.absorbedWeights[4] );
+	EXPECT_DOUBLE_EQ( 0.25, counts.weights[7] );
+	EXPECT_DOUBLE_EQ( 0.0, counts.absorbedWeights[7] );
+
+	tally.Clear();
+	EXPECT_EQ( 0, tally.Counts().NumberOfSurfaces() );
+}
@@ -87,4 +87,15 @@ TEST(PhotonTests, ConstructorFromPhoton){
 	}
 }
 
+TEST(PhotonTests, Weight){
+	Photon defaultPhoton( Point3D( 1.0, 2.0, 3.0 ), 1 );
+	EXPECT_DOUBLE_EQ( 1.0, defaultPhoton.weight );
+
+	Photon weightedPhoton( Point3D( 1.0, 2.0, 3.0 ), 1, 0, 0, 0, 0.25 );
+	EXPECT_DOUBLE_EQ( 0.25, weightedPhoton.weight );
+
+	Photon copiedPhoton( weightedPhoton );
+	EXPECT_DOUBLE_EQ( 0.25, copiedPhoton.weight );
+}
+
 
@@ -0,0 +1,115 @@
+/***************************************************************************
+Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+This file is part of Tonatiuh.
+
+Tonatiuh program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Acknowledgments:
+
+The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+then Chair of the Department of Engineering of the University of Texas at
+Brownsville. From May 2004 to July 2008, it was supported by the Department
+of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+During 2007, NREL also contributed to the validation of Tonatiuh under the
+framework of the Memorandum of Understanding signed with the Spanish
+National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez,
+Juana Amieva, Azael Mancillas, Cesar Cantu.
+***************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include "RandomDeviate.h"
+
+namespace
+{
+	//Pseudo-random generator that returns 0, 1, 2, ...
+	class CountingDeviate : public RandomDeviate
+	{
+	public:
+		CountingDeviate() : RandomDeviate( 4 ), m_next( 0 ) {}
+		void FillArray( double* array, const unsigned long arraySize )
+		{
+			for( unsigned long i = 0; i < arraySize; ++i )	array[i] = m_next++;
+		}
+
+	protected:
+		double m_next;
+	};
+
+	//Quasi-random generator with two dimensions: the coordinate d of the point n is n + d / 10
+	class TwoDimensionalDeviate : public CountingDeviate
+	{
+	public:
+		unsigned int NumberOfDimensions( ) const { return 2; }
+		double SampleCoordinate( unsigned long long sampleIndex, unsigned int dimension ) const
+		{
+			return ( sampleIndex + 0.1 * dimension );
+		}
+	};
+
+	//Generator with substreams: the substream n starts at 100 * n
+	class SubstreamDeviate : public CountingDeviate
+	{
+	public:
+		bool HasSubstreams( ) const { return true; }
+
+	protected:
+		void SetSubstream( unsigned long long substreamIndex ) { m_next = 100.0 * substreamIndex; }
+	};
+}
+
+TEST( RandomDeviateTests, PseudoRandomSamplesFollowTheStream )
+{
+	CountingDeviate rand;
+	EXPECT_EQ( 0u, rand.NumberOfDimensions() );
+	EXPECT_DOUBLE_EQ( 0.0, rand.Sample( 7, 0 ) );
+	EXPECT_DOUBLE_EQ( 1.0, rand.Sample( 7, 1 ) );
+	EXPECT_DOUBLE_EQ( 2.0, rand.RandomDouble() );
+	EXPECT_DOUBLE_EQ( 3.0, rand.Sample( 8, -1 ) );
+}
+
+TEST( RandomDeviateTests, QuasiRandomSamplesUseTheirDimensions )
+{
+	TwoDimensionalDeviate rand;
+	EXPECT_DOUBLE_EQ( 7.0, rand.Sample( 7, 0 ) );
+	EXPECT_DOUBLE_EQ( 7.1, rand.Sample( 7, 1 ) );
+	EXPECT_DOUBLE_EQ( 0.0, rand.Sample( 7, 2 ) );
+	EXPECT_DOUBLE_EQ( 1.0, rand.Sample( 7, -1 ) );
+	EXPECT_DOUBLE_EQ( 7.1, rand.Sample( 7, 1 ) );
+}
+
+TEST( RandomDeviateTests, SubstreamsDiscardTheGeneratedNumbers )
+{
+	SubstreamDeviate rand;
+	EXPECT_DOUBLE_EQ( 0.0, rand.RandomDouble() );
+	EXPECT_TRUE( rand.StartSubstream( 2 ) );
+	EXPECT_DOUBLE_EQ( 200.0, rand.RandomDouble() );
+	EXPECT_TRUE( rand.StartSubstream( 2 ) );
+	EXPECT_DOUBLE_EQ( 200.0, rand.RandomDouble() );
+	EXPECT_DOUBLE_EQ( 201.0, rand.RandomDouble() );
+
+	CountingDeviate stream;
+	EXPECT_DOUBLE_EQ( 0.0, stream.RandomDouble() );
+	EXPECT_FALSE( stream.StartSubstream( 2 ) );
+	EXPECT_DOUBLE_EQ( 1.0, stream.RandomDouble() );
+}
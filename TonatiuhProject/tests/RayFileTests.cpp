@@ -0,0 +1,152 @@
+/***************************************************************************
+Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+This file is part of Tonatiuh.
+
+Tonatiuh program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Acknowledgments:
+
+The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+then Chair of the Department of Engineering of the University of Texas at
+Brownsville. From May 2004 to July 2008, it was supported by the Department
+of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+During 2007, NREL also contributed to the validation of Tonatiuh under the
+framework of the Memorandum of Understanding signed with the Spanish
+National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola,  Gilda Jimenez,
+Juana Amieva, Azael Mancillas, Cesar Cantu.
+***************************************************************************/
+
+#include <vector>
+
+#include <QDir>
+#include <QFile>
+#include <QtConcurrentMap>
+
+#include <gtest/gtest.h>
+
+#include "Ray.h"
+#include "RayFile.h"
+
+namespace
+{
+	/*
+	 * Writes the rays of the chunks thread, thread + threads, ... in decreasing order, as threads
+	 * that finish their chunks in any order. The chunks have ten rays and the ray n has the origin ( n, 0, 0 ).
+	 */
+	struct ChunkWriter
+	{
+		ChunkWriter( RayFile* captureFile, int numberOfThreads, int numberOfChunks )
+		:m_captureFile( captureFile ),
+		 m_numberOfThreads( numberOfThreads ),
+		 m_numberOfChunks( numberOfChunks )
+		{
+
+		}
+
+		typedef void result_type;
+		void operator()( int thread ) const
+		{
+			std::vector< RayFileRecord > records;
+			for( int chunk = m_numberOfChunks - m_numberOfThreads + thread; chunk >= 0; chunk -= m_numberOfThreads )
+			{
+				for( int r = 0; r < 10; ++r )
+				{
+					unsigned long rayIndex = 10 * chunk + r;
+					records.push_back( RayFile::Record( Ray( Point3D( rayIndex, 0.0, 0.0 ), Vector3D( 0.0, 0.0, 1.0 ) ), 1.0, rayIndex ) );
+				}
+				m_captureFile->Write( records );
+			}
+		}
+
+		RayFile* m_captureFile;
+		int m_numberOfThreads;
+		int m_numberOfChunks;
+	};
+}
+
+TEST( RayFileTests, WrittenRaysAreRead )
+{
+	QString fileName = QDir::temp().absoluteFilePath( QLatin1String( "RayFileTests.rays" ) );
+
+	RayFile captureFile;
+	ASSERT_TRUE( captureFile.Create( fileName ) );
+
+	std::vector< RayFileRecord > records;
+	records.push_back( RayFile::Record( Ray( Point3D( 1.0, 2.0, 3.0 ), Vector3D( 0.0, 0.0, 1.0 ) ), 1.0, 7 ) );
+	records.push_back( RayFile::Record( Ray( Point3D( -4.5, 0.25, 100.0 ), Vector3D( 0.6, 0.0, -0.8 ) ), 0.5, 9 ) );
+	captureFile.Write( records );
+	EXPECT_TRUE( records.empty() );
+	ASSERT_TRUE( captureFile.Close( 2.5, 1000 ) );
+
+	{
+		RayFile rayFile;
+		ASSERT_TRUE( rayFile.Open( fileName ) );
+		EXPECT_EQ( rayFile.NumberOfRays(), 2ul );
+		EXPECT_EQ( rayFile.TracedRays(), 1000ul );
+		EXPECT_DOUBLE_EQ( rayFile.PowerPerRay(), 2.5 );
+
+		Ray ray;
+		double weight = 0.0;
+		ASSERT_TRUE( rayFile.ReadRay( 1, &ray, &weight ) );
+		EXPECT_DOUBLE_EQ( ray.origin.x, -4.5 );
+		EXPECT_DOUBLE_EQ( ray.origin.y, 0.25 );
+		EXPECT_DOUBLE_EQ( ray.origin.z, 100.0 );
+		EXPECT_NEAR( ray.direction().x, 0.6, 1e-7 );
+		EXPECT_NEAR( ray.direction().z, -0.8, 1e-7 );
+		EXPECT_DOUBLE_EQ( weight, 0.5 );
+		EXPECT_FALSE( rayFile.ReadRay( 2, &ray, &weight ) );
+	}
+
+	QFile::remove( fileName );
+}
+
+TEST( RayFileTests, RaysAreSortedByRayIndex )
+{
+	QString fileName = QDir::temp().absoluteFilePath( QLatin1String( "RayFileTestsSorted.rays" ) );
+
+	RayFile captureFile;
+	ASSERT_TRUE( captureFile.Create( fileName ) );
+
+	std::vector< int > threads;
+	for( int t = 0; t < 8; ++t )	threads.push_back( t );
+	QtConcurrent::blockingMap( threads, ChunkWriter( &captureFile, 8, 64 ) );
+	ASSERT_TRUE( captureFile.Close( 1.0, 640 ) );
+
+	{
+		RayFile rayFile;
+		ASSERT_TRUE( rayFile.Open( fileName ) );
+		ASSERT_EQ( rayFile.NumberOfRays(), 640ul );
+
+		Ray ray;
+		double weight = 0.0;
+		unsigned long long rayIndex = 0;
+		for( unsigned long r = 0; r < 640; ++r )
+		{
+			ASSERT_TRUE( rayFile.ReadRay( r, &ray, &weight, &rayIndex ) );
+			EXPECT_EQ( r, rayIndex );
+			EXPECT_DOUBLE_EQ( double( r ), ray.origin.x );
+		}
+	}
+
+	QFile::remove( fileName );
+}
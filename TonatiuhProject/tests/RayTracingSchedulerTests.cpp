@@ -0,0 +1,367 @@
+/***************************************************************************
+ Copyright (C) 2008 by the Tonatiuh Software Development Team.
+
+ This file is part of Tonatiuh.
+
+ Tonatiuh program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+ Acknowledgments:
+
+ The development of Tonatiuh was started on 2004 by Dr. Manuel J. Blanco,
+ then Chair of the Department of Engineering of the University of Texas at
+ Brownsville. From May 2004 to July 2008, it was supported by the Department
+ of Energy (DOE) and the National Renewable Energy Laboratory (NREL) under
+ the Minority Research Associate (MURA) Program Subcontract ACQ-4-33623-06.
+ During 2007, NREL also contributed to the validation of Tonatiuh under the
+ framework of the Memorandum of Understanding signed with the Spanish
+ National Renewable Energy Centre (CENER) on February, 20, 2007 (MOU#NREL-07-117).
+ Since June 2006, the development of Tonatiuh is being led by the CENER, under the
+ direction of Dr. Blanco, now Director of CENER Solar Thermal Energy Department.
+
+ Developers: Manuel J. Blanco (mblanco@cener.com), Amaia Mutuberria, Victor Martin.
+
+ Contributors: Javier Garcia-Barberena, Inaki Perez, Inigo Pagola, Gilda Jimenez,
+ Juana Amieva, Azael Mancillas, Cesar Cantu.
+ ***************************************************************************/
+
+#include <vector>
+
+#include <QIcon>
+#include <QMutex>
+#include <QString>
+#include <QFuture>
+#include <QtConcurrentMap>
+#include <QtConcurrentRun>
+#include <QWaitCondition>
+
+#include <gtest/gtest.h>
+
+#include "Photon.h"
+#include "RandomDeviate.h"
+#include "RandomDeviateFactory.h"
+#include "RayTracingScheduler.h"
+#include "TPhotonMap.h"
+
+namespace
+{
+	/*
+	 * Generator that returns the stream index it was created with.
+	 */
+	class StreamDeviate : public RandomDeviate
+	{
+	public:
+		StreamDeviate( unsigned long seed, unsigned long streamIndex )
+		:RandomDeviate( 1 ), m_value( seed + streamIndex )	{ }
+		void FillArray( double* array, const unsigned long arraySize )
+		{
+			for( unsigned long i = 0; i < arraySize; ++i )	array[i] = m_value;
+		}
+
+	private:
+		double m_value;
+	};
+
+	/*
+	 * Generator that returns consecutive numbers from its stream index times one million, as a generator
+	 * without substreams that draws the numbers of a chunk in sequence.
+	 */
+	class SequenceDeviate : public RandomDeviate
+	{
+	public:
+		SequenceDeviate( unsigned long streamIndex )
+		:RandomDeviate( 1 ), m_value( 1000000.0 * streamIndex )	{ }
+		void FillArray( double* array, const unsigned long arraySize )
+		{
+			for( unsigned long i = 0; i < arraySize; ++i )	array[i] = m_value++;
+		}
+
+	private:
+		double m_value;
+	};
+
+	class SequenceDeviateFactory : public RandomDeviateFactory
+	{
+	public:
+		QString RandomDeviateName() const { return QString( "Sequence" ); }
+		QIcon RandomDeviateIcon() const { return QIcon(); }
+		RandomDeviate* CreateRandomDeviate() const { return new SequenceDeviate( 0 ); }
+		RandomDeviate* CreateRandomDeviate( unsigned long, unsigned long streamIndex ) const
+		{
+			return new SequenceDeviate( streamIndex );
+		}
+	};
+
+	/*
+	 * Traces the chunks of the scheduler as RayTracer does: a photon for each ray with a number of the chunk stream.
+	 */
+	struct ChunkTracer
+	{
+		ChunkTracer( TPhotonMap* photonMap, QMutex* photonMapMutex )
+		:m_photonMap( photonMap ),
+		 m_photonMapMutex( photonMapMutex )
+		{
+
+		}
+
+		typedef void result_type;
+		void operator()( RayTracingScheduler* scheduler ) const
+		{
+			unsigned long firstRay = 0;
+			unsigned long numberOfRays = 0;
+			unsigned long chunkIndex = 0;
+			while( scheduler->NextChunk( &firstRay, &numberOfRays, &chunkIndex ) )
+			{
+				RandomDeviate* chunkRand = scheduler->CreateRandomDeviate( chunkIndex );
+				std::vector< Photon > photons;
+				for( unsigned long r = 0; r < numberOfRays; ++r )
+					photons.push_back( Photon( Point3D( firstRay + r, chunkRand->RandomDouble(), 0.0 ), 1 ) );
+				delete chunkRand;
+
+				scheduler->StoreChunk( chunkIndex, numberOfRays, photons, m_photonMap, m_photonMapMutex );
+				scheduler->ChunkFinished( numberOfRays );
+			}
+		}
+
+		TPhotonMap* m_photonMap;
+		QMutex* m_photonMapMutex;
+	};
+
+	/*
+	 * Returns the ray number and the random number of the photons traced with a scheduler of \a numberOfThreads threads.
+	 */
+	std::vector< double > TracePhotons( unsigned long numberOfRays, int numberOfThreads )
+	{
+		SequenceDeviateFactory factory;
+		RayTracingScheduler scheduler( numberOfRays, numberOfThreads );
+		scheduler.SetRandomStreams( &factory, 1, 0, 1 );
+
+		TPhotonMap photonMap;
+		photonMap.SetBufferSize( 2 * numberOfRays );
+		QMutex photonMapMutex;
+		QVector< RayTracingScheduler* > raysPerThread = scheduler.ThreadsList();
+		QtConcurrent::blockingMap( raysPerThread, ChunkTracer( &photonMap, &photonMapMutex ) );
+
+		std::vector< Photon* > photons = photonMap.GetAllPhotons();
+		std::vector< double > values;
+		for( unsigned long p = 0; p < photons.size(); ++p )
+		{
+			values.push_back( photons[p]->pos.x );
+			values.push_back( photons[p]->pos.y );
+		}
+		return ( values );
+	}
+
+	/*
+	 * Returns the index of the next chunk of \a scheduler.
+	 */
+	unsigned long AssignChunk( RayTracingScheduler* scheduler )
+	{
+		unsigned long firstRay = 0;
+		unsigned long numberOfRays = 0;
+		unsigned long chunkIndex = 0;
+		if( !scheduler->NextChunk( &firstRay, &numberOfRays, &chunkIndex ) )	return ( 0 );
+		return ( chunkIndex );
+	}
+
+	/*
+	 * Waits \a milliseconds milliseconds.
+	 */
+	void Sleep( unsigned long milliseconds )
+	{
+		QMutex mutex;
+		QWaitCondition condition;
+		mutex.lock();
+		condition.wait( &mutex, milliseconds );
+		mutex.unlock();
+	}
+
+	class StreamDeviateFactory : public RandomDeviateFactory
+	{
+	public:
+		QString RandomDeviateName() const { return QString( "Stream" ); }
+		QIcon RandomDeviateIcon() const { return QIcon(); }
+		RandomDeviate* CreateRandomDeviate() const { return new StreamDeviate( 0, 0 ); }
+		RandomDeviate* CreateRandomDeviate( unsigned long seed, unsigned long streamIndex ) const
+		{
+			return new StreamDeviate( seed, streamIndex );
+		}
+	};
+}
+
+TEST( RayTracingSchedulerTests, ChunksCoverAllRays )
+{
+	unsigned long numberOfRays = 1234567;
+	RayTracingScheduler scheduler( numberOfRays, 8 );
+
+	unsigned long expectedFirstRay = 0;
+	unsigned long previousChunkSize = numberOfRays;
+	unsigned long firstRay = 0;
+	unsigned long chunkSize = 0;
+	while( scheduler.NextChunk( &firstRay, &chunkSize ) )
+	{
+		EXPECT_EQ( firstRay, expectedFirstRay );
+		EXPECT_GT( chunkSize, 0ul );
+		EXPECT_LE( chunkSize, previousChunkSize );
+
+		expectedFirstRay += chunkSize;
+		previousChunkSize = chunkSize;
+		scheduler.ChunkFinished( chunkSize );
+	}
+
+	EXPECT_EQ( expectedFirstRay, numberOfRays );
+	EXPECT_EQ( scheduler.TracedRays(), numberOfRays );
+}
+
+TEST( RayTracingSchedulerTests, SmallJobsUseAllThreads )
+{
+	RayTracingScheduler scheduler( 100, 8 );
+
+	int numberOfChunks = 0;
+	unsigned long firstRay = 0;
+	unsigned long chunkSize = 0;
+	while( scheduler.NextChunk( &firstRay, &chunkSize ) )	numberOfChunks++;
+
+	EXPECT_GE( numberOfChunks, 8 );
+}
+
+TEST( RayTracingSchedulerTests, CancelStopsAssigningRays )
+{
+	RayTracingScheduler scheduler( 1000000, 4 );
+
+	unsigned long firstRay = 0;
+	unsigned long chunkSize = 0;
+	EXPECT_TRUE( scheduler.NextChunk( &firstRay, &chunkSize ) );
+	scheduler.ChunkFinished( chunkSize );
+
+	scheduler.Cancel();
+	EXPECT_FALSE( scheduler.NextChunk( &firstRay, &chunkSize ) );
+	EXPECT_EQ( scheduler.TracedRays(), chunkSize );
+}
+
+TEST( RayTracingSchedulerTests, ResumedSchedulerRepeatsChunks )
+{
+	unsigned long numberOfRays = 1000000;
+	RayTracingScheduler scheduler( numberOfRays, 4 );
+
+	std::vector< unsigned long > firstRays;
+	std::vector< unsigned long > chunkIndexes;
+	unsigned long firstRay = 0;
+	unsigned long chunkSize = 0;
+	unsigned long chunkIndex = 0;
+	while( scheduler.NextChunk( &firstRay, &chunkSize, &chunkIndex ) )
+	{
+		firstRays.push_back( firstRay );
+		chunkIndexes.push_back( chunkIndex );
+	}
+	ASSERT_GT( firstRays.size(), 4u );
+
+	unsigned long resumedChunk = firstRays.size() / 2;
+	RayTracingScheduler resumed( numberOfRays, 4 );
+	resumed.SetStart( firstRays[resumedChunk], 7 + resumedChunk );
+
+	for( unsigned long c = resumedChunk; c < firstRays.size(); ++c )
+	{
+		ASSERT_TRUE( resumed.NextChunk( &firstRay, &chunkSize, &chunkIndex ) );
+		EXPECT_EQ( firstRay, firstRays[c] );
+		EXPECT_EQ( chunkIndex, 7 + chunkIndexes[c] );
+	}
+	EXPECT_FALSE( resumed.NextChunk( &firstRay, &chunkSize, &chunkIndex ) );
+}
+
+TEST( RayTracingSchedulerTests, ChunksHaveFixedRandomStreams )
+{
+	StreamDeviateFactory factory;
+	RayTracingScheduler scheduler( 1000000, 4 );
+	scheduler.SetRandomStreams( &factory, 1000, 2, 3 );
+	scheduler.SetStart( 0, 5 );
+
+	QMutex photonMapMutex;
+	std::vector< Photon > photons;
+	unsigned long firstRay = 0;
+	unsigned long chunkSize = 0;
+	unsigned long chunkIndex = 0;
+	while( scheduler.NextChunk( &firstRay, &chunkSize, &chunkIndex ) )
+	{
+		RandomDeviate* chunkRand = scheduler.CreateRandomDeviate( chunkIndex );
+		ASSERT_TRUE( chunkRand != 0 );
+		EXPECT_DOUBLE_EQ( 1000.0 + 2 + 3 * chunkIndex, chunkRand->RandomDouble() );
+		delete chunkRand;
+		scheduler.StoreChunk( chunkIndex, chunkSize, photons, 0, &photonMapMutex );
+	}
+	EXPECT_GT( chunkIndex, 5ul );
+}
+
+TEST( RayTracingSchedulerTests, StreamChunksDoNotDependOnTheThreads )
+{
+	unsigned long numberOfRays = 123457;
+	StreamDeviateFactory factory;
+	RayTracingScheduler oneThread( numberOfRays, 1 );
+	oneThread.SetRandomStreams( &factory, 0, 0, 1 );
+	RayTracingScheduler manyThreads( numberOfRays, 16 );
+	manyThreads.SetRandomStreams( &factory, 0, 0, 1 );
+
+	QMutex photonMapMutex;
+	std::vector< Photon > photons;
+	unsigned long firstRay = 0;
+	unsigned long chunkSize = 0;
+	unsigned long chunkIndex = 0;
+	unsigned long expectedFirstRay = 0;
+	unsigned long expectedChunkSize = 0;
+	unsigned long expectedChunkIndex = 0;
+	while( oneThread.NextChunk( &expectedFirstRay, &expectedChunkSize, &expectedChunkIndex ) )
+	{
+		ASSERT_TRUE( manyThreads.NextChunk( &firstRay, &chunkSize, &chunkIndex ) );
+		EXPECT_EQ( expectedFirstRay, firstRay );
+		EXPECT_EQ( expectedChunkSize, chunkSize );
+		EXPECT_EQ( expectedChunkIndex, chunkIndex );
+		oneThread.StoreChunk( expectedChunkIndex, expectedChunkSize, photons, 0, &photonMapMutex );
+		manyThreads.StoreChunk( chunkIndex, chunkSize, photons, 0, &photonMapMutex );
+	}
+	EXPECT_FALSE( manyThreads.NextChunk( &firstRay, &chunkSize, &chunkIndex ) );
+	EXPECT_GE( expectedChunkIndex, 99ul );
+}
+
+TEST( RayTracingSchedulerTests, SeededTracesDoNotDependOnTheThreads )
+{
+	unsigned long numberOfRays = 54321;
+	std::vector< double > oneThread = TracePhotons( numberOfRays, 1 );
+	ASSERT_EQ( 2 * numberOfRays, oneThread.size() );
+	for( unsigned long r = 0; r < numberOfRays; ++r )
+		ASSERT_DOUBLE_EQ( double( r ), oneThread[2 * r] );
+
+	EXPECT_TRUE( oneThread == TracePhotons( numberOfRays, 4 ) );
+	EXPECT_TRUE( oneThread == TracePhotons( numberOfRays, 13 ) );
+}
+
+TEST( RayTracingSchedulerTests, PendingChunksAreBounded )
+{
+	StreamDeviateFactory factory;
+	RayTracingScheduler scheduler( 100000, 1 );
+	scheduler.SetRandomStreams( &factory, 0, 0, 1 );
+
+	//One thread can have four chunks assigned and not stored
+	for( unsigned long c = 0; c < 4; ++c )	ASSERT_EQ( c, AssignChunk( &scheduler ) );
+	QFuture< unsigned long > nextChunk = QtConcurrent::run( AssignChunk, &scheduler );
+
+	QMutex photonMapMutex;
+	std::vector< Photon > photons;
+	for( unsigned long c = 1; c < 4; ++c )	scheduler.StoreChunk( c, 1000, photons, 0, &photonMapMutex );
+	Sleep( 100 );
+	EXPECT_FALSE( nextChunk.isFinished() );
+
+	scheduler.StoreChunk( 0, 1000, photons, 0, &photonMapMutex );
+	EXPECT_EQ( 4ul, nextChunk.result() );
+	for( unsigned long c = 5; c < 8; ++c )	EXPECT_EQ( c, AssignChunk( &scheduler ) );
+}
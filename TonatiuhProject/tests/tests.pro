@@ -6,16 +6,31 @@ QT += xml opengl svg  script network
 
 DEFINES += TEST_DIR=\\\"PWD/../tests\\\"
 
-SOURCES += *.cpp 
+INCLUDEPATH += ../plugins/PhotonMapExportFile/src \
+               ../plugins/ShapeCAD/src
+
+SOURCES += *.cpp \
+           ../plugins/PhotonMapExportFile/src/PhotonChunkCodec.cpp \
+           ../plugins/ShapeCAD/src/MeshLoader.cpp
+
+HEADERS += ../plugins/PhotonMapExportFile/src/PhotonChunkCodec.h \
+           ../plugins/ShapeCAD/src/MeshLoader.h
+
+win32 {
+	LIBS += -lpsapi
+}
            
 CONFIG(debug, debug|release) {
     OBJECTS       +=    $$(TONATIUH_ROOT)/debug/BBox.o \
                         $$(TONATIUH_ROOT)/debug/DifferentialGeometry.o \
+                        $$(TONATIUH_ROOT)/debug/DistributedTrace.o \
                         $$(TONATIUH_ROOT)/debug/Document.o \
                         $$(TONATIUH_ROOT)/debug/InstanceNode.o \
+                        $$(TONATIUH_ROOT)/debug/LightCellSampling.o \
                         $$(TONATIUH_ROOT)/debug/Matrix4x4.o \
                         $$(TONATIUH_ROOT)/debug/moc_Document.o \
                         $$(TONATIUH_ROOT)/debug/moc_ParallelRandomDeviate.o \
+                        $$(TONATIUH_ROOT)/debug/moc_RayTracingScheduler.o \
                         $$(TONATIUH_ROOT)/debug/moc_SceneModel.o \
                         $$(TONATIUH_ROOT)/debug/moc_ScriptRayTracer.o \
                         $$(TONATIUH_ROOT)/debug/NormalVector.o \
@@ -23,10 +38,15 @@ CONFIG(debug, debug|release) {
                         $$(TONATIUH_ROOT)/debug/PathWrapper.o \
                         $$(TONATIUH_ROOT)/debug/Photon.o \
                         $$(TONATIUH_ROOT)/debug/PhotonMapExport.o \
+                        $$(TONATIUH_ROOT)/debug/PhotonMapIndex.o \
+                        $$(TONATIUH_ROOT)/debug/PhotonSurfaceIndex.o \
+                        $$(TONATIUH_ROOT)/debug/PhotonTally.o \
                         $$(TONATIUH_ROOT)/debug/Point3D.o \
                         $$(TONATIUH_ROOT)/debug/PluginManager.o \
+                        $$(TONATIUH_ROOT)/debug/RayFile.o \
                         $$(TONATIUH_ROOT)/debug/RayTracer.o \
                         $$(TONATIUH_ROOT)/debug/RayTracerNoTr.o \
+                        $$(TONATIUH_ROOT)/debug/RayTracingScheduler.o \
                         $$(TONATIUH_ROOT)/debug/RefCount.o \
                         $$(TONATIUH_ROOT)/debug/SceneModel.o \
                         $$(TONATIUH_ROOT)/debug/ScriptRayTracer.o \
@@ -42,6 +62,7 @@ CONFIG(debug, debug|release) {
                         $$(TONATIUH_ROOT)/debug/TMaterial.o \
                         $$(TONATIUH_ROOT)/debug/tonatiuh_script.o \
                         $$(TONATIUH_ROOT)/debug/TPhotonMap.o \
+                        $$(TONATIUH_ROOT)/debug/TraceCheckpoint.o \
                         $$(TONATIUH_ROOT)/debug/Transform.o \
                         $$(TONATIUH_ROOT)/debug/trf.o \
                         $$(TONATIUH_ROOT)/debug/TSceneTracker.o \
@@ -59,11 +80,14 @@ CONFIG(debug, debug|release) {
 else { 
     OBJECTS       +=    $$(TONATIUH_ROOT)/release/BBox.o \
                         $$(TONATIUH_ROOT)/release/DifferentialGeometry.o \
+                        $$(TONATIUH_ROOT)/release/DistributedTrace.o \
                         $$(TONATIUH_ROOT)/release/Document.o \
                         $$(TONATIUH_ROOT)/release/InstanceNode.o \
+                        $$(TONATIUH_ROOT)/release/LightCellSampling.o \
                         $$(TONATIUH_ROOT)/release/Matrix4x4.o \
                         $$(TONATIUH_ROOT)/release/moc_Document.o \
                         $$(TONATIUH_ROOT)/release/moc_ParallelRandomDeviate.o \
+                        $$(TONATIUH_ROOT)/release/moc_RayTracingScheduler.o \
                         $$(TONATIUH_ROOT)/release/moc_SceneModel.o \
                         $$(TONATIUH_ROOT)/release/moc_ScriptRayTracer.o \
                         $$(TONATIUH_ROOT)/release/NormalVector.o \
@@ -71,10 +95,15 @@ else {
                         $$(TONATIUH_ROOT)/release/PathWrapper.o \
                         $$(TONATIUH_ROOT)/release/Photon.o \
                         $$(TONATIUH_ROOT)/release/PhotonMapExport.o \
+                        $$(TONATIUH_ROOT)/release/PhotonMapIndex.o \
+                        $$(TONATIUH_ROOT)/release/PhotonSurfaceIndex.o \
+                        $$(TONATIUH_ROOT)/release/PhotonTally.o \
                         $$(TONATIUH_ROOT)/release/Point3D.o \
                         $$(TONATIUH_ROOT)/release/PluginManager.o \
+                        $$(TONATIUH_ROOT)/release/RayFile.o \
                         $$(TONATIUH_ROOT)/release/RayTracer.o \
                         $$(TONATIUH_ROOT)/release/RayTracerNoTr.o \
+                        $$(TONATIUH_ROOT)/release/RayTracingScheduler.o \
                         $$(TONATIUH_ROOT)/release/RefCount.o \
                         $$(TONATIUH_ROOT)/release/SceneModel.o \
                         $$(TONATIUH_ROOT)/release/ScriptRayTracer.o \
@@ -90,6 +119,7 @@ else {
                         $$(TONATIUH_ROOT)/release/TMaterial.o \
                         $$(TONATIUH_ROOT)/release/tonatiuh_script.o \
                         $$(TONATIUH_ROOT)/release/TPhotonMap.o \
+                        $$(TONATIUH_ROOT)/release/TraceCheckpoint.o \
                         $$(TONATIUH_ROOT)/release/Transform.o \
                         $$(TONATIUH_ROOT)/release/trf.o \
                         $$(TONATIUH_ROOT)/release/TSeparatorKit.o \